@@ -75,13 +75,10 @@ class ButtonBase: public Widget
             int nH = 0;
             for(int nState = 0; nState < 2; ++nState){
                 if(m_TexIDV[nState]){
-                    auto pTexture = g_PNGTexDBN->Retrieve(m_TexIDV[nState]);
-                    if(pTexture){
-                        int nCurrW, nCurrH;
-                        if(!SDL_QueryTexture(pTexture, nullptr, nullptr, &nCurrW, &nCurrH)){
-                            nW = std::max(nCurrW, nW);
-                            nH = std::max(nCurrH, nH);
-                        }
+                    auto stTexture = g_PNGTexDBN->Retrieve(m_TexIDV[nState]);
+                    if(stTexture){
+                        nW = std::max(stTexture.W, nW);
+                        nH = std::max(stTexture.H, nH);
                     }
                 }
             }
@@ -32,6 +32,7 @@ struct ClientEnv
     int  MIR2X_DEBUG;
     bool MIR2X_DEBUG_SHOW_MAP_GRID;
     bool MIR2X_DEBUG_SHOW_CREATURE_COVER;
+    bool MIR2X_DEBUG_SHOW_FRAME_STAT;
 
     ClientEnv()
     {
@@ -39,5 +40,6 @@ struct ClientEnv
 
         MIR2X_DEBUG_SHOW_MAP_GRID       = (MIR2X_DEBUG >= 5) ? true : (std::getenv("MIR2X_DEBUG_SHOW_MAP_GRID"      ) ? true : false);
         MIR2X_DEBUG_SHOW_CREATURE_COVER = (MIR2X_DEBUG >= 5) ? true : (std::getenv("MIR2X_DEBUG_SHOW_CREATURE_COVER") ? true : false);
+        MIR2X_DEBUG_SHOW_FRAME_STAT     = (MIR2X_DEBUG >= 5) ? true : (std::getenv("MIR2X_DEBUG_SHOW_FRAME_STAT"    ) ? true : false);
     }
 };
@@ -190,6 +190,25 @@ bool Creature::EstimatePixelShift(int *pShiftX, int *pShiftY)
     return false;
 }
 
+// current motion from current frame and the whole next motion
+// only done when any of them changes
+void Creature::Prefetch()
+{
+    // it stands after current motion if nothing pending
+    int nNextMotion    = m_MotionQueue.empty() ? MOTION_STAND           : m_MotionQueue.front().Motion;
+    int nNextDirection = m_MotionQueue.empty() ? m_CurrMotion.Direction : m_MotionQueue.front().Direction;
+
+    std::array<int, 4> stSign {{m_CurrMotion.Motion, m_CurrMotion.Direction, nNextMotion, nNextDirection}};
+    if(stSign == m_PrefetchSign){
+        return;
+    }
+
+    PrefetchMotion(m_CurrMotion.Motion, m_CurrMotion.Direction, m_CurrMotion.Frame);
+    PrefetchMotion(nNextMotion, nNextDirection, 0);
+
+    m_PrefetchSign = stSign;
+}
+
 bool Creature::MoveNextMotion()
 {
     if(m_MotionQueue.empty()){
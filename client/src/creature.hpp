@@ -117,6 +117,7 @@
 
 #pragma once
 
+#include <array>
 #include <deque>
 #include <cstddef>
 #include <cstdint>
@@ -145,6 +146,10 @@ class Creature
         double m_UpdateDelay;
         double m_LastUpdateTime;
 
+    protected:
+        // motion/direction of current and next motion last prefetched
+        std::array<int, 4> m_PrefetchSign;
+
     protected:
         Creature(uint32_t nUID, ProcessRun *pRun)
             : m_UID(nUID)
@@ -153,6 +158,7 @@ class Creature
             , m_MotionQueue()
             , m_UpdateDelay(100.0)
             , m_LastUpdateTime(0.0)
+            , m_PrefetchSign {{MOTION_NONE, DIR_NONE, MOTION_NONE, DIR_NONE}}
         {
             assert(m_UID);
             assert(m_ProcessRun);
@@ -199,6 +205,14 @@ class Creature
         virtual bool Draw(int, int) = 0;
         virtual bool Update() = 0;
 
+    public:
+        // let texture database decode frames before drawing them
+        void Prefetch();
+
+    protected:
+        // prefetch frames of (motion, direction) from the given frame
+        virtual void PrefetchMotion(int, int, int) = 0;
+
     protected:
         virtual bool MoveNextMotion();
 
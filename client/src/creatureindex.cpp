@@ -0,0 +1,100 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: creatureindex.cpp
+ *        Created: 06/06/2017 10:40:27
+ *  Last Modified: 06/06/2017 14:50:16
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include "creatureindex.hpp"
+
+void CreatureIndex::Reset(int nH)
+{
+    m_RowV.clear();
+    m_RowV.resize((nH > 0) ? nH : 0);
+    m_LocationMap.clear();
+}
+
+void CreatureIndex::Clear()
+{
+    for(auto &rstRow: m_RowV){
+        rstRow.clear();
+    }
+    m_LocationMap.clear();
+}
+
+void CreatureIndex::Update(uint32_t nUID, Creature *pCreature, int nX, int nY)
+{
+    auto pLocation = m_LocationMap.find(nUID);
+    if(pLocation != m_LocationMap.end()){
+        if(pLocation->second.X == nX && pLocation->second.Y == nY){
+            // most updates, same cell
+            // only need to refresh the pointer
+            for(auto &rstEntry: m_RowV[nY]){
+                if(rstEntry.UID == nUID){
+                    rstEntry.Object = pCreature;
+                    break;
+                }
+            }
+            return;
+        }
+        Remove(nUID);
+    }
+
+    if(!(pCreature && nX >= 0 && nY >= 0 && nY < (int)(m_RowV.size()))){
+        return;
+    }
+
+    auto &rstRow = m_RowV[nY];
+    auto pInsert = std::upper_bound(rstRow.begin(), rstRow.end(), Entry {nX, nUID, nullptr}, [](const Entry &rstLHS, const Entry &rstRHS) -> bool
+    {
+        return (rstLHS.X < rstRHS.X) || (rstLHS.X == rstRHS.X && rstLHS.UID < rstRHS.UID);
+    });
+
+    rstRow.insert(pInsert, {nX, nUID, pCreature});
+    m_LocationMap[nUID] = {nX, nY};
+}
+
+void CreatureIndex::Remove(uint32_t nUID)
+{
+    auto pLocation = m_LocationMap.find(nUID);
+    if(pLocation == m_LocationMap.end()){
+        return;
+    }
+
+    auto &rstRow = m_RowV[pLocation->second.Y];
+    for(auto pEntry = rstRow.begin(); pEntry != rstRow.end(); ++pEntry){
+        if(pEntry->UID == nUID){
+            rstRow.erase(pEntry);
+            break;
+        }
+    }
+    m_LocationMap.erase(pLocation);
+}
+
+bool CreatureIndex::Has(int nX, int nY) const
+{
+    for(auto &rstEntry: Row(nY)){
+        if(rstEntry.X == nX){
+            return true;
+        }
+
+        if(rstEntry.X > nX){
+            break;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,84 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: creatureindex.hpp
+ *        Created: 06/06/2017 10:14:32
+ *  Last Modified: 06/06/2017 14:51:09
+ *
+ *    Description: creatures bucketed by cell for drawing, one bucket per row, sorted
+ *                 by x, then walking a row with a cursor gives creatures of each cell
+ *                 in painter order, every creature is visited once per frame
+ *
+ *                 location of each creature is cached, Update() only moves it when
+ *                 its cell changes, call it after anything may move the creature
+ *
+ *                 creatures out of the map, i.e. Location() failed, are not indexed
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+class Creature;
+class CreatureIndex final
+{
+    public:
+        struct Entry
+        {
+            int X;
+            uint32_t UID;
+            Creature *Object;
+        };
+
+    private:
+        struct Location
+        {
+            int X;
+            int Y;
+        };
+
+    private:
+        std::vector<std::vector<Entry>> m_RowV;
+        std::unordered_map<uint32_t, Location> m_LocationMap;
+
+    public:
+        CreatureIndex()
+            : m_RowV()
+            , m_LocationMap()
+        {}
+
+       ~CreatureIndex() = default;
+
+    public:
+        // for a new map with nH rows
+        void Reset(int);
+
+        // remove all creatures, keep rows
+        void Clear();
+
+    public:
+        void Update(uint32_t, Creature *, int, int);
+        void Remove(uint32_t);
+
+    public:
+        bool Has(int, int) const;
+
+    public:
+        // entries in row nY, sorted by (X, UID)
+        const std::vector<Entry> &Row(int nY) const
+        {
+            static const std::vector<Entry> stEmptyRow {};
+            return (nY >= 0 && nY < (int)(m_RowV.size())) ? m_RowV[nY] : stEmptyRow;
+        }
+};
@@ -202,4 +202,10 @@ class EmoticonDB: public InnDB<uint32_t, EmoticonItem, LCDeepN, LCLenN, ResMaxN>
                 SDL_DestroyTexture(stItem.Texture);
             }
         }
+
+        size_t ResourceSize(const EmoticonItem &rstItem)
+        {
+            extern SDLDevice *g_SDLDevice;
+            return g_SDLDevice->TextureBytes(rstItem.Texture);
+        }
 };
@@ -26,6 +26,7 @@
 
 #include "inndb.hpp"
 #include "hexstring.hpp"
+#include "sdldevice.hpp"
 
 
 enum FontStyle: uint8_t{
@@ -301,4 +302,10 @@ class FontexDB: public InnDB<FontexDBKT, FontexItem, LCDeepN, LCLenN, ResMaxN>
                 SDL_DestroyTexture(stItem.Texture);
             }
         }
+
+        size_t ResourceSize(const FontexItem &rstItem)
+        {
+            extern SDLDevice *g_SDLDevice;
+            return g_SDLDevice->TextureBytes(rstItem.Texture);
+        }
 };
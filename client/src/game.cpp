@@ -20,10 +20,13 @@
 
 #include <thread>
 #include <future>
+#include <limits>
+#include <algorithm>
 
 #include "log.hpp"
 #include "game.hpp"
 #include "xmlconf.hpp"
+#include "sdldevice.hpp"
 #include "pngtexdbn.hpp"
 #include "fontexdbn.hpp"
 #include "pngtexoffdbn.hpp"
@@ -32,6 +35,7 @@ Game::Game()
     : m_FPS(30.0)
     , m_ServerDelay( 0.00)
     , m_NetPackTick(-1.00)
+    , m_UploadBudget( 4.00)
     , m_CurrentProcess(nullptr)
 {
     // fullfil the time cq
@@ -82,6 +86,57 @@ Game::Game()
     }
     g_Log->AddLog(LOGTYPE_INFO, "HeroGfxDBN path: %s", pNode->GetText());
     g_HeroGfxDBN->Load(pNode->GetText());
+
+    // pack textures into atlas pages, 0 to disable
+    // page size is limited by the renderer
+    {
+        extern SDLDevice *g_SDLDevice;
+        int nPageSize = 0;
+        g_XMLConf->NodeAtoi("Root/Texture/AtlasPageSize", &nPageSize, 2048);
+        nPageSize = std::min<int>(nPageSize, g_SDLDevice->MaxTextureSize());
+
+        g_Log->AddLog(LOGTYPE_INFO, "Texture atlas page size: %d", nPageSize);
+        g_PNGTexDBN->EnableAtlas(nPageSize);
+        g_HeroGfxDBN->EnableAtlas(nPageSize);
+        g_PNGTexOffDBN->EnableAtlas(nPageSize);
+    }
+
+    // decode textures in background, main thread only uploads them
+    // with a time budget of each frame
+    {
+        int nAsyncDecode  = 0;
+        int nPrefetchMax  = 0;
+        int nUploadBudget = 0;
+
+        g_XMLConf->NodeAtoi("Root/Texture/AsyncDecode",  &nAsyncDecode,  1   );
+        g_XMLConf->NodeAtoi("Root/Texture/PrefetchMax",  &nPrefetchMax,  1024);
+        g_XMLConf->NodeAtoi("Root/Texture/UploadBudget", &nUploadBudget, 4   );
+
+        nPrefetchMax   = std::max<int>(nPrefetchMax, 0);
+        m_UploadBudget = std::max<int>(nUploadBudget, 0) * 1.0;
+
+        g_Log->AddLog(LOGTYPE_INFO, "Texture async decoding: %d, prefetch max: %d, upload budget: %dms", nAsyncDecode, nPrefetchMax, nUploadBudget);
+        g_PNGTexDBN->EnableDecoder(nAsyncDecode != 0, nPrefetchMax);
+        g_HeroGfxDBN->EnableDecoder(nAsyncDecode != 0, nPrefetchMax);
+        g_PNGTexOffDBN->EnableDecoder(nAsyncDecode != 0, nPrefetchMax);
+    }
+
+    // video memory in MB each database can keep, 0 for no limit
+    // textures in linear cache are never evicted, so it's a soft limit
+    {
+        int nCacheBudget = 0;
+        g_XMLConf->NodeAtoi("Root/Texture/CacheBudget", &nCacheBudget, 128);
+
+        size_t nByteBudget = std::numeric_limits<size_t>::max();
+        if(nCacheBudget > 0){
+            nByteBudget = (size_t)(nCacheBudget) * 1024 * 1024;
+        }
+
+        g_Log->AddLog(LOGTYPE_INFO, "Texture cache budget: %dMB", nCacheBudget);
+        g_PNGTexDBN->ByteBudget(nByteBudget);
+        g_HeroGfxDBN->ByteBudget(nByteBudget);
+        g_PNGTexOffDBN->ByteBudget(nByteBudget);
+    }
 }
 
 Game::~Game()
@@ -100,6 +155,19 @@ void Game::ProcessEvent()
 
 void Game::Update(double fDeltaMS)
 {
+    // textures decoded in background
+    // each database uploads at least one if there is any
+    {
+        extern PNGTexDBN    *g_PNGTexDBN;
+        extern PNGTexOffDBN *g_HeroGfxDBN;
+        extern PNGTexOffDBN *g_PNGTexOffDBN;
+
+        auto fStartMS = GetTimeTick();
+        g_PNGTexDBN->Upload(m_UploadBudget);
+        g_HeroGfxDBN->Upload(std::max<double>(0.0, m_UploadBudget - (GetTimeTick() - fStartMS)));
+        g_PNGTexOffDBN->Upload(std::max<double>(0.0, m_UploadBudget - (GetTimeTick() - fStartMS)));
+    }
+
     if(m_CurrentProcess){
         m_CurrentProcess->Update(fDeltaMS);
     }
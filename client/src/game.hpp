@@ -15,6 +15,7 @@ class Game
         double m_FPS;
         double m_ServerDelay;
         double m_NetPackTick;
+        double m_UploadBudget;
 
     private:
         std::atomic<bool> m_LoginOK;
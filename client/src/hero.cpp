@@ -18,6 +18,7 @@
  * =====================================================================================
  */
 
+#include <algorithm>
 #include "log.hpp"
 #include "hero.hpp"
 #include "mathfunc.hpp"
@@ -76,24 +77,23 @@ bool Hero::Draw(int nViewX, int nViewY)
     int nDY1 = 0;
 
     extern PNGTexOffDBN *g_HeroGfxDBN;
-    auto pFrame0 = g_HeroGfxDBN->Retrieve(nKey0, &nDX0, &nDY0);
-    auto pFrame1 = g_HeroGfxDBN->Retrieve(nKey1, &nDX1, &nDY1);
+    auto stFrame0 = g_HeroGfxDBN->RetrieveAsync(nKey0, &nDX0, &nDY0, nullptr);
+    auto stFrame1 = g_HeroGfxDBN->RetrieveAsync(nKey1, &nDX1, &nDY1, nullptr);
 
     int nShiftX = 0;
     int nShiftY = 0;
     EstimatePixelShift(&nShiftX, &nShiftY);
 
     extern SDLDevice *g_SDLDevice;
-    if(pFrame1){ SDL_SetTextureAlphaMod(pFrame1, 128); }
-    g_SDLDevice->DrawTexture(pFrame1, X() * SYS_MAPGRIDXP + nDX1 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY1 - nViewY + nShiftY);
-    g_SDLDevice->DrawTexture(pFrame0, X() * SYS_MAPGRIDXP + nDX0 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY0 - nViewY + nShiftY);
+    g_SDLDevice->DrawTexture(stFrame1, X() * SYS_MAPGRIDXP + nDX1 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY1 - nViewY + nShiftY, MakeColor(255, 255, 255, 128));
+    g_SDLDevice->DrawTexture(stFrame0, X() * SYS_MAPGRIDXP + nDX0 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY0 - nViewY + nShiftY);
 
     extern PNGTexDBN *g_PNGTexDBN;
-    auto pBar0 = g_PNGTexDBN->Retrieve(0XFF0014);
-    auto pBar1 = g_PNGTexDBN->Retrieve(0XFF0015);
+    auto stBar0 = g_PNGTexDBN->Retrieve(0XFF0014);
+    auto stBar1 = g_PNGTexDBN->Retrieve(0XFF0015);
 
-    g_SDLDevice->DrawTexture(pBar0, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
-    g_SDLDevice->DrawTexture(pBar1, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
+    g_SDLDevice->DrawTexture(stBar0, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
+    g_SDLDevice->DrawTexture(stBar1, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
 
     return true;
 }
@@ -442,8 +442,13 @@ bool Hero::ActionValid(const ActionNode &rstAction)
 
 size_t Hero::MotionFrameCount()
 {
-    if(GfxID(m_DressID, m_CurrMotion.Motion, m_CurrMotion.Direction) >= 0){
-        switch(m_CurrMotion.Motion){
+    return MotionFrameCount(m_CurrMotion.Motion, m_CurrMotion.Direction);
+}
+
+size_t Hero::MotionFrameCount(int nMotion, int nDirection)
+{
+    if(GfxID(m_DressID, nMotion, nDirection) >= 0){
+        switch(nMotion){
             case MOTION_STAND       : { return 4; }
             case MOTION_WALK        : { return 6; }
             case MOTION_RUN         : { return 6; }
@@ -453,6 +458,21 @@ size_t Hero::MotionFrameCount()
     }else{ return 0; }
 }
 
+void Hero::PrefetchMotion(int nMotion, int nDirection, int nFrame)
+{
+    auto nGfxID = GfxID(m_DressID, nMotion, nDirection);
+    if(nGfxID < 0){
+        return;
+    }
+
+    // same keys as Draw(), body and shadow
+    extern PNGTexOffDBN *g_HeroGfxDBN;
+    for(int nIndex = std::max<int>(nFrame, 0); nIndex < (int)(MotionFrameCount(nMotion, nDirection)); ++nIndex){
+        g_HeroGfxDBN->Prefetch(((uint32_t)(0) << 23) + (((uint32_t)(m_Male ? 1 : 0)) << 22) + (((uint32_t)(nGfxID & 0X01FF)) << 5) + nIndex);
+        g_HeroGfxDBN->Prefetch(((uint32_t)(1) << 23) + (((uint32_t)(m_Male ? 1 : 0)) << 22) + (((uint32_t)(nGfxID & 0X01FF)) << 5) + nIndex);
+    }
+}
+
 bool Hero::Moving()
 {
     return false
@@ -82,6 +82,10 @@ class Hero: public Creature
 
     public:
         size_t MotionFrameCount();
+        size_t MotionFrameCount(int, int);
+
+    protected:
+        void PrefetchMotion(int, int, int);
 
     public:
         bool ValidG()
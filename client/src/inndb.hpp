@@ -8,7 +8,7 @@
  *    Description: base of all Int->Tex map cache
  *
  *                 Internal Database support for 
- *                 1. FIFO
+ *                 1. CLOCK eviction against a byte budget and a count limit
  *                 2. Double level cache
  *                 3. Easy for extension
  *
@@ -18,6 +18,7 @@
  *                 to instantiation this class
  *                 1. define LoadResource()
  *                 2. define FreeResource()
+ *                 3. define ResourceSize(), in bytes, for the budget
  *
  *                 I don't make a virtual API for Load(const char *) since if we have
  *                 a Load(), we may also need a Valid(), and RAII may also make this 
@@ -39,11 +40,22 @@
 #pragma once
 #include <utility>
 #include <tuple>
-#include <queue>
+#include <limits>
+#include <vector>
 #include <unordered_map>
 #include "cachequeue.hpp"
 #include <functional>
 
+// counters of one database
+// Hit/Miss/Evict are accumulated since creation
+typedef struct{
+    size_t Hit;     // found in linear cache or main cache
+    size_t Miss;    // LoadResource() called
+    size_t Evict;   // freed to keep the cache under its limits
+    size_t Bytes;   // ResourceSize() of all resources currently cached
+    size_t Count;   // resources currently cached, null ones included
+}InnDBStat;
+
 // because for PNGTexOffDB, the offset and texture are both important
 // otherwise I could only put a ``SDL_Texture *" here instead of ResT
 //
@@ -55,25 +67,46 @@ template<typename KeyT, // key type, can only be unsigned intergal, so no refere
     size_t LCDeepN, size_t LCLenN, size_t ResMaxN>
 class InnDB
 {
+    private:
+        typedef struct{
+            ResT   Resource;
+            size_t Size;
+
+            // CLOCK reference bit
+            // set when accessed, cleared when the hand passes by
+            bool Referenced;
+        }CacheNode;
+
     private:
         // linear cache
-        std::array<CacheQueue<std::tuple<ResT, unsigned long, KeyT>, LCDeepN>, LCLenN> m_LCache;
+        std::array<CacheQueue<std::tuple<ResT, KeyT>, LCDeepN>, LCLenN> m_LCache;
 
         // main cache
-        std::unordered_map<KeyT, std::pair<unsigned long, ResT>> m_Cache;
+        std::unordered_map<KeyT, CacheNode> m_Cache;
+
+        // CLOCK ring, all keys in m_Cache, order doesn't matter
+        // the hand points to the next one to check
+        std::vector<KeyT> m_ClockV;
+        size_t            m_ClockHand;
 
-        // time stamp queue
-        std::queue<std::tuple<unsigned long, KeyT>>  m_TimeStampQ;
+        size_t m_ResourceMaxCount;
+        size_t m_ByteBudget;
 
-        size_t        m_ResourceMaxCount;
-        size_t        m_ResourceCount;
-        unsigned long m_CurrentTime;
+        // nothing is evicted while it's non-zero
+        size_t m_HoldCount;
+
+        InnDBStat m_Stat;
 
     public:
         InnDB()
-            : m_ResourceMaxCount(ResMaxN)
-            , m_ResourceCount(0)
-            , m_CurrentTime(0)
+            : m_LCache()
+            , m_Cache()
+            , m_ClockV()
+            , m_ClockHand(0)
+            , m_ResourceMaxCount(ResMaxN)
+            , m_ByteBudget(std::numeric_limits<size_t>::max())
+            , m_HoldCount(0)
+            , m_Stat {0, 0, 0, 0, 0}
         {
             static_assert(std::is_unsigned<KeyT>::value,
                     "unsigned intergal type supported only please");
@@ -98,8 +131,11 @@ class InnDB
         // function handler or pure virtual function for LoadResource() doesn't mater
         // we define it as pure virtual for conformming with FreeResource()
         //
-        virtual ResT LoadResource(KeyT)   = 0;
-        virtual void FreeResource(ResT &) = 0;
+        // ResourceSize() is called once when the resource is loaded
+        //
+        virtual ResT   LoadResource(KeyT)           = 0;
+        virtual void   FreeResource(ResT &)         = 0;
+        virtual size_t ResourceSize(const ResT &)   = 0;
 
         void ClearLC()
         {
@@ -118,9 +154,15 @@ class InnDB
             for(auto &stRecord: m_Cache){
                 // TODO
                 // important to make it pure virtual for derived class to define it
-                FreeResource(stRecord.second.second);
+                FreeResource(stRecord.second.Resource);
             }
             m_Cache.clear();
+
+            m_ClockV.clear();
+            m_ClockHand = 0;
+
+            m_Stat.Bytes = 0;
+            m_Stat.Count = 0;
         }
 
     public:
@@ -130,6 +172,49 @@ class InnDB
             return LCLenN > 0 && LCDeepN > 0;
         }
 
+        // only check if the key has a record, even a null one
+        // won't load it and won't touch the reference bit
+        bool InnCached(KeyT nKey) const
+        {
+            return m_Cache.find(nKey) != m_Cache.end();
+        }
+
+    public:
+        const InnDBStat &Stat() const
+        {
+            return m_Stat;
+        }
+
+        size_t ByteBudget() const
+        {
+            return m_ByteBudget;
+        }
+
+        // takes effect when next resource is loaded
+        // resource larger than the budget is still kept till next loading
+        void ByteBudget(size_t nByteBudget)
+        {
+            m_ByteBudget = nByteBudget;
+        }
+
+    public:
+        // keep all retrieved resources alive till ReleaseEviction()
+        // for callers which queue resources and use them later, i.e. draw batch
+        // eviction is deferred to the first loading after release, calls can nest
+        void HoldEviction()
+        {
+            m_HoldCount++;
+        }
+
+        void ReleaseEviction()
+        {
+            if(m_HoldCount){
+                m_HoldCount--;
+            }
+        }
+
+    public:
+
         // internal retrieve function, for derived class use only
         // when retrieved successfully:
         //      when there is LC enabled, m_LCache[*pLCBucketIndex].Head() is the current result
@@ -162,13 +247,6 @@ class InnDB
                 const std::function<size_t(KeyT)> &fnLinearCacheKey,
                 size_t *pLCBucketIndex)
         {
-            // everytime when call this function
-            // there must be a resource retrieved responding to nKey
-            // even if it's null, so update time stamp at each time
-            //
-            // overflow will be handled
-            m_CurrentTime++;
-
             // if linear cache is enabled
             // then first try to retrieve from linear cache
             //
@@ -183,26 +261,22 @@ class InnDB
                     // find resource in LC, good!
                     //
                     // 1. move the record in LC to its head
-                    m_LCache[nLCacheKey].SwapHead(nLocationInLC);
-
-                    // 2. update access time stamp in LC *only*
                     //    *important*:
-                    //    didn't update the access time in hash map Cache!
-                    std::get<1>(m_LCache[nLCacheKey].Head()) = m_CurrentTime;
-
-                    // 3. push the access stamp at the end of the time stamp queue
-                    m_TimeStampQ.emplace(m_CurrentTime, nKey);
+                    //    didn't touch the reference bit in m_Cache, record in LC
+                    //    won't be evicted, and the bit is set when it leaves LC
+                    m_LCache[nLCacheKey].SwapHead(nLocationInLC);
 
-                    // 4. return the bucket index
+                    // 2. return the bucket index
                     if(pLCBucketIndex){
                         *pLCBucketIndex = nLocationInLC;
                     }
 
-                    // 5. return the resource
+                    // 3. return the resource
                     if(pResource){
                         *pResource = std::get<0>(m_LCache[nLCacheKey].Head());
                     }
 
+                    m_Stat.Hit++;
                     return true;
                 }
             }
@@ -215,45 +289,20 @@ class InnDB
                 // we find it in m_Cache, OK...
 
                 // 1. Put a record in LC if necessary
-                //
-                //    but when LC is full, insertion of a record causes to drop another
-                //    old record, we need to update the resource access time w.r.t the 
-                //    to-drop record, since whenever there is a record in LC, access time
-                //    in m_Cache won't be updated.
                 if(UseLC()){
-
-                    // since the old record is in LC, it must exist in m_Cache
-                    // update its time stamp
-                    //
-                    if(m_LCache[nLCacheKey].Full()){
-                        m_Cache[std::get<2>(m_LCache[nLCacheKey].Back())].first // in hashmap and LC
-                            = std::get<1>(m_LCache[nLCacheKey].Back());         // update it's time stamp
-                    }
-
-                    // set pLCBucketIndex if necessary
-                    if(pLCBucketIndex){
-                        *pLCBucketIndex = nLCacheKey;
-                    }
-
-                    // now insert the record to LC
-                    // if it's full, the back() is overwrited as new head
-                    //
-                    m_LCache[nLCacheKey].PushHead(pTextureInst->second.second, m_CurrentTime, nKey);
+                    PushLC(nLCacheKey, nKey, pTextureInst->second.Resource, pLCBucketIndex);
                 }
 
-                // 2. set access time in m_Cache
-                //
-                pTextureInst->second.first = m_CurrentTime;
-
-                // 3. push the access stamp at the end of the time stamp queue
+                // 2. mark it as accessed
                 //
-                m_TimeStampQ.emplace(m_CurrentTime, nKey);
+                pTextureInst->second.Referenced = true;
 
-                // 4. return the resource pointer
+                // 3. return the resource pointer
                 if(pResource){
-                    *pResource = pTextureInst->second.second;
+                    *pResource = pTextureInst->second.Resource;
                 }
 
+                m_Stat.Hit++;
                 return true;
             }
 
@@ -267,43 +316,28 @@ class InnDB
             // sink into m_Cache quickly
             //
             ResT stResource = LoadResource(nKey);
+            m_Stat.Miss++;
 
             // 1. Put a record in LC if necessary
-            //    same here, we need to handle when LC is full in one box
             //
             if(UseLC()){
-
-                // since the old record is in LC, it must exist in m_Cache
-                // update its time stamp
-                //
-                if(m_LCache[nLCacheKey].Full()){
-                    m_Cache[std::get<2>(m_LCache[nLCacheKey].Back())].first
-                        = std::get<1>(m_LCache[nLCacheKey].Back());
-                }
-
-                // set pLCBucketIndex if necessary
-                if(pLCBucketIndex){
-                    *pLCBucketIndex = nLCacheKey;
-                }
-
-                // now insert the record to LC
-                m_LCache[nLCacheKey].PushHead(stResource, m_CurrentTime, nKey);
+                PushLC(nLCacheKey, nKey, stResource, pLCBucketIndex);
             }
 
-            // 2. put the resource in m_Cache
+            // 2. put the resource in m_Cache and the CLOCK ring
             //
-            m_Cache[nKey] = {m_CurrentTime, stResource};
+            size_t nSize = ResourceSize(stResource);
+            m_Cache[nKey] = {stResource, nSize, true};
+            m_ClockV.push_back(nKey);
 
-            // 3. push the access stamp at the end of the time stamp queue
-            //
-            m_TimeStampQ.emplace(m_CurrentTime, nKey);
+            m_Stat.Bytes += nSize;
+            m_Stat.Count++;
 
-            // 4. reset the size of the cache
-            // 
-            m_ResourceCount++;
-            Resize(fnLinearCacheKey);
+            // 3. evict others if over the limits
+            //
+            Resize(nKey, fnLinearCacheKey);
 
-            // 5. return the resource pointer
+            // 4. return the resource pointer
             if(pResource){
                 *pResource = stResource;
             }
@@ -314,64 +348,84 @@ class InnDB
 
     private:
 
-        // keep the size under m_ResourceMaxCount
-        void Resize(const std::function<size_t(KeyT)> &fnLinearCacheKey)
+        // put a record at head of the LC bucket
+        // when the bucket is full the back one is dropped, it's still in m_Cache, and
+        // since it was accessed recently, give it the reference bit
+        void PushLC(size_t nLCacheKey, KeyT nKey, const ResT &rstResource, size_t *pLCBucketIndex)
         {
-            while(m_ResourceCount > m_ResourceMaxCount){
-                // won't happen actually
-                if(m_TimeStampQ.empty()){ break; }
-
-                // may or may not release one resource
-                ReleaseResource(std::get<1>(m_TimeStampQ.front()),
-                        std::get<0>(m_TimeStampQ.front()), fnLinearCacheKey); 
-                // always pop front by one after trid to release resource
-                m_TimeStampQ.pop();
+            if(m_LCache[nLCacheKey].Full()){
+                m_Cache[std::get<1>(m_LCache[nLCacheKey].Back())].Referenced = true;
             }
+
+            // set pLCBucketIndex if necessary
+            if(pLCBucketIndex){
+                *pLCBucketIndex = nLCacheKey;
+            }
+
+            // now insert the record to LC
+            // if it's full, the back() is overwrited as new head
+            //
+            m_LCache[nLCacheKey].PushHead(rstResource, nKey);
         }
 
-        // when calling this function, the nKey
-        //
-        // 1. shouldn't be in linear cache
+        // keep the cache under m_ResourceMaxCount and m_ByteBudget
         //
-        // 2. it must be in m_Cache, only exception is m_CurrentTime overflowed
-        //      a) when there is no overflow, everytime when free a resource, we compare the time
-        //         if the time in m_Cache != time with the record in the queue, means there is 
-        //         accessing later, so we keep it. other wise we free it.
+        // CLOCK: the hand sweeps the ring, a referenced record gets a second chance by
+        // clearing its bit, records in LC and nKey just loaded are skipped, evict the
+        // first one found otherwise
         //
-        //      b) when there is overflow, think about this scenario:
-        //         current node in time stamp queue is at time k, but the last accessing time of the
-        //         resource is at (k + max) = k, then it's equal, and we release it incorrectly
-        //         
-        void ReleaseResourceByTimeStamp(KeyT nKey, unsigned long nTimeStamp)
+        // each step is O(1), the hole of an evicted one is filled by the last in the
+        // ring, gives up after two rounds if all left are in LC
+        void Resize(KeyT nKey, const std::function<size_t(KeyT)> &fnLinearCacheKey)
         {
-            auto pResInst = m_Cache.find(nKey);
-            // to handle the overflow problem, otherwise we don't need this check
-            if(pResInst != m_Cache.end()){
-                if(pResInst->second.first == nTimeStamp){
-                    FreeResource(pResInst->second.second);
-                    m_Cache.erase(pResInst);
-
-                    m_ResourceCount--;
-                }
+            if(m_HoldCount){
+                return;
             }
-        }
 
-        void ReleaseResource(KeyT nKey,
-                unsigned long nTimeStamp, const std::function<size_t(KeyT)> &fnLinearCacheKey)
-        {
-            // first make sure that the resource is not in LC
-            // return directly if yes
-            if(UseLC() && LocateInLinearCache(fnLinearCacheKey(nKey), nKey, nullptr)){ return; }
+            // bound fixed at start, the ring shrinks while evicting
+            // it can be far over the limits after eviction was held
+            size_t nStep    = 0;
+            size_t nMaxStep = 2 * m_ClockV.size();
+            while(true
+                    && (m_Stat.Count > m_ResourceMaxCount || m_Stat.Bytes > m_ByteBudget)
+                    && (nStep++ < nMaxStep)){
+
+                if(m_ClockHand >= m_ClockV.size()){
+                    m_ClockHand = 0;
+                }
+
+                auto nCurrKey = m_ClockV[m_ClockHand];
+                if(false
+                        || (nCurrKey == nKey)
+                        || (UseLC() && LocateInLinearCache(fnLinearCacheKey(nCurrKey), nCurrKey, nullptr))){
+                    m_ClockHand++;
+                    continue;
+                }
 
-            // not in LC, release resource if (most likely) in the cache
-            ReleaseResourceByTimeStamp(nKey, nTimeStamp);
+                // it must be in m_Cache
+                auto pResInst = m_Cache.find(nCurrKey);
+                if(pResInst->second.Referenced){
+                    pResInst->second.Referenced = false;
+                    m_ClockHand++;
+                    continue;
+                }
+
+                FreeResource(pResInst->second.Resource);
+                m_Stat.Bytes -= pResInst->second.Size;
+                m_Stat.Count--;
+                m_Stat.Evict++;
+                m_Cache.erase(pResInst);
+
+                m_ClockV[m_ClockHand] = m_ClockV.back();
+                m_ClockV.pop_back();
+            }
         }
 
         // assume UseLC() is true, parameters should be checked before invocation
         bool LocateInLinearCache(int nLCKey, KeyT nKey, size_t *pLocationInLC)
         {
             for(m_LCache[nLCKey].Reset(); !m_LCache[nLCKey].Done(); m_LCache[nLCKey].Forward()){
-                if(std::get<2>(m_LCache[nLCKey].Current()) == nKey){
+                if(std::get<1>(m_LCache[nLCKey].Current()) == nKey){
                     if(pLocationInLC){
                         *pLocationInLC = m_LCache[nLCKey].Index();
                     }
@@ -51,11 +51,15 @@ int main()
         delete g_Log         ; g_Log         = nullptr;
         delete g_ClientEnv   ; g_ClientEnv   = nullptr;
         delete g_XMLConf     ; g_XMLConf     = nullptr;
-        delete g_SDLDevice   ; g_SDLDevice   = nullptr;
         delete g_PNGTexDBN   ; g_PNGTexDBN   = nullptr;
         delete g_HeroGfxDBN  ; g_HeroGfxDBN  = nullptr;
+        delete g_PNGTexOffDBN; g_PNGTexOffDBN= nullptr;
         delete g_FontexDBN   ; g_FontexDBN   = nullptr;
         delete g_EmoticonDBN ; g_EmoticonDBN = nullptr;
+
+        // textures and atlas pages are freed in above
+        // they need the renderer
+        delete g_SDLDevice   ; g_SDLDevice   = nullptr;
         delete g_Game        ; g_Game        = nullptr;
     };
 
@@ -17,6 +17,7 @@
  *
  * =====================================================================================
  */
+#include <algorithm>
 #include <SDL2/SDL.h>
 
 #include "log.hpp"
@@ -77,24 +78,23 @@ bool Monster::Draw(int nViewX, int nViewY)
             int nDY1 = 0;
 
             extern PNGTexOffDBN *g_PNGTexOffDBN;
-            auto pFrame0 = g_PNGTexOffDBN->Retrieve(nKey0, &nDX0, &nDY0);
-            auto pFrame1 = g_PNGTexOffDBN->Retrieve(nKey1, &nDX1, &nDY1);
+            auto stFrame0 = g_PNGTexOffDBN->RetrieveAsync(nKey0, &nDX0, &nDY0, nullptr);
+            auto stFrame1 = g_PNGTexOffDBN->RetrieveAsync(nKey1, &nDX1, &nDY1, nullptr);
 
             int nShiftX = 0;
             int nShiftY = 0;
             EstimatePixelShift(&nShiftX, &nShiftY);
 
             extern SDLDevice *g_SDLDevice;
-            if(pFrame1){ SDL_SetTextureAlphaMod(pFrame1, 128); }
-            g_SDLDevice->DrawTexture(pFrame1, X() * SYS_MAPGRIDXP + nDX1 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY1 - nViewY + nShiftY);
-            g_SDLDevice->DrawTexture(pFrame0, X() * SYS_MAPGRIDXP + nDX0 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY0 - nViewY + nShiftY);
+            g_SDLDevice->DrawTexture(stFrame1, X() * SYS_MAPGRIDXP + nDX1 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY1 - nViewY + nShiftY, MakeColor(255, 255, 255, 128));
+            g_SDLDevice->DrawTexture(stFrame0, X() * SYS_MAPGRIDXP + nDX0 - nViewX + nShiftX, Y() * SYS_MAPGRIDYP + nDY0 - nViewY + nShiftY);
 
             extern PNGTexDBN *g_PNGTexDBN;
-            auto pBar0 = g_PNGTexDBN->Retrieve(0XFF0014);
-            auto pBar1 = g_PNGTexDBN->Retrieve(0XFF0015);
+            auto stBar0 = g_PNGTexDBN->Retrieve(0XFF0014);
+            auto stBar1 = g_PNGTexDBN->Retrieve(0XFF0015);
 
-            g_SDLDevice->DrawTexture(pBar0, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
-            g_SDLDevice->DrawTexture(pBar1, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
+            g_SDLDevice->DrawTexture(stBar0, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
+            g_SDLDevice->DrawTexture(stBar1, X() * SYS_MAPGRIDXP - nViewX + nShiftX + 7, Y() * SYS_MAPGRIDYP - nViewY + nShiftY - 53);
         }
     }
 
@@ -103,7 +103,31 @@ bool Monster::Draw(int nViewX, int nViewY)
 
 size_t Monster::MotionFrameCount()
 {
-    return (GfxID(m_CurrMotion.Motion, m_CurrMotion.Direction) < 0) ? 0 : GetGInfoRecord(m_MonsterID).FrameCount(m_LookIDN, GfxID(m_CurrMotion.Motion, m_CurrMotion.Direction));
+    return MotionFrameCount(m_CurrMotion.Motion, m_CurrMotion.Direction);
+}
+
+size_t Monster::MotionFrameCount(int nMotion, int nDirection)
+{
+    return (GfxID(nMotion, nDirection) < 0) ? 0 : GetGInfoRecord(m_MonsterID).FrameCount(m_LookIDN, GfxID(nMotion, nDirection));
+}
+
+void Monster::PrefetchMotion(int nMotion, int nDirection, int nFrame)
+{
+    if(!ValidG()){
+        return;
+    }
+
+    auto nGfxID = GfxID(nMotion, nDirection);
+    if(nGfxID < 0){
+        return;
+    }
+
+    // same keys as Draw(), body and shadow
+    extern PNGTexOffDBN *g_PNGTexOffDBN;
+    for(int nIndex = std::max<int>(nFrame, 0); nIndex < (int)(MotionFrameCount(nMotion, nDirection)); ++nIndex){
+        g_PNGTexOffDBN->Prefetch(0X00000000 + (LookID() << 12) + ((uint32_t)(nGfxID) << 5) + nIndex);
+        g_PNGTexOffDBN->Prefetch(0X01000000 + (LookID() << 12) + ((uint32_t)(nGfxID) << 5) + nIndex);
+    }
 }
 
 bool Monster::ParseNewAction(const ActionNode &rstAction, bool)
@@ -99,6 +99,10 @@ class Monster: public Creature
 
     public:
         size_t MotionFrameCount();
+        size_t MotionFrameCount(int, int);
+
+    protected:
+        void PrefetchMotion(int, int, int);
 
     public:
         template<typename... T> static void ResetGInfoRecord(uint32_t nMonsterID, int nLookIDN, T&&... stT)
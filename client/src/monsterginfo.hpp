@@ -116,7 +116,8 @@ class MonsterGInfo final
 
                         // 1. initialization of count, zero is invalid but legal
                         FrameCount[nAction][nDirection] = 0;
-                        while(g_PNGTexOffDBN->Retrieve(nKey++, nullptr, nullptr)){
+                        // only check the zip index, frames are loaded when drawing
+                        while(g_PNGTexOffDBN->Has(nKey++)){
                             FrameCount[nAction][nDirection]++;
                         }
                     }
@@ -24,7 +24,6 @@
 #include "message.hpp"
 #include "mathfunc.hpp"
 #include "processrun.hpp"
-#include "clientpathfinder.hpp"
 
 MyHero::MyHero(uint32_t nUID, uint32_t nDBID, bool bMale, uint32_t nDressID, ProcessRun *pRun, const ActionNode &rstAction)
 	: Hero(nUID, nDBID, bMale, nDressID, pRun, rstAction)
@@ -165,24 +164,12 @@ bool MyHero::ParseActionQueue()
                 }
 
                 if(LDistance2(nX0, nY0, nX1, nY1) > 2){
-                    ClientPathFinder stPathFinder(false, true);
-                    if(true
-                            && stPathFinder.Search(nX0, nY0, nX1, nY1)
-                            && stPathFinder.GetSolutionStart()){
-
-                        // prepare the path node vector
-                        // won't check the ground during the search
-                        // [  0] : src point
-                        // [end] : dst point or next point of the furthest point one hop can reach
-
-                        std::vector<PathFind::PathNode> stPathNodeV(1, {nX0, nY0});
-                        while(auto pNode = stPathFinder.GetSolutionNext()){
-                            // [  0] :      starting point
-                            // [end] : next starting point
-                            if(stPathNodeV.size() < (m_OnHorse ? 5 : 4)){
-                                stPathNodeV.emplace_back(pNode->X(), pNode->Y());
-                            }else{ break; }
-                        }
+                    // prepare the path node vector
+                    // path could cross invalid ground if dst is not reachable, checked below
+                    // [  0] : src point
+                    // [end] : dst point or next point of the furthest point one hop can reach
+                    std::vector<PathFind::PathNode> stPathNodeV;
+                    if(m_ProcessRun->FindPath(nX0, nY0, nX1, nY1, m_OnHorse ? 5 : 4, &stPathNodeV)){
 
                         // we do path search if LDistance2() > 2
                         // means at least we have two steps to reach the dst point
@@ -41,18 +41,30 @@ class PNGTexDBN: public PNGTexDBType
 
         virtual ~PNGTexDBN() = default;
 
+    private:
+        static size_t LinearCacheKey(uint32_t nKey)
+        {
+            return (nKey & 0X0000FFFF) % PNGTEXDBN_LC_LENGTH;
+        }
+
     public:
-        SDL_Texture *Retrieve(uint32_t nKey)
+        TexRegion Retrieve(uint32_t nKey)
+        {
+            return RetrieveItem(nKey, LinearCacheKey).Region;
+        }
+
+        // null region when it's still being decoded
+        TexRegion RetrieveAsync(uint32_t nKey, bool *pPending)
         {
-            const auto &fnLinearCacheKey = [&](uint32_t nKey)->size_t
-            {
-                return (nKey & 0X0000FFFF) % PNGTEXDBN_LC_LENGTH;
-            };
+            return RetrieveItemAsync(nKey, LinearCacheKey, pPending).Region;
+        }
 
-            return RetrieveItem(nKey, fnLinearCacheKey).Texture;
+        size_t Upload(double fBudgetMS)
+        {
+            return PNGTexDBType::Upload(fBudgetMS, LinearCacheKey);
         }
 
-        SDL_Texture *Retrieve(uint8_t nIndex, uint16_t nImage)
+        TexRegion Retrieve(uint8_t nIndex, uint16_t nImage)
         {
             return Retrieve((uint32_t)(((uint32_t)(nIndex) << 16) + nImage));
         }
@@ -20,28 +20,39 @@
 
 #pragma once
 #include <zip.h>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
 #include <SDL2/SDL.h>
 #include <unordered_map>
 
 #include "inndb.hpp"
+#include "texatlas.hpp"
 #include "hexstring.hpp"
 #include "sdldevice.hpp"
+#include "surfacedecoder.hpp"
 
 
 typedef struct{
-    SDL_Texture *Texture;
-    int          DX;
-    int          DY;
+    TexRegion Region;
+    int       DX;
+    int       DY;
 }PNGTexOffItem;
 
 template<size_t LCDeepN, size_t LCLenN, size_t ResMaxN>
 class PNGTexOffDB: public InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMaxN>
 {
     private:
-        size_t      m_BufSize;
-        uint8_t    *m_Buf;
         struct zip *m_ZIP;
 
+    private:
+        // m_ZIP is used by main thread and the decoder
+        std::mutex m_ZIPLock;
+
+    private:
+        std::vector<uint8_t> m_Buf;
+
     private:
         typedef struct{
             zip_uint64_t Index;
@@ -56,15 +67,43 @@ class PNGTexOffDB: public InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMax
     private:
         std::unordered_map<uint32_t, ZIPItemInfo> m_ZIPItemInfoCache;
 
+    private:
+        std::unique_ptr<TexAtlas> m_TexAtlas;
+
+    private:
+        // decoded surface handed to LoadResource() by Upload()
+        bool         m_Preload;
+        uint32_t     m_PreloadKey;
+        SDL_Surface *m_PreloadSurface;
+
+    private:
+        size_t m_UploadCount;
+
+    private:
+        std::unique_ptr<SurfaceDecoder> m_Decoder;
+
     public:
         PNGTexOffDB()
             : InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMaxN>()
-            , m_BufSize(0)
-            , m_Buf(nullptr)
             , m_ZIP(nullptr)
+            , m_ZIPLock()
+            , m_Buf()
             , m_ZIPItemInfoCache()
+            , m_TexAtlas()
+            , m_Preload(false)
+            , m_PreloadKey(0)
+            , m_PreloadSurface(nullptr)
+            , m_UploadCount(0)
+            , m_Decoder()
         {}
-        virtual ~PNGTexOffDB() = default;
+        // stop the decoder before anything it reads goes
+        // free textures before the atlas goes
+        // also FreeResource() can't be called in ~InnDB()
+        virtual ~PNGTexOffDB()
+        {
+            m_Decoder.reset();
+            this->ClearCache();
+        }
 
     public:
         bool Valid()
@@ -122,6 +161,39 @@ class PNGTexOffDB: public InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMax
             return Valid();
         }
 
+        // pack textures into pages of nPageSize x nPageSize, 0 to disable
+        // textures already loaded are dropped
+        void EnableAtlas(int nPageSize)
+        {
+            this->ClearCache();
+            m_TexAtlas.reset((nPageSize > 0) ? new TexAtlas(nPageSize, nPageSize) : nullptr);
+        }
+
+        // decode in a worker thread for RetrieveItemAsync() and Prefetch()
+        // at most nPrefetchMax keys wait for prefetching, call it after Load()
+        void EnableDecoder(bool bEnable, size_t nPrefetchMax)
+        {
+            m_Decoder.reset();
+            if(bEnable){
+                m_Decoder.reset(new SurfaceDecoder([this](uint32_t nKey, std::vector<uint8_t> *pBuf) -> bool
+                {
+                    return ReadItem(nKey, pBuf);
+                }, nPrefetchMax));
+            }
+        }
+
+    public:
+        // check the item without loading it
+        bool Has(uint32_t nKey) const
+        {
+            return m_ZIPItemInfoCache.find(nKey) != m_ZIPItemInfoCache.end();
+        }
+
+        size_t UploadCount() const
+        {
+            return m_UploadCount;
+        }
+
     public:
         void RetrieveItem(uint32_t nKey, PNGTexOffItem *pItem,
                 const std::function<size_t(uint32_t)> &fnLinearCacheKey)
@@ -133,13 +205,98 @@ class PNGTexOffDB: public InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMax
             }
         }
 
-        void ExtendBuf(size_t nSize)
+        // won't load a missed item in current thread, it's decoded in background
+        // and a null item is returned meanwhile, *pPending tells if it's coming
+        void RetrieveItemAsync(uint32_t nKey, PNGTexOffItem *pItem,
+                const std::function<size_t(uint32_t)> &fnLinearCacheKey, bool *pPending)
+        {
+            if(pPending){
+                *pPending = false;
+            }
+
+            if(m_Decoder && !this->InnCached(nKey) && Has(nKey)){
+                m_Decoder->Request(nKey, true);
+                if(pPending){
+                    *pPending = true;
+                }
+
+                if(pItem){
+                    *pItem = {{nullptr, 0, 0, 0, 0}, 0, 0};
+                }
+                return;
+            }
+            RetrieveItem(nKey, pItem, fnLinearCacheKey);
+        }
+
+        // decode it in background if not loaded yet
+        void Prefetch(uint32_t nKey)
+        {
+            if(m_Decoder && !this->InnCached(nKey) && Has(nKey)){
+                m_Decoder->Request(nKey, false);
+            }
+        }
+
+        // create textures for decoded surfaces, main thread only
+        // stops once it takes more than fBudgetMS, the rest waits for next call
+        size_t Upload(double fBudgetMS,
+                const std::function<size_t(uint32_t)> &fnLinearCacheKey)
         {
-            if(nSize > m_BufSize){
-                delete m_Buf;
-                m_Buf = new uint8_t[nSize];
-                m_BufSize = nSize;
+            if(!m_Decoder){
+                return 0;
+            }
+
+            size_t nCount = 0;
+            auto stStart = std::chrono::steady_clock::now();
+
+            uint32_t     nKey     = 0;
+            SDL_Surface *pSurface = nullptr;
+            while(m_Decoder->Take(&nKey, &pSurface)){
+                // could be loaded synchronously meanwhile
+                if(!this->InnCached(nKey)){
+                    m_Preload        = true;
+                    m_PreloadKey     = nKey;
+                    m_PreloadSurface = pSurface;
+
+                    PNGTexOffItem stItem;
+                    RetrieveItem(nKey, &stItem, fnLinearCacheKey);
+
+                    m_Preload        = false;
+                    m_PreloadSurface = nullptr;
+                    nCount++;
+                }
+
+                if(pSurface){
+                    SDL_FreeSurface(pSurface);
+                }
+
+                if(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stStart).count() >= fBudgetMS){
+                    break;
+                }
             }
+
+            m_UploadCount += nCount;
+            return nCount;
+        }
+
+    private:
+        // called by main thread and the decoder
+        // m_ZIPItemInfoCache is read-only after Load()
+        bool ReadItem(uint32_t nKey, std::vector<uint8_t> *pBuf)
+        {
+            auto pZIPIndexInst = m_ZIPItemInfoCache.find(nKey);
+            if(pZIPIndexInst == m_ZIPItemInfoCache.end()){ return false; }
+
+            std::lock_guard<std::mutex> stLockGuard(m_ZIPLock);
+            auto fp = zip_fopen_index(m_ZIP, pZIPIndexInst->second.Index, ZIP_FL_UNCHANGED);
+            if(fp == nullptr){ return false; }
+
+            size_t nSize = pZIPIndexInst->second.Size;
+            pBuf->resize(nSize);
+
+            bool bRead = (nSize == (size_t)zip_fread(fp, pBuf->data(), nSize));
+            zip_fclose(fp);
+
+            return bRead;
         }
 
     public:
@@ -148,7 +305,7 @@ class PNGTexOffDB: public InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMax
         virtual PNGTexOffItem LoadResource(uint32_t nKey)
         {
             // null resource desc
-            PNGTexOffItem stItem {nullptr, 0, 0};
+            PNGTexOffItem stItem {{nullptr, 0, 0, 0, 0}, 0, 0};
 
             auto pZIPIndexInst = m_ZIPItemInfoCache.find(nKey);
             if(pZIPIndexInst == m_ZIPItemInfoCache.end()){ return stItem; }
@@ -156,27 +313,29 @@ class PNGTexOffDB: public InnDB<uint32_t, PNGTexOffItem, LCDeepN, LCLenN, ResMax
             stItem.DX = pZIPIndexInst->second.DX;
             stItem.DY = pZIPIndexInst->second.DY;
 
-            auto fp = zip_fopen_index(m_ZIP, pZIPIndexInst->second.Index, ZIP_FL_UNCHANGED);
-            if(fp == nullptr){ return stItem; }
-
-            size_t nSize = pZIPIndexInst->second.Size;
-            ExtendBuf(nSize);
-
-            if(nSize != (size_t)zip_fread(fp, m_Buf, nSize)){
-                zip_fclose(fp);
+            extern SDLDevice *g_SDLDevice;
+            if(m_Preload && (m_PreloadKey == nKey)){
+                // null surface for failed decoding
+                // then we get a null item as synchronous loading
+                stItem.Region = g_SDLDevice->CreateTexRegion(m_PreloadSurface, m_TexAtlas.get());
                 return stItem;
             }
 
-            extern SDLDevice *g_SDLDevice;
-            stItem.Texture = g_SDLDevice->CreateTexture((const uint8_t *)m_Buf, nSize);
-
+            if(ReadItem(nKey, &m_Buf)){
+                stItem.Region = g_SDLDevice->CreateTexRegion((const uint8_t *)(m_Buf.data()), m_Buf.size(), m_TexAtlas.get());
+            }
             return stItem;
         }
 
         void FreeResource(PNGTexOffItem &stItem)
         {
-            if(stItem.Texture){
-                SDL_DestroyTexture(stItem.Texture);
-            }
+            extern SDLDevice *g_SDLDevice;
+            g_SDLDevice->FreeTexRegion(stItem.Region, m_TexAtlas.get());
+        }
+
+        size_t ResourceSize(const PNGTexOffItem &stItem)
+        {
+            extern SDLDevice *g_SDLDevice;
+            return g_SDLDevice->TextureBytes(stItem.Region);
         }
 };
@@ -42,24 +42,42 @@ class PNGTexOffDBN: public PNGTexOffDBType
 
         virtual ~PNGTexOffDBN() = default;
 
+    private:
+        static size_t LinearCacheKey(uint32_t nKey)
+        {
+            return (nKey & 0X0000FFFF) % PNGTEXOFFDBN_LC_LENGTH;
+        }
+
     public:
-        SDL_Texture *Retrieve(uint32_t nKey, int *pDX, int *pDY)
+        TexRegion Retrieve(uint32_t nKey, int *pDX, int *pDY)
         {
-            const auto &fnLinearCacheKey = [&](uint32_t nKey)
-            {
-                return (nKey & 0X0000FFFF) % PNGTEXOFFDBN_LC_LENGTH;
-            };
+            PNGTexOffItem stItem;
+            RetrieveItem(nKey, &stItem, LinearCacheKey);
+
+            if(pDX){ *pDX = stItem.DX; };
+            if(pDY){ *pDY = stItem.DY; };
 
+            return stItem.Region;
+        }
+
+        // null region when it's still being decoded
+        TexRegion RetrieveAsync(uint32_t nKey, int *pDX, int *pDY, bool *pPending)
+        {
             PNGTexOffItem stItem;
-            RetrieveItem(nKey, &stItem, fnLinearCacheKey);
+            RetrieveItemAsync(nKey, &stItem, LinearCacheKey, pPending);
 
             if(pDX){ *pDX = stItem.DX; };
             if(pDY){ *pDY = stItem.DY; };
 
-            return stItem.Texture;
+            return stItem.Region;
+        }
+
+        size_t Upload(double fBudgetMS)
+        {
+            return PNGTexOffDBType::Upload(fBudgetMS, LinearCacheKey);
         }
 
-        SDL_Texture *Retrieve(uint8_t nIndex, uint16_t nImage, int *pDX, int *pDY)
+        TexRegion Retrieve(uint8_t nIndex, uint16_t nImage, int *pDX, int *pDY)
         {
             return Retrieve((uint32_t)(((uint32_t)(nIndex) << 16) + nImage), pDX, pDY);
         }
@@ -82,10 +82,7 @@ void ProcessLogo::Draw()
     // so any operation on texture should be done and consumed ASAP
 
     Uint8 bColor = std::lround(255 * Ratio());
-    auto pTexture = g_PNGTexDBN->Retrieve(255, 0);
-    SDL_SetTextureColorMod(pTexture, bColor, bColor, bColor);
-
-    g_SDLDevice->DrawTexture(pTexture, 0, 0);
+    g_SDLDevice->DrawTexture(g_PNGTexDBN->Retrieve(255, 0), 0, 0, MakeColor(bColor, bColor, bColor, 255));
     g_SDLDevice->Present();
 }
 
@@ -18,24 +18,35 @@
  * =====================================================================================
  */
 
+#include <cstdio>
 #include <memory>
+#include <string>
 #include <cstring>
 
 #include "monster.hpp"
 #include "mathfunc.hpp"
 #include "sysconst.hpp"
 #include "pngtexdbn.hpp"
+#include "pngtexoffdbn.hpp"
 #include "sdldevice.hpp"
 #include "clientenv.hpp"
 #include "processrun.hpp"
+#include "clientpathfinder.hpp"
 
 ProcessRun::ProcessRun()
     : Process()
+    , m_MapID(0)
+    , m_Mir2xMapData()
+    , m_WalkMap()
+    , m_PortalGraph(&m_WalkMap)
     , m_MyHero(nullptr)
     , m_ViewX(0)
     , m_ViewY(0)
     , m_RollMap(false)
     , m_ControbBoard(0, 0, nullptr, false)
+    , m_CreatureIndex()
+    , m_StaticMapLayer()
+    , m_PrefetchRect {0, 0, 0, 0}
 {
 }
 
@@ -68,9 +79,13 @@ void ProcessRun::Update(double)
         if((nDViewX == 0) && (nDViewY == 0) && !m_MyHero->Moving()){ m_RollMap = false; }
     }
 
+    PrefetchMap();
+
     for(auto pRecord: m_CreatureRecord){
         if(pRecord.second){
             pRecord.second->Update();
+            pRecord.second->Prefetch();
+            UpdateCreatureIndex(pRecord.second);
         }
     }
 }
@@ -88,58 +103,9 @@ void ProcessRun::Draw()
         int nX1 = (m_ViewX + 2 * SYS_MAPGRIDXP + SYS_OBJMAXW + g_SDLDevice->WindowW(false)) / SYS_MAPGRIDXP;
         int nY1 = (m_ViewY + 2 * SYS_MAPGRIDYP + SYS_OBJMAXH + g_SDLDevice->WindowH(false)) / SYS_MAPGRIDYP;
 
-        // tiles
-        for(int nY = nY0; nY <= nY1; ++nY){
-            for(int nX = nX0; nX <= nX1; ++nX){
-                if(m_Mir2xMapData.ValidC(nX, nY) && !(nX % 2) && !(nY % 2)){
-                    auto nParam = m_Mir2xMapData.Tile(nX, nY).Param;
-                    if(nParam & 0X80000000){
-                        if(auto pTexture = g_PNGTexDBN->Retrieve(nParam & 0X00FFFFFF)){
-                            g_SDLDevice->DrawTexture(pTexture, nX * SYS_MAPGRIDXP - m_ViewX, nY * SYS_MAPGRIDYP - m_ViewY);
-                        }
-                    }
-                }
-            }
-        }
-
-        // ground objects
-        for(int nY = nY0; nY <= nY1; ++nY){
-            for(int nX = nX0; nX <= nX1; ++nX){
-                if(m_Mir2xMapData.ValidC(nX, nY) && (m_Mir2xMapData.Cell(nX, nY).Param & 0X80000000)){
-                    // for obj-0
-                    {
-                        auto nParam = m_Mir2xMapData.Cell(nX, nY).Obj[0].Param;
-                        if(nParam & 0X80000000){
-                            auto nObjParam = m_Mir2xMapData.Cell(nX, nY).ObjParam;
-                            if(nObjParam & ((uint32_t)(1) << 22)){
-                                if(auto pTexture = g_PNGTexDBN->Retrieve(nParam & 0X00FFFFFF)){
-                                    int nH = 0;
-                                    if(!SDL_QueryTexture(pTexture, nullptr, nullptr, nullptr, &nH)){
-                                        g_SDLDevice->DrawTexture(pTexture, nX * SYS_MAPGRIDXP - m_ViewX, (nY + 1) * SYS_MAPGRIDYP - m_ViewY - nH);
-                                    }
-                                }
-                            }
-                        }
-                    }
-
-                    // for obj-1
-                    {
-                        auto nParam = m_Mir2xMapData.Cell(nX, nY).Obj[0].Param;
-                        if(nParam & 0X80000000){
-                            auto nObjParam = m_Mir2xMapData.Cell(nX, nY).ObjParam;
-                            if(nObjParam & ((uint32_t)(1) << 6)){
-                                if(auto pTexture = g_PNGTexDBN->Retrieve(nParam & 0X00FFFFFF)){
-                                    int nH = 0;
-                                    if(!SDL_QueryTexture(pTexture, nullptr, nullptr, nullptr, &nH)){
-                                        g_SDLDevice->DrawTexture(pTexture, nX * SYS_MAPGRIDXP - m_ViewX, (nY + 1) * SYS_MAPGRIDYP - m_ViewY - nH);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        // tiles and ground objects
+        // cached, only strips exposed by rolling are drawn
+        m_StaticMapLayer.Draw(m_Mir2xMapData, m_ViewX, m_ViewY, g_SDLDevice->WindowW(false), g_SDLDevice->WindowH(false));
 
         extern ClientEnv *g_ClientEnv;
         if(g_ClientEnv->MIR2X_DEBUG_SHOW_MAP_GRID){
@@ -161,6 +127,8 @@ void ProcessRun::Draw()
 
         // over-ground objects
         for(int nY = nY0; nY <= nY1; ++nY){
+            auto &rstRow    = m_CreatureIndex.Row(nY);
+            auto  pCreature = rstRow.begin();
             for(int nX = nX0; nX <= nX1; ++nX){
                 if(m_Mir2xMapData.ValidC(nX, nY) && (m_Mir2xMapData.Cell(nX, nY).Param & 0X80000000)){
                     // for obj-0
@@ -169,11 +137,8 @@ void ProcessRun::Draw()
                         if(nParam & 0X80000000){
                             auto nObjParam = m_Mir2xMapData.Cell(nX, nY).ObjParam;
                             if(!(nObjParam & ((uint32_t)(1) << 22))){
-                                if(auto pTexture = g_PNGTexDBN->Retrieve(nParam & 0X00FFFFFF)){
-                                    int nH = 0;
-                                    if(!SDL_QueryTexture(pTexture, nullptr, nullptr, nullptr, &nH)){
-                                        g_SDLDevice->DrawTexture(pTexture, nX * SYS_MAPGRIDXP - m_ViewX, (nY + 1) * SYS_MAPGRIDYP - m_ViewY - nH);
-                                    }
+                                if(auto stTexture = g_PNGTexDBN->RetrieveAsync(nParam & 0X00FFFFFF, nullptr)){
+                                    g_SDLDevice->DrawTexture(stTexture, nX * SYS_MAPGRIDXP - m_ViewX, (nY + 1) * SYS_MAPGRIDYP - m_ViewY - stTexture.H);
                                 }
                             }
                         }
@@ -185,11 +150,8 @@ void ProcessRun::Draw()
                         if(nParam & 0X80000000){
                             auto nObjParam = m_Mir2xMapData.Cell(nX, nY).ObjParam;
                             if(!(nObjParam & ((uint32_t)(1) << 6))){
-                                if(auto pTexture = g_PNGTexDBN->Retrieve(nParam & 0X00FFFFFF)){
-                                    int nH = 0;
-                                    if(!SDL_QueryTexture(pTexture, nullptr, nullptr, nullptr, &nH)){
-                                        g_SDLDevice->DrawTexture(pTexture, nX * SYS_MAPGRIDXP - m_ViewX, (nY + 1) * SYS_MAPGRIDYP - m_ViewY - nH);
-                                    }
+                                if(auto stTexture = g_PNGTexDBN->RetrieveAsync(nParam & 0X00FFFFFF, nullptr)){
+                                    g_SDLDevice->DrawTexture(stTexture, nX * SYS_MAPGRIDXP - m_ViewX, (nY + 1) * SYS_MAPGRIDYP - m_ViewY - stTexture.H);
                                 }
                             }
                         }
@@ -215,17 +177,20 @@ void ProcessRun::Draw()
                 }
 
                 // draw actors
+                // row is sorted by x, the cursor only moves forward
                 {
-                    for(auto pCreature: m_CreatureRecord){
-                        if(pCreature.second && (pCreature.second->X() == nX) && (pCreature.second->Y() == nY)){
-                            extern ClientEnv *g_ClientEnv;
-                            if(g_ClientEnv->MIR2X_DEBUG_SHOW_CREATURE_COVER){
-                                g_SDLDevice->PushColor(0, 0, 255, 30);
-                                g_SDLDevice->FillRectangle(nX * SYS_MAPGRIDXP - m_ViewX, nY * SYS_MAPGRIDYP - m_ViewY, SYS_MAPGRIDXP, SYS_MAPGRIDYP);
-                                g_SDLDevice->PopColor();
-                            }
-                            pCreature.second->Draw(m_ViewX, m_ViewY);
+                    while((pCreature != rstRow.end()) && (pCreature->X < nX)){
+                        ++pCreature;
+                    }
+
+                    for(; (pCreature != rstRow.end()) && (pCreature->X == nX); ++pCreature){
+                        extern ClientEnv *g_ClientEnv;
+                        if(g_ClientEnv->MIR2X_DEBUG_SHOW_CREATURE_COVER){
+                            g_SDLDevice->PushColor(0, 0, 255, 30);
+                            g_SDLDevice->FillRectangle(nX * SYS_MAPGRIDXP - m_ViewX, nY * SYS_MAPGRIDYP - m_ViewY, SYS_MAPGRIDXP, SYS_MAPGRIDYP);
+                            g_SDLDevice->PopColor();
                         }
+                        pCreature->Object->Draw(m_ViewX, m_ViewY);
                     }
                 }
 
@@ -234,6 +199,28 @@ void ProcessRun::Draw()
     }
 
     m_ControbBoard.Draw();
+
+    extern ClientEnv *g_ClientEnv;
+    if(g_ClientEnv->MIR2X_DEBUG_SHOW_FRAME_STAT){
+        // of the last frame
+        // texture cache counters are accumulated since start
+        extern PNGTexDBN    *g_PNGTexDBN;
+        extern PNGTexOffDBN *g_HeroGfxDBN;
+        extern PNGTexOffDBN *g_PNGTexOffDBN;
+
+        InnDBStat stCacheStat {0, 0, 0, 0, 0};
+        for(auto pStat: {&g_PNGTexDBN->Stat(), &g_HeroGfxDBN->Stat(), &g_PNGTexOffDBN->Stat()}){
+            stCacheStat.Miss  += pStat->Miss;
+            stCacheStat.Evict += pStat->Evict;
+            stCacheStat.Bytes += pStat->Bytes;
+        }
+
+        char szStat[256];
+        std::snprintf(szStat, sizeof(szStat), "MIR2X-V0.1 draw call: %d, texture bind: %d, texture cache: %dMB, miss: %d, evict: %d",
+                (int)(g_SDLDevice->LastFrameStat().DrawCall), (int)(g_SDLDevice->LastFrameStat().TextureBind),
+                (int)(stCacheStat.Bytes / 1024 / 1024), (int)(stCacheStat.Miss), (int)(stCacheStat.Evict));
+        g_SDLDevice->SetWindowTitle(szStat);
+    }
     g_SDLDevice->Present();
 }
 
@@ -374,6 +361,7 @@ void ProcessRun::ProcessEvent(const SDL_Event &rstEvent)
                                             nX,
                                             nY,
                                             MapID()}, false);
+                                    UpdateCreatureIndex(m_MyHero);
                                 }
                             }
 
@@ -390,6 +378,12 @@ void ProcessRun::ProcessEvent(const SDL_Event &rstEvent)
             {
                 break;
             }
+        case SDL_RENDER_TARGETS_RESET:
+            {
+                // content of render targets is lost
+                m_StaticMapLayer.Invalidate();
+                break;
+            }
         case SDL_KEYDOWN:
             {
                 // m_MyHero->SetState(0);
@@ -407,24 +401,105 @@ int ProcessRun::LoadMap(uint32_t nMapID)
     if(nMapID){
         m_MapID = nMapID;
         if(auto pMapName = SYS_MAPFILENAME(nMapID)){
-            return m_Mir2xMapData.Load(pMapName);
+            if(auto nRet = m_Mir2xMapData.Load(pMapName)){
+                return nRet;
+            }
+
+            m_CreatureIndex.Reset(m_Mir2xMapData.H());
+            m_StaticMapLayer.Invalidate();
+            m_PrefetchRect = {0, 0, 0, 0};
+            m_WalkMap = GridPathFinder::WalkMap(m_Mir2xMapData.W(), m_Mir2xMapData.H());
+            for(int nX = 0; nX < m_Mir2xMapData.W(); ++nX){
+                for(int nY = 0; nY < m_Mir2xMapData.H(); ++nY){
+                    m_WalkMap.Set(nX, nY, CanMove(false, nX, nY));
+                }
+            }
+
+            // client could be installed read-only
+            // then the graph is built each time the map is loaded
+            auto szGraphPath = std::string(pMapName) + ".hpa";
+            m_PortalGraph = PortalGraph(&m_WalkMap);
+            if(!m_PortalGraph.Load(szGraphPath.c_str())){
+                m_PortalGraph.Build();
+                m_PortalGraph.Save(szGraphPath.c_str());
+            }
+            return 0;
         }
     }
     return -1;
 }
 
+// ask the texture database to decode tiles and ground objects around the view
+// when the view moves only cells newly covered are requested
+void ProcessRun::PrefetchMap()
+{
+    if(!m_Mir2xMapData.Valid()){
+        return;
+    }
+
+    // in cells, besides the ones for drawing
+    const int nMargin = 8;
+
+    extern SDLDevice *g_SDLDevice;
+    int nX0 = (m_ViewX - 2 * SYS_MAPGRIDXP - SYS_OBJMAXW) / SYS_MAPGRIDXP - nMargin;
+    int nY0 = (m_ViewY - 2 * SYS_MAPGRIDYP - SYS_OBJMAXH) / SYS_MAPGRIDYP - nMargin;
+    int nX1 = (m_ViewX + 2 * SYS_MAPGRIDXP + SYS_OBJMAXW + g_SDLDevice->WindowW(false)) / SYS_MAPGRIDXP + nMargin;
+    int nY1 = (m_ViewY + 2 * SYS_MAPGRIDYP + SYS_OBJMAXH + g_SDLDevice->WindowH(false)) / SYS_MAPGRIDYP + nMargin;
+
+    SDL_Rect stRect {nX0, nY0, nX1 - nX0 + 1, nY1 - nY0 + 1};
+    if(true
+            && stRect.x == m_PrefetchRect.x
+            && stRect.y == m_PrefetchRect.y
+            && stRect.w == m_PrefetchRect.w
+            && stRect.h == m_PrefetchRect.h){
+        return;
+    }
+
+    extern PNGTexDBN *g_PNGTexDBN;
+    for(int nY = nY0; nY <= nY1; ++nY){
+        for(int nX = nX0; nX <= nX1; ++nX){
+            SDL_Point stPoint {nX, nY};
+            if(SDL_PointInRect(&stPoint, &m_PrefetchRect) || !m_Mir2xMapData.ValidC(nX, nY)){
+                continue;
+            }
+
+            if(!(nX % 2) && !(nY % 2)){
+                auto nParam = m_Mir2xMapData.Tile(nX, nY).Param;
+                if(nParam & 0X80000000){
+                    g_PNGTexDBN->Prefetch(nParam & 0X00FFFFFF);
+                }
+            }
+
+            // same as drawing, ground and over-ground objects both use obj-0
+            if(m_Mir2xMapData.Cell(nX, nY).Param & 0X80000000){
+                auto nParam = m_Mir2xMapData.Cell(nX, nY).Obj[0].Param;
+                if(nParam & 0X80000000){
+                    g_PNGTexDBN->Prefetch(nParam & 0X00FFFFFF);
+                }
+            }
+        }
+    }
+    m_PrefetchRect = stRect;
+}
+
+void ProcessRun::UpdateCreatureIndex(Creature *pCreature)
+{
+    if(pCreature){
+        int nX = -1;
+        int nY = -1;
+        if(pCreature->Location(&nX, &nY)){
+            m_CreatureIndex.Update(pCreature->UID(), pCreature, nX, nY);
+        }else{
+            m_CreatureIndex.Remove(pCreature->UID());
+        }
+    }
+}
+
 bool ProcessRun::CanMove(bool bCheckCreature, int nX, int nY){
     if(m_Mir2xMapData.ValidC(nX, nY)
             && (m_Mir2xMapData.Cell(nX, nY).Param & 0X80000000)
             && (m_Mir2xMapData.Cell(nX, nY).Param & 0X00800000)){
-        if(bCheckCreature){
-            for(auto pCreature: m_CreatureRecord){
-                if(pCreature.second && (pCreature.second->X() == nX) && (pCreature.second->Y() == nY)){
-                    return false;
-                }
-            }
-        }
-        return true;
+        return !(bCheckCreature && m_CreatureIndex.Has(nX, nY));
     }
     return false;
 }
@@ -450,6 +525,45 @@ bool ProcessRun::CanMove(bool bCheckCreature, int nX0, int nY0, int nX1, int nY1
     return false;
 }
 
+bool ProcessRun::FindPath(int nX0, int nY0, int nX1, int nY1, size_t nMaxNode, std::vector<PathFind::PathNode> *pPathV)
+{
+    if(!pPathV){
+        return false;
+    }
+
+    // 1. both ends on valid ground, portal graph refines only nMaxNode nodes
+    //    creatures cost more but are allowed
+    if(true
+            && m_WalkMap.Walkable(nX0, nY0)
+            && m_WalkMap.Walkable(nX1, nY1)
+            && m_PortalGraph.Search(nX0, nY0, nX1, nY1, pPathV, nMaxNode, [this](int nX, int nY){ return !CanMove(true, nX, nY); })){
+        if(nMaxNode && pPathV->size() > nMaxNode){
+            pPathV->erase(pPathV->begin() + nMaxNode, pPathV->end());
+        }
+        return true;
+    }
+
+    // 2. player clicked on invalid ground, or it's not reachable
+    //    ClientPathFinder still gives a path towards it, invalid grids cost very high
+    ClientPathFinder stPathFinder(false, true);
+    if(true
+            && stPathFinder.Search(nX0, nY0, nX1, nY1)
+            && stPathFinder.GetSolutionStart()){
+
+        pPathV->assign(1, {nX0, nY0});
+        while(auto pNode = stPathFinder.GetSolutionNext()){
+            if(nMaxNode && pPathV->size() >= nMaxNode){
+                break;
+            }
+            pPathV->emplace_back(pNode->X(), pNode->Y());
+        }
+        return true;
+    }
+
+    pPathV->clear();
+    return false;
+}
+
 bool ProcessRun::LocatePoint(int nPX, int nPY, int *pX, int *pY)
 {
     if(pX){ *pX = (nPX + m_ViewX) / SYS_MAPGRIDXP; }
@@ -18,6 +18,7 @@
  * =====================================================================================
  */
 #pragma once
+#include <vector>
 #include <cstdint>
 #include <unordered_map>
 
@@ -26,6 +27,10 @@
 #include "message.hpp"
 #include "mir2xmap.hpp"
 #include "creature.hpp"
+#include "pathfinder.hpp"
+#include "portalgraph.hpp"
+#include "creatureindex.hpp"
+#include "staticmaplayer.hpp"
 #include "mir2xmapdata.hpp"
 #include "controlboard.hpp"
 
@@ -35,6 +40,12 @@ class ProcessRun: public Process
         uint32_t     m_MapID;
         Mir2xMapData m_Mir2xMapData;
 
+    private:
+        // CanMove(false, x, y) of all cells and portal graph on it
+        // rebuilt when map changes
+        GridPathFinder::WalkMap m_WalkMap;
+        PortalGraph             m_PortalGraph;
+
     private:
         MyHero *m_MyHero;
 
@@ -51,9 +62,28 @@ class ProcessRun: public Process
     private:
         std::unordered_map<uint32_t, Creature*> m_CreatureRecord;
 
+    private:
+        // creatures bucketed by cell, used by Draw() and CanMove()
+        // call UpdateCreatureIndex() after anything may move a creature
+        CreatureIndex m_CreatureIndex;
+
+    private:
+        StaticMapLayer m_StaticMapLayer;
+
+    private:
+        // cells around the view whose textures have been prefetched
+        // zero size means nothing prefetched yet
+        SDL_Rect m_PrefetchRect;
+
     private:
         int LoadMap(uint32_t);
 
+    private:
+        void UpdateCreatureIndex(Creature *);
+
+    private:
+        void PrefetchMap();
+
     public:
         ProcessRun();
         virtual ~ProcessRun() = default;
@@ -86,4 +116,9 @@ class ProcessRun: public Process
     public:
         bool CanMove(bool, int, int);
         bool CanMove(bool, int, int, int, int);
+
+    public:
+        // path from (nX0, nY0) to (nX1, nY1) includes both ends, at most nMaxNode nodes
+        // creatures are not blocking but cost more, same as ClientPathFinder(false, true)
+        bool FindPath(int, int, int, int, size_t, std::vector<PathFind::PathNode> *);
 };
@@ -48,6 +48,7 @@ void ProcessRun::Net_LOGINOK(const uint8_t *pBuf, size_t nLen)
         m_MyHero = new MyHero(stSMLOK.UID, stSMLOK.DBID, (bool)(stSMLOK.Male), 0, this, stAction);
 
         m_CreatureRecord[m_MyHero->UID()] = m_MyHero;
+        UpdateCreatureIndex(m_MyHero);
 
         {
             extern SDLDevice *g_SDLDevice;
@@ -76,6 +77,7 @@ void ProcessRun::Net_ACTION(const uint8_t *pBuf, size_t)
         auto pRecord = m_CreatureRecord.find(stSMA.UID);
         if((pRecord != m_CreatureRecord.end()) && pRecord->second){
             pRecord->second->ParseNewAction(stAction, true);
+            UpdateCreatureIndex(pRecord->second);
         }
     }else{
         if(m_MyHero && m_MyHero->UID() == stSMA.UID){
@@ -90,9 +92,11 @@ void ProcessRun::Net_ACTION(const uint8_t *pBuf, size_t)
                 delete pRecord.second;
             }
             m_CreatureRecord.clear();
+            m_CreatureIndex.Clear();
 
             m_MyHero = new MyHero(nUID, nDBID, bMale, nDress, this, stAction);
             m_CreatureRecord[m_MyHero->UID()] = m_MyHero;
+            UpdateCreatureIndex(m_MyHero);
         }
     }
 }
@@ -126,6 +130,7 @@ void ProcessRun::Net_CORECORD(const uint8_t *pBuf, size_t)
                     {
                         if(auto pMonster = Monster::Create(stSMCOR.Common.UID, stSMCOR.Monster.MonsterID, this, stAction)){
                             m_CreatureRecord[stSMCOR.Common.UID] = pMonster;
+                            UpdateCreatureIndex(pMonster);
                         }
                         break;
                     }
@@ -141,6 +146,7 @@ void ProcessRun::Net_CORECORD(const uint8_t *pBuf, size_t)
         }else{
             if(pRecord->second){
                 pRecord->second->ParseNewAction(stAction, true);
+                UpdateCreatureIndex(pRecord->second);
             }
         }
     }
@@ -66,13 +66,12 @@ void ProcessSyrc::Draw()
     extern PNGTexDBN  *g_PNGTexDBN;
     extern SDLDevice  *g_SDLDevice;
 
-    auto pTexture = g_PNGTexDBN->Retrieve(255, 2);
-    int nW, nH;
-
-    SDL_QueryTexture(pTexture, nullptr, nullptr, &nW, &nH);
+    auto stTexture = g_PNGTexDBN->Retrieve(255, 2);
+    int nW = stTexture.W;
+    int nH = stTexture.H;
 
     g_SDLDevice->ClearScreen();
-    g_SDLDevice->DrawTexture(pTexture,
+    g_SDLDevice->DrawTexture(stTexture,
             112,  // dst x
             528,  // dst y
             0,    // src x
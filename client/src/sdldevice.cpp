@@ -19,6 +19,7 @@
  */
 
 #include <cassert>
+#include <algorithm>
 #include <SDL2/SDL.h>
 #include <system_error>
 #include <SDL2/SDL_image.h>
@@ -30,6 +31,12 @@
 SDLDevice::SDLDevice()
     : m_Window(nullptr)
     , m_Renderer(nullptr)
+    , m_ColorStack()
+    , m_DrawBatch(false)
+    , m_BatchNodeV()
+    , m_CurrFrameStat {0, 0}
+    , m_LastFrameStat {0, 0}
+    , m_LastTexture(nullptr)
     , m_WindowW(0)
     , m_WindowH(0)
 {
@@ -231,6 +238,121 @@ SDL_Texture *SDLDevice::CreateTexture(const uint8_t *pMem, size_t nSize)
 }
 
 
+SDL_Surface *SDLDevice::CreateSurface(const uint8_t *pMem, size_t nSize)
+{
+    if(pMem == nullptr || nSize <= 0){ return nullptr; }
+
+    SDL_Surface *pstSurface = nullptr;
+    if(auto pstRWops = SDL_RWFromConstMem((const void *)pMem, nSize)){
+        pstSurface = IMG_LoadPNG_RW(pstRWops);
+        SDL_FreeRW(pstRWops);
+    }
+    return pstSurface;
+}
+
+SDL_Texture *SDLDevice::CreateBlankTexture(int nW, int nH)
+{
+    if(nW > 0 && nH > 0){
+        if(auto pTexture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, nW, nH)){
+            SDL_SetTextureBlendMode(pTexture, SDL_BLENDMODE_BLEND);
+            return pTexture;
+        }
+    }
+    return nullptr;
+}
+
+int SDLDevice::MaxTextureSize()
+{
+    SDL_RendererInfo stInfo;
+    if(!SDL_GetRendererInfo(m_Renderer, &stInfo)){
+        // zero means no limit
+        if(stInfo.max_texture_width > 0 && stInfo.max_texture_height > 0){
+            return std::min<int>(stInfo.max_texture_width, stInfo.max_texture_height);
+        }
+        return 1 << 16;
+    }
+    return 0;
+}
+
+TexRegion SDLDevice::CreateTexRegion(const uint8_t *pMem, size_t nSize, TexAtlas *pAtlas)
+{
+    TexRegion stRegion {nullptr, 0, 0, 0, 0};
+    if(!pAtlas){
+        if(auto pTexture = CreateTexture(pMem, nSize)){
+            int nW = 0;
+            int nH = 0;
+            if(!SDL_QueryTexture(pTexture, nullptr, nullptr, &nW, &nH)){
+                stRegion = {pTexture, 0, 0, nW, nH};
+            }else{
+                SDL_DestroyTexture(pTexture);
+            }
+        }
+        return stRegion;
+    }
+
+    if(auto pSurface = CreateSurface(pMem, nSize)){
+        stRegion = CreateTexRegion(pSurface, pAtlas);
+        SDL_FreeSurface(pSurface);
+    }
+    return stRegion;
+}
+
+TexRegion SDLDevice::CreateTexRegion(SDL_Surface *pSurface, TexAtlas *pAtlas)
+{
+    TexRegion stRegion {nullptr, 0, 0, 0, 0};
+    if(pSurface){
+        if(!(pAtlas && pAtlas->Add(pSurface, &stRegion))){
+            if(auto pTexture = SDL_CreateTextureFromSurface(m_Renderer, pSurface)){
+                stRegion = {pTexture, 0, 0, pSurface->w, pSurface->h};
+            }
+        }
+    }
+    return stRegion;
+}
+
+void SDLDevice::FreeTexRegion(const TexRegion &rstRegion, TexAtlas *pAtlas)
+{
+    if(rstRegion.Texture){
+        if(pAtlas && pAtlas->Has(rstRegion.Texture)){
+            pAtlas->Free(rstRegion);
+        }else{
+            SDL_DestroyTexture(rstRegion.Texture);
+        }
+    }
+}
+
+size_t SDLDevice::TextureBytes(SDL_Texture *pTexture)
+{
+    int nW = 0;
+    int nH = 0;
+    if(pTexture && !SDL_QueryTexture(pTexture, nullptr, nullptr, &nW, &nH)){
+        return TextureBytes(TexRegion {pTexture, 0, 0, nW, nH});
+    }
+    return 0;
+}
+
+size_t SDLDevice::TextureBytes(const TexRegion &rstRegion)
+{
+    uint32_t nFormat = 0;
+    if(rstRegion.Texture && !SDL_QueryTexture(rstRegion.Texture, &nFormat, nullptr, nullptr, nullptr)){
+        // SDL_BYTESPERPIXEL() gives 0 for YUV formats, we never create them
+        return (size_t)(rstRegion.W) * (size_t)(rstRegion.H) * (size_t)(SDL_BYTESPERPIXEL(nFormat));
+    }
+    return 0;
+}
+
+// every copy goes through here, for the frame statistics
+void SDLDevice::InnCopy(SDL_Texture *pTexture, const SDL_Rect &rstSrc, const SDL_Rect &rstDst)
+{
+    if(pTexture != m_LastTexture){
+        m_LastTexture = pTexture;
+        m_CurrFrameStat.TextureBind++;
+    }
+
+    m_CurrFrameStat.DrawCall++;
+    SDL_RenderCopy(m_Renderer, pTexture, &rstSrc, &rstDst);
+}
+
 // TODO
 // didn't check the validation of parameters
 // 1. non-negative w/h
@@ -243,7 +365,7 @@ void SDLDevice::DrawTexture(SDL_Texture *pstTexture,
     if(pstTexture){
         SDL_Rect stSrc {nSrcX, nSrcY, nSrcW, nSrcH};
         SDL_Rect stDst {nDstX, nDstY, nSrcW, nSrcH};
-        SDL_RenderCopy(m_Renderer, pstTexture, &stSrc, &stDst);
+        InnCopy(pstTexture, stSrc, stDst);
     }
 }
 
@@ -257,6 +379,131 @@ void SDLDevice::DrawTexture(SDL_Texture *pstTexture, int nX, int nY)
     }
 }
 
+void SDLDevice::DrawTexture(const TexRegion &rstRegion, int nX, int nY)
+{
+    DrawTexture(rstRegion, nX, nY, 0, 0, rstRegion.W, rstRegion.H);
+}
+
+void SDLDevice::DrawTexture(const TexRegion &rstRegion,
+        int nDstX, int nDstY,
+        int nSrcX, int nSrcY,
+        int nSrcW, int nSrcH)
+{
+    if(!rstRegion.Texture){
+        return;
+    }
+
+    // clip by the region
+    // otherwise we get pixels of neighbors in the page
+    if(nSrcX < 0){ nDstX -= nSrcX; nSrcW += nSrcX; nSrcX = 0; }
+    if(nSrcY < 0){ nDstY -= nSrcY; nSrcH += nSrcY; nSrcY = 0; }
+
+    nSrcW = std::min<int>(nSrcW, rstRegion.W - nSrcX);
+    nSrcH = std::min<int>(nSrcH, rstRegion.H - nSrcY);
+
+    if(nSrcW <= 0 || nSrcH <= 0){
+        return;
+    }
+
+    SDL_Rect stSrc {rstRegion.X + nSrcX, rstRegion.Y + nSrcY, nSrcW, nSrcH};
+    SDL_Rect stDst {nDstX, nDstY, nSrcW, nSrcH};
+
+    if(m_DrawBatch){
+        m_BatchNodeV.push_back({rstRegion.Texture, stSrc, stDst});
+    }else{
+        InnCopy(rstRegion.Texture, stSrc, stDst);
+    }
+}
+
+void SDLDevice::DrawTexture(const TexRegion &rstRegion, int nX, int nY, const SDL_Color &rstColor)
+{
+    if(!rstRegion.Texture){
+        return;
+    }
+
+    // modulation is taken when the copy is issued
+    // so this one can't be queued in a batch
+    SDL_SetTextureColorMod(rstRegion.Texture, rstColor.r, rstColor.g, rstColor.b);
+    SDL_SetTextureAlphaMod(rstRegion.Texture, rstColor.a);
+
+    InnCopy(rstRegion.Texture, {rstRegion.X, rstRegion.Y, rstRegion.W, rstRegion.H}, {nX, nY, rstRegion.W, rstRegion.H});
+
+    SDL_SetTextureColorMod(rstRegion.Texture, 255, 255, 255);
+    SDL_SetTextureAlphaMod(rstRegion.Texture, 255);
+}
+
+void SDLDevice::BeginDrawBatch()
+{
+    m_DrawBatch = true;
+    m_BatchNodeV.clear();
+}
+
+void SDLDevice::EndDrawBatch()
+{
+    m_DrawBatch = false;
+    std::stable_sort(m_BatchNodeV.begin(), m_BatchNodeV.end(), [](const BatchNode &rstLHS, const BatchNode &rstRHS) -> bool
+    {
+        return rstLHS.Texture < rstRHS.Texture;
+    });
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    // one geometry call for all sprites on the same texture
+    std::vector<SDL_Vertex> stVertexV;
+    std::vector<int>        stIndexV;
+
+    for(size_t nBegin = 0, nEnd = 0; nBegin < m_BatchNodeV.size(); nBegin = nEnd){
+        auto pTexture = m_BatchNodeV[nBegin].Texture;
+        while((nEnd < m_BatchNodeV.size()) && (m_BatchNodeV[nEnd].Texture == pTexture)){
+            ++nEnd;
+        }
+
+        int nTexW = 0;
+        int nTexH = 0;
+        if(SDL_QueryTexture(pTexture, nullptr, nullptr, &nTexW, &nTexH) || !nTexW || !nTexH){
+            continue;
+        }
+
+        stVertexV.clear();
+        stIndexV.clear();
+
+        for(size_t nIndex = nBegin; nIndex < nEnd; ++nIndex){
+            auto &rstSrc = m_BatchNodeV[nIndex].Src;
+            auto &rstDst = m_BatchNodeV[nIndex].Dst;
+
+            float fU0 = 1.0f * (rstSrc.x) / nTexW;
+            float fV0 = 1.0f * (rstSrc.y) / nTexH;
+            float fU1 = 1.0f * (rstSrc.x + rstSrc.w) / nTexW;
+            float fV1 = 1.0f * (rstSrc.y + rstSrc.h) / nTexH;
+
+            float fX0 = 1.0f * (rstDst.x);
+            float fY0 = 1.0f * (rstDst.y);
+            float fX1 = 1.0f * (rstDst.x + rstDst.w);
+            float fY1 = 1.0f * (rstDst.y + rstDst.h);
+
+            int nBase = (int)(stVertexV.size());
+            stVertexV.push_back({{fX0, fY0}, {255, 255, 255, 255}, {fU0, fV0}});
+            stVertexV.push_back({{fX1, fY0}, {255, 255, 255, 255}, {fU1, fV0}});
+            stVertexV.push_back({{fX1, fY1}, {255, 255, 255, 255}, {fU1, fV1}});
+            stVertexV.push_back({{fX0, fY1}, {255, 255, 255, 255}, {fU0, fV1}});
+
+            stIndexV.insert(stIndexV.end(), {nBase, nBase + 1, nBase + 2, nBase, nBase + 2, nBase + 3});
+        }
+
+        m_CurrFrameStat.DrawCall++;
+        if(pTexture != m_LastTexture){
+            m_LastTexture = pTexture;
+            m_CurrFrameStat.TextureBind++;
+        }
+        SDL_RenderGeometry(m_Renderer, pTexture, &(stVertexV[0]), (int)(stVertexV.size()), &(stIndexV[0]), (int)(stIndexV.size()));
+    }
+#else
+    for(auto &rstNode: m_BatchNodeV){
+        InnCopy(rstNode.Texture, rstNode.Src, rstNode.Dst);
+    }
+#endif
+    m_BatchNodeV.clear();
+}
+
 TTF_Font *SDLDevice::CreateTTF(const uint8_t *pMem, size_t nSize, uint8_t nFontPointSize)
 {
     if(pMem == nullptr || nSize <= 0){ return nullptr; }
@@ -26,26 +26,89 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
+#include "texatlas.hpp"
 #include "colorfunc.hpp"
 
 class SDLDevice final
 {
+    public:
+        // counted between two Present()
+        struct FrameStat
+        {
+            size_t DrawCall;
+            size_t TextureBind;
+        };
+
+    private:
+        struct BatchNode
+        {
+            SDL_Texture *Texture;
+            SDL_Rect     Src;
+            SDL_Rect     Dst;
+        };
+
     public:
         SDLDevice();
        ~SDLDevice();
 
     public:
        SDL_Texture *CreateTexture(const uint8_t *, size_t);
+       SDL_Surface *CreateSurface(const uint8_t *, size_t);
+
+    public:
+       // empty ARGB8888 texture, for atlas pages
+       SDL_Texture *CreateBlankTexture(int, int);
+       int MaxTextureSize();
+
+    public:
+       // decode a png into the atlas, as a standalone texture if no atlas or it doesn't fit
+       // free it by FreeTexRegion() with the same atlas
+       // surface version only copies the pixels, caller still owns the surface
+       TexRegion CreateTexRegion(const uint8_t *, size_t, TexAtlas *);
+       TexRegion CreateTexRegion(SDL_Surface *, TexAtlas *);
+       void      FreeTexRegion(const TexRegion &, TexAtlas *);
+
+    public:
+       // video memory taken, as width * height * bytes per pixel
+       // for atlas region only the sub-rect is counted
+       size_t TextureBytes(SDL_Texture *);
+       size_t TextureBytes(const TexRegion &);
 
     public:
        void SetWindowIcon();
        void DrawTexture(SDL_Texture *, int, int);
        void DrawTexture(SDL_Texture *, int, int, int, int, int, int);
 
+    public:
+       // src rect is relative to the region and clipped by it
+       void DrawTexture(const TexRegion &, int, int);
+       void DrawTexture(const TexRegion &, int, int, int, int, int, int);
+
+       // with color and alpha modulation, restored after drawing
+       // since the page is shared, never set modulation on region.Texture directly
+       void DrawTexture(const TexRegion &, int, int, const SDL_Color &);
+
+    public:
+       // region draws between Begin/EndDrawBatch() are queued and sorted by texture
+       // only for sprites not overlapping each other, since the order changes
+       // queued textures are used in EndDrawBatch(), hold eviction of their DB till then
+       void BeginDrawBatch();
+       void EndDrawBatch();
+
+    public:
+       const FrameStat &LastFrameStat() const
+       {
+           return m_LastFrameStat;
+       }
+
     public:
        void Present()
        {
            SDL_RenderPresent(m_Renderer);
+
+           m_LastFrameStat = m_CurrFrameStat;
+           m_CurrFrameStat = {0, 0};
+           m_LastTexture   = nullptr;
        }
 
        void SetWindowTitle(const char *szUTF8Title)
@@ -112,6 +175,36 @@ class SDLDevice final
            return pSurface ? SDL_CreateTextureFromSurface(m_Renderer, pSurface) : nullptr;
        }
 
+       // texture can be used as render target
+       // content could be lost when SDL_RENDER_TARGETS_RESET received
+       SDL_Texture *CreateRenderTexture(int nW, int nH)
+       {
+           if(nW > 0 && nH > 0 && SDL_RenderTargetSupported(m_Renderer)){
+               if(auto pTexture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, nW, nH)){
+                   SDL_SetTextureBlendMode(pTexture, SDL_BLENDMODE_NONE);
+                   return pTexture;
+               }
+           }
+           return nullptr;
+       }
+
+       // nullptr to draw on the window
+       bool SetRenderTarget(SDL_Texture *pTexture)
+       {
+           return !SDL_SetRenderTarget(m_Renderer, pTexture);
+       }
+
+       void SetClipRect(int nX, int nY, int nW, int nH)
+       {
+           SDL_Rect stRect {nX, nY, nW, nH};
+           SDL_RenderSetClipRect(m_Renderer, &stRect);
+       }
+
+       void DisableClipRect()
+       {
+           SDL_RenderSetClipRect(m_Renderer, nullptr);
+       }
+
        int WindowW(bool bRealWindowSizeInPixel)
        {
            int nW, nH;
@@ -149,10 +242,22 @@ class SDLDevice final
     private:
        std::vector<std::array<uint32_t, 2>> m_ColorStack;
 
+    private:
+       bool                   m_DrawBatch;
+       std::vector<BatchNode> m_BatchNodeV;
+
+    private:
+       FrameStat    m_CurrFrameStat;
+       FrameStat    m_LastFrameStat;
+       SDL_Texture *m_LastTexture;
+
     private:
        int m_WindowW;
        int m_WindowH;
 
     private:
        // for sound
+
+    private:
+       void InnCopy(SDL_Texture *, const SDL_Rect &, const SDL_Rect &);
 };
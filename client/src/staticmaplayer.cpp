@@ -0,0 +1,203 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: staticmaplayer.cpp
+ *        Created: 06/06/2017 16:40:12
+ *  Last Modified: 06/06/2017 21:36:55
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdlib>
+#include "sysconst.hpp"
+#include "pngtexdbn.hpp"
+#include "sdldevice.hpp"
+#include "torusfunc.hpp"
+#include "staticmaplayer.hpp"
+
+StaticMapLayer::~StaticMapLayer()
+{
+    if(m_Texture){
+        SDL_DestroyTexture(m_Texture);
+    }
+}
+
+bool StaticMapLayer::Resize(int nW, int nH)
+{
+    if(m_Texture && (m_W == nW) && (m_H == nH)){
+        return true;
+    }
+
+    if(m_Texture){
+        SDL_DestroyTexture(m_Texture);
+    }
+
+    extern SDLDevice *g_SDLDevice;
+    m_Texture = g_SDLDevice->CreateRenderTexture(nW, nH);
+    m_W       = m_Texture ? nW : 0;
+    m_H       = m_Texture ? nH : 0;
+    m_Valid   = false;
+
+    return m_Texture != nullptr;
+}
+
+void StaticMapLayer::Draw(const Mir2xMapData &rstMapData, int nViewX, int nViewY, int nW, int nH)
+{
+    if(!(rstMapData.Valid() && nW > 0 && nH > 0)){
+        return;
+    }
+
+    extern PNGTexDBN *g_PNGTexDBN;
+    extern SDLDevice *g_SDLDevice;
+    if(!(Resize(nW, nH) && g_SDLDevice->SetRenderTarget(m_Texture))){
+        // no cache, draw it directly
+        DrawCells(rstMapData, nViewX, nViewY,
+                (nViewX - 2 * SYS_MAPGRIDXP - SYS_OBJMAXW) / SYS_MAPGRIDXP,
+                (nViewY - 2 * SYS_MAPGRIDYP - SYS_OBJMAXH) / SYS_MAPGRIDYP,
+                (nViewX + 2 * SYS_MAPGRIDXP + SYS_OBJMAXW + nW) / SYS_MAPGRIDXP,
+                (nViewY + 2 * SYS_MAPGRIDYP + SYS_OBJMAXH + nH) / SYS_MAPGRIDYP);
+        m_Valid = false;
+        return;
+    }
+
+    // skipped items may be ready now
+    if(m_Valid && m_Incomplete && (m_UploadCount != g_PNGTexDBN->UploadCount())){
+        m_Valid = false;
+    }
+
+    if(false
+            || !m_Valid
+            || std::abs(nViewX - m_ViewX) >= m_W
+            || std::abs(nViewY - m_ViewY) >= m_H){
+        m_Incomplete  = false;
+        m_UploadCount = g_PNGTexDBN->UploadCount();
+        DrawRegion(rstMapData, nViewX, nViewY, m_W, m_H);
+    }else{
+        // keep the count when it was first incomplete
+        if(!m_Incomplete){
+            m_UploadCount = g_PNGTexDBN->UploadCount();
+        }
+
+        // newly exposed columns and rows
+        TorusExposed(m_ViewX, m_ViewY, nViewX, nViewY, m_W, m_H, [this, &rstMapData](int nRegionX, int nRegionY, int nRegionW, int nRegionH)
+        {
+            DrawRegion(rstMapData, nRegionX, nRegionY, nRegionW, nRegionH);
+        });
+    }
+
+    g_SDLDevice->DisableClipRect();
+    g_SDLDevice->SetRenderTarget(nullptr);
+
+    m_ViewX = nViewX;
+    m_ViewY = nViewY;
+    m_Valid = true;
+
+    TorusSplit(nViewX, m_W, m_W, [this, nViewX, nViewY](int nMapX, int nTexX, int nPieceW)
+    {
+        TorusSplit(nViewY, m_H, m_H, [this, nViewX, nViewY, nMapX, nTexX, nPieceW](int nMapY, int nTexY, int nPieceH)
+        {
+            g_SDLDevice->DrawTexture(m_Texture, nMapX - nViewX, nMapY - nViewY, nTexX, nTexY, nPieceW, nPieceH);
+        });
+    });
+}
+
+// draw (nX, nY, nW, nH) of the map into the texture
+// texture should already be the render target
+void StaticMapLayer::DrawRegion(const Mir2xMapData &rstMapData, int nX, int nY, int nW, int nH)
+{
+    TorusSplit(nX, nW, m_W, [this, &rstMapData, nY, nH](int nMapX, int nTexX, int nPieceW)
+    {
+        TorusSplit(nY, nH, m_H, [this, &rstMapData, nMapX, nTexX, nPieceW](int nMapY, int nTexY, int nPieceH)
+        {
+            extern SDLDevice *g_SDLDevice;
+            g_SDLDevice->SetClipRect(nTexX, nTexY, nPieceW, nPieceH);
+
+            g_SDLDevice->PushColor(0, 0, 0, 0);
+            g_SDLDevice->FillRectangle(nTexX, nTexY, nPieceW, nPieceH);
+            g_SDLDevice->PopColor();
+
+            DrawCells(rstMapData, nMapX - nTexX, nMapY - nTexY,
+                    (nMapX - 2 * SYS_MAPGRIDXP - SYS_OBJMAXW) / SYS_MAPGRIDXP,
+                    (nMapY - 2 * SYS_MAPGRIDYP - SYS_OBJMAXH) / SYS_MAPGRIDYP,
+                    (nMapX + 2 * SYS_MAPGRIDXP + SYS_OBJMAXW + nPieceW) / SYS_MAPGRIDXP,
+                    (nMapY + 2 * SYS_MAPGRIDYP + SYS_OBJMAXH + nPieceH) / SYS_MAPGRIDYP);
+        });
+    });
+}
+
+// draw tiles and ground objects of cells in [nX0, nX1] x [nY0, nY1]
+// map pixel (nOriginX, nOriginY) is put at (0, 0) of current render target
+void StaticMapLayer::DrawCells(const Mir2xMapData &rstMapData, int nOriginX, int nOriginY, int nX0, int nY0, int nX1, int nY1)
+{
+    extern PNGTexDBN *g_PNGTexDBN;
+    extern SDLDevice *g_SDLDevice;
+
+    // tiles
+    // they never overlap, so can be drawn in a batch
+    // retrieving a tile may evict one already queued, hold it till the batch is drawn
+    g_PNGTexDBN->HoldEviction();
+    g_SDLDevice->BeginDrawBatch();
+    for(int nY = nY0; nY <= nY1; ++nY){
+        for(int nX = nX0; nX <= nX1; ++nX){
+            if(rstMapData.ValidC(nX, nY) && !(nX % 2) && !(nY % 2)){
+                auto nParam = rstMapData.Tile(nX, nY).Param;
+                if(nParam & 0X80000000){
+                    bool bPending = false;
+                    if(auto stTexture = g_PNGTexDBN->RetrieveAsync(nParam & 0X00FFFFFF, &bPending)){
+                        g_SDLDevice->DrawTexture(stTexture, nX * SYS_MAPGRIDXP - nOriginX, nY * SYS_MAPGRIDYP - nOriginY);
+                    }
+                    m_Incomplete = m_Incomplete || bPending;
+                }
+            }
+        }
+    }
+    g_SDLDevice->EndDrawBatch();
+    g_PNGTexDBN->ReleaseEviction();
+
+    // ground objects
+    for(int nY = nY0; nY <= nY1; ++nY){
+        for(int nX = nX0; nX <= nX1; ++nX){
+            if(rstMapData.ValidC(nX, nY) && (rstMapData.Cell(nX, nY).Param & 0X80000000)){
+                // for obj-0
+                {
+                    auto nParam = rstMapData.Cell(nX, nY).Obj[0].Param;
+                    if(nParam & 0X80000000){
+                        auto nObjParam = rstMapData.Cell(nX, nY).ObjParam;
+                        if(nObjParam & ((uint32_t)(1) << 22)){
+                            bool bPending = false;
+                            if(auto stTexture = g_PNGTexDBN->RetrieveAsync(nParam & 0X00FFFFFF, &bPending)){
+                                g_SDLDevice->DrawTexture(stTexture, nX * SYS_MAPGRIDXP - nOriginX, (nY + 1) * SYS_MAPGRIDYP - nOriginY - stTexture.H);
+                            }
+                            m_Incomplete = m_Incomplete || bPending;
+                        }
+                    }
+                }
+
+                // for obj-1
+                {
+                    auto nParam = rstMapData.Cell(nX, nY).Obj[0].Param;
+                    if(nParam & 0X80000000){
+                        auto nObjParam = rstMapData.Cell(nX, nY).ObjParam;
+                        if(nObjParam & ((uint32_t)(1) << 6)){
+                            bool bPending = false;
+                            if(auto stTexture = g_PNGTexDBN->RetrieveAsync(nParam & 0X00FFFFFF, &bPending)){
+                                g_SDLDevice->DrawTexture(stTexture, nX * SYS_MAPGRIDXP - nOriginX, (nY + 1) * SYS_MAPGRIDYP - nOriginY - stTexture.H);
+                            }
+                            m_Incomplete = m_Incomplete || bPending;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: staticmaplayer.hpp
+ *        Created: 06/06/2017 16:02:45
+ *  Last Modified: 06/06/2017 21:37:18
+ *
+ *    Description: tiles and ground objects of current view cached in a render target
+ *                 the texture is used as a torus, map pixel (x, y) always goes to
+ *                 (x mod W, y mod H), then when view rolls only newly exposed strips
+ *                 need to be drawn, others are still valid at the same place
+ *
+ *                 a frame without rolling costs only copying the texture to screen
+ *
+ *                 if render target is not supported, layer is drawn directly on the
+ *                 window each frame, as before
+ *
+ *                 textures still being decoded are skipped, the whole view is drawn
+ *                 again when any of them gets uploaded
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <SDL2/SDL.h>
+#include "mir2xmapdata.hpp"
+
+class StaticMapLayer final
+{
+    private:
+        SDL_Texture *m_Texture;
+
+    private:
+        int m_W;
+        int m_H;
+
+    private:
+        // view the texture currently caches
+        // only meaningful if m_Valid
+        int  m_ViewX;
+        int  m_ViewY;
+        bool m_Valid;
+
+    private:
+        // some items were skipped in the texture
+        // and upload count of the texture database then
+        bool   m_Incomplete;
+        size_t m_UploadCount;
+
+    public:
+        StaticMapLayer()
+            : m_Texture(nullptr)
+            , m_W(0)
+            , m_H(0)
+            , m_ViewX(0)
+            , m_ViewY(0)
+            , m_Valid(false)
+            , m_Incomplete(false)
+            , m_UploadCount(0)
+        {}
+
+       ~StaticMapLayer();
+
+    public:
+        StaticMapLayer(const StaticMapLayer &) = delete;
+        StaticMapLayer &operator = (const StaticMapLayer &) = delete;
+
+    public:
+        // call it when map changes or render targets reset
+        void Invalidate()
+        {
+            m_Valid = false;
+        }
+
+    public:
+        // draw (nViewX, nViewY, nW, nH) of the map to (0, 0) of the window
+        void Draw(const Mir2xMapData &, int, int, int, int);
+
+    private:
+        bool Resize(int, int);
+
+    private:
+        void DrawRegion(const Mir2xMapData &, int, int, int, int);
+        void DrawCells (const Mir2xMapData &, int, int, int, int, int, int);
+};
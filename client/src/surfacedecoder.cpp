@@ -0,0 +1,183 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: surfacedecoder.cpp
+ *        Created: 06/08/2017 10:40:22
+ *  Last Modified: 06/08/2017 18:41:16
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include "sdldevice.hpp"
+#include "surfacedecoder.hpp"
+
+SurfaceDecoder::SurfaceDecoder(const ReadFunc &fnRead, size_t nPrefetchMax)
+    : m_ReadFunc(fnRead)
+    , m_PrefetchMax(nPrefetchMax)
+    , m_Lock()
+    , m_CV()
+    , m_Stop(false)
+    , m_UrgentQ()
+    , m_PrefetchQ()
+    , m_PendingMap()
+    , m_DoneQ()
+    , m_Thread()
+{
+    // start after all members are ready
+    m_Thread = std::thread([this](){ MainLoop(); });
+}
+
+SurfaceDecoder::~SurfaceDecoder()
+{
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+        m_Stop = true;
+    }
+
+    m_CV.notify_all();
+    if(m_Thread.joinable()){
+        m_Thread.join();
+    }
+
+    for(auto &rstDone: m_DoneQ){
+        if(rstDone.second){
+            SDL_FreeSurface(rstDone.second);
+        }
+    }
+}
+
+void SurfaceDecoder::Request(uint32_t nKey, bool bUrgent)
+{
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+
+        auto pPending = m_PendingMap.find(nKey);
+        if(pPending != m_PendingMap.end()){
+            if(bUrgent && pPending->second == PENDING_PREFETCH){
+                pPending->second = PENDING_URGENT;
+
+                // if not found it's being decoded
+                auto pPrefetch = std::find(m_PrefetchQ.begin(), m_PrefetchQ.end(), nKey);
+                if(pPrefetch != m_PrefetchQ.end()){
+                    m_PrefetchQ.erase(pPrefetch);
+                    m_UrgentQ.push_back(nKey);
+                }
+            }
+            return;
+        }
+
+        if(bUrgent){
+            m_UrgentQ.push_back(nKey);
+            m_PendingMap[nKey] = PENDING_URGENT;
+        }else{
+            if(!m_PrefetchMax){
+                return;
+            }
+
+            // it's only a guess
+            // the newer the more likely to be used
+            if(m_PrefetchQ.size() >= m_PrefetchMax){
+                m_PendingMap.erase(m_PrefetchQ.front());
+                m_PrefetchQ.pop_front();
+            }
+
+            m_PrefetchQ.push_back(nKey);
+            m_PendingMap[nKey] = PENDING_PREFETCH;
+        }
+    }
+    m_CV.notify_one();
+}
+
+bool SurfaceDecoder::Take(uint32_t *pKey, SDL_Surface **ppSurface)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    if(m_DoneQ.empty()){
+        return false;
+    }
+
+    if(pKey){
+        *pKey = m_DoneQ.front().first;
+    }
+
+    if(ppSurface){
+        *ppSurface = m_DoneQ.front().second;
+    }else if(m_DoneQ.front().second){
+        SDL_FreeSurface(m_DoneQ.front().second);
+    }
+
+    m_PendingMap.erase(m_DoneQ.front().first);
+    m_DoneQ.pop_front();
+    return true;
+}
+
+bool SurfaceDecoder::Pending(uint32_t nKey)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    return m_PendingMap.find(nKey) != m_PendingMap.end();
+}
+
+size_t SurfaceDecoder::PendingCount()
+{
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    return m_PendingMap.size();
+}
+
+void SurfaceDecoder::MainLoop()
+{
+    // reused for all items
+    std::vector<uint8_t> stBuf;
+
+    while(true){
+        uint32_t nKey = 0;
+        {
+            std::unique_lock<std::mutex> stUniqueLock(m_Lock);
+            m_CV.wait(stUniqueLock, [this]() -> bool
+            {
+                return m_Stop || !m_UrgentQ.empty() || !m_PrefetchQ.empty();
+            });
+
+            if(m_Stop){
+                return;
+            }
+
+            if(!m_UrgentQ.empty()){
+                nKey = m_UrgentQ.front();
+                m_UrgentQ.pop_front();
+            }else{
+                nKey = m_PrefetchQ.front();
+                m_PrefetchQ.pop_front();
+            }
+        }
+
+        SDL_Surface *pSurface = nullptr;
+        if(m_ReadFunc(nKey, &stBuf)){
+            extern SDLDevice *g_SDLDevice;
+            pSurface = g_SDLDevice->CreateSurface(stBuf.data(), stBuf.size());
+
+            // atlas pages are in ARGB8888
+            // convert here then main thread only copies pixels
+            if(pSurface && pSurface->format->format != SDL_PIXELFORMAT_ARGB8888){
+                auto pARGB = SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+                SDL_FreeSurface(pSurface);
+                pSurface = pARGB;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_Lock);
+            m_PendingMap[nKey] = PENDING_DONE;
+            m_DoneQ.emplace_back(nKey, pSurface);
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: surfacedecoder.hpp
+ *        Created: 06/08/2017 10:12:37
+ *  Last Modified: 06/08/2017 18:40:05
+ *
+ *    Description: read and decode png items to SDL_Surface in a worker thread
+ *
+ *                 renderer can only be used in main thread, so the worker stops at
+ *                 the surface, main thread takes the results and creates textures
+ *
+ *                 two queues:
+ *                 1. urgent  : items wanted by current frame, no limit
+ *                 2. prefetch: items may be wanted soon, capped, oldest dropped
+ *
+ *                 a key is pending since Request() till its result is taken, and
+ *                 it can't be requested twice in this period, failed decoding is
+ *                 also reported as a null surface
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <SDL2/SDL.h>
+#include <unordered_map>
+#include <condition_variable>
+
+class SurfaceDecoder final
+{
+    public:
+        // read raw data of the key, called in the worker thread
+        // should be thread-safe with whatever main thread does
+        using ReadFunc = std::function<bool(uint32_t, std::vector<uint8_t> *)>;
+
+    private:
+        enum PendingState: int
+        {
+            PENDING_URGENT,
+            PENDING_PREFETCH,
+            PENDING_DONE,
+        };
+
+    private:
+        const ReadFunc m_ReadFunc;
+        const size_t   m_PrefetchMax;
+
+    private:
+        std::mutex              m_Lock;
+        std::condition_variable m_CV;
+        bool                    m_Stop;
+
+    private:
+        std::deque<uint32_t> m_UrgentQ;
+        std::deque<uint32_t> m_PrefetchQ;
+
+    private:
+        std::unordered_map<uint32_t, int> m_PendingMap;
+
+    private:
+        std::deque<std::pair<uint32_t, SDL_Surface *>> m_DoneQ;
+
+    private:
+        std::thread m_Thread;
+
+    public:
+        SurfaceDecoder(const ReadFunc &, size_t);
+       ~SurfaceDecoder();
+
+    public:
+        SurfaceDecoder(const SurfaceDecoder &) = delete;
+        SurfaceDecoder &operator = (const SurfaceDecoder &) = delete;
+
+    public:
+        // queue a key for decoding, do nothing if it's already pending
+        // a pending prefetch key requested as urgent moves to the urgent queue
+        void Request(uint32_t, bool);
+
+        // take one result, caller owns the surface, which can be null
+        bool Take(uint32_t *, SDL_Surface **);
+
+    public:
+        bool   Pending(uint32_t);
+        size_t PendingCount();
+
+    private:
+        void MainLoop();
+};
@@ -0,0 +1,220 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: texatlas.cpp
+ *        Created: 06/07/2017 09:40:18
+ *  Last Modified: 06/07/2017 17:24:41
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include "texatlas.hpp"
+#include "sdldevice.hpp"
+
+TexAtlas::~TexAtlas()
+{
+    for(auto &rstPage: m_PageV){
+        if(rstPage.Texture){
+            SDL_DestroyTexture(rstPage.Texture);
+        }
+    }
+}
+
+bool TexAtlas::Has(const SDL_Texture *pTexture) const
+{
+    if(pTexture){
+        for(auto &rstPage: m_PageV){
+            if(rstPage.Texture == pTexture){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool TexAtlas::Allocate(int nW, int nH, size_t *pPage, int *pX, int *pY)
+{
+    if(!(nW > 0 && nH > 0 && nW <= m_PageW && nH <= m_PageH)){
+        return false;
+    }
+
+    // shelf height is aligned to 8
+    // then sprites with close heights can share shelves
+    int nShelfH = std::min<int>(m_PageH, (nH + 7) / 8 * 8);
+
+    // 1. best fit among existing shelves
+    //    don't waste more than half of the shelf
+    {
+        Shelf   *pBestShelf   = nullptr;
+        Segment *pBestSegment = nullptr;
+        size_t   nBestPage    = 0;
+
+        for(size_t nPage = 0; nPage < m_PageV.size(); ++nPage){
+            for(auto &rstShelf: m_PageV[nPage].ShelfV){
+                if(true
+                        && rstShelf.H >= nH
+                        && rstShelf.H <= 2 * nShelfH
+                        && (!pBestShelf || rstShelf.H < pBestShelf->H)){
+                    for(auto &rstSegment: rstShelf.FreeV){
+                        if(rstSegment.W >= nW){
+                            pBestShelf   = &rstShelf;
+                            pBestSegment = &rstSegment;
+                            nBestPage    = nPage;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if(pBestShelf){
+            *pPage = nBestPage;
+            *pX    = pBestSegment->X;
+            *pY    = pBestShelf->Y;
+
+            pBestSegment->X += nW;
+            pBestSegment->W -= nW;
+
+            if(!pBestSegment->W){
+                pBestShelf->FreeV.erase(pBestShelf->FreeV.begin() + (pBestSegment - &(pBestShelf->FreeV[0])));
+            }
+            return true;
+        }
+    }
+
+    // 2. open a new shelf
+    //    in existing pages, or in a new page
+    for(size_t nPage = 0; nPage <= m_PageV.size(); ++nPage){
+        if(nPage == m_PageV.size()){
+            extern SDLDevice *g_SDLDevice;
+            if(auto pTexture = g_SDLDevice->CreateBlankTexture(m_PageW, m_PageH)){
+                m_PageV.push_back({pTexture, 0, 0, {}});
+            }else{
+                return false;
+            }
+        }
+
+        auto &rstPage = m_PageV[nPage];
+        if(rstPage.Bottom + nShelfH <= m_PageH){
+            rstPage.ShelfV.push_back({rstPage.Bottom, nShelfH, {}});
+            if(nW < m_PageW){
+                rstPage.ShelfV.back().FreeV.push_back({nW, m_PageW - nW});
+            }
+
+            *pPage = nPage;
+            *pX    = 0;
+            *pY    = rstPage.Bottom;
+
+            rstPage.Bottom += nShelfH;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TexAtlas::Add(SDL_Surface *pSurface, TexRegion *pRegion)
+{
+    if(!(pSurface && pRegion)){
+        return false;
+    }
+
+    size_t nPage = 0;
+    int    nX    = 0;
+    int    nY    = 0;
+
+    if(!Allocate(pSurface->w, pSurface->h, &nPage, &nX, &nY)){
+        return false;
+    }
+
+    // pages are in ARGB8888
+    // convert if the decoder gives something else
+    auto pARGB = pSurface;
+    if(pSurface->format->format != SDL_PIXELFORMAT_ARGB8888){
+        pARGB = SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_ARGB8888, 0);
+    }
+
+    bool bUpdated = false;
+    if(pARGB && !SDL_LockSurface(pARGB)){
+        SDL_Rect stRect {nX, nY, pSurface->w, pSurface->h};
+        bUpdated = !SDL_UpdateTexture(m_PageV[nPage].Texture, &stRect, pARGB->pixels, pARGB->pitch);
+        SDL_UnlockSurface(pARGB);
+    }
+
+    if(pARGB && (pARGB != pSurface)){
+        SDL_FreeSurface(pARGB);
+    }
+
+    TexRegion stRegion {m_PageV[nPage].Texture, nX, nY, pSurface->w, pSurface->h};
+    m_PageV[nPage].Count++;
+
+    if(!bUpdated){
+        Free(stRegion);
+        return false;
+    }
+
+    *pRegion = stRegion;
+    return true;
+}
+
+void TexAtlas::Free(const TexRegion &rstRegion)
+{
+    for(auto &rstPage: m_PageV){
+        if(rstPage.Texture != rstRegion.Texture){
+            continue;
+        }
+
+        for(auto &rstShelf: rstPage.ShelfV){
+            if(rstShelf.Y != rstRegion.Y){
+                continue;
+            }
+
+            // give the segment back, merge with neighbors
+            auto pNext = std::lower_bound(rstShelf.FreeV.begin(), rstShelf.FreeV.end(), rstRegion.X, [](const Segment &rstSegment, int nX) -> bool
+            {
+                return rstSegment.X < nX;
+            });
+
+            auto pCurr = rstShelf.FreeV.insert(pNext, {rstRegion.X, rstRegion.W});
+            if((pCurr + 1 != rstShelf.FreeV.end()) && (pCurr->X + pCurr->W == (pCurr + 1)->X)){
+                pCurr->W += (pCurr + 1)->W;
+                rstShelf.FreeV.erase(pCurr + 1);
+            }
+
+            if((pCurr != rstShelf.FreeV.begin()) && ((pCurr - 1)->X + (pCurr - 1)->W == pCurr->X)){
+                (pCurr - 1)->W += pCurr->W;
+                rstShelf.FreeV.erase(pCurr);
+            }
+            break;
+        }
+
+        // drop empty shelves on the top, then they can be opened with other heights
+        while(true
+                && !rstPage.ShelfV.empty()
+                &&  rstPage.ShelfV.back().FreeV.size() == 1
+                &&  rstPage.ShelfV.back().FreeV[0].W == m_PageW){
+            rstPage.Bottom -= rstPage.ShelfV.back().H;
+            rstPage.ShelfV.pop_back();
+        }
+
+        if(rstPage.Count){
+            rstPage.Count--;
+        }
+
+        if(!rstPage.Count){
+            rstPage.Bottom = 0;
+            rstPage.ShelfV.clear();
+        }
+        return;
+    }
+}
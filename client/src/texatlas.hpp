@@ -0,0 +1,118 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: texatlas.hpp
+ *        Created: 06/07/2017 09:12:40
+ *  Last Modified: 06/07/2017 17:25:03
+ *
+ *    Description: pack small textures into large pages, then most sprites drawn in
+ *                 one frame share a few textures and SDL can batch the copies
+ *
+ *                 shelf packer: each page is cut into horizontal shelves, one shelf
+ *                 holds sprites of similar height side by side, free segments of a
+ *                 shelf are reused, a page is reset when all its sprites are freed
+ *
+ *                 sprites larger than one page are not accepted, caller should keep
+ *                 them as individual textures
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <SDL2/SDL.h>
+
+// a texture, or part of an atlas page
+// X/Y/W/H is the sub-rect in Texture, null Texture for invalid one
+struct TexRegion
+{
+    SDL_Texture *Texture;
+
+    int X;
+    int Y;
+    int W;
+    int H;
+
+    explicit operator bool () const
+    {
+        return Texture != nullptr;
+    }
+};
+
+class TexAtlas final
+{
+    private:
+        struct Segment
+        {
+            int X;
+            int W;
+        };
+
+        struct Shelf
+        {
+            int Y;
+            int H;
+
+            // sorted by X, never adjacent
+            std::vector<Segment> FreeV;
+        };
+
+        struct Page
+        {
+            SDL_Texture *Texture;
+
+            size_t Count;
+            int    Bottom;
+
+            std::vector<Shelf> ShelfV;
+        };
+
+    private:
+        const int m_PageW;
+        const int m_PageH;
+
+    private:
+        std::vector<Page> m_PageV;
+
+    public:
+        TexAtlas(int nPageW, int nPageH)
+            : m_PageW(nPageW)
+            , m_PageH(nPageH)
+            , m_PageV()
+        {}
+
+       ~TexAtlas();
+
+    public:
+        TexAtlas(const TexAtlas &) = delete;
+        TexAtlas &operator = (const TexAtlas &) = delete;
+
+    public:
+        // copy the surface into the atlas
+        // return false if it doesn't fit, nothing changed
+        bool Add(SDL_Surface *, TexRegion *);
+
+        // region should be returned by Add()
+        void Free(const TexRegion &);
+
+    public:
+        bool Has(const SDL_Texture *) const;
+
+    public:
+        size_t PageCount() const
+        {
+            return m_PageV.size();
+        }
+
+    private:
+        bool Allocate(int, int, size_t *, int *, int *);
+};
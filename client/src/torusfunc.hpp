@@ -0,0 +1,65 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: torusfunc.hpp
+ *        Created: 06/06/2017 16:10:22
+ *  Last Modified: 06/06/2017 21:35:40
+ *
+ *    Description: coordinates of a texture used as a torus, see StaticMapLayer
+ *                 map pixel x always goes to (x mod size) of the texture
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <cstdlib>
+
+// non-negative for negative nX
+inline int TorusMod(int nX, int nSize)
+{
+    return ((nX % nSize) + nSize) % nSize;
+}
+
+// split [nX, nX + nW) of the map into pieces continuous in the texture
+// nW <= nSize, so at most two pieces, fnOnPiece(nMapX, nTexX, nLen)
+template<typename F> void TorusSplit(int nX, int nW, int nSize, const F &fnOnPiece)
+{
+    int nTexX = TorusMod(nX, nSize);
+    if(nTexX + nW <= nSize){
+        fnOnPiece(nX, nTexX, nW);
+    }else{
+        fnOnPiece(nX, nTexX, nSize - nTexX);
+        fnOnPiece(nX + nSize - nTexX, 0, nW - (nSize - nTexX));
+    }
+}
+
+// regions of the map newly exposed when the nW x nH view rolls from (nX0, nY0) to (nX1, nY1)
+// fnOnRegion(nX, nY, nW, nH), the corner could be reported twice, that's OK
+// rolling by the view size or more exposes the whole view
+template<typename F> void TorusExposed(int nX0, int nY0, int nX1, int nY1, int nW, int nH, const F &fnOnRegion)
+{
+    if(std::abs(nX1 - nX0) >= nW || std::abs(nY1 - nY0) >= nH){
+        fnOnRegion(nX1, nY1, nW, nH);
+        return;
+    }
+
+    if(nX1 > nX0){
+        fnOnRegion(nX0 + nW, nY1, nX1 - nX0, nH);
+    }else if(nX1 < nX0){
+        fnOnRegion(nX1, nY1, nX0 - nX1, nH);
+    }
+
+    if(nY1 > nY0){
+        fnOnRegion(nX1, nY0 + nH, nW, nY1 - nY0);
+    }else if(nY1 < nY0){
+        fnOnRegion(nX1, nY1, nW, nY0 - nY1);
+    }
+}
@@ -0,0 +1,156 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: bitgrid.hpp
+ *        Created: 06/02/2017 09:36:10
+ *  Last Modified: 06/05/2017 10:41:26
+ *
+ *    Description: one bit per cell of a W x H grid, row-major, packed in uint64_t
+ *
+ *                 for per-cell flags which are checked very often, i.e. walkability and
+ *                 occupancy, one bit test instead of decoding map data or scanning lists,
+ *                 and whole-grid queries work on 64 cells at a time
+ *
+ *                 out of grid reads as false, writes are ignored
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class BitGrid
+{
+    protected:
+        int m_W;
+        int m_H;
+
+    protected:
+        // bits after W * H in the last word are always zero
+        std::vector<uint64_t> m_BitV;
+
+    protected:
+        // count of set bits, kept by Set()
+        size_t m_Count;
+
+    public:
+        BitGrid(int nW = 0, int nH = 0)
+            : m_W((nW > 0) ? nW : 0)
+            , m_H((nH > 0) ? nH : 0)
+            , m_BitV(((size_t)(m_W) * m_H + 63) / 64, 0)
+            , m_Count(0)
+        {}
+
+    public:
+        int W() const { return m_W; }
+        int H() const { return m_H; }
+
+    public:
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+    public:
+        bool Get(int nX, int nY) const
+        {
+            if(ValidC(nX, nY)){
+                auto nIndex = (size_t)(nY) * m_W + nX;
+                return (m_BitV[nIndex / 64] >> (nIndex % 64)) & 1;
+            }
+            return false;
+        }
+
+        void Set(int nX, int nY, bool bValue)
+        {
+            if(ValidC(nX, nY)){
+                auto nIndex = (size_t)(nY) * m_W + nX;
+                auto nMask  = (uint64_t)(1) << (nIndex % 64);
+                auto &rstWord = m_BitV[nIndex / 64];
+
+                if(bValue != ((rstWord & nMask) != 0)){
+                    if(bValue){
+                        rstWord |= nMask;
+                        m_Count++;
+                    }else{
+                        rstWord &= ~nMask;
+                        m_Count--;
+                    }
+                }
+            }
+        }
+
+    public:
+        // no bit set
+        bool None() const
+        {
+            return m_Count == 0;
+        }
+
+        size_t Count() const
+        {
+            return m_Count;
+        }
+
+    public:
+        // for queries combining multiple grids of the same size word by word
+        // cell (nX, nY) is bit ((nY * W + nX) % 64) of word ((nY * W + nX) / 64)
+        const std::vector<uint64_t> &Words() const
+        {
+            return m_BitV;
+        }
+
+    public:
+        // bit helpers for word by word queries
+        // builtins of gcc/clang are not portable, fallback for other compilers
+        static int PopCount(uint64_t nBits)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_popcountll(nBits);
+#else
+            int nCount = 0;
+            for(; nBits; nBits &= (nBits - 1)){
+                nCount++;
+            }
+            return nCount;
+#endif
+        }
+
+        // index of the lowest set bit, nBits should be non-zero
+        static int LowestBit(uint64_t nBits)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(nBits);
+#else
+            int nIndex = 0;
+            for(; !(nBits & 1); nBits >>= 1){
+                nIndex++;
+            }
+            return nIndex;
+#endif
+        }
+
+    public:
+        // FNV-1a of all bits
+        // to check if data built from this grid is out of date
+        uint64_t Checksum() const
+        {
+            uint64_t nHash = 14695981039346656037ULL;
+            for(auto nBits: m_BitV){
+                for(int nByte = 0; nByte < 8; ++nByte){
+                    nHash = (nHash ^ ((nBits >> (nByte * 8)) & 0XFF)) * 1099511628211ULL;
+                }
+            }
+            return nHash;
+        }
+};
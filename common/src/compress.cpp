@@ -5,7 +5,19 @@
  *        Created: 04/23/2017 21:34:23
  *  Last Modified: 04/25/2017 14:25:47
  *
- *    Description: 
+ *    Description: codec for fixed size server / client messages
+ *
+ *                 data stream is [Mask][Comp], bit i of Mask is set iif byte i of the
+ *                 origin data is not zero, Comp are all non-zero bytes in order
+ *
+ *                 CountData / Encode / Decode have three implementations:
+ *                      1. scalar : byte-at-a-time, works everywhere
+ *                      2. SSE2   : build mask by compare + movemask for 16 bytes
+ *                      3. AVX2   : build mask for 32 bytes, compaction and expansion
+ *                                  by byte shuffle with 256-entry tables
+ *
+ *                 implementation is selected at runtime by cpu features, all of them
+ *                 produce exactly the same stream
  *
  *        Version: 1.0
  *       Revision: none
@@ -18,65 +30,327 @@
  * =====================================================================================
  */
 
-#include <memory>
 #include <cstring>
 #include "compress.hpp"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIR2X_COMPRESS_X86
+#include <immintrin.h>
+#endif
+
 int Compress::CountMask(const uint8_t *pData, size_t nDataLen)
 {
     if(pData){
-        int  nMaskCount = 0;
-        auto pOrigBegin = pData;
+        // count by 8 bytes and use memcpy to avoid the alignment and strict-aliasing issue
+        // compiler makes it a plain load
+        //
+        // previously it used std::align() and counted the last partial word twice
+        // the mask count is used to verify the compressed length, so it should be exact
+        int nMaskCount = 0;
+        size_t nIndex  = 0;
 
-        // need better understanding of std::align()
-        // http://en.cppreference.com/w/cpp/memory/align
-        // document says it does nothing if the given buffer is too small to fit
+        for(; nIndex + sizeof(unsigned long long) <= nDataLen; nIndex += sizeof(unsigned long long)){
+            unsigned long long nWord = 0;
+            std::memcpy(&nWord, pData + nIndex, sizeof(nWord));
+            nMaskCount += __builtin_popcountll(nWord);
+        }
 
-        // we may have smaller memory chunk at the begin and end of pData
-        // but [pData, pData + nDataLen) is enough to hold at least one unsign long long if not return nullptr
+        for(; nIndex < nDataLen; ++nIndex){
+            nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
+        }
+        return nMaskCount;
+    }
+    return -1;
+}
 
-        // nasty casts, std::align only accpet (void * &)
-        auto pCastData = static_cast<void *>(const_cast<uint8_t *>(pData));
+namespace
+{
+    int CountDataScalar(const uint8_t *pData, size_t nDataLen)
+    {
+        int nCount = 0;
+        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+            nCount += (pData[nIndex] ? 1 : 0);
+        }
+        return nCount;
+    }
 
-        // if succeed after this call pData and nDataLen will be adjusted
-        if(std::align(alignof(unsigned long long), sizeof(unsigned long long), pCastData, nDataLen)){
-            for(size_t nIndex = 0; nIndex < nDataLen; nIndex += sizeof(unsigned long long)){
-                // TODO remove the strict-aliasing issue here
-                nMaskCount += __builtin_popcountll(*((unsigned long long *)((const uint8_t *)(pCastData) + nIndex)));
+    // encode / decode [nBegin, nDataLen) byte by byte, nBegin should be multiple of 8
+    // SIMD implementations use them for the rest bytes
+    // mask bytes for the range will be cleared first
+    int EncodeTail(uint8_t *pMask, uint8_t *pComp, const uint8_t *pData, size_t nBegin, size_t nDataLen, int nDataCount)
+    {
+        std::memset(pMask + nBegin / 8, 0, (nDataLen + 7) / 8 - nBegin / 8);
+        for(size_t nIndex = nBegin; nIndex < nDataLen; ++nIndex){
+            if(pData[nIndex]){
+                pMask[nIndex / 8  ] |= (0X01 << (nIndex % 8));
+                pComp[nDataCount++]  = pData[nIndex];
             }
         }
+        return nDataCount;
+    }
 
-        // we always do it no matter align succeed or not
-        pData = (const uint8_t *)(pCastData);
+    int DecodeTail(uint8_t *pOrig, const uint8_t *pMask, const uint8_t *pComp, size_t nBegin, size_t nDataLen, int nDecodeCount)
+    {
+        for(size_t nIndex = nBegin; nIndex < nDataLen; ++nIndex){
+            pOrig[nIndex] = (pMask[nIndex / 8] & (0x01 << (nIndex % 8))) ? pComp[nDecodeCount++] : 0;
+        }
+        return nDecodeCount;
+    }
 
-        // for (possible) memory chunk at the begin
-        // pData could be adjusted by std::align() if succeed
-        for(const uint8_t *pBegin = pOrigBegin; pBegin < pData; ++pBegin){
-            nMaskCount += __builtin_popcount((unsigned int)(*pBegin));
+    // compact / expand 8 bytes by one mask byte
+    // used for the groups the SIMD path can't load or store as a whole
+    int CompactByte(uint8_t *pComp, const uint8_t *pData, uint8_t nMask)
+    {
+        int nCount = 0;
+        while(nMask){
+            auto nBit = __builtin_ctz((unsigned int)(nMask));
+            pComp[nCount++] = pData[nBit];
+            nMask &= (nMask - 1);
         }
+        return nCount;
+    }
 
-        // for (possible) memory chunk at the end
-        // pData and nDataLen could be adjusted by std::align() if succeed
-        if(auto nRest = nDataLen % sizeof(unsigned long long)){
-            for(size_t nIndex = nDataLen - nRest; nIndex < nDataLen; ++nIndex){
-                nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
+    int ExpandByte(uint8_t *pOrig, const uint8_t *pComp, uint8_t nMask)
+    {
+        int nCount = 0;
+        for(int nBit = 0; nBit < 8; ++nBit){
+            pOrig[nBit] = (nMask & (0x01 << nBit)) ? pComp[nCount++] : 0;
+        }
+        return nCount;
+    }
+
+    int EncodeScalar(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+    {
+        return EncodeTail(pDst, pDst + (nDataLen + 7) / 8, pData, 0, nDataLen, 0);
+    }
+
+    int DecodeScalar(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+    {
+        return DecodeTail(pOrig, pMask, pComp, 0, nDataLen, 0);
+    }
+
+#ifdef MIR2X_COMPRESS_X86
+    // shuffle tables indexed by mask byte
+    // Compact[m] : gather the non-zero bytes of an 8-byte group to the front
+    // Expand[m]  : scatter packed bytes back to the set positions, 0X80 gives zero
+    struct ShuffleTable
+    {
+        uint8_t Compact[256][8];
+        uint8_t Expand [256][8];
+
+        ShuffleTable()
+        {
+            for(int nMask = 0; nMask < 256; ++nMask){
+                int nCount = 0;
+                for(int nBit = 0; nBit < 8; ++nBit){
+                    Compact[nMask][nBit] = 0X80;
+                    Expand [nMask][nBit] = 0X80;
+                }
+
+                for(int nBit = 0; nBit < 8; ++nBit){
+                    if(nMask & (0x01 << nBit)){
+                        Compact[nMask][nCount] = (uint8_t)(nBit);
+                        Expand [nMask][nBit  ] = (uint8_t)(nCount);
+                        nCount++;
+                    }
+                }
             }
         }
+    };
 
-        // done, return the count
-        return nMaskCount;
+    const ShuffleTable &GetShuffleTable()
+    {
+        static const ShuffleTable s_ShuffleTable;
+        return s_ShuffleTable;
+    }
+
+    __attribute__((target("sse2"))) int CountDataSSE2(const uint8_t *pData, size_t nDataLen)
+    {
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        const auto stZero = _mm_setzero_si128();
+        for(; nIndex + 16 <= nDataLen; nIndex += 16){
+            auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+            auto nZero  = (unsigned int)(_mm_movemask_epi8(_mm_cmpeq_epi8(stData, stZero)));
+            nCount += (16 - __builtin_popcount(nZero));
+        }
+        return nCount + CountDataScalar(pData + nIndex, nDataLen - nIndex);
+    }
+
+    __attribute__((target("sse2"))) int EncodeSSE2(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+    {
+        auto pMask = pDst;
+        auto pComp = pDst + (nDataLen + 7) / 8;
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        const auto stZero = _mm_setzero_si128();
+        for(; nIndex + 16 <= nDataLen; nIndex += 16){
+            auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+            auto nBits  = (~(unsigned int)(_mm_movemask_epi8(_mm_cmpeq_epi8(stData, stZero)))) & 0XFFFF;
+
+            pMask[nIndex / 8 + 0] = (uint8_t)(nBits & 0XFF);
+            pMask[nIndex / 8 + 1] = (uint8_t)(nBits >> 8);
+
+            nCount += CompactByte(pComp + nCount, pData + nIndex + 0, (uint8_t)(nBits & 0XFF));
+            nCount += CompactByte(pComp + nCount, pData + nIndex + 8, (uint8_t)(nBits >> 8));
+        }
+        return EncodeTail(pMask, pComp, pData, nIndex, nDataLen, nCount);
+    }
+
+    int DecodeSSE2(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+    {
+        // no byte shuffle in SSE2
+        // only shortcut the empty and full groups, they are the most common
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 8 <= nDataLen; nIndex += 8){
+            switch(auto nMask = pMask[nIndex / 8]){
+                case 0X00:
+                    {
+                        std::memset(pOrig + nIndex, 0, 8);
+                        break;
+                    }
+                case 0XFF:
+                    {
+                        std::memcpy(pOrig + nIndex, pComp + nCount, 8);
+                        nCount += 8;
+                        break;
+                    }
+                default:
+                    {
+                        nCount += ExpandByte(pOrig + nIndex, pComp + nCount, nMask);
+                        break;
+                    }
+            }
+        }
+        return DecodeTail(pOrig, pMask, pComp, nIndex, nDataLen, nCount);
+    }
+
+    __attribute__((target("avx2"))) int CountDataAVX2(const uint8_t *pData, size_t nDataLen)
+    {
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        const auto stZero = _mm256_setzero_si256();
+        for(; nIndex + 32 <= nDataLen; nIndex += 32){
+            auto stData = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+            auto nZero  = (unsigned int)(_mm256_movemask_epi8(_mm256_cmpeq_epi8(stData, stZero)));
+            nCount += (32 - __builtin_popcount(nZero));
+        }
+        return nCount + CountDataSSE2(pData + nIndex, nDataLen - nIndex);
+    }
+
+    __attribute__((target("avx2"))) int EncodeAVX2(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+    {
+        // most messages are shorter than one vector
+        // don't pay the extra CountDataAVX2() pass if the loop below won't run
+        if(nDataLen < 32){
+            return EncodeScalar(pDst, pData, nDataLen);
+        }
+
+        auto pMask = pDst;
+        auto pComp = pDst + (nDataLen + 7) / 8;
+
+        // the 8-byte store of a compacted group may write over its own length
+        // output buffer has exact size, so do it only if the rest non-zero bytes can cover it
+        const auto nTotal = CountDataAVX2(pData, nDataLen);
+        const auto &rstTable = GetShuffleTable();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        const auto stZero = _mm256_setzero_si256();
+        for(; nIndex + 32 <= nDataLen; nIndex += 32){
+            auto stData = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+            auto nBits  = ~(uint32_t)(_mm256_movemask_epi8(_mm256_cmpeq_epi8(stData, stZero)));
+
+            for(int nGroup = 0; nGroup < 4; ++nGroup){
+                auto nMask  = (uint8_t)((nBits >> (nGroup * 8)) & 0XFF);
+                auto pGroup = pData + nIndex + nGroup * 8;
+
+                pMask[nIndex / 8 + nGroup] = nMask;
+                if(nCount + 8 <= nTotal){
+                    auto stGroup   = _mm_loadl_epi64((const __m128i *)(pGroup));
+                    auto stShuffle = _mm_loadl_epi64((const __m128i *)(rstTable.Compact[nMask]));
+                    _mm_storel_epi64((__m128i *)(pComp + nCount), _mm_shuffle_epi8(stGroup, stShuffle));
+                    nCount += __builtin_popcount((unsigned int)(nMask));
+                }else{
+                    nCount += CompactByte(pComp + nCount, pGroup, nMask);
+                }
+            }
+        }
+        return EncodeTail(pMask, pComp, pData, nIndex, nDataLen, nCount);
+    }
+
+    __attribute__((target("avx2"))) int DecodeAVX2(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+    {
+        // the 8-byte load of packed bytes may read over its own length
+        // do it only if it's inside the compressed stream
+        const auto nCompLen = Compress::CountMask(pMask, (nDataLen + 7) / 8);
+        const auto &rstTable = GetShuffleTable();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 8 <= nDataLen; nIndex += 8){
+            auto nMask = pMask[nIndex / 8];
+            if(nCount + 8 <= nCompLen){
+                auto stComp    = _mm_loadl_epi64((const __m128i *)(pComp + nCount));
+                auto stShuffle = _mm_loadl_epi64((const __m128i *)(rstTable.Expand[nMask]));
+                _mm_storel_epi64((__m128i *)(pOrig + nIndex), _mm_shuffle_epi8(stComp, stShuffle));
+                nCount += __builtin_popcount((unsigned int)(nMask));
+            }else{
+                nCount += ExpandByte(pOrig + nIndex, pComp + nCount, nMask);
+            }
+        }
+        return DecodeTail(pOrig, pMask, pComp, nIndex, nDataLen, nCount);
+    }
+#endif
+
+    struct CompressCodec
+    {
+        const char *Name;
+
+        int (*CountData)(const uint8_t *, size_t);
+        int (*Encode)(uint8_t *, const uint8_t *, size_t);
+        int (*Decode)(uint8_t *, size_t, const uint8_t *, const uint8_t *);
+    };
+
+    CompressCodec SelectCodec()
+    {
+#ifdef MIR2X_COMPRESS_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2")){
+            return {"AVX2", CountDataAVX2, EncodeAVX2, DecodeAVX2};
+        }
+
+        if(__builtin_cpu_supports("sse2")){
+            return {"SSE2", CountDataSSE2, EncodeSSE2, DecodeSSE2};
+        }
+#endif
+        return {"Scalar", CountDataScalar, EncodeScalar, DecodeScalar};
+    }
+
+    const CompressCodec &GetCodec()
+    {
+        static const CompressCodec s_Codec = SelectCodec();
+        return s_Codec;
     }
-    return -1;
+}
+
+const char *Compress::CodecName()
+{
+    return GetCodec().Name;
 }
 
 int Compress::CountData(const uint8_t *pData, size_t nDataLen)
 {
     if(pData){
-        int nCount = 0;
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            nCount += (pData[nIndex] ? 1 : 0);
-        }
-        return nCount;
+        return GetCodec().CountData(pData, nDataLen);
     }
     return -1;
 }
@@ -84,20 +358,7 @@ int Compress::CountData(const uint8_t *pData, size_t nDataLen)
 int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
 {
     if(pDst && pData && nDataLen){
-        auto nMaskLen = ((nDataLen + 7) / 8);
-        auto pMask = pDst;
-        auto pComp = pDst + nMaskLen;
-
-        std::memset(pMask, 0, nMaskLen);
-
-        int nDataCount = 0;
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            if(pData[nIndex]){
-                pMask[nIndex / 8  ] |= (0X01 << (nIndex % 8));
-                pComp[nDataCount++]  = pData[nIndex];
-            }
-        }
-        return nDataCount;
+        return GetCodec().Encode(pDst, pData, nDataLen);
     }
     return -1;
 }
@@ -105,11 +366,7 @@ int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
 int Compress::Decode(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
 {
     if(pOrig && nDataLen && pMask && pComp){
-        int nDecodeCount = 0;
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            pOrig[nIndex] = (pMask[nIndex / 8] & (0x01 << (nIndex % 8))) ? pComp[nDecodeCount++] : 0;
-        }
-        return nDecodeCount;
+        return GetCodec().Decode(pOrig, nDataLen, pMask, pComp);
     }
     return -1;
 }
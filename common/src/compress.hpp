@@ -29,4 +29,7 @@ namespace Compress
 
     int Encode(uint8_t *, const uint8_t *, size_t);
     int Decode(uint8_t *, size_t, const uint8_t *, const uint8_t *);
+
+    // implementation selected by cpu features: "AVX2", "SSE2" or "Scalar"
+    const char *CodecName();
 }
@@ -3,9 +3,15 @@
  *
  *       Filename: eventtask.hpp
  *        Created: 04/03/2016 22:55:21
- *  Last Modified: 04/21/2016 18:11:02
+ *  Last Modified: 05/25/2017 16:20:37
  *
- *    Description: 
+ *    Description: timer node of EventTaskHub, only the hub can create it
+ *
+ *                 one node is shared by the hub and the handles returned to callers, it's
+ *                 reference counted and released to the hub's pool by the last owner
+ *
+ *                 m_Done     : cancelled, or an one-shot task has been invoked
+ *                 m_Running  : hub thread is invoking m_Func
  *
  *        Version: 1.0
  *       Revision: none
@@ -19,37 +25,48 @@
  */
 #pragma once
 
-#include "task.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 
-class EventTask: public Task
+class EventTaskHub;
+class EventTask final
 {
-    public:
+    private:
         friend class EventTaskHub;
 
-    protected:
-		uint32_t m_EventID;
+    private:
+        EventTaskHub *m_Hub;
 
-	protected:
-		EventTask(uint32_t nDelayMS, const std::function<void (void)>& fnOp)
-            : Task(nDelayMS, fnOp)
-            , m_EventID(0)
-        {}
+    private:
+        std::function<void()>                 m_Func;
+        std::chrono::steady_clock::time_point m_Expiration;
+        uint32_t                              m_PeriodMS;
 
-        virtual ~EventTask() = default;
+    private:
+        // only accessed by the hub thread
+        // m_Next links the node in the submission queue or a wheel slot
+        uint64_t   m_ExpireTick;
+        EventTask *m_Next;
 
-	public:
-		void ID(uint32_t nID)
-        {
-			m_EventID = nID;
-		}
+    private:
+        std::atomic<int>  m_RefCount;
+        std::atomic<bool> m_Done;
+        std::atomic<bool> m_Running;
 
-		uint32_t ID() const
-        {
-			return m_EventID;
-		}
+    private:
+        EventTask(EventTaskHub *pHub, uint32_t nDelayMS, uint32_t nPeriodMS, std::function<void()> &&fnOp)
+            : m_Hub(pHub)
+            , m_Func(std::move(fnOp))
+            , m_Expiration(std::chrono::steady_clock::now() + std::chrono::milliseconds(nDelayMS))
+            , m_PeriodMS(nPeriodMS)
+            , m_ExpireTick(0)
+            , m_Next(nullptr)
+            , m_RefCount(1)
+            , m_Done(false)
+            , m_Running(false)
+        {}
 
-        std::chrono::system_clock::time_point Cycle() const
-        {
-            return m_Expiration;
-        }
+        ~EventTask() = default;
 };
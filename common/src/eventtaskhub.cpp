@@ -0,0 +1,342 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: eventtaskhub.cpp
+ *        Created: 05/25/2017 14:02:11
+ *  Last Modified: 05/25/2017 17:51:26
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <new>
+#include <thread>
+#include "eventtaskhub.hpp"
+
+EventTaskHub::EventTaskHub()
+    : BaseHub<EventTaskHub>()
+    , m_StartTime(std::chrono::steady_clock::now())
+    , m_SubmitHead(nullptr)
+    , m_Idle(false)
+    , m_WaitLock()
+    , m_WaitCV()
+    , m_CurrTick(0)
+    , m_TaskCount(0)
+    , m_Level0()
+    , m_LevelN()
+    , m_EventTaskBlockPN()
+{
+    m_Level0.fill(nullptr);
+    for(auto &rstLevel: m_LevelN){
+        rstLevel.fill(nullptr);
+    }
+}
+
+EventTaskHub::~EventTaskHub()
+{
+    Shutdown();
+    Join();
+
+    // tasks submitted after the hub thread exited
+    Clear();
+}
+
+EventTask *EventTaskHub::CreateEventTask(uint32_t nDelayMS, uint32_t nPeriodMS, std::function<void()> &&fnOp)
+{
+    auto pData = m_EventTaskBlockPN.Get();
+    if(!pData){ return nullptr; }
+
+    return new (pData) EventTask(this, nDelayMS, nPeriodMS, std::move(fnOp));
+}
+
+void EventTaskHub::DeleteEventTask(EventTask *pTask)
+{
+    if(!pTask){ return; }
+
+    pTask->~EventTask();
+    m_EventTaskBlockPN.Free(pTask);
+}
+
+void EventTaskHub::Release(EventTask *pTask)
+{
+    if(pTask){
+        if(pTask->m_RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            pTask->m_Hub->DeleteEventTask(pTask);
+        }
+    }
+}
+
+EventTaskHub::Handle EventTaskHub::Submit(uint32_t nDelayMS, uint32_t nPeriodMS, std::function<void()> &&fnOp)
+{
+    if(!(State() && fnOp)){
+        return {};
+    }
+
+    auto pTask = CreateEventTask(nDelayMS, nPeriodMS, std::move(fnOp));
+    if(!pTask){
+        return {};
+    }
+
+    // one reference for the hub, one for the handle
+    pTask->m_RefCount.store(2, std::memory_order_relaxed);
+
+    auto pHead = m_SubmitHead.load();
+    do{
+        pTask->m_Next = pHead;
+    }while(!m_SubmitHead.compare_exchange_weak(pHead, pTask));
+
+    // only the idle hub thread waits for submission
+    // lock before notify, otherwise it may miss the signal between its check and wait
+    if(m_Idle.load()){
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_WaitLock);
+        }
+        m_WaitCV.notify_one();
+    }
+    return Handle(pTask);
+}
+
+bool EventTaskHub::Dismiss(const Handle &rstHandle)
+{
+    auto pTask = rstHandle.m_Task;
+    if(!pTask){
+        return false;
+    }
+
+    // won't unlink the node from the wheel, it's dropped when its slot expires
+    // this makes Dismiss() O(1) and callable from any thread
+    bool bDismissed = !pTask->m_Done.exchange(true);
+
+    if(std::this_thread::get_id() != m_Thread.get_id()){
+        while(pTask->m_Running.load()){
+            std::this_thread::yield();
+        }
+    }
+    return bDismissed;
+}
+
+void EventTaskHub::Shutdown()
+{
+    // 1. set it as terminated
+    State(false);
+
+    // 2. wake the hub thread, it clears all un-invoked tasks before exit
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_WaitLock);
+    }
+    m_WaitCV.notify_one();
+}
+
+uint64_t EventTaskHub::CurrentTick() const
+{
+    auto nNS = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_StartTime).count();
+    return (uint64_t)(nNS) / (TICK_MS * 1000000ULL);
+}
+
+uint64_t EventTaskHub::ExpireTick(const EventTask *pTask) const
+{
+    // round up, never invoke a task before its expiration
+    auto nNS = std::chrono::duration_cast<std::chrono::nanoseconds>(pTask->m_Expiration - m_StartTime).count();
+    return (nNS > 0) ? (((uint64_t)(nNS) + TICK_MS * 1000000ULL - 1) / (TICK_MS * 1000000ULL)) : 0;
+}
+
+void EventTaskHub::Schedule(EventTask *pTask)
+{
+    // tasks already expired go to current slot
+    // m_CurrTick is the next tick to run, it's not in progress
+    auto nExpireTick = (pTask->m_ExpireTick > m_CurrTick) ? pTask->m_ExpireTick : m_CurrTick;
+    auto nDelta      = nExpireTick - m_CurrTick;
+
+    EventTask **ppSlot = nullptr;
+    if(nDelta < LEVEL0_SIZE){
+        ppSlot = &(m_Level0[nExpireTick % LEVEL0_SIZE]);
+    }else{
+        // too far away, park it in the farthest slot
+        // it will be cascaded and re-scheduled with its real expire tick
+        if(nDelta >= WHEEL_SPAN){
+            nExpireTick = m_CurrTick + WHEEL_SPAN - 1;
+        }
+
+        int nLevel = 1;
+        while(nDelta >= (LEVEL0_SIZE << (LEVELN_BITS * nLevel)) && nLevel < LEVEL_COUNT - 1){
+            nLevel++;
+        }
+        ppSlot = &(m_LevelN[nLevel - 1][(nExpireTick >> (LEVEL0_BITS + LEVELN_BITS * (nLevel - 1))) % LEVELN_SIZE]);
+    }
+
+    pTask->m_Next = *ppSlot;
+    *ppSlot = pTask;
+}
+
+void EventTaskHub::Cascade(EventTask *pTask)
+{
+    while(pTask){
+        auto pNext = pTask->m_Next;
+        if(pTask->m_Done.load()){
+            m_TaskCount--;
+            Release(pTask);
+        }else{
+            Schedule(pTask);
+        }
+        pTask = pNext;
+    }
+}
+
+void EventTaskHub::RunTick()
+{
+    // 1. cascade from the highest level
+    //    then tasks moved down can be cascaded again in the same tick
+    for(int nLevel = LEVEL_COUNT - 1; nLevel >= 1; --nLevel){
+        auto nShift = LEVEL0_BITS + LEVELN_BITS * (nLevel - 1);
+        if(m_CurrTick % (1ULL << nShift) == 0){
+            auto &rstSlot = m_LevelN[nLevel - 1][(m_CurrTick >> nShift) % LEVELN_SIZE];
+            auto pTask = rstSlot;
+
+            rstSlot = nullptr;
+            Cascade(pTask);
+        }
+    }
+
+    // 2. take the whole slot, tasks re-scheduled in this tick always go to later slots
+    auto pTask = m_Level0[m_CurrTick % LEVEL0_SIZE];
+    m_Level0[m_CurrTick % LEVEL0_SIZE] = nullptr;
+
+    while(pTask){
+        auto pNext = pTask->m_Next;
+        if(pTask->m_ExpireTick > m_CurrTick && !pTask->m_Done.load()){
+            // parked task with very long delay
+            Schedule(pTask);
+            pTask = pNext;
+            continue;
+        }
+
+        // check m_Done after setting m_Running
+        // Dismiss() sets m_Done first then checks m_Running
+        pTask->m_Running.store(true);
+        bool bInvoke = pTask->m_PeriodMS ? !pTask->m_Done.load() : !pTask->m_Done.exchange(true);
+
+        if(bInvoke){
+            pTask->m_Func();
+        }
+        pTask->m_Running.store(false);
+
+        if(pTask->m_PeriodMS && !pTask->m_Done.load()){
+            // keep the period without drift
+            // but never schedule it in current tick again
+            auto nPeriodTick = (pTask->m_PeriodMS + TICK_MS - 1) / TICK_MS;
+            pTask->m_ExpireTick += (nPeriodTick ? nPeriodTick : 1);
+            if(pTask->m_ExpireTick <= m_CurrTick){
+                pTask->m_ExpireTick = m_CurrTick + 1;
+            }
+            Schedule(pTask);
+        }else{
+            m_TaskCount--;
+            Release(pTask);
+        }
+        pTask = pNext;
+    }
+
+    m_CurrTick++;
+}
+
+void EventTaskHub::DrainSubmit()
+{
+    auto pHead = m_SubmitHead.exchange(nullptr);
+    if(!pHead){
+        return;
+    }
+
+    // reverse the list to keep the submission order
+    EventTask *pList = nullptr;
+    while(pHead){
+        auto pNext = pHead->m_Next;
+        pHead->m_Next = pList;
+        pList = pHead;
+        pHead = pNext;
+    }
+
+    // the wheel is empty, skip all ticks passed during idle
+    if(!m_TaskCount){
+        m_CurrTick = CurrentTick();
+    }
+
+    while(pList){
+        auto pNext = pList->m_Next;
+        if(pList->m_Done.load()){
+            Release(pList);
+        }else{
+            pList->m_ExpireTick = ExpireTick(pList);
+            m_TaskCount++;
+            Schedule(pList);
+        }
+        pList = pNext;
+    }
+}
+
+void EventTaskHub::Clear()
+{
+    // release the hub's reference of all un-invoked tasks
+    // handles hold by callers are still valid, Dismiss() on them returns false
+    auto fnClearList = [this](EventTask *pTask)
+    {
+        while(pTask){
+            auto pNext = pTask->m_Next;
+            pTask->m_Done.store(true);
+            Release(pTask);
+            pTask = pNext;
+        }
+    };
+
+    fnClearList(m_SubmitHead.exchange(nullptr));
+    for(auto &pTask: m_Level0){
+        fnClearList(pTask);
+        pTask = nullptr;
+    }
+
+    for(auto &rstLevel: m_LevelN){
+        for(auto &pTask: rstLevel){
+            fnClearList(pTask);
+            pTask = nullptr;
+        }
+    }
+    m_TaskCount = 0;
+}
+
+void EventTaskHub::MainLoop()
+{
+    while(State()){
+        DrainSubmit();
+
+        auto nCurrTick = CurrentTick();
+        while(State() && m_TaskCount && m_CurrTick <= nCurrTick){
+            RunTick();
+        }
+
+        std::unique_lock<std::mutex> stUniqueLock(m_WaitLock);
+        if(m_TaskCount){
+            // wait for the next tick
+            // new submissions are picked up then, no need to wake up for them
+            m_WaitCV.wait_until(stUniqueLock, m_StartTime + std::chrono::milliseconds(m_CurrTick * TICK_MS), [this]()
+            {
+                return !State();
+            });
+        }else{
+            m_Idle.store(true);
+            m_WaitCV.wait(stUniqueLock, [this]()
+            {
+                return !State() || m_SubmitHead.load();
+            });
+            m_Idle.store(false);
+        }
+    }
+    Clear();
+}
@@ -3,18 +3,35 @@
  *
  *       Filename: eventtaskhub.hpp
  *        Created: 04/03/2016 22:55:21
- *  Last Modified: 05/24/2016 17:02:25
+ *  Last Modified: 05/25/2017 17:48:02
  *
  *    Description: this class support event executation after a delay
- *                 so don't think too much of performance
  *
- *                 this class support operations:
- *                 1. Launch()          : state the whole hub and make it's running
- *                 2. Dismiss(nID)      : cancel one handler when 
- *                 3. Shutdown(bClear)  : terminated the hub, clear all handlers
+ *                 previously all tasks were in a priority_queue protected by one mutex,
+ *                 and live ID's were in an unordered_set, every Metronome re-armed itself
+ *                 by Add() for each tick, with one Metronome per map this is a global
+ *                 serialization point
+ *
+ *                 now it's a hierarchical timing wheel driven by the hub thread:
+ *
+ *                      level 0: 256 slots, 1 tick each
+ *                      level 1:  64 slots, 256 ticks each
+ *                      level 2:  64 slots, 256 * 64 ticks each
+ *                      level 3:  64 slots, 256 * 64 * 64 ticks each
+ *
+ *                 with TICK_MS = 10 it covers ~7.7 days, longer delays are parked in the
+ *                 last slot and re-inserted, add / cancel are O(1), expired tasks of one
+ *                 tick are invoked in one batch
  *
- *                 I don't want to make a Suspend() / Restart() since doesn't make
- *                 sense
+ *                 submission is a lock-free MPSC queue, only the hub thread touches the
+ *                 wheel, producers never take a lock unless the hub thread is idle
+ *
+ *                 this class support operations:
+ *                 1. Launch()              : state the whole hub and make it's running
+ *                 2. Add(nDelayMS, fnOp)   : one-shot task, return a handle
+ *                 3. AddPeriodic(nMS, fnOp): invoke fnOp every nMS until dismissed
+ *                 4. Dismiss(rstHandle)    : cancel one task by its handle
+ *                 5. Shutdown()            : terminated the hub, clear all tasks
  *
  *        Version: 1.0
  *       Revision: none
@@ -28,9 +45,12 @@
  */
 #pragma once
 
+#include <array>
 #include <mutex>
-#include <queue>
-#include <unordered_set>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <condition_variable>
 
 #include "basehub.hpp"
@@ -40,207 +60,161 @@
 using EventTaskBlockPN = MemoryBlockPN<sizeof(EventTask), 1024, 4>;
 class EventTaskHub: public BaseHub<EventTaskHub>
 {
-    private:
-        struct TaskComp
+    public:
+        // reference to a task, copyable
+        // keeps the node alive but won't keep the task scheduled
+        class Handle final
         {
-            // won't check empty pointer
-            bool operator()(const EventTask* pLHS, const EventTask* pRHS) const
-            {
-                return pLHS->Cycle() > pRHS->Cycle();
-            }
-        };
+            private:
+                friend class EventTaskHub;
+
+            private:
+                EventTask *m_Task;
+
+            private:
+                explicit Handle(EventTask *pTask)
+                    : m_Task(pTask)
+                {}
+
+            public:
+                Handle()
+                    : m_Task(nullptr)
+                {}
+
+                Handle(const Handle &rstHandle)
+                    : m_Task(rstHandle.m_Task)
+                {
+                    if(m_Task){
+                        m_Task->m_RefCount.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
 
-    protected:
-        uint32_t                         m_LastEventID;
-        std::mutex                       m_EventLock;
-        std::condition_variable          m_EventCV;
-        std::unordered_set<uint32_t>     m_EventIDV;
-        std::function<void(EventTask *)> m_Exec;
-        EventTaskBlockPN                 m_EventTaskBlockPN;
+                Handle(Handle &&rstHandle)
+                    : m_Task(rstHandle.m_Task)
+                {
+                    rstHandle.m_Task = nullptr;
+                }
 
-    protected:
-        std::priority_queue<EventTask*, std::deque<EventTask *>, TaskComp> m_EventList;
+                Handle &operator = (Handle stHandle)
+                {
+                    std::swap(m_Task, stHandle.m_Task);
+                    return *this;
+                }
 
-    public:
-        EventTaskHub(const std::function<void(EventTask *)>
-                &fnExec = [](EventTask *pTask){ if(pTask){ (*pTask)(); } })
-            : BaseHub<EventTaskHub>()
-            , m_LastEventID(0)
-            , m_Exec(fnExec)
-        {}
+               ~Handle()
+                {
+                    EventTaskHub::Release(m_Task);
+                }
 
-        virtual ~EventTaskHub() = default;
+            public:
+                explicit operator bool () const
+                {
+                    return m_Task != nullptr;
+                }
+        };
 
-    public:
-        // try to cancel one operation before its invocation
-        // here m_EventIDV is actually an unordered_set, if in demand of perfrmance
-        // we can limit the number of handlers and put them in a real vector
-        bool Dismiss(uint32_t nID)
-        {
-            if(nID == 0){ return false; }
+    private:
+        constexpr static uint32_t TICK_MS = 10;
 
-            std::lock_guard<std::mutex> stLockGuard(m_EventLock);
-            auto pRecord = m_EventIDV.find(nID);
+    private:
+        constexpr static int LEVEL0_BITS = 8;
+        constexpr static int LEVELN_BITS = 6;
+        constexpr static int LEVEL_COUNT = 4;
 
-            if(pRecord == m_EventIDV.end()){ return false; }
+        constexpr static uint64_t LEVEL0_SIZE = (1 << LEVEL0_BITS);
+        constexpr static uint64_t LEVELN_SIZE = (1 << LEVELN_BITS);
+        constexpr static uint64_t WHEEL_SPAN  = (1ULL << (LEVEL0_BITS + LEVELN_BITS * (LEVEL_COUNT - 1)));
 
-            m_EventIDV.erase(pRecord);
-            return true;
-        }
+    private:
+        const std::chrono::steady_clock::time_point m_StartTime;
 
-    public:
-        EventTask *CreateEventTask(uint32_t nDelayMS, std::function<void()> && fnOp)
-        {
-            auto pData = m_EventTaskBlockPN.Get();
-            if(!pData){ return nullptr; }
+    private:
+        // MPSC submission queue
+        // producers push to m_SubmitHead by CAS, hub thread takes the whole list
+        std::atomic<EventTask *> m_SubmitHead;
 
-            return new (pData) EventTask(nDelayMS, std::move(fnOp));
-        }
+    private:
+        // only used to wake the hub thread
+        // when it's idle or shutdown
+        std::atomic<bool>       m_Idle;
+        std::mutex              m_WaitLock;
+        std::condition_variable m_WaitCV;
 
-        EventTask *CreateEventTask(uint32_t nDelayMS, const std::function<void()> & fnOp)
-        {
-            return CreateEventTask(nDelayMS, std::function<void()>(fnOp));
-        }
+    private:
+        // only accessed by the hub thread
+        uint64_t m_CurrTick;
+        size_t   m_TaskCount;
 
-        void DeleteEventTask(EventTask *pTask)
-        {
-            if(!pTask){ return; }
+        std::array<EventTask *, LEVEL0_SIZE> m_Level0;
+        std::array<std::array<EventTask *, LEVELN_SIZE>, LEVEL_COUNT - 1> m_LevelN;
 
-            pTask->~EventTask();
-            m_EventTaskBlockPN.Free(pTask);
-        }
+    private:
+        EventTaskBlockPN m_EventTaskBlockPN;
+
+    public:
+        EventTaskHub();
+        virtual ~EventTaskHub();
+
+    public:
+        // try to cancel one task before its invocation
+        // return true if the task won't be invoked anymore because of this call
+        //
+        // if the task is being invoked in the hub thread, it waits the invocation to
+        // finish, then after Dismiss() it's safe to destroy objects used by the task
+        // it won't wait if called by the task itself
+        bool Dismiss(const Handle &);
 
     public:
         // this function will clear the un-invoked handlers and stop the hub
         // by stopping the executing thread, previously I was thinking of adding
         // a parameter to decide if clear the handler list or not, but finally I
         // decide to always clear it
-        void Shutdown()
-        {
-            // 1. set it as terminated
-            State(false);
-
-            // 2. clear all un-invoked handlers
-            m_EventLock.lock();
-
-            //this list should already be empty
-            while(!m_EventList.empty()){
-                DeleteEventTask(m_EventList.top());
-                m_EventList.pop();
-            }
-
-            m_EventIDV.clear();
-            m_EventLock.unlock();
-            m_EventCV.notify_one();
-        }
+        void Shutdown();
 
     public:
-        uint32_t Add(uint32_t nDelayMS, std::function<void()> &&fnOp)
+        Handle Add(uint32_t nDelayMS, std::function<void()> &&fnOp)
         {
-            return Add(CreateEventTask(nDelayMS, std::move(fnOp)));
+            return Submit(nDelayMS, 0, std::move(fnOp));
         }
 
-        uint32_t Add(uint32_t nDelayMS, const std::function<void()> &fnOp)
+        Handle Add(uint32_t nDelayMS, const std::function<void()> &fnOp)
         {
             return Add(nDelayMS, std::function<void()>(fnOp));
         }
 
-        uint32_t Add(EventTask *pTask)
+        // first invocation is after nPeriodMS
+        // the task keeps its schedule without drift, it won't be re-allocated for each period
+        Handle AddPeriodic(uint32_t nPeriodMS, std::function<void()> &&fnOp)
         {
-            if(!pTask){return 0;}
-
-            bool bDoSignal = false;
-            uint32_t nValidID = 0;
-            m_EventLock.lock();
-
-            if(State()){
-                // check if the event has a valid id
-                if(pTask->ID() == 0){
-                    // if not generate one
-                    m_LastEventID = (m_EventIDV.empty() ? 1 : (m_LastEventID + 1));
-
-                    // overflowed, find a valid ID here by testing in a loop
-                    if(!m_LastEventID){
-                        for(uint32_t nID = 1; nID; ++nID){
-                            if(m_EventIDV.find(nID) == m_EventIDV.end()){
-                                m_LastEventID = nID;
-                                break;
-                            }
-                        }
-
-                        // still we can't get a valid ID, could merely happen
-                        if(!m_LastEventID){
-                            m_EventLock.unlock();
-                            DeleteEventTask(pTask);
-                            return 0;
-                        }
-                    }
-                    pTask->ID(m_LastEventID);
-                }
+            return Submit(nPeriodMS, nPeriodMS, std::move(fnOp));
+        }
 
-                // ok now pTask has a valid ID
-
-                nValidID = pTask->ID();
-                m_EventIDV.insert(nValidID);
-                m_EventList.push(pTask);
-
-                // if the list was empty or this event is the top in the list
-                // means we need to take care of the newly added handler, we have to notify
-                bDoSignal = (pTask == m_EventList.top());
-            }else{
-                // the hub is temerminated or stopped
-                m_EventLock.unlock();
-                DeleteEventTask(pTask);
-                return 0;
-            }
-
-            m_EventLock.unlock();
-            if(bDoSignal){ m_EventCV.notify_one(); }
-
-            // return pTask->ID();
-            // this ``return pTask->ID()" I think it's a bug since after the ``unlock()"
-            // there is no guarantee that the pointer pTask would stay valid
-            return nValidID;
+        Handle AddPeriodic(uint32_t nPeriodMS, const std::function<void()> &fnOp)
+        {
+            return AddPeriodic(nPeriodMS, std::function<void()>(fnOp));
         }
 
     public:
-        void MainLoop()
-        {
-            std::unique_lock<std::mutex> stUniqueLock(m_EventLock, std::defer_lock);
-            while(State()){
-                std::cv_status stRet = std::cv_status::no_timeout;
-                stUniqueLock.lock();
-                if(m_EventList.empty()){
-                    // wait until new handler added in
-                    m_EventCV.wait(stUniqueLock);
-                }else{
-                    // or wait for a shorter time
-                    stRet = m_EventCV.wait_until(stUniqueLock, m_EventList.top()->Cycle());
-                }
+        void MainLoop();
 
-                // the mutex is locked again now...
-                if(stRet == std::cv_status::timeout){
-                    // ok we had a timeout
-                    // so there has to be an event we *have to* execute
-                    // because time is up!
-                    auto pTask = m_EventList.top();
-                    m_EventList.pop();
-
-                    // check if the event was stopped
-                    auto pRecord = m_EventIDV.find(pTask->ID());
-                    if(pRecord == m_EventIDV.end()){
-                        stUniqueLock.unlock();
-                        DeleteEventTask(pTask);
-                        continue;
-                    }
-                    m_EventIDV.erase(pRecord);
-                    stUniqueLock.unlock();
+    private:
+        Handle Submit(uint32_t, uint32_t, std::function<void()> &&);
 
-                    // it's time to execute it
-                    if(m_Exec){ m_Exec(pTask); }
-                }else{
-                    stUniqueLock.unlock();
-                }
-            }
-        }
+    private:
+        EventTask *CreateEventTask(uint32_t, uint32_t, std::function<void()> &&);
+        void DeleteEventTask(EventTask *);
+
+    private:
+        static void Release(EventTask *);
+
+    private:
+        uint64_t CurrentTick() const;
+        uint64_t ExpireTick(const EventTask *) const;
+
+    private:
+        void Schedule(EventTask *);
+        void Cascade(EventTask *);
+        void RunTick();
+        void DrainSubmit();
+        void Clear();
 };
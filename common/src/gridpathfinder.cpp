@@ -0,0 +1,288 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: gridpathfinder.cpp
+ *        Created: 05/30/2017 11:02:53
+ *  Last Modified: 05/30/2017 18:04:10
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdlib>
+#include "gridpathfinder.hpp"
+
+constexpr float GridPathFinder::STRAIGHT_COST;
+constexpr float GridPathFinder::DIAGONAL_COST;
+constexpr float GridPathFinder::OCCUPIED_COST;
+
+GridPathFinder::SearchPool &GridPathFinder::GetSearchPool()
+{
+    // monsters search from map actors, which run on Theron worker threads
+    // one pool per thread, no lock
+    static thread_local SearchPool s_SearchPool;
+    return s_SearchPool;
+}
+
+bool GridPathFinder::BeginSearch(int nX0, int nY0, int nX1, int nY1)
+{
+    m_PathV.clear();
+    m_ExpandCount = 0;
+
+    if(!(true
+                && m_WalkMap
+                && m_WalkMap->ValidC(nX0, nY0)
+                && nX0 >= m_BoundX0 && nX0 < m_BoundX1
+                && nY0 >= m_BoundY0 && nY0 < m_BoundY1
+                && Walkable(nX1, nY1))){
+        return false;
+    }
+
+    auto &rstPool = GetSearchPool();
+    auto  nCount  = (size_t)(m_WalkMap->W()) * m_WalkMap->H();
+
+    // pool is shared by all maps of this thread
+    // grow for the biggest one, never shrink
+    if(rstPool.Mark.size() < nCount){
+        rstPool.G.resize(nCount);
+        rstPool.Parent.resize(nCount);
+        rstPool.Mark.resize(nCount, 0);
+        rstPool.Closed.resize(nCount, 0);
+    }
+
+    // new generation invalidates all states
+    // clear only when it wraps around
+    if(++rstPool.Generation == 0){
+        std::fill(rstPool.Mark.begin(), rstPool.Mark.end(), 0);
+        std::fill(rstPool.Closed.begin(), rstPool.Closed.end(), 0);
+        rstPool.Generation = 1;
+    }
+
+    rstPool.Heap.clear();
+    PushOpen(CellIndex(nX0, nY0), -1, 0.0f, nX0, nY0, nX1, nY1);
+    return true;
+}
+
+void GridPathFinder::PushOpen(int nIndex, int nParent, float fG, int nX, int nY, int nGoalX, int nGoalY)
+{
+    auto &rstPool = GetSearchPool();
+    if(rstPool.Closed[nIndex] == rstPool.Generation){
+        return;
+    }
+
+    if(rstPool.Mark[nIndex] == rstPool.Generation && rstPool.G[nIndex] <= fG){
+        return;
+    }
+
+    rstPool.Mark  [nIndex] = rstPool.Generation;
+    rstPool.G     [nIndex] = fG;
+    rstPool.Parent[nIndex] = nParent;
+
+    // no decrease-key, the old entry is skipped when popped
+    rstPool.Heap.push_back({fG + Heuristic(nX, nY, nGoalX, nGoalY), nIndex});
+    std::push_heap(rstPool.Heap.begin(), rstPool.Heap.end());
+}
+
+int GridPathFinder::PopOpen()
+{
+    auto &rstPool = GetSearchPool();
+    while(!rstPool.Heap.empty()){
+        std::pop_heap(rstPool.Heap.begin(), rstPool.Heap.end());
+        auto nIndex = rstPool.Heap.back().Index;
+        rstPool.Heap.pop_back();
+
+        if(rstPool.Closed[nIndex] != rstPool.Generation){
+            rstPool.Closed[nIndex] = rstPool.Generation;
+            m_ExpandCount++;
+            return nIndex;
+        }
+    }
+    return -1;
+}
+
+void GridPathFinder::BuildPath(int nGoal)
+{
+    auto &rstPool = GetSearchPool();
+
+    // 1. jump points from goal to start
+    std::vector<int> stPointV;
+    for(int nIndex = nGoal; nIndex >= 0; nIndex = rstPool.Parent[nIndex]){
+        stPointV.push_back(nIndex);
+    }
+
+    // 2. fill cells between two jump points
+    //    they are always on a straight or diagonal line
+    m_PathV.clear();
+    for(auto pPoint = stPointV.rbegin(); pPoint != stPointV.rend(); ++pPoint){
+        int nX = *pPoint % m_WalkMap->W();
+        int nY = *pPoint / m_WalkMap->W();
+
+        if(m_PathV.empty()){
+            m_PathV.emplace_back(nX, nY);
+            continue;
+        }
+
+        int nCurrX = m_PathV.back().X;
+        int nCurrY = m_PathV.back().Y;
+
+        int nDX = (nX > nCurrX) - (nX < nCurrX);
+        int nDY = (nY > nCurrY) - (nY < nCurrY);
+
+        while(nCurrX != nX || nCurrY != nY){
+            nCurrX += nDX;
+            nCurrY += nDY;
+            m_PathV.emplace_back(nCurrX, nCurrY);
+        }
+    }
+}
+
+// jump from (nX, nY) in direction (nDX, nDY), (nX, nY) itself is not checked
+// return true and the jump point if found, the jump point is
+//   1. the goal
+//   2. a cell with forced neighbor
+//   3. for diagonal jump, a cell where a straight jump finds a jump point
+//
+// diagonal step is allowed without checking its two neighbors, so the pruning rule
+// is the original one by Harabor and Grastien
+bool GridPathFinder::Jump(int nX, int nY, int nDX, int nDY, int nGoalX, int nGoalY, int *pJumpX, int *pJumpY) const
+{
+    while(true){
+        nX += nDX;
+        nY += nDY;
+
+        if(!Walkable(nX, nY)){
+            return false;
+        }
+
+        bool bJumpPoint = false;
+        if(nX == nGoalX && nY == nGoalY){
+            bJumpPoint = true;
+        }else if(nDX && nDY){
+            if(false
+                    || (Walkable(nX - nDX, nY + nDY) && !Walkable(nX - nDX, nY))
+                    || (Walkable(nX + nDX, nY - nDY) && !Walkable(nX, nY - nDY))){
+                bJumpPoint = true;
+            }else{
+                int nX1 = 0;
+                int nY1 = 0;
+                bJumpPoint = false
+                    || Jump(nX, nY, nDX, 0, nGoalX, nGoalY, &nX1, &nY1)
+                    || Jump(nX, nY, 0, nDY, nGoalX, nGoalY, &nX1, &nY1);
+            }
+        }else if(nDX){
+            bJumpPoint = false
+                || (Walkable(nX + nDX, nY + 1) && !Walkable(nX, nY + 1))
+                || (Walkable(nX + nDX, nY - 1) && !Walkable(nX, nY - 1));
+        }else{
+            bJumpPoint = false
+                || (Walkable(nX + 1, nY + nDY) && !Walkable(nX + 1, nY))
+                || (Walkable(nX - 1, nY + nDY) && !Walkable(nX - 1, nY));
+        }
+
+        if(bJumpPoint){
+            *pJumpX = nX;
+            *pJumpY = nY;
+            return true;
+        }
+    }
+}
+
+bool GridPathFinder::Search(int nX0, int nY0, int nX1, int nY1)
+{
+    if(!BeginSearch(nX0, nY0, nX1, nY1)){
+        return false;
+    }
+
+    if(nX0 == nX1 && nY0 == nY1){
+        m_PathV.emplace_back(nX0, nY0);
+        return true;
+    }
+
+    auto &rstPool = GetSearchPool();
+    auto  nGoal   = CellIndex(nX1, nY1);
+
+    while(!rstPool.Heap.empty()){
+        auto nCurr = PopOpen();
+        if(nCurr < 0){
+            break;
+        }
+
+        if(nCurr == nGoal){
+            BuildPath(nGoal);
+            return true;
+        }
+
+        int nCurrX = nCurr % m_WalkMap->W();
+        int nCurrY = nCurr / m_WalkMap->W();
+
+        // 1. directions to search
+        //    start node searches all 8 directions, others are pruned by the parent
+        int nDirCount = 0;
+        int nDirV[8][2];
+
+        auto fnAddDir = [&nDirCount, &nDirV](int nDX, int nDY)
+        {
+            nDirV[nDirCount][0] = nDX;
+            nDirV[nDirCount][1] = nDY;
+            nDirCount++;
+        };
+
+        auto nParent = rstPool.Parent[nCurr];
+        if(nParent < 0){
+            for(int nDX = -1; nDX <= 1; ++nDX){
+                for(int nDY = -1; nDY <= 1; ++nDY){
+                    if(nDX || nDY){
+                        fnAddDir(nDX, nDY);
+                    }
+                }
+            }
+        }else{
+            int nParentX = nParent % m_WalkMap->W();
+            int nParentY = nParent / m_WalkMap->W();
+
+            int nDX = (nCurrX > nParentX) - (nCurrX < nParentX);
+            int nDY = (nCurrY > nParentY) - (nCurrY < nParentY);
+
+            if(nDX && nDY){
+                fnAddDir(nDX,   0);
+                fnAddDir(  0, nDY);
+                fnAddDir(nDX, nDY);
+
+                if(!Walkable(nCurrX - nDX, nCurrY)){ fnAddDir(-nDX,  nDY); }
+                if(!Walkable(nCurrX, nCurrY - nDY)){ fnAddDir( nDX, -nDY); }
+            }else if(nDX){
+                fnAddDir(nDX, 0);
+                if(!Walkable(nCurrX, nCurrY + 1)){ fnAddDir(nDX, +1); }
+                if(!Walkable(nCurrX, nCurrY - 1)){ fnAddDir(nDX, -1); }
+            }else{
+                fnAddDir(0, nDY);
+                if(!Walkable(nCurrX + 1, nCurrY)){ fnAddDir(+1, nDY); }
+                if(!Walkable(nCurrX - 1, nCurrY)){ fnAddDir(-1, nDY); }
+            }
+        }
+
+        // 2. jump in each direction, only jump points go to open list
+        for(int nIndex = 0; nIndex < nDirCount; ++nIndex){
+            int nDX = nDirV[nIndex][0];
+            int nDY = nDirV[nIndex][1];
+
+            int nJumpX = 0;
+            int nJumpY = 0;
+            if(Jump(nCurrX, nCurrY, nDX, nDY, nX1, nY1, &nJumpX, &nJumpY)){
+                auto nStep = std::max<int>(std::abs(nJumpX - nCurrX), std::abs(nJumpY - nCurrY));
+                auto fCost = nStep * ((nDX && nDY) ? DIAGONAL_COST : STRAIGHT_COST);
+                PushOpen(CellIndex(nJumpX, nJumpY), nCurr, rstPool.G[nCurr] + fCost, nJumpX, nJumpY, nX1, nY1);
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,257 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: gridpathfinder.hpp
+ *        Created: 05/30/2017 10:14:26
+ *  Last Modified: 05/30/2017 18:02:47
+ *
+ *    Description: path finder specialized for 8-direction grid map
+ *
+ *                 AStarPathFinder is generic, it asks two std::function for each
+ *                 neighbor and allocates nodes from its own pool per search, for map
+ *                 grids we can do better:
+ *
+ *                 1. walkability is a packed bitmap, built once per map
+ *                 2. uniform cost search uses Jump Point Search, only jump points
+ *                    are pushed to the open list, straight lines are skipped
+ *                 3. weighted search, i.e. occupied cells cost more, uses A* with a
+ *                    flat binary heap, cost of a cell comes from a functor, no
+ *                    std::function call
+ *                 4. per-cell search state lives in a thread local pool which is
+ *                    reused by all searches of this thread, reset is O(1) by a
+ *                    generation counter
+ *
+ *                 cost keeps the same as ServerPathFinder: straight step 1.0, diagonal
+ *                 step 1.1 to prefer going straight, diagonal step is allowed if the
+ *                 destination cell is walkable, no matter of its two neighbors
+ *
+ *                 path is given cell by cell, includes start and goal
+ *
+ *                 search can be bounded in a rectangle, cells out of it are taken as
+ *                 blocked, PortalGraph uses it to refine a path inside one cluster
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+
+#include "bitgrid.hpp"
+#include "pathfinder.hpp"
+
+class GridPathFinder final
+{
+    public:
+        // one bit per cell, row-major
+        // out of map is not walkable
+        class WalkMap: public BitGrid
+        {
+            public:
+                WalkMap(int nW = 0, int nH = 0)
+                    : BitGrid(nW, nH)
+                {}
+
+            public:
+                bool Walkable(int nX, int nY) const
+                {
+                    return Get(nX, nY);
+                }
+        };
+
+    private:
+        struct HeapNode
+        {
+            float F;
+            int   Index;
+
+            // std::push_heap() makes a max heap
+            bool operator < (const HeapNode &rstNode) const
+            {
+                return F > rstNode.F;
+            }
+        };
+
+        // search state of all cells
+        // valid only if Mark[i] is current generation
+        struct SearchPool
+        {
+            uint32_t Generation;
+
+            std::vector<float>    G;
+            std::vector<int>      Parent;
+            std::vector<uint32_t> Mark;
+            std::vector<uint32_t> Closed;
+
+            std::vector<HeapNode> Heap;
+
+            SearchPool()
+                : Generation(0)
+                , G()
+                , Parent()
+                , Mark()
+                , Closed()
+                , Heap()
+            {}
+        };
+
+    private:
+        constexpr static float STRAIGHT_COST = 1.0f;
+        constexpr static float DIAGONAL_COST = 1.1f;
+
+        // extra cost of the cell the functor reports as occupied
+        // same as ServerPathFinder: 100.0 and 100.1
+        constexpr static float OCCUPIED_COST = 99.0f;
+
+    private:
+        const WalkMap *m_WalkMap;
+
+    private:
+        // search bound, [X0, X1) x [Y0, Y1)
+        int m_BoundX0;
+        int m_BoundY0;
+        int m_BoundX1;
+        int m_BoundY1;
+
+    private:
+        size_t m_ExpandCount;
+        std::vector<PathFind::PathNode> m_PathV;
+
+    public:
+        GridPathFinder(const WalkMap *pWalkMap)
+            : m_WalkMap(pWalkMap)
+            , m_BoundX0(0)
+            , m_BoundY0(0)
+            , m_BoundX1(pWalkMap ? pWalkMap->W() : 0)
+            , m_BoundY1(pWalkMap ? pWalkMap->H() : 0)
+            , m_ExpandCount(0)
+            , m_PathV()
+        {}
+
+       ~GridPathFinder() = default;
+
+    public:
+        // following searches only go through cells in (nX, nY, nW, nH)
+        void Bound(int nX, int nY, int nW, int nH)
+        {
+            m_BoundX0 = nX;
+            m_BoundY0 = nY;
+            m_BoundX1 = nX + nW;
+            m_BoundY1 = nY + nH;
+        }
+
+    public:
+        // uniform cost search by JPS
+        bool Search(int, int, int, int);
+
+        // weighted search by A*
+        // fnOccupied(nX, nY) returns true if the walkable cell is taken, then stepping
+        // into it costs OCCUPIED_COST more, it's still allowed
+        template<typename OccupiedFunc> bool Search(int nX0, int nY0, int nX1, int nY1, OccupiedFunc &&fnOccupied)
+        {
+            if(!BeginSearch(nX0, nY0, nX1, nY1)){
+                return false;
+            }
+
+            if(nX0 == nX1 && nY0 == nY1){
+                m_PathV.emplace_back(nX0, nY0);
+                return true;
+            }
+
+            static const int nDX[] = { 0, +1, +1, +1,  0, -1, -1, -1};
+            static const int nDY[] = {-1, -1,  0, +1, +1, +1,  0, -1};
+
+            auto &rstPool = GetSearchPool();
+            auto  nGoal   = CellIndex(nX1, nY1);
+
+            while(!rstPool.Heap.empty()){
+                auto nCurr = PopOpen();
+                if(nCurr < 0){
+                    break;
+                }
+
+                if(nCurr == nGoal){
+                    BuildPath(nGoal);
+                    return true;
+                }
+
+                int nCurrX = nCurr % m_WalkMap->W();
+                int nCurrY = nCurr / m_WalkMap->W();
+
+                for(int nDir = 0; nDir < 8; ++nDir){
+                    int nNextX = nCurrX + nDX[nDir];
+                    int nNextY = nCurrY + nDY[nDir];
+
+                    if(!Walkable(nNextX, nNextY)){
+                        continue;
+                    }
+
+                    auto fCost = (nDir % 2) ? DIAGONAL_COST : STRAIGHT_COST;
+                    if(fnOccupied(nNextX, nNextY)){
+                        fCost += OCCUPIED_COST;
+                    }
+                    PushOpen(CellIndex(nNextX, nNextY), nCurr, rstPool.G[nCurr] + fCost, nNextX, nNextY, nX1, nY1);
+                }
+            }
+            return false;
+        }
+
+    public:
+        const std::vector<PathFind::PathNode> &Path() const
+        {
+            return m_PathV;
+        }
+
+        // nodes popped from the open list in last search
+        size_t ExpandCount() const
+        {
+            return m_ExpandCount;
+        }
+
+    private:
+        bool Walkable(int nX, int nY) const
+        {
+            return true
+                && nX >= m_BoundX0
+                && nX <  m_BoundX1
+                && nY >= m_BoundY0
+                && nY <  m_BoundY1
+                && m_WalkMap->Walkable(nX, nY);
+        }
+
+        int CellIndex(int nX, int nY) const
+        {
+            return nY * m_WalkMap->W() + nX;
+        }
+
+        static float Heuristic(int nX0, int nY0, int nX1, int nY1)
+        {
+            // octile distance with diagonal cost 1.1
+            int nDX = std::abs(nX1 - nX0);
+            int nDY = std::abs(nY1 - nY0);
+            return STRAIGHT_COST * std::max<int>(nDX, nDY) + (DIAGONAL_COST - STRAIGHT_COST) * std::min<int>(nDX, nDY);
+        }
+
+    private:
+        SearchPool &GetSearchPool();
+
+    private:
+        bool BeginSearch(int, int, int, int);
+        void PushOpen(int, int, float, int, int, int, int);
+        int  PopOpen();
+        void BuildPath(int);
+
+    private:
+        bool Jump(int, int, int, int, int, int, int *, int *) const;
+};
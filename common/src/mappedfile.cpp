@@ -0,0 +1,84 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: mappedfile.cpp
+ *        Created: 06/04/2017 11:20:43
+ *  Last Modified: 06/04/2017 15:36:52
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "mappedfile.hpp"
+
+MappedFile::MappedFile(const char *szFullName)
+    : m_Data(nullptr)
+    , m_Size(0)
+    , m_Buf()
+{
+    if(!szFullName){
+        return;
+    }
+
+#ifdef _WIN32
+    if(auto fp = std::fopen(szFullName, "rb")){
+        std::fseek(fp, 0, SEEK_END);
+        auto nFileSize = std::ftell(fp);
+        std::fseek(fp, 0, SEEK_SET);
+
+        if(nFileSize > 0){
+            m_Buf.resize(nFileSize);
+            if(std::fread(&(m_Buf[0]), nFileSize, 1, fp) == 1){
+                m_Data = &(m_Buf[0]);
+                m_Size = m_Buf.size();
+            }else{
+                m_Buf.clear();
+            }
+        }
+        std::fclose(fp);
+    }
+#else
+    auto nFD = open(szFullName, O_RDONLY);
+    if(nFD < 0){
+        return;
+    }
+
+    // mapping stays valid after close()
+    struct stat stFileStat;
+    if(!fstat(nFD, &stFileStat) && stFileStat.st_size > 0){
+        auto pMap = mmap(nullptr, (size_t)(stFileStat.st_size), PROT_READ, MAP_PRIVATE, nFD, 0);
+        if(pMap != MAP_FAILED){
+            m_Data = (const uint8_t *)(pMap);
+            m_Size = (size_t)(stFileStat.st_size);
+        }
+    }
+    close(nFD);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if(m_Data){
+        munmap((void *)(m_Data), m_Size);
+    }
+#endif
+}
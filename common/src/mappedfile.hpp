@@ -0,0 +1,54 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: mappedfile.hpp
+ *        Created: 06/04/2017 11:02:17
+ *  Last Modified: 06/04/2017 15:36:40
+ *
+ *    Description: read-only view of a whole file
+ *                 mmap-ed on linux, read into a buffer on windows
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class MappedFile final
+{
+    private:
+        const uint8_t *m_Data;
+        size_t         m_Size;
+
+    private:
+        // only used if no mmap
+        std::vector<uint8_t> m_Buf;
+
+    public:
+        MappedFile(const char *);
+       ~MappedFile();
+
+    public:
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator = (const MappedFile &) = delete;
+
+    public:
+        bool Valid() const
+        {
+            return m_Data && m_Size;
+        }
+
+    public:
+        const uint8_t *Data() const { return m_Data; }
+        size_t         Size() const { return m_Size; }
+};
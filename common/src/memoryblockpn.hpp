@@ -68,6 +68,7 @@
 #include <mutex>
 #include <vector>
 #include <memory>
+#include <cstddef>
 #include <cstdint>
 
 #include "cachequeue.hpp"
@@ -257,10 +258,13 @@ class MemoryBlockPN
         {
             if(!pData){ return; }
 
-            // pOff is the constant offset of a memory block to its data field
+            // nOff is the constant offset of a memory block to its data field
             // pHead is the starting address of the memory block, w.r.t. the data chunk to free
-            constexpr auto pOff  = (uint8_t *)(&((*((InnMemoryBlock *)(0))).Data[0]));
-            const     auto pHead = (InnMemoryBlock *)((uint8_t *)pData - pOff);
+            //
+            // don't compute nOff by dereferencing a null InnMemoryBlock pointer, newer gcc
+            // rejects it in constant expression, InnMemoryBlock is standard layout
+            constexpr auto nOff  = offsetof(InnMemoryBlock, Data);
+            const     auto pHead = (InnMemoryBlock *)((uint8_t *)pData - nOff);
 
             // 1. get the branch index
             size_t nBranchIndex = ((BranchSize > 1) ? (pHead->BranchID) : 0);
@@ -3,7 +3,7 @@
  *
  *       Filename: mir2xmapdata.cpp
  *        Created: 08/31/2015 18:26:57
- *  Last Modified: 03/24/2017 17:03:30
+ *  Last Modified: 06/04/2017 16:20:47
  *
  *    Description: class to record data for mir2x map
  *                 this class won't define operation over the data
@@ -19,20 +19,55 @@
  * =====================================================================================
  */
 
+#include <mutex>
+#include <string>
 #include <vector>
 #include <memory>
 #include <cstdint>
 #include <cstring>
 #include <cassert>
 #include <algorithm>
+#include <unordered_map>
 
 #include "sysconst.hpp"
 #include "mathfunc.hpp"
 #include "mir2xmapdata.hpp"
 
+constexpr uint32_t Mir2xMapData::FLAT_MAGIC;
+constexpr uint16_t Mir2xMapData::FLAT_VERSION;
+
+static uint64_t FlatChecksum(const uint8_t *pData, size_t nSize)
+{
+    uint64_t nHash = 14695981039346656037ULL;
+    for(size_t nIndex = 0; nIndex < nSize; ++nIndex){
+        nHash = (nHash ^ pData[nIndex]) * 1099511628211ULL;
+    }
+    return nHash;
+}
+
 int Mir2xMapData::Load(const char *szFullName)
 {
+    m_W = 0;
+    m_H = 0;
     m_Data.clear();
+    m_Mapping.reset();
+
+    if(!szFullName){
+        return -1;
+    }
+
+    // flat file starts with FLAT_MAGIC
+    // compressed file starts with W and H, W is even, first byte of FLAT_MAGIC is odd
+    if(auto pFile = std::fopen(szFullName, "rb")){
+        uint32_t nMagic = 0;
+        auto bFlat = (std::fread(&nMagic, sizeof(nMagic), 1, pFile) == 1) && (nMagic == FLAT_MAGIC);
+        std::fclose(pFile);
+
+        if(bFlat){
+            return LoadFlat(szFullName);
+        }
+    }
+
     if(auto pFile = std::fopen(szFullName, "rb")){
         std::fseek(pFile, 0, SEEK_END);
         auto nFileSize = ftell(pFile);
@@ -94,6 +129,87 @@ int Mir2xMapData::Load(const char *szFullName)
 }
 
 
+int Mir2xMapData::LoadFlat(const char *szFullName)
+{
+    // mapped files are shared by path, checked only when first mapped
+    // expired when the last instance using it is gone
+    static std::mutex stLock;
+    static std::unordered_map<std::string, std::weak_ptr<const MappedFile>> stMappingMap;
+
+    std::shared_ptr<const MappedFile> pMapping;
+    {
+        std::lock_guard<std::mutex> stLockGuard(stLock);
+        auto pRecord = stMappingMap.find(szFullName);
+        if(pRecord != stMappingMap.end()){
+            pMapping = pRecord->second.lock();
+        }
+
+        if(!pMapping){
+            auto pNewMapping = std::make_shared<const MappedFile>(szFullName);
+            if(!pNewMapping->Valid() || pNewMapping->Size() < sizeof(FLATHEAD)){
+                return -1;
+            }
+
+            FLATHEAD stHead;
+            std::memcpy(&stHead, pNewMapping->Data(), sizeof(stHead));
+
+            if(false
+                    || stHead.Magic     != FLAT_MAGIC
+                    || stHead.Version   != FLAT_VERSION
+                    || stHead.BlockSize != sizeof(BLOCK)
+                    || stHead.W == 0 || stHead.W % 2
+                    || stHead.H == 0 || stHead.H % 2){
+                return -1;
+            }
+
+            auto nDataSize = (size_t)(stHead.W / 2) * (stHead.H / 2) * sizeof(BLOCK);
+            if(false
+                    || pNewMapping->Size() != sizeof(FLATHEAD) + nDataSize
+                    || stHead.Checksum != FlatChecksum(pNewMapping->Data() + sizeof(FLATHEAD), nDataSize)){
+                return -1;
+            }
+
+            pMapping = pNewMapping;
+            stMappingMap[szFullName] = pMapping;
+        }
+    }
+
+    FLATHEAD stHead;
+    std::memcpy(&stHead, pMapping->Data(), sizeof(stHead));
+
+    m_W = stHead.W;
+    m_H = stHead.H;
+    m_Mapping = pMapping;
+    return 0;
+}
+
+int Mir2xMapData::SaveFlat(const char *szFullName)
+{
+    if(!(szFullName && Valid())){
+        return -1;
+    }
+
+    FLATHEAD stHead;
+    std::memset(&stHead, 0, sizeof(stHead));
+
+    stHead.Magic     = FLAT_MAGIC;
+    stHead.Version   = FLAT_VERSION;
+    stHead.BlockSize = (uint16_t)(sizeof(BLOCK));
+    stHead.W         = m_W;
+    stHead.H         = m_H;
+    stHead.Checksum  = FlatChecksum(Data(), Size());
+
+    if(auto pFile = std::fopen(szFullName, "wb")){
+        auto bDone = true
+            && std::fwrite(&stHead, sizeof(stHead), 1, pFile) == 1
+            && std::fwrite(Data(), Size(), 1, pFile) == 1;
+
+        std::fclose(pFile);
+        return bDone ? 0 : -1;
+    }
+    return -1;
+}
+
 int Mir2xMapData::LoadHead(uint8_t * &pData)
 {
     std::memcpy(&m_W, pData + 0, 2);
@@ -722,6 +838,7 @@ bool Mir2xMapData::Allocate(uint16_t nW, uint16_t nH)
     if(nW * nH){
         m_W = nW;
         m_H = nH;
+        m_Mapping.reset();
 
         m_Data.resize(m_W * m_H / 4);
         std::memset(&(m_Data[0]), 0, sizeof(m_Data[0]) * m_Data.size());
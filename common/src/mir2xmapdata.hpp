@@ -3,11 +3,20 @@
  *
  *       Filename: mir2xmapdata.hpp
  *        Created: 08/31/2015 18:26:57
- *  Last Modified: 03/31/2017 15:43:00
+ *  Last Modified: 06/04/2017 16:12:05
  *
  *    Description: class to record data for mir2x map
  *                 this class won't define operation over the data
  *
+ *                 two file formats:
+ *                      1. compressed: header + four grid passes, decoded at load
+ *                      2. flat      : FLATHEAD + final BLOCK array as-is, mapped
+ *                                     read-only and used directly, no decoding
+ *
+ *                 Load() detects the format, a flat file is mapped once and shared
+ *                 by all instances loading the same path, any non-const access of
+ *                 a mapped instance takes a private copy first
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -20,10 +29,13 @@
  */
 
 #pragma once
+#include <memory>
 #include <vector>
 #include <cstdint>
 #include <functional>
 
+#include "mappedfile.hpp"
+
 class Mir2xMapData
 {
     public:
@@ -93,8 +105,27 @@ class Mir2xMapData
             TILE   Tile[1];
             CELL   Cell[4];
         }BLOCK;
+
+        // header of the flat format, followed by (W / 2) * (H / 2) BLOCKs
+        // Checksum is FNV-1a of all bytes of the BLOCK array
+        typedef struct
+        {
+            uint32_t Magic;
+            uint16_t Version;
+            uint16_t BlockSize;
+
+            uint16_t W;
+            uint16_t H;
+            uint32_t Reserved;
+
+            uint64_t Checksum;
+        }FLATHEAD;
 #pragma pack(pop)
 
+    public:
+        constexpr static uint32_t FLAT_MAGIC   = 0X4658324D; // "M2XF"
+        constexpr static uint16_t FLAT_VERSION = 1;
+
     private:
         uint16_t m_W;
         uint16_t m_H;
@@ -104,11 +135,16 @@ class Mir2xMapData
         // but never since now it's undefined because of the strict aliasing rule
         std::vector<BLOCK> m_Data;
 
+    private:
+        // set if loaded from a flat file, then m_Data is empty
+        std::shared_ptr<const MappedFile> m_Mapping;
+
     public:
         Mir2xMapData()
             : m_W(0)
             , m_H(0)
             , m_Data()
+            , m_Mapping()
         {}
 
         Mir2xMapData(const char *pName)
@@ -117,15 +153,45 @@ class Mir2xMapData
             Load(pName);
         }
 
+    private:
+        size_t BlockCount() const
+        {
+            return (size_t)(m_W / 2) * (m_H / 2);
+        }
+
+        const BLOCK *Blocks() const
+        {
+            if(m_Mapping){
+                return (const BLOCK *)(m_Mapping->Data() + sizeof(FLATHEAD));
+            }
+            return m_Data.empty() ? nullptr : &(m_Data[0]);
+        }
+
+        // take a private copy before writing
+        void Detach()
+        {
+            if(m_Mapping){
+                m_Data.assign(Blocks(), Blocks() + BlockCount());
+                m_Mapping.reset();
+            }
+        }
+
     public:
         const uint8_t *Data() const
         {
-            return (uint8_t *)(&m_Data[0]);
+            return (const uint8_t *)(Blocks());
         }
 
         size_t Size() const
         {
-            return m_Data.size() * sizeof(m_Data[0]);
+            return Valid() ? (BlockCount() * sizeof(BLOCK)) : 0;
+        }
+
+        // bytes of block data owned by this instance
+        // zero if mapped from a flat file, the mapping is shared and read-only
+        size_t PrivateSize() const
+        {
+            return m_Mapping ? 0 : Size();
         }
 
     public:
@@ -138,6 +204,7 @@ class Mir2xMapData
     public:
         auto &Block(int nX, int nY)
         {
+            Detach();
             return m_Data[nX / 2 + (nY / 2) * (m_W / 2)];
         }
 
@@ -154,7 +221,7 @@ class Mir2xMapData
     public:
         const auto &Block(int nX, int nY) const
         {
-            return m_Data[nX / 2 + (nY / 2) * (m_W / 2)];
+            return Blocks()[nX / 2 + (nY / 2) * (m_W / 2)];
         }
 
         const auto &Tile(int nX, int nY) const
@@ -171,6 +238,10 @@ class Mir2xMapData
         int Load(const char *);
         int Save(const char *);
 
+    public:
+        // write in flat format
+        int SaveFlat(const char *);
+
     private:
         bool PickOneBit(const uint8_t *pData, size_t nOffset)
         {
@@ -180,7 +251,7 @@ class Mir2xMapData
     public:
         bool Valid() const
         {
-            return !m_Data.empty();
+            return m_Mapping || !m_Data.empty();
         }
 
         bool ValidC(int nX, int nY) const
@@ -193,6 +264,9 @@ class Mir2xMapData
             return nX >= 0 && nX < m_W * 48 && nY >= 0 && nY < m_H * 32;
         }
 
+    private:
+        int LoadFlat(const char *);
+
     private:
         int LoadHead(uint8_t * &);
         int LoadGrid(uint8_t * &, std::function<int(int, int, int, const uint8_t *, size_t &, const uint8_t *, size_t &)>);
@@ -0,0 +1,434 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: portalgraph.cpp
+ *        Created: 05/31/2017 10:40:07
+ *  Last Modified: 05/31/2017 19:10:22
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include "portalgraph.hpp"
+
+constexpr int PortalGraph::CLUSTER_SIZE;
+constexpr int PortalGraph::MAX_SINGLE_PORTAL_RUN;
+
+namespace
+{
+    // file layout: header, nodes, edges
+    struct PortalGraphHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        int32_t  W;
+        int32_t  H;
+        int32_t  ClusterSize;
+        uint32_t NodeCount;
+        uint32_t EdgeCount;
+        uint32_t Reserved;
+        uint64_t Checksum;
+    };
+
+    constexpr uint32_t PORTAL_GRAPH_MAGIC   = 0X48504147; // "GAPH"
+    constexpr uint32_t PORTAL_GRAPH_VERSION = 1;
+
+    constexpr float INF_COST = std::numeric_limits<float>::max();
+
+    float Octile(int nX0, int nY0, int nX1, int nY1)
+    {
+        int nDX = std::abs(nX1 - nX0);
+        int nDY = std::abs(nY1 - nY0);
+        return 1.0f * std::max<int>(nDX, nDY) + 0.1f * std::min<int>(nDX, nDY);
+    }
+}
+
+PortalGraph::PortalGraph(const GridPathFinder::WalkMap *pWalkMap)
+    : m_WalkMap(pWalkMap)
+    , m_ClusterW(pWalkMap ? ((pWalkMap->W() + CLUSTER_SIZE - 1) / CLUSTER_SIZE) : 0)
+    , m_ClusterH(pWalkMap ? ((pWalkMap->H() + CLUSTER_SIZE - 1) / CLUSTER_SIZE) : 0)
+    , m_NodeV()
+    , m_EdgeV()
+    , m_ClusterNodeV((size_t)(m_ClusterW) * m_ClusterH)
+{}
+
+void PortalGraph::ClusterDistance(int nX, int nY, std::vector<float> *pDistV) const
+{
+    pDistV->assign(CLUSTER_SIZE * CLUSTER_SIZE, INF_COST);
+
+    int nX0 = (nX / CLUSTER_SIZE) * CLUSTER_SIZE;
+    int nY0 = (nY / CLUSTER_SIZE) * CLUSTER_SIZE;
+
+    auto fnLocal = [nX0, nY0](int nCellX, int nCellY)
+    {
+        return (nCellY - nY0) * CLUSTER_SIZE + (nCellX - nX0);
+    };
+
+    // 256 cells, dijkstra with std::push_heap is enough
+    std::vector<std::pair<float, int>> stHeap;
+    auto fnPush = [&stHeap, pDistV](int nLocal, float fDist)
+    {
+        if(fDist < (*pDistV)[nLocal]){
+            (*pDistV)[nLocal] = fDist;
+            stHeap.emplace_back(-fDist, nLocal);
+            std::push_heap(stHeap.begin(), stHeap.end());
+        }
+    };
+
+    static const int nDX[] = { 0, +1, +1, +1,  0, -1, -1, -1};
+    static const int nDY[] = {-1, -1,  0, +1, +1, +1,  0, -1};
+
+    fnPush(fnLocal(nX, nY), 0.0f);
+    while(!stHeap.empty()){
+        std::pop_heap(stHeap.begin(), stHeap.end());
+        auto fDist  = -stHeap.back().first;
+        auto nLocal =  stHeap.back().second;
+        stHeap.pop_back();
+
+        if(fDist > (*pDistV)[nLocal]){
+            continue;
+        }
+
+        int nCurrX = nX0 + nLocal % CLUSTER_SIZE;
+        int nCurrY = nY0 + nLocal / CLUSTER_SIZE;
+
+        for(int nDir = 0; nDir < 8; ++nDir){
+            int nNextX = nCurrX + nDX[nDir];
+            int nNextY = nCurrY + nDY[nDir];
+
+            if(true
+                    && nNextX >= nX0 && nNextX < nX0 + CLUSTER_SIZE
+                    && nNextY >= nY0 && nNextY < nY0 + CLUSTER_SIZE
+                    && m_WalkMap->Walkable(nNextX, nNextY)){
+                fnPush(fnLocal(nNextX, nNextY), fDist + ((nDir % 2) ? 1.1f : 1.0f));
+            }
+        }
+    }
+}
+
+void PortalGraph::Build()
+{
+    m_NodeV.clear();
+    m_EdgeV.clear();
+    for(auto &rstNodeV: m_ClusterNodeV){
+        rstNodeV.clear();
+    }
+
+    if(!m_WalkMap){
+        return;
+    }
+
+    int nW = m_WalkMap->W();
+    int nH = m_WalkMap->H();
+
+    // 1. portals
+    //    cell index -> node id, one cell can be portal of two borders
+    std::unordered_map<int, uint32_t> stCellNodeMap;
+    std::vector<std::vector<Edge>>    stEdgeVV;
+
+    auto fnNode = [this, nW, &stCellNodeMap, &stEdgeVV](int nX, int nY) -> uint32_t
+    {
+        auto stRet = stCellNodeMap.emplace(nY * nW + nX, (uint32_t)(m_NodeV.size()));
+        if(stRet.second){
+            m_NodeV.push_back({nX, nY, 0, 0});
+            m_ClusterNodeV[ClusterID(nX, nY)].push_back(stRet.first->second);
+            stEdgeVV.emplace_back();
+        }
+        return stRet.first->second;
+    };
+
+    auto fnPortal = [&fnNode, &stEdgeVV](int nX0, int nY0, int nX1, int nY1)
+    {
+        auto nNode0 = fnNode(nX0, nY0);
+        auto nNode1 = fnNode(nX1, nY1);
+
+        stEdgeVV[nNode0].push_back({nNode1, 1.0f});
+        stEdgeVV[nNode1].push_back({nNode0, 1.0f});
+    };
+
+    // walk along a border, (nX, nY) is on one side, (nX + nDX, nY + nDY) on the other
+    // the border goes in (nStepX, nStepY) for nLength cells
+    auto fnBorder = [this, &fnPortal](int nX, int nY, int nDX, int nDY, int nStepX, int nStepY, int nLength)
+    {
+        int nRunBegin = -1;
+        for(int nIndex = 0; nIndex <= nLength; ++nIndex){
+            int nCurrX = nX + nStepX * nIndex;
+            int nCurrY = nY + nStepY * nIndex;
+
+            bool bOpen = true
+                && nIndex < nLength
+                && m_WalkMap->Walkable(nCurrX, nCurrY)
+                && m_WalkMap->Walkable(nCurrX + nDX, nCurrY + nDY);
+
+            if(bOpen){
+                if(nRunBegin < 0){
+                    nRunBegin = nIndex;
+                }
+                continue;
+            }
+
+            if(nRunBegin >= 0){
+                int nRunEnd = nIndex - 1;
+                if(nRunEnd - nRunBegin + 1 < MAX_SINGLE_PORTAL_RUN){
+                    int nMid = (nRunBegin + nRunEnd) / 2;
+                    fnPortal(nX + nStepX * nMid, nY + nStepY * nMid, nX + nStepX * nMid + nDX, nY + nStepY * nMid + nDY);
+                }else{
+                    fnPortal(nX + nStepX * nRunBegin, nY + nStepY * nRunBegin, nX + nStepX * nRunBegin + nDX, nY + nStepY * nRunBegin + nDY);
+                    fnPortal(nX + nStepX * nRunEnd,   nY + nStepY * nRunEnd,   nX + nStepX * nRunEnd   + nDX, nY + nStepY * nRunEnd   + nDY);
+                }
+                nRunBegin = -1;
+            }
+        }
+    };
+
+    for(int nCY = 0; nCY < m_ClusterH; ++nCY){
+        for(int nCX = 0; nCX < m_ClusterW; ++nCX){
+            int nX0 = nCX * CLUSTER_SIZE;
+            int nY0 = nCY * CLUSTER_SIZE;
+
+            // right border and bottom border of each cluster
+            if(nCX + 1 < m_ClusterW){
+                fnBorder(nX0 + CLUSTER_SIZE - 1, nY0, 1, 0, 0, 1, std::min<int>(CLUSTER_SIZE, nH - nY0));
+            }
+
+            if(nCY + 1 < m_ClusterH){
+                fnBorder(nX0, nY0 + CLUSTER_SIZE - 1, 0, 1, 1, 0, std::min<int>(CLUSTER_SIZE, nW - nX0));
+            }
+        }
+    }
+
+    // 2. intra edges
+    //    shortest path inside the cluster between each pair of its portals
+    std::vector<float> stDistV;
+    for(auto &rstNodeV: m_ClusterNodeV){
+        for(auto nFrom: rstNodeV){
+            ClusterDistance(m_NodeV[nFrom].X, m_NodeV[nFrom].Y, &stDistV);
+            for(auto nTo: rstNodeV){
+                if(nTo != nFrom){
+                    auto fDist = stDistV[(m_NodeV[nTo].Y % CLUSTER_SIZE) * CLUSTER_SIZE + (m_NodeV[nTo].X % CLUSTER_SIZE)];
+                    if(fDist < INF_COST){
+                        stEdgeVV[nFrom].push_back({nTo, fDist});
+                    }
+                }
+            }
+        }
+    }
+
+    // 3. flatten
+    for(size_t nIndex = 0; nIndex < m_NodeV.size(); ++nIndex){
+        m_NodeV[nIndex].EdgeBegin = (uint32_t)(m_EdgeV.size());
+        m_NodeV[nIndex].EdgeCount = (uint32_t)(stEdgeVV[nIndex].size());
+        m_EdgeV.insert(m_EdgeV.end(), stEdgeVV[nIndex].begin(), stEdgeVV[nIndex].end());
+    }
+}
+
+bool PortalGraph::Load(const char *szPath)
+{
+    if(!(m_WalkMap && szPath)){
+        return false;
+    }
+
+    auto fp = std::fopen(szPath, "rb");
+    if(!fp){
+        return false;
+    }
+
+    std::vector<Node> stNodeV;
+    std::vector<Edge> stEdgeV;
+
+    bool bOK = false;
+    PortalGraphHeader stHeader;
+
+    if(true
+            && std::fread(&stHeader, sizeof(stHeader), 1, fp) == 1
+            && stHeader.Magic       == PORTAL_GRAPH_MAGIC
+            && stHeader.Version     == PORTAL_GRAPH_VERSION
+            && stHeader.W           == m_WalkMap->W()
+            && stHeader.H           == m_WalkMap->H()
+            && stHeader.ClusterSize == CLUSTER_SIZE
+            && stHeader.Checksum    == m_WalkMap->Checksum()){
+
+        stNodeV.resize(stHeader.NodeCount);
+        stEdgeV.resize(stHeader.EdgeCount);
+
+        bOK = true
+            && std::fread(stNodeV.data(), sizeof(Node), stNodeV.size(), fp) == stNodeV.size()
+            && std::fread(stEdgeV.data(), sizeof(Edge), stEdgeV.size(), fp) == stEdgeV.size();
+    }
+    std::fclose(fp);
+
+    if(!bOK){
+        return false;
+    }
+
+    // the file could be truncated or broken
+    // don't trust any index in it
+    for(auto &rstNode: stNodeV){
+        if(false
+                || !m_WalkMap->ValidC(rstNode.X, rstNode.Y)
+                || (uint64_t)(rstNode.EdgeBegin) + rstNode.EdgeCount > stEdgeV.size()){
+            return false;
+        }
+    }
+
+    for(auto &rstEdge: stEdgeV){
+        if(rstEdge.To >= stNodeV.size()){
+            return false;
+        }
+    }
+
+    m_NodeV.swap(stNodeV);
+    m_EdgeV.swap(stEdgeV);
+
+    for(auto &rstNodeV: m_ClusterNodeV){
+        rstNodeV.clear();
+    }
+
+    for(size_t nIndex = 0; nIndex < m_NodeV.size(); ++nIndex){
+        m_ClusterNodeV[ClusterID(m_NodeV[nIndex].X, m_NodeV[nIndex].Y)].push_back((uint32_t)(nIndex));
+    }
+    return true;
+}
+
+bool PortalGraph::Save(const char *szPath) const
+{
+    if(!(m_WalkMap && szPath)){
+        return false;
+    }
+
+    PortalGraphHeader stHeader;
+    stHeader.Magic       = PORTAL_GRAPH_MAGIC;
+    stHeader.Version     = PORTAL_GRAPH_VERSION;
+    stHeader.W           = m_WalkMap->W();
+    stHeader.H           = m_WalkMap->H();
+    stHeader.ClusterSize = CLUSTER_SIZE;
+    stHeader.NodeCount   = (uint32_t)(m_NodeV.size());
+    stHeader.EdgeCount   = (uint32_t)(m_EdgeV.size());
+    stHeader.Reserved    = 0;
+    stHeader.Checksum    = m_WalkMap->Checksum();
+
+    auto fp = std::fopen(szPath, "wb");
+    if(!fp){
+        return false;
+    }
+
+    bool bOK = true
+        && std::fwrite(&stHeader,     sizeof(stHeader), 1,              fp) == 1
+        && std::fwrite(m_NodeV.data(), sizeof(Node),    m_NodeV.size(), fp) == m_NodeV.size()
+        && std::fwrite(m_EdgeV.data(), sizeof(Edge),    m_EdgeV.size(), fp) == m_EdgeV.size();
+
+    bOK = (std::fclose(fp) == 0) && bOK;
+    if(!bOK){
+        std::remove(szPath);
+    }
+    return bOK;
+}
+
+bool PortalGraph::AbstractSearch(int nX0, int nY0, int nX1, int nY1, std::vector<PathFind::PathNode> *pWayPointV) const
+{
+    if(!(m_WalkMap->ValidC(nX0, nY0) && m_WalkMap->Walkable(nX1, nY1))){
+        return false;
+    }
+
+    // start and goal are two extra nodes
+    // start connects to portals of its cluster, portals of goal cluster connect to goal
+    auto nNodeCount = (uint32_t)(m_NodeV.size());
+    auto nStart     = nNodeCount + 0;
+    auto nGoal      = nNodeCount + 1;
+
+    auto nStartCluster = ClusterID(nX0, nY0);
+    auto nGoalCluster  = ClusterID(nX1, nY1);
+
+    std::vector<float> stStartDistV;
+    std::vector<float> stGoalDistV;
+
+    ClusterDistance(nX0, nY0, &stStartDistV);
+    ClusterDistance(nX1, nY1, &stGoalDistV);
+
+    auto fnLocal = [](int nX, int nY)
+    {
+        return (nY % CLUSTER_SIZE) * CLUSTER_SIZE + (nX % CLUSTER_SIZE);
+    };
+
+    std::vector<float>    stGV(nNodeCount + 2, INF_COST);
+    std::vector<uint32_t> stParentV(nNodeCount + 2, nStart);
+    std::vector<uint8_t>  stClosedV(nNodeCount + 2, 0);
+
+    std::vector<std::pair<float, uint32_t>> stHeap;
+    auto fnPush = [&](uint32_t nNode, uint32_t nParent, float fG)
+    {
+        if(!stClosedV[nNode] && fG < stGV[nNode]){
+            stGV[nNode]      = fG;
+            stParentV[nNode] = nParent;
+
+            auto fH = (nNode == nGoal) ? 0.0f : Octile(m_NodeV[nNode].X, m_NodeV[nNode].Y, nX1, nY1);
+            stHeap.emplace_back(-(fG + fH), nNode);
+            std::push_heap(stHeap.begin(), stHeap.end());
+        }
+    };
+
+    stGV[nStart] = 0.0f;
+    for(auto nNode: m_ClusterNodeV[nStartCluster]){
+        auto fDist = stStartDistV[fnLocal(m_NodeV[nNode].X, m_NodeV[nNode].Y)];
+        if(fDist < INF_COST){
+            fnPush(nNode, nStart, fDist);
+        }
+    }
+
+    while(!stHeap.empty()){
+        std::pop_heap(stHeap.begin(), stHeap.end());
+        auto nCurr = stHeap.back().second;
+        stHeap.pop_back();
+
+        if(stClosedV[nCurr]){
+            continue;
+        }
+        stClosedV[nCurr] = 1;
+
+        if(nCurr == nGoal){
+            break;
+        }
+
+        auto &rstNode = m_NodeV[nCurr];
+        for(uint32_t nIndex = 0; nIndex < rstNode.EdgeCount; ++nIndex){
+            auto &rstEdge = m_EdgeV[rstNode.EdgeBegin + nIndex];
+            fnPush(rstEdge.To, nCurr, stGV[nCurr] + rstEdge.Cost);
+        }
+
+        if(ClusterID(rstNode.X, rstNode.Y) == nGoalCluster){
+            auto fDist = stGoalDistV[fnLocal(rstNode.X, rstNode.Y)];
+            if(fDist < INF_COST){
+                fnPush(nGoal, nCurr, stGV[nCurr] + fDist);
+            }
+        }
+    }
+
+    if(!stClosedV[nGoal]){
+        return false;
+    }
+
+    pWayPointV->clear();
+    pWayPointV->emplace_back(nX1, nY1);
+    for(auto nNode = stParentV[nGoal]; nNode != nStart; nNode = stParentV[nNode]){
+        pWayPointV->emplace_back(m_NodeV[nNode].X, m_NodeV[nNode].Y);
+    }
+    pWayPointV->emplace_back(nX0, nY0);
+
+    std::reverse(pWayPointV->begin(), pWayPointV->end());
+    return true;
+}
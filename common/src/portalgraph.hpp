@@ -0,0 +1,208 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: portalgraph.hpp
+ *        Created: 05/31/2017 09:52:18
+ *  Last Modified: 05/31/2017 19:13:45
+ *
+ *    Description: hierarchical path finding (HPA*) over GridPathFinder::WalkMap
+ *
+ *                 map is split into CLUSTER_SIZE x CLUSTER_SIZE clusters, for each
+ *                 walkable run on the border of two clusters we put portals on both
+ *                 sides, then precompute
+ *
+ *                      1. inter edge: portal to its pair in the next cluster, cost 1.0
+ *                      2. intra edge: portal to portal in the same cluster, cost is
+ *                         the shortest path inside the cluster
+ *
+ *                 a long path is found by:
+ *
+ *                      1. connect start and goal to portals of their clusters
+ *                      2. A* on the portal graph, a few hundred nodes for a big map
+ *                         rather than all cells
+ *                      3. refine each hop by GridPathFinder bounded in one cluster,
+ *                         stop as long as enough cells are ready, the rest of the
+ *                         path is never refined, monsters and players re-path
+ *                         after a few steps anyway
+ *
+ *                 the graph is built when a map is loaded and saved alongside the map
+ *                 file, next time it's loaded directly if the walkability checksum
+ *                 still matches
+ *
+ *                 portal path is not always the shortest, and it could miss a way
+ *                 which only crosses a cluster border diagonally at a corner, then
+ *                 Search() falls back to a full grid search
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "pathfinder.hpp"
+#include "gridpathfinder.hpp"
+
+class PortalGraph final
+{
+    public:
+        constexpr static int CLUSTER_SIZE = 16;
+
+    private:
+        // walkable runs longer than this get two portals at both ends
+        constexpr static int MAX_SINGLE_PORTAL_RUN = 6;
+
+    private:
+        struct Node
+        {
+            int X;
+            int Y;
+
+            uint32_t EdgeBegin;
+            uint32_t EdgeCount;
+        };
+
+        struct Edge
+        {
+            uint32_t To;
+            float    Cost;
+        };
+
+    private:
+        const GridPathFinder::WalkMap *m_WalkMap;
+
+    private:
+        int m_ClusterW;
+        int m_ClusterH;
+
+    private:
+        // adjacency in CSR form, edges of node i are
+        // m_EdgeV[m_NodeV[i].EdgeBegin, m_NodeV[i].EdgeBegin + m_NodeV[i].EdgeCount)
+        std::vector<Node> m_NodeV;
+        std::vector<Edge> m_EdgeV;
+
+        // nodes of each cluster
+        std::vector<std::vector<uint32_t>> m_ClusterNodeV;
+
+    public:
+        PortalGraph(const GridPathFinder::WalkMap *);
+       ~PortalGraph() = default;
+
+    public:
+        void Build();
+
+    public:
+        // return false if the file doesn't exist, or it's built for another map
+        bool Load(const char *);
+        bool Save(const char *) const;
+
+    public:
+        size_t NodeCount() const
+        {
+            return m_NodeV.size();
+        }
+
+    public:
+        // path includes start and goal
+        // refine at least nMaxNode cells from the start, 0 means the whole path
+        bool Search(int nX0, int nY0, int nX1, int nY1, std::vector<PathFind::PathNode> *pPathV, size_t nMaxNode = 0) const
+        {
+            return InnSearch(nX0, nY0, nX1, nY1, pPathV, nMaxNode, [](GridPathFinder *pFinder, int nX0, int nY0, int nX1, int nY1)
+            {
+                return pFinder->Search(nX0, nY0, nX1, nY1);
+            });
+        }
+
+        // local refinement uses weighted search
+        // the portal graph itself only knows walkability
+        template<typename OccupiedFunc> bool Search(int nX0, int nY0, int nX1, int nY1, std::vector<PathFind::PathNode> *pPathV, size_t nMaxNode, OccupiedFunc &&fnOccupied) const
+        {
+            return InnSearch(nX0, nY0, nX1, nY1, pPathV, nMaxNode, [&fnOccupied](GridPathFinder *pFinder, int nX0, int nY0, int nX1, int nY1)
+            {
+                return pFinder->Search(nX0, nY0, nX1, nY1, fnOccupied);
+            });
+        }
+
+    private:
+        template<typename RefineFunc> bool InnSearch(int nX0, int nY0, int nX1, int nY1, std::vector<PathFind::PathNode> *pPathV, size_t nMaxNode, const RefineFunc &fnRefine) const
+        {
+            if(!(m_WalkMap && pPathV)){
+                return false;
+            }
+
+            pPathV->clear();
+            GridPathFinder stPathFinder(m_WalkMap);
+
+            // 1. start and goal in the same cluster, or no graph
+            //    search the grid directly
+            std::vector<PathFind::PathNode> stWayPointV;
+            if(!(true
+                        && !m_NodeV.empty()
+                        && ClusterID(nX0, nY0) != ClusterID(nX1, nY1)
+                        && AbstractSearch(nX0, nY0, nX1, nY1, &stWayPointV))){
+                if(fnRefine(&stPathFinder, nX0, nY0, nX1, nY1)){
+                    *pPathV = stPathFinder.Path();
+                    return true;
+                }
+                return false;
+            }
+
+            // 2. refine hop by hop
+            //    each hop is either inside one cluster, or one step over the border
+            pPathV->push_back(stWayPointV[0]);
+            for(size_t nIndex = 1; nIndex < stWayPointV.size(); ++nIndex){
+                if(nMaxNode && pPathV->size() >= nMaxNode){
+                    break;
+                }
+
+                auto &rstFrom = pPathV->back();
+                auto &rstTo   = stWayPointV[nIndex];
+
+                if(rstFrom.X == rstTo.X && rstFrom.Y == rstTo.Y){
+                    continue;
+                }
+
+                auto nClusterID = ClusterID(rstFrom.X, rstFrom.Y);
+                if(nClusterID != ClusterID(rstTo.X, rstTo.Y)){
+                    pPathV->push_back(rstTo);
+                    continue;
+                }
+
+                stPathFinder.Bound((nClusterID % m_ClusterW) * CLUSTER_SIZE, (nClusterID / m_ClusterW) * CLUSTER_SIZE, CLUSTER_SIZE, CLUSTER_SIZE);
+                if(!fnRefine(&stPathFinder, rstFrom.X, rstFrom.Y, rstTo.X, rstTo.Y)){
+                    // only if weighted refinement refuses
+                    // can't happen since occupied cells are allowed
+                    pPathV->clear();
+                    return false;
+                }
+
+                auto &rstHopV = stPathFinder.Path();
+                pPathV->insert(pPathV->end(), rstHopV.begin() + 1, rstHopV.end());
+            }
+            return true;
+        }
+
+    private:
+        int ClusterID(int nX, int nY) const
+        {
+            return (nY / CLUSTER_SIZE) * m_ClusterW + (nX / CLUSTER_SIZE);
+        }
+
+    private:
+        // distance from (nX, nY) to all cells of its cluster
+        // index is local: (nY % CLUSTER_SIZE) * CLUSTER_SIZE + (nX % CLUSTER_SIZE)
+        void ClusterDistance(int, int, std::vector<float> *) const;
+
+    private:
+        // way points: start, portals, goal
+        bool AbstractSearch(int, int, int, int, std::vector<PathFind::PathNode> *) const;
+};
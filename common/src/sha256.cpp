@@ -0,0 +1,149 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: sha256.cpp
+ *        Created: 05/29/2017 16:04:37
+ *  Last Modified: 05/29/2017 17:20:51
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstring>
+#include "sha256.hpp"
+
+namespace
+{
+    const uint32_t g_RoundK[64]
+    {
+        0X428A2F98, 0X71374491, 0XB5C0FBCF, 0XE9B5DBA5, 0X3956C25B, 0X59F111F1, 0X923F82A4, 0XAB1C5ED5,
+        0XD807AA98, 0X12835B01, 0X243185BE, 0X550C7DC3, 0X72BE5D74, 0X80DEB1FE, 0X9BDC06A7, 0XC19BF174,
+        0XE49B69C1, 0XEFBE4786, 0X0FC19DC6, 0X240CA1CC, 0X2DE92C6F, 0X4A7484AA, 0X5CB0A9DC, 0X76F988DA,
+        0X983E5152, 0XA831C66D, 0XB00327C8, 0XBF597FC7, 0XC6E00BF3, 0XD5A79147, 0X06CA6351, 0X14292967,
+        0X27B70A85, 0X2E1B2138, 0X4D2C6DFC, 0X53380D13, 0X650A7354, 0X766A0ABB, 0X81C2C92E, 0X92722C85,
+        0XA2BFE8A1, 0XA81A664B, 0XC24B8B70, 0XC76C51A3, 0XD192E819, 0XD6990624, 0XF40E3585, 0X106AA070,
+        0X19A4C116, 0X1E376C08, 0X2748774C, 0X34B0BCB5, 0X391C0CB3, 0X4ED8AA4A, 0X5B9CCA4F, 0X682E6FF3,
+        0X748F82EE, 0X78A5636F, 0X84C87814, 0X8CC70208, 0X90BEFFFA, 0XA4506CEB, 0XBEF9A3F7, 0XC67178F2,
+    };
+
+    uint32_t RotateRight(uint32_t nValue, int nBits)
+    {
+        return (nValue >> nBits) | (nValue << (32 - nBits));
+    }
+
+    // process one 64-byte block
+    void HashBlock(uint32_t *pState, const uint8_t *pBlock)
+    {
+        uint32_t nW[64];
+        for(int nIndex = 0; nIndex < 16; ++nIndex){
+            nW[nIndex] = 0
+                | ((uint32_t)(pBlock[nIndex * 4 + 0]) << 24)
+                | ((uint32_t)(pBlock[nIndex * 4 + 1]) << 16)
+                | ((uint32_t)(pBlock[nIndex * 4 + 2]) <<  8)
+                | ((uint32_t)(pBlock[nIndex * 4 + 3]) <<  0);
+        }
+
+        for(int nIndex = 16; nIndex < 64; ++nIndex){
+            auto nS0 = RotateRight(nW[nIndex - 15],  7) ^ RotateRight(nW[nIndex - 15], 18) ^ (nW[nIndex - 15] >>  3);
+            auto nS1 = RotateRight(nW[nIndex -  2], 17) ^ RotateRight(nW[nIndex -  2], 19) ^ (nW[nIndex -  2] >> 10);
+            nW[nIndex] = nW[nIndex - 16] + nS0 + nW[nIndex - 7] + nS1;
+        }
+
+        uint32_t nA = pState[0];
+        uint32_t nB = pState[1];
+        uint32_t nC = pState[2];
+        uint32_t nD = pState[3];
+        uint32_t nE = pState[4];
+        uint32_t nF = pState[5];
+        uint32_t nG = pState[6];
+        uint32_t nH = pState[7];
+
+        for(int nIndex = 0; nIndex < 64; ++nIndex){
+            auto nS1   = RotateRight(nE, 6) ^ RotateRight(nE, 11) ^ RotateRight(nE, 25);
+            auto nCh   = (nE & nF) ^ ((~nE) & nG);
+            auto nTmp1 = nH + nS1 + nCh + g_RoundK[nIndex] + nW[nIndex];
+            auto nS0   = RotateRight(nA, 2) ^ RotateRight(nA, 13) ^ RotateRight(nA, 22);
+            auto nMaj  = (nA & nB) ^ (nA & nC) ^ (nB & nC);
+            auto nTmp2 = nS0 + nMaj;
+
+            nH = nG;
+            nG = nF;
+            nF = nE;
+            nE = nD + nTmp1;
+            nD = nC;
+            nC = nB;
+            nB = nA;
+            nA = nTmp1 + nTmp2;
+        }
+
+        pState[0] += nA;
+        pState[1] += nB;
+        pState[2] += nC;
+        pState[3] += nD;
+        pState[4] += nE;
+        pState[5] += nF;
+        pState[6] += nG;
+        pState[7] += nH;
+    }
+}
+
+SHA256::Digest SHA256::Hash(const uint8_t *pData, size_t nDataLen)
+{
+    uint32_t nState[8]
+    {
+        0X6A09E667, 0XBB67AE85, 0X3C6EF372, 0XA54FF53A, 0X510E527F, 0X9B05688C, 0X1F83D9AB, 0X5BE0CD19,
+    };
+
+    size_t nIndex = 0;
+    for(; pData && (nIndex + 64 <= nDataLen); nIndex += 64){
+        HashBlock(nState, pData + nIndex);
+    }
+
+    // padding: 0X80, zeros, then bit length in big-endian
+    // one or two blocks left
+    uint8_t nTail[128];
+    size_t  nTailLen = nDataLen - nIndex;
+
+    std::memset(nTail, 0, sizeof(nTail));
+    if(nTailLen){
+        std::memcpy(nTail, pData + nIndex, nTailLen);
+    }
+    nTail[nTailLen] = 0X80;
+
+    size_t nBlockLen = (nTailLen + 1 + 8 <= 64) ? 64 : 128;
+    uint64_t nBitLen = (uint64_t)(nDataLen) * 8;
+    for(int nByte = 0; nByte < 8; ++nByte){
+        nTail[nBlockLen - 1 - nByte] = (uint8_t)(nBitLen >> (nByte * 8));
+    }
+
+    for(size_t nOff = 0; nOff < nBlockLen; nOff += 64){
+        HashBlock(nState, nTail + nOff);
+    }
+
+    Digest stDigest;
+    for(int nWord = 0; nWord < 8; ++nWord){
+        stDigest[nWord * 4 + 0] = (uint8_t)(nState[nWord] >> 24);
+        stDigest[nWord * 4 + 1] = (uint8_t)(nState[nWord] >> 16);
+        stDigest[nWord * 4 + 2] = (uint8_t)(nState[nWord] >>  8);
+        stDigest[nWord * 4 + 3] = (uint8_t)(nState[nWord] >>  0);
+    }
+    return stDigest;
+}
+
+bool SHA256::Equal(const SHA256::Digest &rstLHS, const SHA256::Digest &rstRHS)
+{
+    uint8_t nDiff = 0;
+    for(size_t nIndex = 0; nIndex < rstLHS.size(); ++nIndex){
+        nDiff |= (rstLHS[nIndex] ^ rstRHS[nIndex]);
+    }
+    return nDiff == 0;
+}
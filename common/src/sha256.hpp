@@ -0,0 +1,37 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: sha256.hpp
+ *        Created: 05/29/2017 16:02:15
+ *  Last Modified: 05/29/2017 17:20:48
+ *
+ *    Description: SHA-256 of a byte buffer, FIPS 180-4
+ *
+ *                 no external crypto library in the tree, this is small enough to
+ *                 keep here, it's for digests kept in memory, not for storage
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace SHA256
+{
+    using Digest = std::array<uint8_t, 32>;
+
+    Digest Hash(const uint8_t *, size_t);
+
+    // compare without early exit, time doesn't depend on where they differ
+    bool Equal(const Digest &, const Digest &);
+}
@@ -0,0 +1,202 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: accountcache.cpp
+ *        Created: 05/29/2017 10:49:21
+ *  Last Modified: 05/29/2017 15:40:03
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <random>
+#include <vector>
+#include <cstring>
+#include <cinttypes>
+#include "monoserver.hpp"
+#include "accountcache.hpp"
+
+AccountCache::AccountCache(size_t nCapacity, uint32_t nExpireMS)
+    : m_Capacity(nCapacity)
+    , m_ExpireMS(nExpireMS)
+    , m_Salt()
+    , m_Lock()
+    , m_LRUList()
+    , m_EntryMap()
+    , m_GUIDMap()
+    , m_HitCount(0)
+    , m_MissCount(0)
+{
+    std::random_device stRD;
+    for(auto &rnByte: m_Salt){
+        rnByte = (uint8_t)(stRD());
+    }
+}
+
+SHA256::Digest AccountCache::PasswordHash(const char *szPassword) const
+{
+    auto nPasswordLen = std::strlen(szPassword);
+    std::vector<uint8_t> stBuf(m_Salt.size() + nPasswordLen);
+
+    std::memcpy(&(stBuf[0]), &(m_Salt[0]), m_Salt.size());
+    std::memcpy(&(stBuf[0]) + m_Salt.size(), szPassword, nPasswordLen);
+
+    auto stDigest = SHA256::Hash(&(stBuf[0]), stBuf.size());
+
+    // don't leave the plain text on heap
+    // write by volatile pointer, compiler can't drop it as a dead store
+    volatile uint8_t *pBuf = &(stBuf[0]);
+    for(size_t nIndex = 0; nIndex < stBuf.size(); ++nIndex){
+        pBuf[nIndex] = 0;
+    }
+    return stDigest;
+}
+
+void AccountCache::Erase(std::unordered_map<std::string, CacheEntry>::iterator pEntry)
+{
+    auto pGUID = m_GUIDMap.find(pEntry->second.Record.GUID);
+    if(pGUID != m_GUIDMap.end() && pGUID->second == pEntry->first){
+        m_GUIDMap.erase(pGUID);
+    }
+
+    m_LRUList.erase(pEntry->second.LRU);
+    m_EntryMap.erase(pEntry);
+}
+
+bool AccountCache::Get(const char *szAccount, const char *szPassword, AccountRecord *pRecord)
+{
+    if(!(Enabled() && szAccount && szPassword && pRecord)){
+        return false;
+    }
+
+    // hash before taking the lock
+    auto stPasswordHash = PasswordHash(szPassword);
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    auto pEntry = m_EntryMap.find(szAccount);
+    if(pEntry == m_EntryMap.end()){
+        m_MissCount++;
+        return false;
+    }
+
+    if(std::chrono::steady_clock::now() >= pEntry->second.Expiration){
+        Erase(pEntry);
+        m_MissCount++;
+        return false;
+    }
+
+    // password could be changed in database
+    // let database decide, the entry is refreshed if it succeeds
+    if(!SHA256::Equal(pEntry->second.PasswordHash, stPasswordHash)){
+        m_MissCount++;
+        return false;
+    }
+
+    m_LRUList.splice(m_LRUList.begin(), m_LRUList, pEntry->second.LRU);
+    *pRecord = pEntry->second.Record;
+
+    m_HitCount++;
+    return true;
+}
+
+void AccountCache::Put(const char *szAccount, const char *szPassword, const AccountRecord &rstRecord)
+{
+    if(!(Enabled() && szAccount && szPassword)){
+        return;
+    }
+
+    auto stPasswordHash = PasswordHash(szPassword);
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    auto pEntry = m_EntryMap.find(szAccount);
+    if(pEntry != m_EntryMap.end()){
+        // the database query could start before the latest Update()
+        // keep the cached row, only accept the password which database just verified
+        //
+        // an expired entry or a different guid means the row was changed outside, replace it
+        if(true
+                && pEntry->second.Record.GUID == rstRecord.GUID
+                && std::chrono::steady_clock::now() < pEntry->second.Expiration){
+            pEntry->second.PasswordHash = stPasswordHash;
+            m_LRUList.splice(m_LRUList.begin(), m_LRUList, pEntry->second.LRU);
+            return;
+        }
+        Erase(pEntry);
+    }
+
+    while(m_EntryMap.size() >= m_Capacity){
+        Erase(m_EntryMap.find(m_LRUList.back()));
+    }
+
+    m_LRUList.push_front(szAccount);
+
+    auto &rstEntry = m_EntryMap[szAccount];
+    rstEntry.PasswordHash = stPasswordHash;
+    rstEntry.Record       = rstRecord;
+    rstEntry.Expiration   = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_ExpireMS);
+    rstEntry.LRU          = m_LRUList.begin();
+
+    m_GUIDMap[rstRecord.GUID] = szAccount;
+}
+
+void AccountCache::Update(uint32_t nGUID, const PersistHub::Record &rstRecord)
+{
+    if(!Enabled()){
+        return;
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    auto pGUID = m_GUIDMap.find(nGUID);
+    if(pGUID == m_GUIDMap.end()){
+        return;
+    }
+
+    auto pEntry = m_EntryMap.find(pGUID->second);
+    if(pEntry == m_EntryMap.end()){
+        return;
+    }
+
+    auto &rstCached = pEntry->second.Record;
+    if(rstRecord.Has(PersistHub::FIELD_MAPID    )){ rstCached.MapID     = (uint32_t)(rstRecord.Value[PersistHub::FIELD_MAPID]); }
+    if(rstRecord.Has(PersistHub::FIELD_MAPX     )){ rstCached.MapX      = rstRecord.Value[PersistHub::FIELD_MAPX     ]; }
+    if(rstRecord.Has(PersistHub::FIELD_MAPY     )){ rstCached.MapY      = rstRecord.Value[PersistHub::FIELD_MAPY     ]; }
+    if(rstRecord.Has(PersistHub::FIELD_LEVEL    )){ rstCached.Level     = rstRecord.Value[PersistHub::FIELD_LEVEL    ]; }
+    if(rstRecord.Has(PersistHub::FIELD_DIRECTION)){ rstCached.Direction = rstRecord.Value[PersistHub::FIELD_DIRECTION]; }
+}
+
+void AccountCache::Invalidate(const char *szAccount)
+{
+    if(!szAccount){
+        return;
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    auto pEntry = m_EntryMap.find(szAccount);
+    if(pEntry != m_EntryMap.end()){
+        Erase(pEntry);
+    }
+}
+
+void AccountCache::Clear()
+{
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    m_LRUList.clear();
+    m_EntryMap.clear();
+    m_GUIDMap.clear();
+}
+
+void AccountCache::Report()
+{
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_INFO, "AccountCache statistics: HitCount = %" PRIu64 ", MissCount = %" PRIu64,
+            (uint64_t)(m_HitCount), (uint64_t)(m_MissCount));
+}
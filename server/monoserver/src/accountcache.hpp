@@ -0,0 +1,148 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: accountcache.hpp
+ *        Created: 05/29/2017 10:07:44
+ *  Last Modified: 05/29/2017 15:38:10
+ *
+ *    Description: in-memory cache of account and guid rows for login
+ *
+ *                 each login costs two round trips to the database:
+ *
+ *                      (account, password) -> fld_id      by tbl_account
+ *                      fld_id              -> guid row    by tbl_guid
+ *
+ *                 successful logins put the result here keyed by account name, then
+ *                 relogin and reconnect are served in ServiceCore without DBPod
+ *
+ *                 1. password is checked by the cache, mismatch goes to database, only
+ *                    salted SHA-256 of the password is kept, never the plain text
+ *                 2. entries expire after m_ExpireMS and the least recently used
+ *                    is evicted when full
+ *                 3. PersistHub writes player state behind, database could be older
+ *                    than memory, so Update() keeps cached rows current by guid, and
+ *                    Put() never overwrites the row of a live entry by database result
+ *                 4. Invalidate() / Clear() when account or guid rows are changed
+ *                    outside of the server
+ *
+ *                 capacity 0 disables the cache
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <list>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+#include "sha256.hpp"
+#include "persisthub.hpp"
+
+class AccountCache final
+{
+    public:
+        struct AccountRecord
+        {
+            uint32_t ID;
+            uint32_t GUID;
+            uint32_t MapID;
+            int      MapX;
+            int      MapY;
+            int      Level;
+            int      JobID;
+            int      Direction;
+
+            AccountRecord()
+                : ID(0)
+                , GUID(0)
+                , MapID(0)
+                , MapX(0)
+                , MapY(0)
+                , Level(0)
+                , JobID(0)
+                , Direction(0)
+            {}
+        };
+
+    private:
+        struct CacheEntry
+        {
+            SHA256::Digest PasswordHash;
+            AccountRecord  Record;
+
+            std::chrono::steady_clock::time_point Expiration;
+            std::list<std::string>::iterator      LRU;
+        };
+
+    private:
+        const size_t   m_Capacity;
+        const uint32_t m_ExpireMS;
+
+    private:
+        // random per instance, digests of the same password differ in every run
+        std::array<uint8_t, 16> m_Salt;
+
+    private:
+        std::mutex m_Lock;
+
+        // front is the most recently used
+        std::list<std::string> m_LRUList;
+
+        std::unordered_map<std::string, CacheEntry> m_EntryMap;
+        std::unordered_map<uint32_t, std::string>   m_GUIDMap;
+
+    private:
+        std::atomic<uint64_t> m_HitCount;
+        std::atomic<uint64_t> m_MissCount;
+
+    public:
+        AccountCache(size_t, uint32_t);
+       ~AccountCache() = default;
+
+    public:
+        bool Enabled() const
+        {
+            return m_Capacity > 0;
+        }
+
+    public:
+        // return true and fill the record if account is cached and password matches
+        bool Get(const char *, const char *, AccountRecord *);
+
+        // called after login succeeded by database
+        // if account is cached already only password is refreshed, row by database
+        // could be older than the cached one which is kept current by Update()
+        void Put(const char *, const char *, const AccountRecord &);
+
+    public:
+        // apply state marked to PersistHub
+        // do nothing if the guid is not cached
+        void Update(uint32_t, const PersistHub::Record &);
+
+    public:
+        void Invalidate(const char *);
+        void Clear();
+
+    public:
+        // log hit / miss counts
+        void Report();
+
+    private:
+        void Erase(std::unordered_map<std::string, CacheEntry>::iterator);
+
+    private:
+        SHA256::Digest PasswordHash(const char *) const;
+};
@@ -80,6 +80,7 @@ ActiveObject::ActiveObject()
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ActiveObject>();
 }
 
 ActiveObject::~ActiveObject()
@@ -58,6 +58,10 @@ enum MessagePackType: int
     MPK_PATHFINDOK,
     MPK_ATTACK,
     MPK_NOTICE,
+    MPK_IDLE,
+    MPK_MAPLOADED,
+    MPK_MAPIDLE,
+    MPK_UNLOADMAP,
 };
 
 typedef struct
@@ -246,6 +250,7 @@ typedef struct
     uint32_t UID;
     uint32_t MapID;
     uint32_t MapUID;
+    uint32_t SessionID;
 
     int X;
     int Y;
@@ -333,3 +338,26 @@ typedef struct
     int X;
     int Y;
 }AMNotice;
+
+typedef struct
+{
+    uint32_t UID;
+    uint32_t MapID;
+}AMIdle;
+
+typedef struct
+{
+    uint32_t MapID;
+
+    // ServerMap *
+    void *Data;
+
+    uint32_t LoadTime;
+    uint32_t MemorySize;
+}AMMapLoaded;
+
+typedef struct
+{
+    uint32_t MapID;
+    uint32_t IdleTime;
+}AMMapIdle;
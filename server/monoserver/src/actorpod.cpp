@@ -170,27 +170,27 @@ bool ActorPod::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr,
     if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_INFO, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u)",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), 0, nRespond);
     }
 
     if(!rstAddr){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Try to send message to an emtpy address",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), 0, nRespond);
         return false;
     }
 
     if(rstAddr == GetAddress()){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Try to send message to itself",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), 0, nRespond);
         return false;
     }
 
     if(!Theron::Actor::Send<MessagePack>({rstMB, 0, nRespond}, rstAddr)){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Faile to send message to given address",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), 0, nRespond);
         return false;
     }
 
@@ -208,27 +208,27 @@ bool ActorPod::Forward(const MessageBuf &rstMB,
     if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_INFO, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u)",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), nID, nRespond);
     }
 
     if(!rstAddr){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Try to send message to an empty address",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), nID, nRespond);
         return false;
     }
 
     if(rstAddr == GetAddress()){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Try to send message to itself",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), nID, nRespond);
         return false;
     }
 
     if(!Theron::Actor::Send<MessagePack>({rstMB, nID, nRespond}, rstAddr)){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Failed to send message to given address",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack::Name(rstMB.Type()), nID, nRespond);
         return false;
     }
 
@@ -0,0 +1,153 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: aoigrid.cpp
+ *        Created: 05/20/2017 14:35:50
+ *  Last Modified: 05/20/2017 23:40:12
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cinttypes>
+#include "aoigrid.hpp"
+#include "monoserver.hpp"
+
+AOIGrid::AOIGrid(int nW, int nH, int nRangeW, int nRangeH)
+    : m_W(std::max<int>(nW, 0))
+    , m_H(std::max<int>(nH, 0))
+    , m_RangeW(std::max<int>(nRangeW, 1))
+    , m_RangeH(std::max<int>(nRangeH, 1))
+    , m_BucketW(m_RangeW)
+    , m_BucketH(m_RangeH)
+    , m_BucketCountW((m_W + m_BucketW - 1) / m_BucketW)
+    , m_BucketCountH((m_H + m_BucketH - 1) / m_BucketH)
+    , m_BucketV()
+    , m_RecordV()
+{
+    m_BucketV.resize((size_t)(m_BucketCountW) * (size_t)(m_BucketCountH));
+}
+
+void AOIGrid::BucketErase(uint32_t nUID, int nX, int nY)
+{
+    auto &rstBucket = m_BucketV[BucketIndex(nX, nY)];
+    for(auto &nBucketUID: rstBucket){
+        if(nBucketUID == nUID){
+            std::swap(nBucketUID, rstBucket.back());
+            rstBucket.pop_back();
+            return;
+        }
+    }
+
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_WARNING, "AOIGrid bucket doesn't contain UID = %" PRIu32 " at (%d, %d)", nUID, nX, nY);
+}
+
+std::unordered_set<uint32_t> AOIGrid::CollectViewer(uint32_t nUID, int nX, int nY) const
+{
+    std::unordered_set<uint32_t> stViewerSet;
+    QueryRange(nX, nY, [nUID, &stViewerSet](const AOIRecord &rstRecord){
+        if(rstRecord.UID != nUID){
+            stViewerSet.insert(rstRecord.UID);
+        }
+    });
+    return stViewerSet;
+}
+
+bool AOIGrid::Add(uint32_t nUID, uint32_t nFlag, const Theron::Address &rstAddress, int nX, int nY)
+{
+    if(!(nUID && ValidC(nX, nY))){
+        return false;
+    }
+
+    auto pRecord = m_RecordV.find(nUID);
+    if(pRecord != m_RecordV.end()){
+        pRecord->second.Flag    = nFlag;
+        pRecord->second.Address = rstAddress;
+        return Move(nUID, nX, nY);
+    }
+
+    auto stViewerSet = CollectViewer(nUID, nX, nY);
+    for(auto nViewerUID: stViewerSet){
+        m_RecordV[nViewerUID].ViewerSet.insert(nUID);
+    }
+
+    auto &rstRecord = m_RecordV[nUID];
+    rstRecord = AOIRecord(nUID, nFlag, rstAddress, nX, nY);
+    rstRecord.ViewerSet.swap(stViewerSet);
+
+    m_BucketV[BucketIndex(nX, nY)].push_back(nUID);
+    return true;
+}
+
+bool AOIGrid::Move(uint32_t nUID, int nX, int nY)
+{
+    if(!ValidC(nX, nY)){
+        return false;
+    }
+
+    auto pRecord = m_RecordV.find(nUID);
+    if(pRecord == m_RecordV.end()){
+        return false;
+    }
+
+    auto &rstRecord = pRecord->second;
+    if(rstRecord.X == nX && rstRecord.Y == nY){
+        return true;
+    }
+
+    if(BucketIndex(rstRecord.X, rstRecord.Y) != BucketIndex(nX, nY)){
+        BucketErase(nUID, rstRecord.X, rstRecord.Y);
+        m_BucketV[BucketIndex(nX, nY)].push_back(nUID);
+    }
+
+    rstRecord.X = nX;
+    rstRecord.Y = nY;
+
+    // only the delta of the viewer set is applied
+    // 1. viewers out of range now : remove me from their set
+    // 2. viewers just come in     : add me to their set
+    auto stViewerSet = CollectViewer(nUID, nX, nY);
+    for(auto nViewerUID: rstRecord.ViewerSet){
+        if(stViewerSet.find(nViewerUID) == stViewerSet.end()){
+            m_RecordV[nViewerUID].ViewerSet.erase(nUID);
+        }
+    }
+
+    for(auto nViewerUID: stViewerSet){
+        if(rstRecord.ViewerSet.find(nViewerUID) == rstRecord.ViewerSet.end()){
+            m_RecordV[nViewerUID].ViewerSet.insert(nUID);
+        }
+    }
+
+    rstRecord.ViewerSet.swap(stViewerSet);
+    return true;
+}
+
+bool AOIGrid::Remove(uint32_t nUID)
+{
+    auto pRecord = m_RecordV.find(nUID);
+    if(pRecord == m_RecordV.end()){
+        return false;
+    }
+
+    for(auto nViewerUID: pRecord->second.ViewerSet){
+        auto pViewer = m_RecordV.find(nViewerUID);
+        if(pViewer != m_RecordV.end()){
+            pViewer->second.ViewerSet.erase(nUID);
+        }
+    }
+
+    BucketErase(nUID, pRecord->second.X, pRecord->second.Y);
+    m_RecordV.erase(pRecord);
+    return true;
+}
@@ -0,0 +1,212 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: aoigrid.hpp
+ *        Created: 05/20/2017 14:02:17
+ *  Last Modified: 05/20/2017 23:41:09
+ *
+ *    Description: area-of-interest index for server map
+ *
+ *                 previously server map keeps UID's in each cell and for every action
+ *                 it scans a (2 * W + 1) x (2 * H + 1) rectangle and retrieves the
+ *                 UIDRecord for every UID found, which is the dominant cost for map
+ *
+ *                 AOIGrid divides the map into coarse buckets with bucket size equal
+ *                 to the visible range, then a range query only touches 3 x 3 buckets
+ *                 at most, and each record keeps cached address and class flag, so
+ *                 no GetUIDRecord() needed during broadcast
+ *
+ *                 every record also maintains a viewer set: ``who can see me"
+ *                 since visibility is symmetric it's also ``whom I can see", this set
+ *                 is updated incrementally by Add() / Move() / Remove(), then broadcast
+ *                 fan-out is just walking through the viewer set
+ *
+ *                 this class is not thread-safe, it's owned by server map and only
+ *                 accessed in the actor thread of the map
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <Theron/Address.h>
+
+enum AOIFlagType: uint32_t
+{
+    AOIFLAG_NONE       = 0,
+    AOIFLAG_ACTIVE     = (1 << 0),
+    AOIFLAG_CHAROBJECT = (1 << 1),
+    AOIFLAG_PLAYER     = (1 << 2),
+};
+
+class AOIGrid final
+{
+    public:
+        struct AOIRecord
+        {
+            uint32_t UID;
+            uint32_t Flag;
+            Theron::Address Address;
+
+            // session bound to the object, zero if none
+            // then map can send net messages to players directly
+            uint32_t SessionID;
+
+            int X;
+            int Y;
+
+            // objects in the visible range
+            // don't include the record itself
+            std::unordered_set<uint32_t> ViewerSet;
+
+            AOIRecord(uint32_t nUID = 0, uint32_t nFlag = AOIFLAG_NONE, const Theron::Address &rstAddress = Theron::Address::Null(), int nX = -1, int nY = -1)
+                : UID(nUID)
+                , Flag(nFlag)
+                , Address(rstAddress)
+                , SessionID(0)
+                , X(nX)
+                , Y(nY)
+                , ViewerSet()
+            {}
+        };
+
+    private:
+        const int m_W;
+        const int m_H;
+
+    private:
+        // half size of the visible rectangle
+        // (X0, Y0) and (X1, Y1) can see each other iif |X0 - X1| <= RangeW and |Y0 - Y1| <= RangeH
+        const int m_RangeW;
+        const int m_RangeH;
+
+    private:
+        // bucket size equals to the visible range
+        // then one range query touches at most 3 x 3 buckets
+        const int m_BucketW;
+        const int m_BucketH;
+        const int m_BucketCountW;
+        const int m_BucketCountH;
+
+    private:
+        std::vector<std::vector<uint32_t>> m_BucketV;
+        std::unordered_map<uint32_t, AOIRecord> m_RecordV;
+
+    public:
+        AOIGrid(int, int, int, int);
+       ~AOIGrid() = default;
+
+    public:
+        bool InRange(int nX0, int nY0, int nX1, int nY1) const
+        {
+            return true
+                && (std::abs(nX0 - nX1) <= m_RangeW)
+                && (std::abs(nY0 - nY1) <= m_RangeH);
+        }
+
+    public:
+        // insert a new record, or move it if already exists
+        bool Add(uint32_t, uint32_t, const Theron::Address &, int, int);
+
+        // update location of an existing record
+        // viewer sets are updated by the delta of the visible range
+        bool Move(uint32_t, int, int);
+
+        // remove the record and detach it from all viewer sets
+        bool Remove(uint32_t);
+
+        // bind a session to an existing record
+        bool BindSession(uint32_t nUID, uint32_t nSessionID)
+        {
+            auto pRecord = m_RecordV.find(nUID);
+            if(pRecord == m_RecordV.end()){
+                return false;
+            }
+
+            pRecord->second.SessionID = nSessionID;
+            return true;
+        }
+
+    public:
+        const AOIRecord *Find(uint32_t nUID) const
+        {
+            auto pRecord = m_RecordV.find(nUID);
+            return (pRecord == m_RecordV.end()) ? nullptr : &(pRecord->second);
+        }
+
+        size_t Count() const
+        {
+            return m_RecordV.size();
+        }
+
+    public:
+        // visit all records can see location (nX, nY)
+        // it only scans the nearby buckets, cost is O(neighbors)
+        template<typename F> void QueryRange(int nX, int nY, F &&fnOp) const
+        {
+            int nBX0 = std::max<int>(0, (nX - m_RangeW) / m_BucketW);
+            int nBY0 = std::max<int>(0, (nY - m_RangeH) / m_BucketH);
+            int nBX1 = std::min<int>(m_BucketCountW - 1, (nX + m_RangeW) / m_BucketW);
+            int nBY1 = std::min<int>(m_BucketCountH - 1, (nY + m_RangeH) / m_BucketH);
+
+            for(int nBY = nBY0; nBY <= nBY1; ++nBY){
+                for(int nBX = nBX0; nBX <= nBX1; ++nBX){
+                    for(auto nUID: m_BucketV[nBY * m_BucketCountW + nBX]){
+                        auto pRecord = m_RecordV.find(nUID);
+                        if(true
+                                && (pRecord != m_RecordV.end())
+                                && InRange(nX, nY, pRecord->second.X, pRecord->second.Y)){
+                            fnOp(pRecord->second);
+                        }
+                    }
+                }
+            }
+        }
+
+        // visit all viewers of given UID
+        template<typename F> void QueryViewer(uint32_t nUID, F &&fnOp) const
+        {
+            if(auto pRecord = Find(nUID)){
+                for(auto nViewerUID: pRecord->ViewerSet){
+                    if(auto pViewer = Find(nViewerUID)){
+                        fnOp(*pViewer);
+                    }
+                }
+            }
+        }
+
+        template<typename F> void ForEach(F &&fnOp) const
+        {
+            for(auto &rstRecord: m_RecordV){
+                fnOp(rstRecord.second);
+            }
+        }
+
+    private:
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+        size_t BucketIndex(int nX, int nY) const
+        {
+            return (size_t)((nY / m_BucketH) * m_BucketCountW + (nX / m_BucketW));
+        }
+
+    private:
+        void BucketErase(uint32_t, int, int);
+        std::unordered_set<uint32_t> CollectViewer(uint32_t, int, int) const;
+};
@@ -19,6 +19,7 @@
  */
 #include <mariadb/mysql.h>
 #include "dbrecord.hpp"
+#include "monoserver.hpp"
 #include "dbconnection.hpp"
 
 DBConnection::DBConnection(
@@ -29,6 +30,7 @@ DBConnection::DBConnection(
         unsigned int nPort)
     : m_SQL(nullptr)
     , m_Valid(false)
+    , m_StatementCache()
 {
     m_Valid = false;
     m_SQL   = mysql_init(nullptr);
@@ -45,9 +47,38 @@ DBConnection::DBConnection(
 
 DBConnection::~DBConnection()
 {
+    // statements should be closed before the connection
+    for(auto &rstRecord: m_StatementCache){
+        delete rstRecord.second;
+    }
+
     if(m_SQL){ mysql_close(m_SQL); }
 }
 
+DBStatement *DBConnection::Prepare(const char *szSQL)
+{
+    if(!(szSQL && Valid())){
+        return nullptr;
+    }
+
+    auto pRecord = m_StatementCache.find(szSQL);
+    if(pRecord != m_StatementCache.end()){
+        return pRecord->second;
+    }
+
+    auto pStatement = new DBStatement(this);
+    if(!pStatement->Prepare(szSQL)){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Prepare statement failed: (%d: %s), SQL = %s", pStatement->ErrorID(), pStatement->ErrorInfo(), szSQL);
+
+        delete pStatement;
+        return nullptr;
+    }
+
+    m_StatementCache[szSQL] = pStatement;
+    return pStatement;
+}
+
 void DBConnection::DestroyDBRecord(DBRecord *pDBRecord)
 {
     delete pDBRecord;
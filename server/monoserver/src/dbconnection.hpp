@@ -19,9 +19,12 @@
  */
 #pragma once
 #include <new>
+#include <string>
+#include <unordered_map>
 #include <mariadb/mysql.h>
 
 #include "dbrecord.hpp"
+#include "dbstatement.hpp"
 
 class DBConnection
 {
@@ -50,10 +53,19 @@ class DBConnection
 
         void DestroyDBRecord(DBRecord *);
 
+    public:
+        // prepare the statement at the first call and cache it by SQL text
+        // return nullptr if failed, check ErrorID() / ErrorInfo()
+        DBStatement *Prepare(const char *);
+
     private:
         MYSQL   *m_SQL;
         bool     m_Valid;
 
+    private:
+        std::unordered_map<std::string, DBStatement *> m_StatementCache;
+
     public:
         friend class DBRecord;
+        friend class DBStatement;
 };
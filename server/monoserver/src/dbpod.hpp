@@ -14,6 +14,21 @@
  *                 put RTTI support for the db unlock, which needs unique
  *                 pointer with deleter, so I just make a memory pool inside.
  *
+ *                 CreateDBHDR() is blocking, caller holds the connection for the
+ *                 whole round trip, it's fine for server initialization but a login
+ *                 storm on ThreadPN could stall all connections
+ *
+ *                 Submit() is the non-blocking way: each connection has its own
+ *                 worker thread and task queue, tasks are pipelined on it and the
+ *                 connection lock is taken once for a batch, task gets the
+ *                 connection and should send result back to actor by message
+ *
+ *                 tasks already submitted are always executed, destructor waits
+ *                 until all queues are drained
+ *
+ *                 connection and record types are template arguments only for the
+ *                 fake backend in tools/dbpodcheck, server always uses the default
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -26,8 +41,15 @@
  */
 
 #pragma once
+#include <deque>
+#include <mutex>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <functional>
+#include <condition_variable>
 
+#include "log.hpp"
 #include "dbrecord.hpp"
 #include "dbconnection.hpp"
 #include "memoryblockpn.hpp"
@@ -37,13 +59,13 @@
 //       1 : single thread
 //    >= 2 : support multi-thread
 //
-template<size_t ConnectionSize = 4>
+template<size_t ConnectionSize = 4, typename DBConnectionType = DBConnection, typename DBRecordType = DBRecord>
 class DBPod final
 {
     private:
         // the lock is on DBConnection and its DBRecordPN both, so here
         // we just use a un-locking PN
-        using DBRecordPN = MemoryBlockPN<sizeof(DBRecord), 1024, 1>;
+        using DBRecordPN = MemoryBlockPN<sizeof(DBRecordType), 1024, 1>;
         class InnDeleter
         {
             private:
@@ -60,7 +82,7 @@ class DBPod final
                 // so just use default destructor
                 ~InnDeleter() = default;
 
-            void operator()(DBRecord *pBuf)
+            void operator()(DBRecordType *pBuf)
             {
                 // 0. screen out null operation
                 if(!pBuf){ return; }
@@ -71,12 +93,12 @@ class DBPod final
                 // 2. unlock the corresponding DBConnection
                 //    not a good design since lock() / unlock() are in different scope
                 //    be careful when using it
-                if(ConnectionSize > 1 && m_Lock){ m_Lock->unlock(); }
+                if(m_Lock){ m_Lock->unlock(); }
             }
         };
 
     public:
-        using DBHDR = std::unique_ptr<DBRecord, InnDeleter>;
+        using DBHDR = std::unique_ptr<DBRecordType, InnDeleter>;
 
     private:
         std::string m_HostName;
@@ -86,15 +108,30 @@ class DBPod final
 
         unsigned int m_Port;
 
-        size_t m_Count;
+        std::atomic<size_t> m_Count;
         std::mutex *m_LockV[ConnectionSize];
         DBRecordPN m_DBRPNV[ConnectionSize];
-        DBConnection *m_DBConnV[ConnectionSize];
+        DBConnectionType *m_DBConnV[ConnectionSize];
+
+    private:
+        struct TaskQueue
+        {
+            std::mutex Lock;
+            std::condition_variable CV;
+            std::deque<std::function<void(DBConnectionType *)>> TaskQ;
+        };
+
+        std::atomic<bool>   m_Running;
+        std::atomic<size_t> m_SubmitCount;
+        std::thread         m_WorkerV[ConnectionSize];
+        TaskQueue           m_TaskQueueV[ConnectionSize];
 
     public:
         // I didn't check validation of connection here
         DBPod()
             : m_Count(0)
+            , m_Running(false)
+            , m_SubmitCount(0)
         {
             static_assert(ConnectionSize > 0, "DBPod should contain at least one connection handler");
 
@@ -104,6 +141,31 @@ class DBPod final
             }
         }
 
+        ~DBPod()
+        {
+            // workers exit only after their queues are empty
+            // the lock / unlock makes sure a waiting worker can't miss the flag
+            m_Running = false;
+            for(size_t nIndex = 0; nIndex < ConnectionSize; ++nIndex){
+                {
+                    std::lock_guard<std::mutex> stLockGuard(m_TaskQueueV[nIndex].Lock);
+                }
+                m_TaskQueueV[nIndex].CV.notify_one();
+            }
+
+            for(auto &rstWorker: m_WorkerV){
+                if(rstWorker.joinable()){
+                    rstWorker.join();
+                }
+            }
+
+            // all DBHDR's should have been released before this
+            for(size_t nIndex = 0; nIndex < ConnectionSize; ++nIndex){
+                delete m_DBConnV[nIndex];
+                delete m_LockV[nIndex];
+            }
+        }
+
         // launch the db connection
         // return value
         //      0: OK
@@ -123,51 +185,134 @@ class DBPod final
             m_Port     = nPort;
 
             for(int nIndex = 0; nIndex < (int)ConnectionSize; ++nIndex){
-                auto pConn = new DBConnection(szHostName, szUserName, szPassword, szDBName, nPort);
+                auto pConn = new DBConnectionType(szHostName, szUserName, szPassword, szDBName, nPort);
                 if(!pConn->Valid()){ delete pConn; return 2;}
 
+                // always lock the connection, even for single connection
+                // worker thread of Submit() shares it with CreateDBHDR() callers
                 m_DBConnV[nIndex] = pConn;
-                if(ConnectionSize > 1){ m_LockV[nIndex] = new std::mutex(); }
+                m_LockV[nIndex]   = new std::mutex();
             }
 
+            m_Running = true;
+            for(size_t nIndex = 0; nIndex < ConnectionSize; ++nIndex){
+                m_WorkerV[nIndex] = std::thread([this, nIndex](){ WorkerLoop(nIndex); });
+            }
             return 0;
         }
 
+    public:
+        // submit a task and return immediately
+        // task is invoked in the worker thread of one connection, it should report the
+        // result as a message, since the submitter is not waiting for it
+        //
+        // tasks on one connection are executed in submission order
+        // return false if the pod is not running, caller should report failure to its requester
+        bool Submit(std::function<void(DBConnectionType *)> &&fnTask)
+        {
+            if(!fnTask){
+                extern Log *g_Log;
+                g_Log->AddLog(LOGTYPE_WARNING, "Submit empty task to DBPod");
+                return false;
+            }
+
+            auto nIndex = (m_SubmitCount++) % ConnectionSize;
+            {
+                // check the flag with queue locked
+                // then a task accepted here is always seen by the worker before it exits
+                std::lock_guard<std::mutex> stLockGuard(m_TaskQueueV[nIndex].Lock);
+                if(!m_Running){
+                    extern Log *g_Log;
+                    g_Log->AddLog(LOGTYPE_WARNING, "Submit task to DBPod which is not running, task dropped");
+                    return false;
+                }
+                m_TaskQueueV[nIndex].TaskQ.push_back(std::move(fnTask));
+            }
+            m_TaskQueueV[nIndex].CV.notify_one();
+            return true;
+        }
+
+    private:
+        void WorkerLoop(size_t nIndex)
+        {
+            auto &rstQueue = m_TaskQueueV[nIndex];
+            std::deque<std::function<void(DBConnectionType *)>> stTaskQ;
+
+            while(true){
+                {
+                    std::unique_lock<std::mutex> stUniqueLock(rstQueue.Lock);
+                    rstQueue.CV.wait(stUniqueLock, [this, &rstQueue](){ return !m_Running || !rstQueue.TaskQ.empty(); });
+
+                    // drain the queue before exit
+                    // submitter gets no reply for a dropped task
+                    if(rstQueue.TaskQ.empty()){
+                        return;
+                    }
+                    std::swap(stTaskQ, rstQueue.TaskQ);
+                }
+
+                // take the connection once for the whole batch
+                // it's shared with CreateDBHDR()
+                {
+                    std::lock_guard<std::mutex> stLockGuard(*m_LockV[nIndex]);
+                    for(auto &fnTask: stTaskQ){
+                        fnTask(m_DBConnV[nIndex]);
+                    }
+                }
+
+                stTaskQ.clear();
+            }
+        }
+
+    public:
         // make sure it's non-throw
+        // connection lock should be held, it's released with the DBHDR
         DBHDR InnCreateDBHDR(size_t nPodIndex)
         {
-            DBRecord *pRecord;
+            DBRecordType *pRecord;
             try{
                 auto pBuf = m_DBRPNV[nPodIndex].Get();
-                if(!pBuf){ return DBHDR(nullptr, InnDeleter()); }
+                if(!pBuf){
+                    // null DBHDR never calls the deleter
+                    m_LockV[nPodIndex]->unlock();
+                    return DBHDR(nullptr, InnDeleter());
+                }
 
-                pRecord = m_DBConnV[nPodIndex]->CreateDBRecord((DBRecord *)pBuf);
+                pRecord = m_DBConnV[nPodIndex]->CreateDBRecord((DBRecordType *)pBuf);
             }catch(...){
                 pRecord = nullptr;
             }
 
+            if(!pRecord){
+                m_LockV[nPodIndex]->unlock();
+            }
             return DBHDR(pRecord, InnDeleter(m_LockV[nPodIndex], &(m_DBRPNV[nPodIndex])));
         }
 
         DBHDR CreateDBHDR()
         {
-            // for single thread only, we don't need the lock protection
-            if(ConnectionSize == 1){ return InnCreateDBHDR(0); }
+            // single connection, wait the worker thread if it's using it
+            if(ConnectionSize == 1){
+                m_LockV[0]->lock();
+                return InnCreateDBHDR(0);
+            }
 
             // ok we need to handle multi-thread
-            size_t nIndex = (m_Count++) % ConnectionSize;
-            while(true){
+            // take the first free connection, if all are busy then wait on the one
+            // picked by round-robin, don't spin since a query can take long
+            //
+            // see here, we don't unlock when return
+            // it unlocks when HDR is destructing
+            size_t nStart = (m_Count++) % ConnectionSize;
+            for(size_t nCount = 0; nCount < ConnectionSize; ++nCount){
+                auto nIndex = (nStart + nCount) % ConnectionSize;
                 if(m_LockV[nIndex]->try_lock()){
-                    // see here, we don't unlock when return
-                    // it unlocks when HDR is destructing
                     return InnCreateDBHDR(nIndex);
                 }
-
-                nIndex = (nIndex + 1) % ConnectionSize;
             }
 
-            // never be here
-            return DBHDR(nullptr, InnDeleter());
+            m_LockV[nStart]->lock();
+            return InnCreateDBHDR(nStart);
         }
 };
 
@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <cstdarg>
+#include <cstdlib>
 #include <cstring>
 #include <mariadb/mysql.h>
 
@@ -40,13 +41,11 @@ bool DBRecord::Execute(const char *szQueryCmd, ...)
 // TODO: we already put the query cmd in internal buffer, so here do I
 //       need to put the argument szQueryCmd?
 //
-//       I was planning to make Query() public then we can do some
-//       query without result store like
+//       Query() is public now for query without result store like
 //
 //          Query("use database mir2x");
 //
-//       but currently I haven't done it yet since I have no idea that
-//       this is necessary or not
+//       PersistHub uses it for batched update
 bool DBRecord::Query(const char *szQueryCmd)
 {
     // 1. make a default false state
@@ -111,25 +110,43 @@ bool DBRecord::Fetch()
         && ((m_CurrentRow = mysql_fetch_row(m_SQLRES)) != nullptr);  // don't have to free the row
 }
 
-const char *DBRecord::Get(const char *szColumnName)
+int DBRecord::Column(const char *szColumnName)
 {
-    if(szColumnName && std::strlen(szColumnName)){
-        if(m_CurrentRow){
-            mysql_field_seek(m_SQLRES, 0);
-
-            int nIndex = 0;
-            MYSQL_FIELD *pCurrField = nullptr;
-            while((pCurrField = mysql_fetch_field(m_SQLRES)) != nullptr){
-                if((pCurrField->name) && (!std::strcmp(pCurrField->name, szColumnName))){
-                    return m_CurrentRow[nIndex];
-                }
-                nIndex++;
+    if(szColumnName && std::strlen(szColumnName) && m_SQLRES){
+        auto nFieldCount = (int)(mysql_num_fields(m_SQLRES));
+        auto pFieldV     = mysql_fetch_fields(m_SQLRES);
+
+        for(int nIndex = 0; nIndex < nFieldCount; ++nIndex){
+            if((pFieldV[nIndex].name) && (!std::strcmp(pFieldV[nIndex].name, szColumnName))){
+                return nIndex;
             }
         }
     }
+    return -1;
+}
+
+const char *DBRecord::Get(int nColumn)
+{
+    if(true
+            && m_CurrentRow
+            && nColumn >= 0
+            && nColumn < (int)(mysql_num_fields(m_SQLRES))){
+        return m_CurrentRow[nColumn];
+    }
     return nullptr;
 }
 
+const char *DBRecord::Get(const char *szColumnName)
+{
+    return m_CurrentRow ? Get(Column(szColumnName)) : nullptr;
+}
+
+int64_t DBRecord::GetInt(int nColumn, int64_t nDefault)
+{
+    auto szValue = Get(nColumn);
+    return szValue ? (int64_t)(std::strtoll(szValue, nullptr, 10)) : nDefault;
+}
+
 int DBRecord::RowCount()
 {
     // only call this function after ``select"
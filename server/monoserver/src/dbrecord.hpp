@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include <mariadb/mysql.h>
 
 class DBConnection;
@@ -27,14 +28,28 @@ class DBRecord final
         int  ColumnCount();
 
     public:
+        // run a statement without result set, like update / insert
+        // nothing is stored, Fetch() and Get() are not for it
+        bool Query(const char *);
+
+    public:
+        // 0-based index of the column in result set, -1 if not exist
+        // Get(const char *) searches column by name for each call, in loop over
+        // many rows resolve the index before the loop and use Get(int)
+        int Column(const char *);
+
+    public:
+        const char *Get(int);
         const char *Get(const char *);
 
+        // return nDefault if column doesn't exist or value is NULL
+        int64_t GetInt(int, int64_t nDefault = 0);
+
     public:
         int ErrorID();
         const char *ErrorInfo();
 
     private:
-        bool Query(const char *);
         bool StoreResult();
 
     public:
@@ -0,0 +1,328 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: dbstatement.cpp
+ *        Created: 05/27/2017 10:58:03
+ *  Last Modified: 05/27/2017 17:06:40
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "dbstatement.hpp"
+#include "dbconnection.hpp"
+
+DBStatement::DBStatement(DBConnection *pConnection)
+    : m_Connection(pConnection)
+    , m_Stmt(nullptr)
+    , m_ParamBindV()
+    , m_ParamBufV()
+    , m_ResultBindV()
+    , m_ResultBufV()
+    , m_Executed(false)
+    , m_RowFetched(false)
+{}
+
+DBStatement::~DBStatement()
+{
+    FreeResult();
+    if(m_Stmt){
+        mysql_stmt_close(m_Stmt);
+    }
+}
+
+bool DBStatement::Prepare(const char *szSQL)
+{
+    if(!(szSQL && std::strlen(szSQL))){
+        return false;
+    }
+
+    if(!(m_Connection && m_Connection->m_SQL && m_Connection->Valid())){
+        return false;
+    }
+
+    if(!(m_Stmt = mysql_stmt_init(m_Connection->m_SQL))){
+        return false;
+    }
+
+    if(mysql_stmt_prepare(m_Stmt, szSQL, (unsigned long)(std::strlen(szSQL)))){
+        return false;
+    }
+
+    // let mysql_stmt_store_result() compute max length of each column
+    // then we can allocate result buffers properly
+    my_bool bUpdateMaxLength = 1;
+    mysql_stmt_attr_set(m_Stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &bUpdateMaxLength);
+
+    // parameter buffers are allocated only once
+    // MYSQL_BIND refers to them by pointer
+    auto nParamCount = (size_t)(mysql_stmt_param_count(m_Stmt));
+    m_ParamBufV.resize(nParamCount);
+    m_ParamBindV.resize(nParamCount);
+
+    for(auto &rstBind: m_ParamBindV){
+        std::memset(&rstBind, 0, sizeof(rstBind));
+        rstBind.buffer_type = MYSQL_TYPE_NULL;
+    }
+    return true;
+}
+
+bool DBStatement::Bind(size_t nIndex, int64_t nValue)
+{
+    if(nIndex >= m_ParamBufV.size()){
+        return false;
+    }
+
+    m_ParamBufV[nIndex].Int = (long long)(nValue);
+
+    auto &rstBind = m_ParamBindV[nIndex];
+    std::memset(&rstBind, 0, sizeof(rstBind));
+
+    rstBind.buffer_type = MYSQL_TYPE_LONGLONG;
+    rstBind.buffer      = &(m_ParamBufV[nIndex].Int);
+    return true;
+}
+
+bool DBStatement::Bind(size_t nIndex, const char *szValue)
+{
+    if(nIndex >= m_ParamBufV.size()){
+        return false;
+    }
+
+    auto &rstBind = m_ParamBindV[nIndex];
+    std::memset(&rstBind, 0, sizeof(rstBind));
+
+    if(!szValue){
+        rstBind.buffer_type = MYSQL_TYPE_NULL;
+        return true;
+    }
+
+    m_ParamBufV[nIndex].Str = szValue;
+    m_ParamBufV[nIndex].Len = (unsigned long)(m_ParamBufV[nIndex].Str.size());
+
+    rstBind.buffer_type   = MYSQL_TYPE_STRING;
+    rstBind.buffer        = (void *)(m_ParamBufV[nIndex].Str.data());
+    rstBind.buffer_length = m_ParamBufV[nIndex].Len;
+    rstBind.length        = &(m_ParamBufV[nIndex].Len);
+    return true;
+}
+
+void DBStatement::FreeResult()
+{
+    if(m_Stmt && m_Executed){
+        mysql_stmt_free_result(m_Stmt);
+    }
+
+    m_ResultBindV.clear();
+    m_ResultBufV.clear();
+
+    m_Executed   = false;
+    m_RowFetched = false;
+}
+
+bool DBStatement::BindResult()
+{
+    for(size_t nIndex = 0; nIndex < m_ResultBufV.size(); ++nIndex){
+        auto &rstBind = m_ResultBindV[nIndex];
+        auto &rstBuf  = m_ResultBufV[nIndex];
+
+        std::memset(&rstBind, 0, sizeof(rstBind));
+        if(rstBuf.IsInt){
+            rstBind.buffer_type   = MYSQL_TYPE_LONGLONG;
+            rstBind.buffer        = &(rstBuf.Int);
+            rstBind.buffer_length = (unsigned long)(sizeof(rstBuf.Int));
+        }else{
+            rstBind.buffer_type   = MYSQL_TYPE_STRING;
+            rstBind.buffer        = &(rstBuf.Buf[0]);
+            rstBind.buffer_length = (unsigned long)(rstBuf.Buf.size());
+        }
+        rstBind.length  = &(rstBuf.Len);
+        rstBind.is_null = &(rstBuf.Null);
+    }
+    return m_ResultBindV.empty() || !mysql_stmt_bind_result(m_Stmt, &(m_ResultBindV[0]));
+}
+
+bool DBStatement::Execute()
+{
+    if(!m_Stmt){
+        return false;
+    }
+
+    FreeResult();
+    if(!m_ParamBindV.empty() && mysql_stmt_bind_param(m_Stmt, &(m_ParamBindV[0]))){
+        return false;
+    }
+
+    if(mysql_stmt_execute(m_Stmt)){
+        return false;
+    }
+
+    // no result set: not a select
+    // then it's done
+    auto pMeta = mysql_stmt_result_metadata(m_Stmt);
+    if(!pMeta){
+        m_Executed = true;
+        return mysql_stmt_errno(m_Stmt) == 0;
+    }
+
+    if(mysql_stmt_store_result(m_Stmt)){
+        mysql_free_result(pMeta);
+        return false;
+    }
+    m_Executed = true;
+
+    // integer columns are fetched as long long, others as string
+    // buffer size comes from max length of the stored result, one more byte for '\0'
+    auto nFieldCount = (size_t)(mysql_num_fields(pMeta));
+    auto pFieldV     = mysql_fetch_fields(pMeta);
+
+    m_ResultBufV.resize(nFieldCount);
+    m_ResultBindV.resize(nFieldCount);
+
+    for(size_t nIndex = 0; nIndex < nFieldCount; ++nIndex){
+        switch(pFieldV[nIndex].type){
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_LONGLONG:
+                {
+                    m_ResultBufV[nIndex].IsInt = true;
+                    break;
+                }
+            default:
+                {
+                    m_ResultBufV[nIndex].IsInt = false;
+                    break;
+                }
+        }
+
+        m_ResultBufV[nIndex].Name = pFieldV[nIndex].name ? pFieldV[nIndex].name : "";
+        m_ResultBufV[nIndex].Buf.resize(std::max<size_t>(m_ResultBufV[nIndex].IsInt ? 0 : pFieldV[nIndex].max_length, 32) + 1);
+    }
+
+    mysql_free_result(pMeta);
+    return BindResult();
+}
+
+int DBStatement::RowCount()
+{
+    return m_Executed ? (int)(mysql_stmt_num_rows(m_Stmt)) : -1;
+}
+
+bool DBStatement::Fetch()
+{
+    m_RowFetched = false;
+    if(!(m_Executed && !m_ResultBufV.empty())){
+        return false;
+    }
+
+    auto nRet = mysql_stmt_fetch(m_Stmt);
+    if(nRet == MYSQL_DATA_TRUNCATED){
+        // max length is not available for all types
+        // enlarge the truncated columns and fetch them again
+        bool bRebind = false;
+        for(size_t nIndex = 0; nIndex < m_ResultBufV.size(); ++nIndex){
+            auto &rstBuf = m_ResultBufV[nIndex];
+            if(!rstBuf.IsInt && !rstBuf.Null && (rstBuf.Len >= rstBuf.Buf.size())){
+                rstBuf.Buf.resize(rstBuf.Len + 1);
+
+                auto &rstBind = m_ResultBindV[nIndex];
+                rstBind.buffer        = &(rstBuf.Buf[0]);
+                rstBind.buffer_length = (unsigned long)(rstBuf.Buf.size());
+
+                if(mysql_stmt_fetch_column(m_Stmt, &rstBind, (unsigned int)(nIndex), 0)){
+                    return false;
+                }
+                bRebind = true;
+            }
+        }
+
+        if(bRebind && !BindResult()){
+            return false;
+        }
+    }else if(nRet){
+        // MYSQL_NO_DATA or error
+        return false;
+    }
+
+    for(auto &rstBuf: m_ResultBufV){
+        if(!rstBuf.IsInt){
+            rstBuf.Buf[std::min<size_t>(rstBuf.Len, rstBuf.Buf.size() - 1)] = '\0';
+        }
+    }
+
+    m_RowFetched = true;
+    return true;
+}
+
+int DBStatement::Column(const char *szColumnName)
+{
+    if(szColumnName){
+        for(size_t nIndex = 0; nIndex < m_ResultBufV.size(); ++nIndex){
+            if(m_ResultBufV[nIndex].Name == szColumnName){
+                return (int)(nIndex);
+            }
+        }
+    }
+    return -1;
+}
+
+const char *DBStatement::Get(int nColumn)
+{
+    if(!(m_RowFetched && nColumn >= 0 && (size_t)(nColumn) < m_ResultBufV.size())){
+        return nullptr;
+    }
+
+    auto &rstBuf = m_ResultBufV[nColumn];
+    if(rstBuf.Null){
+        return nullptr;
+    }
+
+    // format integer only when asked as string
+    if(rstBuf.IsInt){
+        std::snprintf(&(rstBuf.Buf[0]), rstBuf.Buf.size(), "%lld", rstBuf.Int);
+    }
+    return &(rstBuf.Buf[0]);
+}
+
+const char *DBStatement::Get(const char *szColumnName)
+{
+    return Get(Column(szColumnName));
+}
+
+int64_t DBStatement::GetInt(int nColumn, int64_t nDefault)
+{
+    if(!(m_RowFetched && nColumn >= 0 && (size_t)(nColumn) < m_ResultBufV.size())){
+        return nDefault;
+    }
+
+    auto &rstBuf = m_ResultBufV[nColumn];
+    if(rstBuf.Null){
+        return nDefault;
+    }
+    return rstBuf.IsInt ? (int64_t)(rstBuf.Int) : (int64_t)(std::strtoll(&(rstBuf.Buf[0]), nullptr, 10));
+}
+
+int DBStatement::ErrorID()
+{
+    return m_Stmt ? (int)(mysql_stmt_errno(m_Stmt)) : m_Connection->ErrorID();
+}
+
+const char *DBStatement::ErrorInfo()
+{
+    return m_Stmt ? mysql_stmt_error(m_Stmt) : m_Connection->ErrorInfo();
+}
@@ -0,0 +1,161 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: dbstatement.hpp
+ *        Created: 05/27/2017 10:21:44
+ *  Last Modified: 05/27/2017 17:05:12
+ *
+ *    Description: prepared statement with bound parameters
+ *
+ *                 DBRecord::Execute() formats the whole SQL by vsnprintf(), the server
+ *                 parses it for every call and parameters have to be quoted by hand
+ *
+ *                 DBStatement is prepared once per connection and cached by
+ *                 DBConnection::Prepare(), then each call only binds and executes:
+ *
+ *                      auto pStmt = pConn->Prepare("select fld_id from tbl_account where fld_account = ?");
+ *                      if(pStmt && pStmt->Bind(0, szAccount) && pStmt->Execute()){
+ *                          while(pStmt->Fetch()){
+ *                              std::atoi(pStmt->Get("fld_id"));
+ *                          }
+ *                      }
+ *
+ *                 integer columns are fetched as long long, other columns as strings,
+ *                 the result set is buffered on client side after Execute()
+ *
+ *                 for loops over many rows, resolve column index once and read by index,
+ *                 GetInt() of an integer column is a plain copy without parsing:
+ *
+ *                      auto nGUID = pStmt->Column("fld_guid");
+ *                      while(pStmt->Fetch()){
+ *                          pStmt->GetInt(nGUID);
+ *                      }
+ *
+ *                 one statement belongs to one connection, not thread-safe, use it when
+ *                 holding the connection
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <mariadb/mysql.h>
+
+class DBConnection;
+class DBStatement final
+{
+    private:
+        struct ParamBuf
+        {
+            long long     Int;
+            std::string   Str;
+            unsigned long Len;
+
+            ParamBuf()
+                : Int(0)
+                , Str()
+                , Len(0)
+            {}
+        };
+
+        struct ResultBuf
+        {
+            std::string       Name;
+            std::vector<char> Buf;
+            unsigned long     Len;
+            my_bool           Null;
+
+            // integer column, value is in Int
+            // Buf is only for Get() as string
+            bool              IsInt;
+            long long         Int;
+
+            ResultBuf()
+                : Name()
+                , Buf()
+                , Len(0)
+                , Null(0)
+                , IsInt(false)
+                , Int(0)
+            {}
+        };
+
+    private:
+        DBConnection *m_Connection;
+        MYSQL_STMT   *m_Stmt;
+
+    private:
+        std::vector<MYSQL_BIND> m_ParamBindV;
+        std::vector<ParamBuf>   m_ParamBufV;
+
+    private:
+        std::vector<MYSQL_BIND> m_ResultBindV;
+        std::vector<ResultBuf>  m_ResultBufV;
+
+    private:
+        bool m_Executed;
+        bool m_RowFetched;
+
+    private:
+        // created by DBConnection::Prepare() only
+        DBStatement(DBConnection *);
+       ~DBStatement();
+
+    private:
+        bool Prepare(const char *);
+
+    public:
+        size_t ParamCount() const
+        {
+            return m_ParamBufV.size();
+        }
+
+    public:
+        // bind parameter by 0-based index
+        // string is copied, caller's buffer can be released after the call
+        bool Bind(size_t, int64_t);
+        bool Bind(size_t, const char *);
+
+    public:
+        // execute with current bound parameters
+        // result set is stored, previous result is discarded
+        bool Execute();
+
+    public:
+        int  RowCount();
+        bool Fetch();
+
+    public:
+        // 0-based index of the column in result set, -1 if not exist
+        // valid after Execute()
+        int Column(const char *);
+
+    public:
+        // return nullptr if column doesn't exist or value is NULL
+        const char *Get(int);
+        const char *Get(const char *);
+
+        // return nDefault if column doesn't exist or value is NULL
+        int64_t GetInt(int, int64_t nDefault = 0);
+
+    public:
+        int ErrorID();
+        const char *ErrorInfo();
+
+    private:
+        void FreeResult();
+        bool BindResult();
+
+    public:
+        friend class DBConnection;
+};
@@ -23,12 +23,16 @@
 #include "log.hpp"
 #include "dbpod.hpp"
 #include "netpod.hpp"
+#include "mpkpool.hpp"
 #include "taskhub.hpp"
 #include "memorypn.hpp"
 #include "threadpn.hpp"
 #include "metronome.hpp"
 #include "serverenv.hpp"
 #include "mainwindow.hpp"
+#include "persisthub.hpp"
+#include "pathfindpn.hpp"
+#include "accountcache.hpp"
 #include "eventtaskhub.hpp"
 #include "addmonsterwindow.hpp"
 #include "serverconfigurewindow.hpp"
@@ -44,6 +48,9 @@ Theron::Framework        *g_Framework;
 ThreadPN                 *g_ThreadPN;
 NetPodN                  *g_NetPodN;
 DBPodN                   *g_DBPodN;
+PersistHub               *g_PersistHub;
+PathFindPN               *g_PathFindPN;
+AccountCache             *g_AccountCache;
 
 MainWindow               *g_MainWindow;
 MonoServer               *g_MonoServer;
@@ -73,6 +80,9 @@ int main()
     g_Framework               = new Theron::Framework(*g_EndPoint);
     g_ThreadPN                = new ThreadPN(4);
     g_DBPodN                  = new DBPodN();
+    g_PersistHub              = new PersistHub("mir2x-monoserver.journal", 3000);
+    g_AccountCache            = new AccountCache(4096, 30 * 60 * 1000);
+    g_PathFindPN              = new PathFindPN(2, 1024);
     g_NetPodN                 = new NetPodN();
 
     g_MainWindow->ShowAll();
@@ -92,6 +102,10 @@ int main()
                 {
                     // request to stop
                     // FLTK will abort() if got 1
+                    MPKPool::Report();
+                    g_PersistHub->Report();
+                    g_AccountCache->Report();
+                    g_PathFindPN->Report();
                     fl_alert("%s", "system request for restart");
                     exit(0);
                     break;
@@ -95,6 +95,7 @@
 #include <utility>
 #include <type_traits>
 
+#include "mpkpool.hpp"
 #include "messagebuf.hpp"
 #include "actormessage.hpp"
 
@@ -113,8 +114,9 @@ class InnMessagePack final
         size_t   m_SBufUsedLen;
 
     private:
-        uint8_t *m_DBuf;
-        size_t   m_DBufLen;
+        // payload longer than SBufSize
+        // reference counted and shared by copies, never modified after creation
+        MPKPool::BufHead *m_DBuf;
 
     public:
         // since we make sender to accept only MessageBuf
@@ -127,27 +129,19 @@ class InnMessagePack final
             : m_Type(nType)
             , m_ID(nID)
             , m_Respond(nRespond)
+            , m_SBufUsedLen(0)
+            , m_DBuf(nullptr)
         {
             if(pData && nDataLen){
                 if(nDataLen <= SBufSize){
                     m_SBufUsedLen = nDataLen;
                     std::memcpy(m_SBuf, pData, nDataLen);
-
-                    m_DBuf = nullptr;
-                    m_DBufLen = 0;
                 }else{
-                    m_DBuf = new uint8_t[nDataLen];
-                    m_DBufLen = nDataLen;
-                    std::memcpy(m_DBuf, pData, nDataLen);
-
-                    m_SBufUsedLen = 0;
+                    m_DBuf = MPKPool::Get(nDataLen);
+                    std::memcpy(m_DBuf->Data(), pData, nDataLen);
                 }
-            }else{
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-
-                m_SBufUsedLen = 0;
             }
+            MPKPool::Record(nType, (pData ? nDataLen : 0), (m_DBuf != nullptr));
         }
 
         InnMessagePack(const MessageBuf &rstMB, uint32_t nID = 0, uint32_t nRespond = 0)
@@ -158,52 +152,38 @@ class InnMessagePack final
             : m_Type(rstMPK.Type())
             , m_ID(rstMPK.ID())
             , m_Respond(rstMPK.Respond())
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_DBuf(rstMPK.m_DBuf)
         {
-            // case-1: use dynamic buffer, steal the buffer
-            //         after this call rstMPK will be invalid
-            if(rstMPK.m_DBuf && rstMPK.m_DBufLen){
-                m_DBuf = rstMPK.m_DBuf;
-                m_DBufLen = rstMPK.m_DBufLen;
-
-                m_SBufUsedLen = 0;
-
-                rstMPK.m_DBuf = nullptr;
-                rstMPK.m_DBufLen = 0;
-                return;
-            }
-
-            // case-1: use static buffer, copy only
-            //         but after this call I make rstMPK invalid
-            if(rstMPK.m_SBufUsedLen){
-                m_SBufUsedLen = rstMPK.m_SBufUsedLen;
+            // use dynamic buffer: steal the buffer
+            // use static buffer : copy only
+            // after this call I make rstMPK invalid
+            if(m_SBufUsedLen){
                 std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
-
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-
-                rstMPK.m_SBufUsedLen = 0;
-                return;
             }
 
-            // case-3: empty message
-            //         shouldn't happen here
-            {
-                m_SBufUsedLen = 0;
-
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-                return;
-            }
+            rstMPK.m_SBufUsedLen = 0;
+            rstMPK.m_DBuf = nullptr;
         }
 
         InnMessagePack(const InnMessagePack &rstMPK)
-            : InnMessagePack(rstMPK.Type(), rstMPK.Data(), rstMPK.DataLen(), rstMPK.ID(), rstMPK.Respond())
-        {}
+            : m_Type(rstMPK.Type())
+            , m_ID(rstMPK.ID())
+            , m_Respond(rstMPK.Respond())
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_DBuf(rstMPK.m_DBuf)
+        {
+            // dynamic buffer is shared, no copy
+            if(m_SBufUsedLen){
+                std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
+            }
+            MPKPool::AddRef(m_DBuf);
+        }
 
     public:
        ~InnMessagePack()
         {
-            delete [] m_DBuf;
+            MPKPool::Release(m_DBuf);
         }
 
     public:
@@ -215,7 +195,6 @@ class InnMessagePack final
 
            std::swap(m_SBufUsedLen  , stMPK.m_SBufUsedLen);
            std::swap(m_DBuf         , stMPK.m_DBuf       );
-           std::swap(m_DBufLen      , stMPK.m_DBufLen    );
 
            if(m_SBufUsedLen){
                std::memcpy(m_SBuf, stMPK.m_SBuf, m_SBufUsedLen);
@@ -232,12 +211,12 @@ class InnMessagePack final
 
         const uint8_t *Data() const
         {
-            return m_SBufUsedLen ? m_SBuf : m_DBuf;
+            return m_SBufUsedLen ? m_SBuf : (m_DBuf ? m_DBuf->Data() : nullptr);
         }
 
         size_t DataLen() const
         {
-            return m_SBufUsedLen ? m_SBufUsedLen : m_DBufLen;
+            return m_SBufUsedLen ? m_SBufUsedLen : (m_DBuf ? m_DBuf->DataLen : 0);
         }
 
         size_t Size() const
@@ -257,7 +236,14 @@ class InnMessagePack final
 
         const char *Name() const
         {
-            switch(m_Type){
+            return Name(m_Type);
+        }
+
+        // look up the name without creating a message
+        // creation is counted by MPKPool::Record()
+        static const char *Name(int nType)
+        {
+            switch(nType){
                 case MPK_NONE               : return "MPK_NONE";
                 case MPK_OK                 : return "MPK_OK";
                 case MPK_ERROR              : return "MPK_ERROR";
@@ -292,6 +278,11 @@ class InnMessagePack final
                 case MPK_PATHFIND           : return "MPK_PATHFIND";
                 case MPK_PATHFINDOK         : return "MPK_PATHFINDOK";
                 case MPK_ATTACK             : return "MPK_ATTACK";
+                case MPK_NOTICE             : return "MPK_NOTICE";
+                case MPK_IDLE               : return "MPK_IDLE";
+                case MPK_MAPLOADED          : return "MPK_MAPLOADED";
+                case MPK_MAPIDLE            : return "MPK_MAPIDLE";
+                case MPK_UNLOADMAP          : return "MPK_UNLOADMAP";
                 default                     : return "MPK_UNKNOWN";
             }
         }
@@ -3,7 +3,7 @@
  *
  *       Filename: metronome.hpp
  *        Created: 04/21/2016 17:29:38
- *  Last Modified: 05/10/2017 00:38:28
+ *  Last Modified: 05/25/2017 18:02:44
  *
  *    Description: generate time tick as MessagePack for actor
  *                 keep it as simple as possible
@@ -33,8 +33,7 @@
 class Metronome final: public Theron::Receiver
 {
     private:
-        uint32_t               m_EventTaskID;           // operation ID in the scheduler
-        std::function<void()> *m_EventTaskFunc;         // 
+        EventTaskHub::Handle m_EventTaskHandle;         // periodic task in the scheduler
 
     private:
         std::mutex                   m_AddressVLock;    // single lock to protect all
@@ -43,63 +42,49 @@ class Metronome final: public Theron::Receiver
     public:
         Metronome(uint32_t nTick)
             : Theron::Receiver()
-            , m_EventTaskID(0)
-            , m_EventTaskFunc(nullptr)
+            , m_EventTaskHandle()
             , m_AddressVLock()
             , m_AddressV()
         {
             // the metronome is immediately ready after creation
+            // it's a periodic task, the scheduler keeps it and won't re-allocate for each tick
             extern EventTaskHub *g_EventTaskHub;
-            m_EventTaskFunc = new std::function<void()>([this, nTick]()
+            m_EventTaskHandle = g_EventTaskHub->AddPeriodic(nTick, [this]()
             {
-                {
-                    // 1. lock the whole class so no address can be added in
-                    std::lock_guard<std::mutex> stLockGuard(m_AddressVLock);
+                // 1. lock the whole class so no address can be added in
+                std::lock_guard<std::mutex> stLockGuard(m_AddressVLock);
 
-                    // 2. send time ticks to all address taking in charge
-                    extern Theron::Framework *g_Framework;
-                    size_t nIndex = 0;
+                // 2. send time ticks to all address taking in charge
+                extern Theron::Framework *g_Framework;
+                size_t nIndex = 0;
 
-                    while(nIndex < m_AddressV.size()){
-                        if(true
-                                && m_AddressV[nIndex]
-                                // must use MessagePack(MPK_METRONOME)
-                                // otherwise Theron::Framework::Send<T>(MPK_METRONOME) takes T as int
-                                && g_Framework->Send(MessagePack(MPK_METRONOME), GetAddress(), m_AddressV[nIndex])){
-                            // current address is valid
-                            // send message done and jump to next
-                            nIndex++;
-                            continue;
-                        }
-
-                        // invalid address
-                        // could be null or deleted already
-                        std::swap(m_AddressV[nIndex], m_AddressV.back());
-                        m_AddressV.pop_back();
+                while(nIndex < m_AddressV.size()){
+                    if(true
+                            && m_AddressV[nIndex]
+                            // must use MessagePack(MPK_METRONOME)
+                            // otherwise Theron::Framework::Send<T>(MPK_METRONOME) takes T as int
+                            && g_Framework->Send(MessagePack(MPK_METRONOME), GetAddress(), m_AddressV[nIndex])){
+                        // current address is valid
+                        // send message done and jump to next
+                        nIndex++;
+                        continue;
                     }
-                }
 
-                // 3. record the ID of next invocation
-                //    every invocation will remove current task handler
-                m_EventTaskID = g_EventTaskHub->Add(nTick, *m_EventTaskFunc);
+                    // invalid address
+                    // could be null or deleted already
+                    std::swap(m_AddressV[nIndex], m_AddressV.back());
+                    m_AddressV.pop_back();
+                }
             });
-
-            // don't need to lock now since it's in constructor
-            m_EventTaskID = g_EventTaskHub->Add(nTick, *m_EventTaskFunc);
         }
 
         virtual ~Metronome()
         {
-            std::lock_guard<std::mutex> stLockGuard(m_AddressVLock);
-
-            // 1. now the handler won't invoke again
-            //    here we need to lock the class
-            //    since m_EventTaskID may change during invocaitoin of m_EventTaskFunc
+            // now the handler won't invoke again
+            // Dismiss() waits if it's sending ticks in the scheduler thread
+            // so don't hold m_AddressVLock here
             extern EventTaskHub *g_EventTaskHub;
-            g_EventTaskHub->Dismiss(m_EventTaskID);
-
-            // 2. delete the handler
-            delete m_EventTaskFunc;
+            g_EventTaskHub->Dismiss(m_EventTaskHandle);
         }
 
     public:
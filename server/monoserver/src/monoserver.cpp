@@ -35,6 +35,7 @@
 #include "uidrecord.hpp"
 #include "mainwindow.hpp"
 #include "monoserver.hpp"
+#include "persisthub.hpp"
 #include "servicecore.hpp"
 #include "eventtaskhub.hpp"
 #include "databaseconfigurewindow.hpp"
@@ -44,7 +45,7 @@ MonoServer::MonoServer()
     , m_LogBuf()
     , m_ServiceCore(nullptr)
     , m_GlobalUID {1}
-    , m_UIDArray()
+    , m_UIDRegistry()
     , m_StartTime()
     , m_MonsterGInfoRecord()
 {
@@ -191,6 +192,11 @@ void MonoServer::Launch()
 {
     CreateDBConnection();
     LoadMonsterRecord();
+
+    // replay the journal before players log in
+    extern PersistHub *g_PersistHub;
+    g_PersistHub->Launch();
+
     RegisterAMFallbackHandler();
 
     CreateServiceCore();
@@ -271,33 +277,60 @@ bool MonoServer::InitMonsterRace()
 
     AddLog(LOGTYPE_INFO, "starting add monster info:");
 
+    // resolve column index once, Get(const char *) searches all columns by
+    // name for each field of each row
+    const int nColName        = pRecord->Column("fld_name");
+    const int nColIndex       = pRecord->Column("fld_index");
+    const int nColRace        = pRecord->Column("fld_race");
+    const int nColLID         = pRecord->Column("fld_lid");
+    const int nColUndead      = pRecord->Column("fld_undead");
+    const int nColLevel       = pRecord->Column("fld_level");
+    const int nColHP          = pRecord->Column("fld_hp");
+    const int nColMP          = pRecord->Column("fld_mp");
+    const int nColAC          = pRecord->Column("fld_ac");
+    const int nColMAC         = pRecord->Column("fld_mac");
+    const int nColDC          = pRecord->Column("fld_dc");
+    const int nColAttackSpeed = pRecord->Column("fld_attackspeed");
+    const int nColWalkSpeed   = pRecord->Column("fld_walkspeed");
+    const int nColSpeed       = pRecord->Column("fld_speed");
+    const int nColHit         = pRecord->Column("fld_hit");
+    const int nColViewRange   = pRecord->Column("fld_viewrange");
+    const int nColRaceIndex   = pRecord->Column("fld_raceindex");
+    const int nColExp         = pRecord->Column("fld_exp");
+    const int nColEscape      = pRecord->Column("fld_escape");
+    const int nColWater       = pRecord->Column("fld_water");
+    const int nColFire        = pRecord->Column("fld_fire");
+    const int nColWind        = pRecord->Column("fld_wind");
+    const int nColLight       = pRecord->Column("fld_light");
+    const int nColEarth       = pRecord->Column("fld_earth");
+
     while(pRecord->Fetch()){
         MONSTERRACEINFO stRaceInfo;
         // 1. record the monster race info
-        stRaceInfo.Name        = std::string(pRecord->Get("fld_name"));
-        stRaceInfo.Index       = std::atoi(pRecord->Get("fld_index"));
-        stRaceInfo.Race        = std::atoi(pRecord->Get("fld_race"));
-        stRaceInfo.LID         = std::atoi(pRecord->Get("fld_lid"));
-        stRaceInfo.Undead      = std::atoi(pRecord->Get("fld_undead"));
-        stRaceInfo.Level       = std::atoi(pRecord->Get("fld_level"));
-        stRaceInfo.HP          = std::atoi(pRecord->Get("fld_hp"));
-        stRaceInfo.MP          = std::atoi(pRecord->Get("fld_mp"));
-        stRaceInfo.AC          = std::atoi(pRecord->Get("fld_ac"));
-        stRaceInfo.MAC         = std::atoi(pRecord->Get("fld_mac"));
-        stRaceInfo.DC          = std::atoi(pRecord->Get("fld_dc"));
-        stRaceInfo.AttackSpead = std::atoi(pRecord->Get("fld_attackspeed"));
-        stRaceInfo.WalkSpead   = std::atoi(pRecord->Get("fld_walkspeed"));
-        stRaceInfo.Spead       = std::atoi(pRecord->Get("fld_speed"));
-        stRaceInfo.Hit         = std::atoi(pRecord->Get("fld_hit"));
-        stRaceInfo.ViewRange   = std::atoi(pRecord->Get("fld_viewrange"));
-        stRaceInfo.RaceIndex   = std::atoi(pRecord->Get("fld_raceindex"));
-        stRaceInfo.Exp         = std::atoi(pRecord->Get("fld_exp"));
-        stRaceInfo.Escape      = std::atoi(pRecord->Get("fld_escape"));
-        stRaceInfo.Water       = std::atoi(pRecord->Get("fld_water"));
-        stRaceInfo.Fire        = std::atoi(pRecord->Get("fld_fire"));
-        stRaceInfo.Wind        = std::atoi(pRecord->Get("fld_wind"));
-        stRaceInfo.Light       = std::atoi(pRecord->Get("fld_light"));
-        stRaceInfo.Earth       = std::atoi(pRecord->Get("fld_earth"));
+        stRaceInfo.Name        = pRecord->Get(nColName) ? pRecord->Get(nColName) : "";
+        stRaceInfo.Index       = pRecord->GetInt(nColIndex);
+        stRaceInfo.Race        = pRecord->GetInt(nColRace);
+        stRaceInfo.LID         = pRecord->GetInt(nColLID);
+        stRaceInfo.Undead      = pRecord->GetInt(nColUndead);
+        stRaceInfo.Level       = pRecord->GetInt(nColLevel);
+        stRaceInfo.HP          = pRecord->GetInt(nColHP);
+        stRaceInfo.MP          = pRecord->GetInt(nColMP);
+        stRaceInfo.AC          = pRecord->GetInt(nColAC);
+        stRaceInfo.MAC         = pRecord->GetInt(nColMAC);
+        stRaceInfo.DC          = pRecord->GetInt(nColDC);
+        stRaceInfo.AttackSpead = pRecord->GetInt(nColAttackSpeed);
+        stRaceInfo.WalkSpead   = pRecord->GetInt(nColWalkSpeed);
+        stRaceInfo.Spead       = pRecord->GetInt(nColSpeed);
+        stRaceInfo.Hit         = pRecord->GetInt(nColHit);
+        stRaceInfo.ViewRange   = pRecord->GetInt(nColViewRange);
+        stRaceInfo.RaceIndex   = pRecord->GetInt(nColRaceIndex);
+        stRaceInfo.Exp         = pRecord->GetInt(nColExp);
+        stRaceInfo.Escape      = pRecord->GetInt(nColEscape);
+        stRaceInfo.Water       = pRecord->GetInt(nColWater);
+        stRaceInfo.Fire        = pRecord->GetInt(nColFire);
+        stRaceInfo.Wind        = pRecord->GetInt(nColWind);
+        stRaceInfo.Light       = pRecord->GetInt(nColLight);
+        stRaceInfo.Earth       = pRecord->GetInt(nColEarth);
 
         // 2. make a room in the global table
         s_MonsterRaceInfoV.resize(stRaceInfo.Index + 1, -1);
@@ -329,13 +362,18 @@ bool MonoServer::InitMonsterItem()
 
     AddLog(LOGTYPE_INFO, "starting add monster item:");
 
+    const int nColMonster = pRecord->Column("fld_monster");
+    const int nColType    = pRecord->Column("fld_type");
+    const int nColChance  = pRecord->Column("fld_chance");
+    const int nColCount   = pRecord->Column("fld_count");
+
     while(pRecord->Fetch()){
         MONSTERITEMINFO stItemInfo;
         // 1. get the item desc
-        stItemInfo.MonsterIndex = std::atoi(pRecord->Get("fld_monster"));
-        stItemInfo.Type         = std::atoi(pRecord->Get("fld_type"));
-        stItemInfo.Chance       = std::atoi(pRecord->Get("fld_chance"));
-        stItemInfo.Count        = std::atoi(pRecord->Get("fld_count"));
+        stItemInfo.MonsterIndex = pRecord->GetInt(nColMonster);
+        stItemInfo.Type         = pRecord->GetInt(nColType);
+        stItemInfo.Chance       = pRecord->GetInt(nColChance);
+        stItemInfo.Count        = pRecord->GetInt(nColCount);
         // 2. make a room for it
         if(true 
                 && stItemInfo.MonsterIndex > 0
@@ -446,107 +484,109 @@ void MonoServer::FlushBrowser()
 
 uint32_t MonoServer::GetUID()
 {
-    return m_GlobalUID.fetch_add(1);
+    // never pass UIDRegistry::UID_LIMIT
+    // otherwise the counter wraps and UID's alias live objects
+    auto nUID = m_GlobalUID.load();
+    do{
+        if(nUID >= UIDRegistry::UID_LIMIT){
+            AddLog(LOGTYPE_FATAL, "UID exhausted: UID_LIMIT = %" PRIu32, UIDRegistry::UID_LIMIT);
+            Restart();
+            return 0;
+        }
+    }while(!m_GlobalUID.compare_exchange_weak(nUID, nUID + 1));
+    return nUID;
 }
 
 bool MonoServer::LinkUID(uint32_t nUID, ServerObject *pObject)
 {
     if(nUID && pObject){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind == rstRecord.Record.end()){
-                rstRecord.Record[nUID] = pObject;
-                return true;
-            }else{
-                AddLog(LOGTYPE_WARNING, "UIDArray duplicated UID: (%" PRIu32 ", %p, %p)", nUID, stFind->second, pObject);
-                return false;
-            }
+        if(m_UIDRegistry.Link(nUID, pObject)){
+            return true;
         }
+
+        // can't go on with an object not registered
+        AddLog(LOGTYPE_FATAL, "UIDRegistry duplicated or out of range UID: (%" PRIu32 ", %p)", nUID, pObject);
+        Restart();
+        return false;
     }
 
-    AddLog(LOGTYPE_WARNING, "Invalid argument LinkUID(UID = %" PRIu32 ", ServerObject = %p)", nUID, pObject);
+    AddLog(LOGTYPE_FATAL, "Invalid argument LinkUID(UID = %" PRIu32 ", ServerObject = %p)", nUID, pObject);
+    Restart();
     return false;
 }
 
 void MonoServer::EraseUID(uint32_t nUID)
 {
-    if(nUID){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind != rstRecord.Record.end()){
-                if(stFind->second){
-                    if(stFind->second->UID() != nUID){
-                        AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, stFind->second->UID());
-                    }
-                    delete stFind->second;
-                }
-                rstRecord.Record.erase(stFind);
-            }
+    // Erase() returns after all readers which may see the instance finish
+    // then we can safely delete it here
+    if(auto pObject = m_UIDRegistry.Erase(nUID)){
+        if(pObject->UID() != nUID){
+            AddLog(LOGTYPE_WARNING, "UIDRegistry mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pObject->UID());
         }
+        delete pObject;
     }
 }
 
 UIDRecord MonoServer::GetUIDRecord(uint32_t nUID)
 {
-    if(nUID){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind != rstRecord.Record.end()){
-                if(stFind->second){
-                    if(stFind->second->UID() == nUID){
-                        // two solutions
-                        // 1. for server object, define a virtual UIDRecord GetUIDRecord()
-                        //    then here directly forward the result
-                        //
-                        // 2. maintain UID() for server object
-                        //    maintain UID() and GetAddress() for classes from ActiveObject
-                        //    then construct a temporary UIDRecord and return
-                        //
-                        // solution-1 : simpler but it introduces concept of address to server object
-                        // solution-2 : means I should make both UID() and GetAddress() atomically accessable
-                        //
-                        // UID()        : OK by default
-                        // GetAddress() : which calls m_ActorPod->GetAddress()
-                        //                m_ActorPod could change when other threads accessing it
-                        //
-                        // solution:
-                        // 1. we constrains that we can only access an UID if the object actively given it
-                        //    means if we try to access object through GetUIDRecord(nUID), then the nUID is reported
-                        //    by the object itself. rather than we do randomly draw an UID and access it
-                        //
-                        //    an UID can be deleted then we get an invalid UIDRecord
-                        //    this behaves like malloc() / free(), any pointer try to free() should be from malloc()
-                        //
-                        //    this means if we trying to access ActiveObject::GetAddress(), its m_ActorPod has
-                        //    already be initialized otherwise we can't get its UID
-                        //
-                        // 2. before deletion of active object we should call Deactivate() which calls m_ActorPod->Detach()
-                        //    this helps to detach *this* from the actor thread of m_ActorPod, then deletion in other thread is OK
-                        //
-                        //    then deletion of m_ActorPod will wait if m_ActorPod is scheduled in actor threads
-                        //
-                        auto bActive   = stFind->second->ClassFrom<ActiveObject>();
-                        auto stAddress = bActive ? ((ActiveObject *)(stFind->second))->GetAddress() : Theron::Address::Null();
-                        return {nUID, stAddress, stFind->second->ClassEntry()};
-                    }else{
-                        AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, stFind->second->UID());
-                    }
-                }
+    // the class entry is static and lives with the process
+    // but address should be copied out inside the read section
+    auto stAddress  = Theron::Address::Null();
+    auto nClassMask = (uint64_t)(0);
+    const std::vector<ServerObject::ClassCodeName> *pClassEntry = nullptr;
+
+    m_UIDRegistry.Read(nUID, [this, nUID, &stAddress, &nClassMask, &pClassEntry](const ServerObject *pObject)
+    {
+        if(pObject){
+            if(pObject->UID() == nUID){
+                // two solutions
+                // 1. for server object, define a virtual UIDRecord GetUIDRecord()
+                //    then here directly forward the result
+                //
+                // 2. maintain UID() for server object
+                //    maintain UID() and GetAddress() for classes from ActiveObject
+                //    then construct a temporary UIDRecord and return
+                //
+                // solution-1 : simpler but it introduces concept of address to server object
+                // solution-2 : means I should make both UID() and GetAddress() atomically accessable
+                //
+                // UID()        : OK by default
+                // GetAddress() : which calls m_ActorPod->GetAddress()
+                //                m_ActorPod could change when other threads accessing it
+                //
+                // solution:
+                // 1. we constrains that we can only access an UID if the object actively given it
+                //    means if we try to access object through GetUIDRecord(nUID), then the nUID is reported
+                //    by the object itself. rather than we do randomly draw an UID and access it
+                //
+                //    an UID can be deleted then we get an invalid UIDRecord
+                //    this behaves like malloc() / free(), any pointer try to free() should be from malloc()
+                //
+                //    this means if we trying to access ActiveObject::GetAddress(), its m_ActorPod has
+                //    already be initialized otherwise we can't get its UID
+                //
+                // 2. before deletion of active object we should call Deactivate() which calls m_ActorPod->Detach()
+                //    this helps to detach *this* from the actor thread of m_ActorPod, then deletion in other thread is OK
+                //
+                //    then deletion of m_ActorPod will wait if m_ActorPod is scheduled in actor threads
+                //
+                nClassMask  = pObject->ClassMask();
+                stAddress   = (nClassMask & ServerObject::ClassBit<ActiveObject>()) ? ((const ActiveObject *)(pObject))->GetAddress() : Theron::Address::Null();
+                pClassEntry = &(pObject->ClassEntry());
+            }else{
+                AddLog(LOGTYPE_WARNING, "UIDRegistry mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pObject->UID());
             }
         }
+    });
+
+    if(pClassEntry){
+        return {nUID, stAddress, nClassMask, *pClassEntry};
     }
 
     // for all other cases, return empty record
     // 1. provided uid as zero
     // 2. record doesn't exist
-    // 3. record contains an empty pointer
-    // 4. record mismatch
+    // 3. record mismatch
     static const std::vector<ServerObject::ClassCodeName> stNullEntry {};
-    return UIDRecord(0, Theron::Address::Null(), stNullEntry);
+    return UIDRecord(0, Theron::Address::Null(), 0, stNullEntry);
 }
@@ -31,6 +31,7 @@
 #include "taskhub.hpp"
 #include "database.hpp"
 #include "uidrecord.hpp"
+#include "uidregistry.hpp"
 #include "eventtaskhub.hpp"
 #include "monsterginforecord.hpp"
 
@@ -38,12 +39,6 @@ class ServiceCore;
 class ServerObject;
 class MonoServer final
 {
-    struct UIDLockRecord
-    {
-        std::mutex Lock;
-        std::unordered_map<uint32_t, const ServerObject *> Record;
-    };
-
     private:
         std::mutex m_LogLock;
         std::vector<char> m_LogBuf;
@@ -55,7 +50,7 @@ class MonoServer final
         std::atomic<uint32_t> m_GlobalUID;
 
     private:
-        std::array<UIDLockRecord, 17> m_UIDArray;
+        UIDRegistry m_UIDRegistry;
 
     private:
         std::chrono::time_point<std::chrono::system_clock> m_StartTime;
@@ -175,6 +170,7 @@ class MonoServer final
         // retrieve uid from global tables
         // return a valid uid means it's valid *during the invocation*
         // it could be immediately invalid by EraseUID() from other threads
+        // this is lock-free, EraseUID() waits until all readers finish
         UIDRecord GetUIDRecord(uint32_t);
 
     public:
@@ -39,6 +39,7 @@ Monster::Monster(uint32_t   nMonsterID,
         uint8_t             nLifeState)
     : CharObject(pServiceCore, pServerMap, nMapX, nMapY, nDirection, nLifeState)
     , m_MonsterID(nMonsterID)
+    , m_IdleCount(0)
 {
     auto fnRegisterClass = [this]() -> void {
         if(!RegisterClass<Monster, CharObject>()){
@@ -49,6 +50,7 @@ Monster::Monster(uint32_t   nMonsterID,
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<Monster>();
 
     // set attack mode
     SetState(STATE_ATTACKMODE, STATE_ATTACKMODE_NORMAL);
@@ -347,32 +349,38 @@ void Monster::SearchViewRange()
 void Monster::ReportCORecord(uint32_t nSessionID)
 {
     if(nSessionID){
-        SMCORecord stSMCOR;
-        // TODO: don't use OBJECT_MONSTER, we need translation
-        //       rule of communication, the sender is responsible to translate
+        auto stPacket = SendPacket::Reserve(SM_CORECORD, sizeof(SMCORecord));
+        if(auto pSMCOR = stPacket.As<SMCORecord>()){
+            auto &stSMCOR = *pSMCOR;
 
-        // 1. set type
-        stSMCOR.Type = CREATURE_MONSTER;
+            // TODO: don't use OBJECT_MONSTER, we need translation
+            //       rule of communication, the sender is responsible to translate
 
-        // 2. set common info
-        stSMCOR.Common.UID   = UID();
-        stSMCOR.Common.MapID = MapID();
+            // 1. set type
+            stSMCOR.Type = CREATURE_MONSTER;
 
-        stSMCOR.Common.Action      = ACTION_STAND;
-        stSMCOR.Common.ActionParam = 0;
-        stSMCOR.Common.Speed       = 0;
-        stSMCOR.Common.Direction   = Direction();
+            // 2. set common info
+            stSMCOR.Common.UID   = UID();
+            stSMCOR.Common.MapID = MapID();
 
-        stSMCOR.Common.X    = X();
-        stSMCOR.Common.Y    = Y();
-        stSMCOR.Common.EndX = X();
-        stSMCOR.Common.EndY = Y();
+            stSMCOR.Common.Action      = ACTION_STAND;
+            stSMCOR.Common.ActionParam = 0;
+            stSMCOR.Common.Speed       = 0;
+            stSMCOR.Common.Direction   = Direction();
 
-        // 3. set specified info
-        stSMCOR.Monster.MonsterID = m_MonsterID;
+            stSMCOR.Common.X    = X();
+            stSMCOR.Common.Y    = Y();
+            stSMCOR.Common.EndX = X();
+            stSMCOR.Common.EndY = Y();
 
-        extern NetPodN *g_NetPodN;
-        g_NetPodN->Send(nSessionID, SM_CORECORD, stSMCOR);
+            // 3. set specified info
+            stSMCOR.Monster.MonsterID = m_MonsterID;
+
+            if(stPacket.Commit()){
+                extern NetPodN *g_NetPodN;
+                g_NetPodN->Send(nSessionID, stPacket);
+            }
+        }
     }else{
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "invalid session id");
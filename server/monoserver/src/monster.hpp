@@ -78,6 +78,11 @@ class Monster: public CharObject
     protected:
         const uint32_t m_MonsterID;
 
+    protected:
+        // count of metronomes without target
+        // report MPK_IDLE to the map periodically, then the map may stop ticking it
+        uint32_t m_IdleCount;
+
     public:
         Monster(uint32_t,               // monster id
                 ServiceCore *,          // service core
@@ -29,6 +29,22 @@
 void Monster::On_MPK_METRONOME(const MessagePack &, const Theron::Address &)
 {
     Update();
+
+    // no target now, tell the map we are idle
+    // don't report every tick, map keeps ticking us if players are around
+    if(!m_TargetQ.empty()){
+        m_IdleCount = 0;
+        return;
+    }
+
+    if((m_IdleCount++ % 10) == 0){
+        if(ActorPodValid() && m_Map->ActorPodValid()){
+            AMIdle stAMI;
+            stAMI.UID   = UID();
+            stAMI.MapID = m_Map->ID();
+            m_ActorPod->Forward({MPK_IDLE, stAMI}, m_Map->GetAddress());
+        }
+    }
 }
 
 void Monster::On_MPK_PULLCOINFO(const MessagePack &rstMPK, const Theron::Address &)
@@ -0,0 +1,222 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: mpkpool.cpp
+ *        Created: 05/26/2017 11:03:47
+ *  Last Modified: 05/26/2017 16:42:55
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <new>
+#include <array>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <cinttypes>
+#include "mpkpool.hpp"
+#include "memorypn.hpp"
+#include "monoserver.hpp"
+#include "messagepack.hpp"
+
+// declared here rather than in function
+// ThreadCache is in anonymous namespace and needs it
+extern MemoryPN *g_MemoryPN;
+
+namespace
+{
+    // per-thread free lists
+    // buffers freed by a thread go to its own cache, no matter who allocated them
+    struct ThreadCache
+    {
+        std::array<std::vector<void *>, 6> FreeV;
+
+        ~ThreadCache()
+        {
+            for(auto &rstFreeV: FreeV){
+                for(auto pBuf: rstFreeV){
+                    g_MemoryPN->Free(pBuf);
+                }
+            }
+        }
+    };
+
+    ThreadCache &GetThreadCache()
+    {
+        static thread_local ThreadCache s_ThreadCache;
+        return s_ThreadCache;
+    }
+
+    // only the owner thread updates it, with load + store rather than RMW
+    // atomics are for Report() reading it from other threads
+    struct TypeCount
+    {
+        std::atomic<uint64_t> Count;
+        std::atomic<uint64_t> PoolCount;
+        std::atomic<size_t>   MaxDataLen;
+
+        TypeCount()
+            : Count(0)
+            , PoolCount(0)
+            , MaxDataLen(0)
+        {}
+
+        void Add(uint64_t nCount, uint64_t nPoolCount, size_t nDataLen)
+        {
+            Count.store(Count.load(std::memory_order_relaxed) + nCount, std::memory_order_relaxed);
+            PoolCount.store(PoolCount.load(std::memory_order_relaxed) + nPoolCount, std::memory_order_relaxed);
+
+            if(nDataLen > MaxDataLen.load(std::memory_order_relaxed)){
+                MaxDataLen.store(nDataLen, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct ThreadCount;
+    struct CountRegistry
+    {
+        std::mutex Lock;
+        std::vector<ThreadCount *> ThreadCountV;
+
+        // counts of exited threads, guarded by Lock
+        std::array<TypeCount, 256> ExitCountV;
+    };
+
+    CountRegistry &GetCountRegistry()
+    {
+        static CountRegistry s_CountRegistry;
+        return s_CountRegistry;
+    }
+
+    // per-thread counts, no cache line shared between threads in Record()
+    // registered for Report(), merged into ExitCountV when the thread exits
+    struct ThreadCount
+    {
+        std::array<TypeCount, 256> CountV;
+
+        ThreadCount()
+        {
+            auto &rstRegistry = GetCountRegistry();
+            std::lock_guard<std::mutex> stLockGuard(rstRegistry.Lock);
+            rstRegistry.ThreadCountV.push_back(this);
+        }
+
+        ~ThreadCount()
+        {
+            auto &rstRegistry = GetCountRegistry();
+            std::lock_guard<std::mutex> stLockGuard(rstRegistry.Lock);
+            for(size_t nType = 0; nType < CountV.size(); ++nType){
+                rstRegistry.ExitCountV[nType].Add(
+                        CountV[nType].Count.load(std::memory_order_relaxed),
+                        CountV[nType].PoolCount.load(std::memory_order_relaxed),
+                        CountV[nType].MaxDataLen.load(std::memory_order_relaxed));
+            }
+            rstRegistry.ThreadCountV.erase(std::find(rstRegistry.ThreadCountV.begin(), rstRegistry.ThreadCountV.end(), this));
+        }
+    };
+
+    ThreadCount &GetThreadCount()
+    {
+        static thread_local ThreadCount s_ThreadCount;
+        return s_ThreadCount;
+    }
+}
+
+MPKPool::BufHead *MPKPool::Get(size_t nDataLen)
+{
+    static_assert(CLASS_COUNT == std::tuple_size<decltype(ThreadCache::FreeV)>::value, "ThreadCache::FreeV should have one free list per class");
+    if(!nDataLen){
+        return nullptr;
+    }
+
+    uint32_t nClassID = 0;
+    while(nClassID < CLASS_COUNT && (MIN_CLASS_SIZE << nClassID) < nDataLen){
+        nClassID++;
+    }
+
+    void *pBuf = nullptr;
+    if(nClassID < CLASS_COUNT){
+        auto &rstFreeV = GetThreadCache().FreeV[nClassID];
+        if(!rstFreeV.empty()){
+            pBuf = rstFreeV.back();
+            rstFreeV.pop_back();
+        }else{
+            pBuf = g_MemoryPN->Get(sizeof(BufHead) + (MIN_CLASS_SIZE << nClassID));
+        }
+    }else{
+        pBuf = g_MemoryPN->Get(sizeof(BufHead) + nDataLen);
+    }
+
+    return new (pBuf) BufHead(nClassID, nDataLen);
+}
+
+void MPKPool::Free(BufHead *pHead)
+{
+    auto nClassID = pHead->ClassID;
+    pHead->~BufHead();
+
+    if(nClassID < CLASS_COUNT){
+        auto &rstFreeV = GetThreadCache().FreeV[nClassID];
+        if(rstFreeV.size() < CACHE_SIZE){
+            rstFreeV.push_back(pHead);
+            return;
+        }
+    }
+
+    g_MemoryPN->Free(pHead);
+}
+
+void MPKPool::Record(int nType, size_t nDataLen, bool bPooled)
+{
+    // counts are only for statistics
+    // thread local, no shared atomic RMW on the hot path
+    static_assert(TYPE_COUNT == std::tuple_size<decltype(ThreadCount::CountV)>::value, "ThreadCount::CountV should have one count per type");
+    GetThreadCount().CountV[(nType >= 0 && (size_t)(nType) < TYPE_COUNT) ? nType : (TYPE_COUNT - 1)].Add(1, (bPooled ? 1 : 0), nDataLen);
+}
+
+void MPKPool::Report()
+{
+    // sum up first, AddLog() creates messages and calls Record()
+    std::array<TypeCount, TYPE_COUNT> stTypeCountV;
+    {
+        auto &rstRegistry = GetCountRegistry();
+        std::lock_guard<std::mutex> stLockGuard(rstRegistry.Lock);
+
+        auto fnMerge = [&stTypeCountV](const std::array<TypeCount, TYPE_COUNT> &rstCountV)
+        {
+            for(size_t nType = 0; nType < TYPE_COUNT; ++nType){
+                stTypeCountV[nType].Add(
+                        rstCountV[nType].Count.load(std::memory_order_relaxed),
+                        rstCountV[nType].PoolCount.load(std::memory_order_relaxed),
+                        rstCountV[nType].MaxDataLen.load(std::memory_order_relaxed));
+            }
+        };
+
+        fnMerge(rstRegistry.ExitCountV);
+        for(auto pThreadCount: rstRegistry.ThreadCountV){
+            fnMerge(pThreadCount->CountV);
+        }
+    }
+
+    extern MonoServer *g_MonoServer;
+    for(size_t nType = 0; nType < TYPE_COUNT; ++nType){
+        auto nCount      = stTypeCountV[nType].Count.load(std::memory_order_relaxed);
+        auto nPoolCount  = stTypeCountV[nType].PoolCount.load(std::memory_order_relaxed);
+        auto nMaxDataLen = stTypeCountV[nType].MaxDataLen.load(std::memory_order_relaxed);
+
+        if(nCount){
+            g_MonoServer->AddLog(LOGTYPE_INFO, "MessagePack statistics: Type = %s, Count = %" PRIu64 ", PoolCount = %" PRIu64 ", MaxDataLen = %d",
+                    MessagePack::Name((int)(nType)), nCount, nPoolCount, (int)(nMaxDataLen));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: mpkpool.hpp
+ *        Created: 05/26/2017 10:12:35
+ *  Last Modified: 05/26/2017 16:40:18
+ *
+ *    Description: buffer pool for MessagePack payload longer than SBufSize
+ *
+ *                 previously MessagePack used new uint8_t[] for these payloads and its
+ *                 copy constructor did a deep copy, Theron copies each message when
+ *                 sending, AMPathFindOK, AMAddCharObject, net packages etc. all take
+ *                 this path
+ *
+ *                 now the payload lives in one reference counted buffer:
+ *
+ *                      [BufHead][Data]
+ *
+ *                 copy of a MessagePack only increases the count, payload is immutable
+ *                 after creation so sharing is safe between threads
+ *
+ *                 buffers are size-classed: 128, 256, ..., 4096 bytes, each thread keeps
+ *                 a small free list per class, refill and overflow go to g_MemoryPN, and
+ *                 payloads longer than the largest class go to g_MemoryPN directly
+ *
+ *                 it also counts messages per MPK type: how many created, how many of
+ *                 them used the pool, and the longest payload, Report() logs them, use
+ *                 it to size SBufSize from real traffic, counts are kept per thread and
+ *                 summed up by Report()
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+class MPKPool final
+{
+    public:
+        struct BufHead
+        {
+            std::atomic<int> RefCount;
+
+            uint32_t ClassID;
+            size_t   DataLen;
+
+            BufHead(uint32_t nClassID, size_t nDataLen)
+                : RefCount(1)
+                , ClassID(nClassID)
+                , DataLen(nDataLen)
+            {}
+
+            uint8_t *Data()
+            {
+                return (uint8_t *)(this + 1);
+            }
+        };
+
+    private:
+        // size of class i is (MIN_CLASS_SIZE << i)
+        // class CLASS_COUNT is for buffers allocated directly
+        constexpr static size_t MIN_CLASS_SIZE = 128;
+        constexpr static size_t CLASS_COUNT    = 6;
+
+        // max buffers cached by one thread for each class
+        constexpr static size_t CACHE_SIZE = 64;
+
+        // MPK type out of [0, TYPE_COUNT) are counted in the last slot
+        constexpr static size_t TYPE_COUNT = 256;
+
+    public:
+        // return a buffer with reference count 1
+        // return nullptr if nDataLen is zero
+        static BufHead *Get(size_t);
+
+    public:
+        static void AddRef(BufHead *pHead)
+        {
+            if(pHead){
+                pHead->RefCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        static void Release(BufHead *pHead)
+        {
+            if(pHead && (pHead->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)){
+                Free(pHead);
+            }
+        }
+
+    public:
+        // record one message creation
+        // bPooled means the payload is in the pool rather than SBuf
+        static void Record(int, size_t, bool);
+
+        // log the counts of all recorded types
+        static void Report();
+
+    private:
+        static void Free(BufHead *);
+};
@@ -50,6 +50,7 @@
 #pragma once
 
 #include <thread>
+#include <vector>
 #include <cstdint>
 #include <asio.hpp>
 #include <Theron/Theron.h>
@@ -285,13 +286,9 @@ template<size_t PodSize> class NetPod: public SyncDriver
         template<typename... Args> bool Send(uint32_t nSessionID, Args&&... args)
         {
             // it's a broadcast
+            // build the packet once and all sessions share it
             if(!nSessionID){
-                for(int nSID = 1; nSID < (int)PodSize; ++nSID){
-                    if(m_SessionV[1][nSID]){
-                        m_SessionV[1][nSID]->Send(std::forward<Args>(args)...);
-                    }
-                }
-                return true;
+                return Broadcast(BuildPacket(std::forward<Args>(args)...));
             }
 
             if(nSessionID < PodSize && m_SessionV[1][nSessionID]){
@@ -303,6 +300,70 @@ template<size_t PodSize> class NetPod: public SyncDriver
             return false;
         }
 
+    public:
+        bool Broadcast(const SendPacket &rstPacket)
+        {
+            if(!rstPacket.Ready()){
+                return false;
+            }
+
+            for(int nSID = 1; nSID < (int)PodSize; ++nSID){
+                if(m_SessionV[1][nSID]){
+                    m_SessionV[1][nSID]->Send(rstPacket);
+                }
+            }
+            return true;
+        }
+
+        // send one packet to a list of sessions
+        // the packet is encoded only once, each session only holds a reference of it
+        // return false if any session in the list is invalid
+        bool Multicast(const uint32_t *pSessionIDList, size_t nCount, const SendPacket &rstPacket)
+        {
+            if(!(pSessionIDList && rstPacket.Ready())){
+                return false;
+            }
+
+            bool bSendAll = true;
+            for(size_t nIndex = 0; nIndex < nCount; ++nIndex){
+                auto nSessionID = pSessionIDList[nIndex];
+                if(nSessionID && nSessionID < PodSize && m_SessionV[1][nSessionID]){
+                    m_SessionV[1][nSessionID]->Send(rstPacket);
+                }else{
+                    bSendAll = false;
+                }
+            }
+            return bSendAll;
+        }
+
+        bool Multicast(const std::vector<uint32_t> &rstSessionIDList, const SendPacket &rstPacket)
+        {
+            return Multicast(rstSessionIDList.data(), rstSessionIDList.size(), rstPacket);
+        }
+
+    private:
+        // make a packet from the argument list of Session::Send()
+        // used for broadcast, callback is not supported for broadcast
+        static SendPacket BuildPacket(const SendPacket &rstPacket)
+        {
+            return rstPacket;
+        }
+
+        static SendPacket BuildPacket(uint8_t nHC)
+        {
+            return SendPacket::Build(nHC, nullptr, 0);
+        }
+
+        static SendPacket BuildPacket(uint8_t nHC, const uint8_t *pData, size_t nLen)
+        {
+            return SendPacket::Build(nHC, pData, nLen);
+        }
+
+        template<typename T> static SendPacket BuildPacket(uint8_t nHC, const T &stMsgT)
+        {
+            return SendPacket::Build(nHC, (const uint8_t *)(&stMsgT), sizeof(stMsgT));
+        }
+
     private:
         void Accept()
         {
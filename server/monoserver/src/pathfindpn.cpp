@@ -0,0 +1,217 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: pathfindpn.cpp
+ *        Created: 06/01/2017 11:03:48
+ *  Last Modified: 06/01/2017 17:46:20
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+#include <cinttypes>
+
+#include "monoserver.hpp"
+#include "syncdriver.hpp"
+#include "pathfindpn.hpp"
+#include "messagepack.hpp"
+
+constexpr int      PathFindPN::CACHE_REGION_SIZE;
+constexpr size_t   PathFindPN::CACHE_PATH_NODE;
+constexpr uint32_t PathFindPN::CACHE_EXPIRE_MS;
+
+PathFindPN::PathFindPN(size_t nThreadCount, size_t nCacheCapacity)
+    : m_CacheCapacity(nCacheCapacity)
+    , m_CacheLock()
+    , m_LRUList()
+    , m_CacheMap()
+    , m_HitCount(0)
+    , m_MissCount(0)
+    , m_FailCount(0)
+    , m_ThreadPool(nThreadCount)
+{}
+
+PathFindPN::CacheKey PathFindPN::MakeKey(uint32_t nMapID, const AMPathFind &rstAMPF)
+{
+    CacheKey stKey;
+    stKey.MapID   = nMapID;
+    stKey.CheckCO = rstAMPF.CheckCO;
+    stKey.RegionX = rstAMPF.X / CACHE_REGION_SIZE;
+    stKey.RegionY = rstAMPF.Y / CACHE_REGION_SIZE;
+    stKey.EndX    = rstAMPF.EndX;
+    stKey.EndY    = rstAMPF.EndY;
+    return stKey;
+}
+
+// path includes start, goal is not sent, it's taken by the target in most cases
+// slots not filled are (-1, -1)
+void PathFindPN::FillPathFindOK(const std::vector<PathFind::PathNode> &rstPathV, int nX1, int nY1, AMPathFindOK *pAMPFOK)
+{
+    auto nPathCount = sizeof(pAMPFOK->Point) / sizeof(pAMPFOK->Point[0]);
+    for(size_t nIndex = 0; nIndex < nPathCount; ++nIndex){
+        pAMPFOK->Point[nIndex].X = -1;
+        pAMPFOK->Point[nIndex].Y = -1;
+    }
+
+    for(size_t nIndex = 0; nIndex < nPathCount && nIndex < rstPathV.size(); ++nIndex){
+        auto &rstNode = rstPathV[nIndex];
+        if(rstNode.X == nX1 && rstNode.Y == nY1){
+            break;
+        }
+
+        pAMPFOK->Point[nIndex].X = rstNode.X;
+        pAMPFOK->Point[nIndex].Y = rstNode.Y;
+    }
+}
+
+bool PathFindPN::Query(uint32_t nMapID, const AMPathFind &rstAMPF, AMPathFindOK *pAMPFOK)
+{
+    if(!(m_CacheCapacity && pAMPFOK)){
+        return false;
+    }
+
+    int nX0 = rstAMPF.X;
+    int nY0 = rstAMPF.Y;
+
+    std::lock_guard<std::mutex> stLockGuard(m_CacheLock);
+    auto pEntry = m_CacheMap.find(MakeKey(nMapID, rstAMPF));
+    if(pEntry == m_CacheMap.end()){
+        m_MissCount++;
+        return false;
+    }
+
+    if(std::chrono::steady_clock::now() >= pEntry->second.Expiration){
+        m_LRUList.erase(pEntry->second.LRU);
+        m_CacheMap.erase(pEntry);
+        m_MissCount++;
+        return false;
+    }
+
+    // find the furthest node the start is on or next to
+    // then reply the rest of the cached path from there
+    auto &rstPathV = pEntry->second.PathV;
+    for(size_t nIndex = rstPathV.size(); nIndex-- > 0;){
+        int nDX = std::abs(rstPathV[nIndex].X - nX0);
+        int nDY = std::abs(rstPathV[nIndex].Y - nY0);
+
+        if(std::max<int>(nDX, nDY) > 1){
+            continue;
+        }
+
+        // need at least one step to go
+        // unless the cached path ends at the goal
+        bool bOnPath = (nDX == 0 && nDY == 0);
+        if(bOnPath && nIndex + 1 == rstPathV.size()){
+            break;
+        }
+
+        // off the path, start steps into node nIndex first
+        std::vector<PathFind::PathNode> stReplyV;
+        if(!bOnPath){
+            stReplyV.emplace_back(nX0, nY0);
+        }
+        stReplyV.insert(stReplyV.end(), rstPathV.begin() + nIndex, rstPathV.end());
+
+        pAMPFOK->UID   = rstAMPF.UID;
+        pAMPFOK->MapID = nMapID;
+        FillPathFindOK(stReplyV, rstAMPF.EndX, rstAMPF.EndY, pAMPFOK);
+
+        m_LRUList.splice(m_LRUList.begin(), m_LRUList, pEntry->second.LRU);
+        m_HitCount++;
+        return true;
+    }
+
+    m_MissCount++;
+    return false;
+}
+
+bool PathFindPN::Submit(std::shared_ptr<const Snapshot> pSnapshot, std::vector<int> stOccupiedV, uint32_t nMapID, const AMPathFind &rstAMPF, const Theron::Address &rstFromAddr, uint32_t nRespond)
+{
+    if(!pSnapshot){
+        return false;
+    }
+
+    std::sort(stOccupiedV.begin(), stOccupiedV.end());
+    return m_ThreadPool.Add([this, pSnapshot, stOccupiedV, nMapID, rstAMPF, rstFromAddr, nRespond]()
+    {
+        Search(*pSnapshot, stOccupiedV, nMapID, rstAMPF, rstFromAddr, nRespond);
+    });
+}
+
+void PathFindPN::Search(const Snapshot &rstSnapshot, const std::vector<int> &rstOccupiedV, uint32_t nMapID, const AMPathFind &rstAMPF, const Theron::Address &rstFromAddr, uint32_t nRespond)
+{
+    int nX0 = rstAMPF.X;
+    int nY0 = rstAMPF.Y;
+    int nX1 = rstAMPF.EndX;
+    int nY1 = rstAMPF.EndY;
+
+    // refine more nodes than one reply needs
+    // then nearby requests can reuse it
+    //
+    // CheckCO: occupied cell is still allowed but costs much more
+    std::vector<PathFind::PathNode> stPathV;
+    auto nW = rstSnapshot.WalkMap.W();
+    bool bFound = rstAMPF.CheckCO
+        ? rstSnapshot.Graph.Search(nX0, nY0, nX1, nY1, &stPathV, CACHE_PATH_NODE, [nW, &rstOccupiedV](int nX, int nY)
+          {
+              return std::binary_search(rstOccupiedV.begin(), rstOccupiedV.end(), nY * nW + nX);
+          })
+        : rstSnapshot.Graph.Search(nX0, nY0, nX1, nY1, &stPathV, CACHE_PATH_NODE);
+
+    if(!bFound){
+        m_FailCount++;
+        SyncDriver().Forward(MPK_ERROR, rstFromAddr, nRespond);
+        return;
+    }
+
+    AMPathFindOK stAMPFOK;
+    stAMPFOK.UID   = rstAMPF.UID;
+    stAMPFOK.MapID = nMapID;
+    FillPathFindOK(stPathV, nX1, nY1, &stAMPFOK);
+    SyncDriver().Forward({MPK_PATHFINDOK, stAMPFOK}, rstFromAddr, nRespond);
+
+    if(m_CacheCapacity){
+        if(stPathV.size() > CACHE_PATH_NODE){
+            stPathV.erase(stPathV.begin() + CACHE_PATH_NODE, stPathV.end());
+        }
+
+        std::lock_guard<std::mutex> stLockGuard(m_CacheLock);
+        auto stKey  = MakeKey(nMapID, rstAMPF);
+        auto pEntry = m_CacheMap.find(stKey);
+        if(pEntry != m_CacheMap.end()){
+            m_LRUList.erase(pEntry->second.LRU);
+            m_CacheMap.erase(pEntry);
+        }
+
+        while(m_CacheMap.size() >= m_CacheCapacity){
+            m_CacheMap.erase(m_LRUList.back());
+            m_LRUList.pop_back();
+        }
+
+        m_LRUList.push_front(stKey);
+
+        auto &rstEntry = m_CacheMap[stKey];
+        rstEntry.PathV      = std::move(stPathV);
+        rstEntry.Expiration = std::chrono::steady_clock::now() + std::chrono::milliseconds(CACHE_EXPIRE_MS);
+        rstEntry.LRU        = m_LRUList.begin();
+    }
+}
+
+void PathFindPN::Report()
+{
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_INFO, "PathFindPN statistics: HitCount = %" PRIu64 ", MissCount = %" PRIu64 ", FailCount = %" PRIu64,
+            (uint64_t)(m_HitCount), (uint64_t)(m_MissCount), (uint64_t)(m_FailCount));
+}
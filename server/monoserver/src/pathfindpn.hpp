@@ -0,0 +1,167 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: pathfindpn.hpp
+ *        Created: 06/01/2017 10:21:35
+ *  Last Modified: 06/01/2017 17:48:02
+ *
+ *    Description: path finding off the map actor
+ *
+ *                 ServerMap used to search in On_MPK_PATHFIND, all other messages of
+ *                 the map wait for it, now the map only posts a task here and returns:
+ *
+ *                      1. walkability and portal graph of a map is built once and never
+ *                         changed, workers share it as an immutable Snapshot
+ *                      2. occupied cells are taken by the map actor from its AOIGrid
+ *                         around the start point and copied into the task
+ *                      3. worker replies MPK_PATHFINDOK / MPK_ERROR to the requestor
+ *                         directly by SyncDriver, as the response of MPK_PATHFIND
+ *
+ *                 a crowd of monsters chasing one player asks for almost the same path,
+ *                 results are kept in a small LRU keyed by (map, start region, goal),
+ *                 a request hits if its start is on, or next to, the cached path
+ *
+ *                 occupancy changes quickly, entries expire in CACHE_EXPIRE_MS, and the
+ *                 requestor checks each step when moving anyway
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <Theron/Theron.h>
+
+#include "pathfinder.hpp"
+#include "portalgraph.hpp"
+#include "threadpool2.hpp"
+#include "actormessage.hpp"
+#include "gridpathfinder.hpp"
+
+class PathFindPN final
+{
+    public:
+        // built by the map before it's shared
+        // graph keeps a pointer to WalkMap, so no copy or move
+        struct Snapshot
+        {
+            GridPathFinder::WalkMap WalkMap;
+            PortalGraph             Graph;
+
+            Snapshot(int nW, int nH)
+                : WalkMap(nW, nH)
+                , Graph(&WalkMap)
+            {}
+
+            Snapshot(const Snapshot &) = delete;
+            Snapshot &operator = (const Snapshot &) = delete;
+        };
+
+    private:
+        // requests with start in the same CACHE_REGION_SIZE x CACHE_REGION_SIZE block share
+        // one entry, cached path keeps CACHE_PATH_NODE nodes from the start
+        constexpr static int      CACHE_REGION_SIZE = 8;
+        constexpr static size_t   CACHE_PATH_NODE   = 16;
+        constexpr static uint32_t CACHE_EXPIRE_MS   = 1000;
+
+    private:
+        struct CacheKey
+        {
+            uint32_t MapID;
+            bool     CheckCO;
+
+            int RegionX;
+            int RegionY;
+            int EndX;
+            int EndY;
+
+            bool operator == (const CacheKey &rstKey) const
+            {
+                return true
+                    && MapID   == rstKey.MapID
+                    && CheckCO == rstKey.CheckCO
+                    && RegionX == rstKey.RegionX
+                    && RegionY == rstKey.RegionY
+                    && EndX    == rstKey.EndX
+                    && EndY    == rstKey.EndY;
+            }
+        };
+
+        struct CacheKeyHash
+        {
+            size_t operator () (const CacheKey &rstKey) const
+            {
+                uint64_t nHash = 14695981039346656037ULL;
+                for(auto nValue: {(int)(rstKey.MapID), (int)(rstKey.CheckCO), rstKey.RegionX, rstKey.RegionY, rstKey.EndX, rstKey.EndY}){
+                    nHash = (nHash ^ (uint32_t)(nValue)) * 1099511628211ULL;
+                }
+                return (size_t)(nHash);
+            }
+        };
+
+        struct CacheEntry
+        {
+            std::vector<PathFind::PathNode> PathV;
+
+            std::chrono::steady_clock::time_point Expiration;
+            std::list<CacheKey>::iterator         LRU;
+        };
+
+    private:
+        const size_t m_CacheCapacity;
+
+    private:
+        std::mutex m_CacheLock;
+
+        // front is the most recently used
+        std::list<CacheKey> m_LRUList;
+        std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> m_CacheMap;
+
+    private:
+        std::atomic<uint64_t> m_HitCount;
+        std::atomic<uint64_t> m_MissCount;
+        std::atomic<uint64_t> m_FailCount;
+
+    private:
+        // declared last, destroyed first
+        // dtor waits for running tasks, they still need the cache
+        ThreadPool2 m_ThreadPool;
+
+    public:
+        PathFindPN(size_t, size_t);
+       ~PathFindPN() = default;
+
+    public:
+        // try the cache in the map actor before posting a task
+        // return true and fill the response if hit
+        bool Query(uint32_t, const AMPathFind &, AMPathFindOK *);
+
+        // post the search to a worker thread
+        // occupied cells are indices (nY * W + nX), only used when CheckCO is set
+        bool Submit(std::shared_ptr<const Snapshot>, std::vector<int>, uint32_t, const AMPathFind &, const Theron::Address &, uint32_t);
+
+    public:
+        // log hit / miss counts
+        void Report();
+
+    private:
+        void Search(const Snapshot &, const std::vector<int> &, uint32_t, const AMPathFind &, const Theron::Address &, uint32_t);
+
+    private:
+        static CacheKey MakeKey(uint32_t, const AMPathFind &);
+        static void FillPathFindOK(const std::vector<PathFind::PathNode> &, int, int, AMPathFindOK *);
+};
@@ -0,0 +1,378 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: persisthub.cpp
+ *        Created: 05/28/2017 10:31:05
+ *  Last Modified: 05/28/2017 16:24:52
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <algorithm>
+#include <unistd.h>
+
+#include "dbpod.hpp"
+#include "monoserver.hpp"
+#include "persisthub.hpp"
+
+namespace
+{
+    // one journal entry per DBID per flush
+    // all fields are 4 bytes, no padding inside
+    struct JournalRecord
+    {
+        uint32_t Magic;
+        uint32_t DBID;
+        uint32_t Mask;
+        int32_t  Value[PersistHub::FIELD_MAX];
+        uint32_t Check;
+    };
+
+    uint32_t JournalCheck(const JournalRecord &rstRecord)
+    {
+        // FNV-1a over all fields before Check
+        // the last entry could be half-written when crashed
+        uint32_t nHash = 2166136261U;
+        auto pData = (const uint8_t *)(&rstRecord);
+        for(size_t nIndex = 0; nIndex < sizeof(rstRecord) - sizeof(rstRecord.Check); ++nIndex){
+            nHash = (nHash ^ pData[nIndex]) * 16777619U;
+        }
+        return nHash;
+    }
+
+    const char *s_ColumnV[] = {
+        "fld_mapid",
+        "fld_mapx",
+        "fld_mapy",
+        "fld_level",
+        "fld_direction",
+        "fld_hp",
+        "fld_mp",
+    };
+}
+
+PersistHub::PersistHub(const char *szJournalName, uint32_t nIntervalMS)
+    : BaseHub<PersistHub>()
+    , m_JournalName(szJournalName ? szJournalName : "")
+    , m_Journal(nullptr)
+    , m_IntervalMS(MIN_INTERVAL_MS)
+    , m_Lock()
+    , m_CV()
+    , m_PendingMap()
+    , m_FlushCount(0)
+    , m_RowCount(0)
+    , m_FailCount(0)
+    , m_TotalMS(0)
+    , m_MaxMS(0)
+    , m_MaxRows(0)
+{
+    static_assert(sizeof(s_ColumnV) / sizeof(s_ColumnV[0]) == FIELD_MAX, "PersistHub needs one column per field");
+    Interval(nIntervalMS);
+}
+
+PersistHub::~PersistHub()
+{
+    Shutdown();
+    Join();
+
+    if(m_Journal){
+        std::fclose(m_Journal);
+    }
+}
+
+void PersistHub::Mark(uint32_t nDBID, const Record &rstRecord)
+{
+    if(!(nDBID && rstRecord.Mask)){
+        return;
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    auto &rstPending = m_PendingMap[nDBID];
+
+    auto stRecord = rstRecord;
+    stRecord.MergeOld(rstPending);
+    rstPending = stRecord;
+}
+
+void PersistHub::Shutdown()
+{
+    State(false);
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    }
+    m_CV.notify_one();
+}
+
+bool PersistHub::OpenJournal()
+{
+    if(m_Journal){
+        return true;
+    }
+
+    // append mode, writes always go to the end
+    // even after the file is truncated
+    if(!(m_Journal = std::fopen(m_JournalName.c_str(), "ab+"))){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Open persist journal failed: %s", m_JournalName.c_str());
+        return false;
+    }
+    return true;
+}
+
+void PersistHub::ReplayJournal()
+{
+    if(!m_Journal){
+        return;
+    }
+
+    std::fseek(m_Journal, 0, SEEK_SET);
+
+    size_t nCount = 0;
+    JournalRecord stJournalRecord;
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    while(std::fread(&stJournalRecord, sizeof(stJournalRecord), 1, m_Journal) == 1){
+        if(false
+                || stJournalRecord.Magic != JOURNAL_MAGIC
+                || stJournalRecord.Check != JournalCheck(stJournalRecord)){
+            // broken tail when crashed during appending
+            // entries after it are not trustable
+            extern MonoServer *g_MonoServer;
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Broken persist journal entry, drop the rest of %s", m_JournalName.c_str());
+            break;
+        }
+
+        Record stRecord;
+        for(int nField = 0; nField < FIELD_MAX; ++nField){
+            if(stJournalRecord.Mask & (1 << nField)){
+                stRecord.Set(nField, stJournalRecord.Value[nField]);
+            }
+        }
+
+        // entries are in time order, later one wins
+        // and changes marked after launch are newer than all of them
+        auto &rstPending = m_PendingMap[stJournalRecord.DBID];
+        stRecord.MergeOld(rstPending);
+        rstPending = stRecord;
+        nCount++;
+    }
+
+    std::clearerr(m_Journal);
+    std::fseek(m_Journal, 0, SEEK_END);
+
+    if(nCount){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_INFO, "Replay %d persist journal entries from %s", (int)(nCount), m_JournalName.c_str());
+    }
+}
+
+bool PersistHub::AppendJournal(const std::unordered_map<uint32_t, Record> &rstRecordMap)
+{
+    if(!m_Journal){
+        return false;
+    }
+
+    for(auto &rstEntry: rstRecordMap){
+        JournalRecord stJournalRecord;
+        stJournalRecord.Magic = JOURNAL_MAGIC;
+        stJournalRecord.DBID  = rstEntry.first;
+        stJournalRecord.Mask  = rstEntry.second.Mask;
+
+        std::copy(rstEntry.second.Value, rstEntry.second.Value + FIELD_MAX, stJournalRecord.Value);
+        stJournalRecord.Check = JournalCheck(stJournalRecord);
+
+        if(std::fwrite(&stJournalRecord, sizeof(stJournalRecord), 1, m_Journal) != 1){
+            return false;
+        }
+    }
+
+    // data is on disk before we touch the database
+    return !std::fflush(m_Journal) && !fsync(fileno(m_Journal));
+}
+
+void PersistHub::TruncateJournal()
+{
+    if(m_Journal){
+        std::fflush(m_Journal);
+        if(ftruncate(fileno(m_Journal), 0)){
+            extern MonoServer *g_MonoServer;
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Truncate persist journal failed: %s", m_JournalName.c_str());
+        }
+    }
+}
+
+bool PersistHub::Write(const std::vector<std::pair<uint32_t, Record>> &rstRecordV, size_t nBegin, size_t nEnd)
+{
+    // values are all integers, no need to escape
+    std::string szSQL = "update tbl_guid set ";
+
+    bool bFirstColumn = true;
+    for(int nField = 0; nField < FIELD_MAX; ++nField){
+        std::string szCase;
+        for(size_t nIndex = nBegin; nIndex < nEnd; ++nIndex){
+            if(rstRecordV[nIndex].second.Has(nField)){
+                szCase += " when ";
+                szCase += std::to_string(rstRecordV[nIndex].first);
+                szCase += " then ";
+                szCase += std::to_string(rstRecordV[nIndex].second.Value[nField]);
+            }
+        }
+
+        // nobody changed this column
+        if(szCase.empty()){
+            continue;
+        }
+
+        if(!bFirstColumn){
+            szSQL += ", ";
+        }
+        bFirstColumn = false;
+
+        szSQL += s_ColumnV[nField];
+        szSQL += " = case fld_guid";
+        szSQL += szCase;
+        szSQL += " else ";
+        szSQL += s_ColumnV[nField];
+        szSQL += " end";
+    }
+
+    if(bFirstColumn){
+        return true;
+    }
+
+    szSQL += " where fld_guid in (";
+    for(size_t nIndex = nBegin; nIndex < nEnd; ++nIndex){
+        if(nIndex != nBegin){
+            szSQL += ", ";
+        }
+        szSQL += std::to_string(rstRecordV[nIndex].first);
+    }
+    szSQL += ")";
+
+    extern DBPodN *g_DBPodN;
+    extern MonoServer *g_MonoServer;
+
+    auto pRecord = g_DBPodN->CreateDBHDR();
+    if(!pRecord){
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Create database handler failed");
+        return false;
+    }
+
+    if(!pRecord->Query(szSQL.c_str())){
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Batched update of %d players failed: %s", (int)(nEnd - nBegin), pRecord->ErrorInfo());
+        return false;
+    }
+    return true;
+}
+
+void PersistHub::Flush()
+{
+    std::unordered_map<uint32_t, Record> stRecordMap;
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+        std::swap(stRecordMap, m_PendingMap);
+    }
+
+    if(stRecordMap.empty()){
+        return;
+    }
+
+    extern MonoServer *g_MonoServer;
+    auto stStartTime = std::chrono::steady_clock::now();
+
+    if(!AppendJournal(stRecordMap)){
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Append persist journal failed: %s", m_JournalName.c_str());
+    }
+
+    std::vector<std::pair<uint32_t, Record>> stRecordV(stRecordMap.begin(), stRecordMap.end());
+    std::vector<std::pair<uint32_t, Record>> stFailV;
+
+    for(size_t nBegin = 0; nBegin < stRecordV.size(); nBegin += MAX_BATCH_ROWS){
+        auto nEnd = std::min<size_t>(nBegin + MAX_BATCH_ROWS, stRecordV.size());
+        if(!Write(stRecordV, nBegin, nEnd)){
+            stFailV.insert(stFailV.end(), stRecordV.begin() + nBegin, stRecordV.begin() + nEnd);
+        }
+    }
+
+    if(stFailV.empty()){
+        // everything in the journal is in database now
+        TruncateJournal();
+    }else{
+        // keep the journal, and retry failed ones next time
+        // changes marked during this flush are newer
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+        for(auto &rstFail: stFailV){
+            auto &rstPending = m_PendingMap[rstFail.first];
+            auto stRecord = rstPending;
+
+            stRecord.MergeOld(rstFail.second);
+            rstPending = stRecord;
+        }
+        m_FailCount += stFailV.size();
+    }
+
+    auto nCostMS = (uint32_t)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stStartTime).count());
+    auto nRows   = (uint32_t)(stRecordV.size());
+
+    m_FlushCount++;
+    m_RowCount += nRows;
+    m_TotalMS  += nCostMS;
+
+    if(nCostMS > m_MaxMS){ m_MaxMS = nCostMS; }
+    if(nRows > m_MaxRows){ m_MaxRows = nRows; }
+
+    if(nCostMS > m_IntervalMS){
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Persist flush of %d players took %d ms, longer than interval %d ms", (int)(nRows), (int)(nCostMS), (int)(m_IntervalMS));
+    }
+}
+
+void PersistHub::Report()
+{
+    extern MonoServer *g_MonoServer;
+
+    uint64_t nFlushCount = m_FlushCount;
+    uint64_t nRowCount   = m_RowCount;
+    uint64_t nTotalMS    = m_TotalMS;
+
+    g_MonoServer->AddLog(LOGTYPE_INFO,
+            "PersistHub statistics: FlushCount = %" PRIu64 ", RowCount = %" PRIu64 ", FailCount = %" PRIu64 ", AvgRows = %" PRIu64 ", MaxRows = %d, AvgMS = %" PRIu64 ", MaxMS = %d",
+            nFlushCount,
+            nRowCount,
+            (uint64_t)(m_FailCount),
+            nFlushCount ? (nRowCount / nFlushCount) : 0,
+            (int)(m_MaxRows),
+            nFlushCount ? (nTotalMS / nFlushCount) : 0,
+            (int)(m_MaxMS));
+}
+
+void PersistHub::MainLoop()
+{
+    if(OpenJournal()){
+        ReplayJournal();
+    }
+
+    while(State()){
+        {
+            std::unique_lock<std::mutex> stUniqueLock(m_Lock);
+            m_CV.wait_for(stUniqueLock, std::chrono::milliseconds(m_IntervalMS), [this]()
+            {
+                return !State();
+            });
+        }
+
+        // flush once more when shutting down
+        Flush();
+    }
+}
@@ -0,0 +1,166 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: persisthub.hpp
+ *        Created: 05/28/2017 09:46:12
+ *  Last Modified: 05/28/2017 16:21:37
+ *
+ *    Description: write-behind persistence of player state
+ *
+ *                 player state only lives in memory, login reads it from tbl_guid and
+ *                 nothing writes it back, PersistHub does it without blocking actors:
+ *
+ *                 1. player marks changed fields by Mark(), only in memory, changes of
+ *                    one DBID are coalesced and the last value wins
+ *                 2. the hub thread wakes every m_IntervalMS, appends all pending
+ *                    records to the journal and syncs it to disk
+ *                 3. then writes them by batched update, each statement covers up to
+ *                    MAX_BATCH_ROWS players:
+ *
+ *                      update tbl_guid set
+ *                          fld_mapx = case fld_guid when 1 then 17 when 5 then 22 else fld_mapx end,
+ *                          ...
+ *                      where fld_guid in (1, 5)
+ *
+ *                 4. journal is truncated after all statements succeed, failed records
+ *                    are merged back and retried next time
+ *
+ *                 at launch the journal is replayed, so a crash loses at most the changes
+ *                 of one interval, rows are created by login, here we only update
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "basehub.hpp"
+
+class PersistHub: public BaseHub<PersistHub>
+{
+    public:
+        enum FieldType: int
+        {
+            FIELD_MAPID = 0,
+            FIELD_MAPX,
+            FIELD_MAPY,
+            FIELD_LEVEL,
+            FIELD_DIRECTION,
+            FIELD_HP,
+            FIELD_MP,
+            FIELD_MAX,
+        };
+
+        struct Record
+        {
+            uint32_t Mask;
+            int32_t  Value[FIELD_MAX];
+
+            Record()
+                : Mask(0)
+                , Value()
+            {}
+
+            void Set(int nField, int32_t nValue)
+            {
+                Mask |= (1 << nField);
+                Value[nField] = nValue;
+            }
+
+            bool Has(int nField) const
+            {
+                return Mask & (1 << nField);
+            }
+
+            // take fields of an older record which are not set in this one
+            void MergeOld(const Record &rstOld)
+            {
+                for(int nField = 0; nField < FIELD_MAX; ++nField){
+                    if(!Has(nField) && rstOld.Has(nField)){
+                        Set(nField, rstOld.Value[nField]);
+                    }
+                }
+            }
+        };
+
+    private:
+        constexpr static size_t   MAX_BATCH_ROWS  = 128;
+        constexpr static uint32_t JOURNAL_MAGIC   = 0X4D325053;
+        constexpr static uint32_t MIN_INTERVAL_MS = 100;
+
+    private:
+        std::string m_JournalName;
+        std::FILE  *m_Journal;
+
+    private:
+        std::atomic<uint32_t> m_IntervalMS;
+
+    private:
+        std::mutex              m_Lock;
+        std::condition_variable m_CV;
+
+        std::unordered_map<uint32_t, Record> m_PendingMap;
+
+    private:
+        // only for statistics, updated by the hub thread
+        std::atomic<uint64_t> m_FlushCount;
+        std::atomic<uint64_t> m_RowCount;
+        std::atomic<uint64_t> m_FailCount;
+        std::atomic<uint64_t> m_TotalMS;
+        std::atomic<uint32_t> m_MaxMS;
+        std::atomic<uint32_t> m_MaxRows;
+
+    public:
+        PersistHub(const char *, uint32_t);
+       ~PersistHub();
+
+    public:
+        // mark changed fields of one player
+        // callable from any actor thread, it only touches memory
+        void Mark(uint32_t, const Record &);
+
+    public:
+        // flush cadence, takes effect from the next interval
+        void Interval(uint32_t nIntervalMS)
+        {
+            m_IntervalMS = (nIntervalMS > MIN_INTERVAL_MS) ? nIntervalMS : MIN_INTERVAL_MS;
+        }
+
+        uint32_t Interval() const
+        {
+            return m_IntervalMS;
+        }
+
+    public:
+        void Shutdown();
+        void MainLoop();
+
+    public:
+        // log flush latency and batch size
+        void Report();
+
+    private:
+        bool OpenJournal();
+        void ReplayJournal();
+        bool AppendJournal(const std::unordered_map<uint32_t, Record> &);
+        void TruncateJournal();
+
+    private:
+        void Flush();
+        bool Write(const std::vector<std::pair<uint32_t, Record>> &, size_t, size_t);
+};
@@ -20,6 +20,7 @@
 
 #include "netpod.hpp"
 #include "player.hpp"
+#include "accountcache.hpp"
 #include "memorypn.hpp"
 #include "charobject.hpp"
 #include "protocoldef.hpp"
@@ -36,7 +37,19 @@ Player::Player(uint32_t nDBID,
     , m_JobID(0)        // will provide after bind
     , m_SessionID(0)    // provide by bind
     , m_Level(0)        // after bind
+    , m_Feature()
+    , m_FeatureEx()
+    , m_PersistRecord()
 {
+    // state loaded from database, not dirty
+    m_PersistRecord.Set(PersistHub::FIELD_MAPID,     (int32_t)(MapID()));
+    m_PersistRecord.Set(PersistHub::FIELD_MAPX,      (int32_t)(X()));
+    m_PersistRecord.Set(PersistHub::FIELD_MAPY,      (int32_t)(Y()));
+    m_PersistRecord.Set(PersistHub::FIELD_LEVEL,     (int32_t)(m_Level));
+    m_PersistRecord.Set(PersistHub::FIELD_DIRECTION, (int32_t)(Direction()));
+    m_PersistRecord.Set(PersistHub::FIELD_HP,        (int32_t)(m_HP));
+    m_PersistRecord.Set(PersistHub::FIELD_MP,        (int32_t)(m_MP));
+
     m_StateHook.Install("CheckTime", [this](){ For_CheckTime(); return false; });
     auto fnRegisterClass = [this]() -> void {
         if(!RegisterClass<Player, CharObject>()){
@@ -47,6 +60,7 @@ Player::Player(uint32_t nDBID,
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<Player>();
 }
 
 void Player::Operate(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -124,6 +138,37 @@ bool Player::Update()
     return true;
 }
 
+void Player::MarkPersist()
+{
+    int32_t nValueV[PersistHub::FIELD_MAX];
+    nValueV[PersistHub::FIELD_MAPID]     = (int32_t)(MapID());
+    nValueV[PersistHub::FIELD_MAPX]      = (int32_t)(X());
+    nValueV[PersistHub::FIELD_MAPY]      = (int32_t)(Y());
+    nValueV[PersistHub::FIELD_LEVEL]     = (int32_t)(m_Level);
+    nValueV[PersistHub::FIELD_DIRECTION] = (int32_t)(Direction());
+    nValueV[PersistHub::FIELD_HP]        = (int32_t)(m_HP);
+    nValueV[PersistHub::FIELD_MP]        = (int32_t)(m_MP);
+
+    // only send fields changed since last mark
+    // PersistHub coalesces them and writes in batch
+    PersistHub::Record stRecord;
+    for(int nField = 0; nField < PersistHub::FIELD_MAX; ++nField){
+        if(m_PersistRecord.Value[nField] != nValueV[nField]){
+            stRecord.Set(nField, nValueV[nField]);
+            m_PersistRecord.Set(nField, nValueV[nField]);
+        }
+    }
+
+    if(stRecord.Mask){
+        extern PersistHub *g_PersistHub;
+        g_PersistHub->Mark(m_DBID, stRecord);
+
+        // database is behind, relogin reads cached row
+        extern AccountCache *g_AccountCache;
+        g_AccountCache->Update(m_DBID, stRecord);
+    }
+}
+
 bool Player::Bind(uint32_t nSessionID)
 {
     m_SessionID = nSessionID;
@@ -136,26 +181,33 @@ bool Player::Bind(uint32_t nSessionID)
 void Player::ReportCORecord(uint32_t nSessionID)
 {
     if(nSessionID){
-        SMCORecord stSMCOR;
-
-        stSMCOR.Type = CREATURE_PLAYER;
-
-        stSMCOR.Common.UID       = UID();
-        stSMCOR.Common.MapID     = MapID();
-        stSMCOR.Common.X         = X();
-        stSMCOR.Common.Y         = Y();
-        stSMCOR.Common.EndX      = X();
-        stSMCOR.Common.EndY      = Y();
-        stSMCOR.Common.Direction = Direction();
-        stSMCOR.Common.Speed     = Speed();
-        stSMCOR.Common.Action    = ACTION_STAND;
-
-        stSMCOR.Player.DBID      = m_DBID;
-        stSMCOR.Player.JobID     = m_JobID;
-        stSMCOR.Player.Level     = m_Level;
-
-        extern NetPodN *g_NetPodN;
-        g_NetPodN->Send(nSessionID, SM_CORECORD, stSMCOR);
+        // build the message in place in the send packet
+        // then no intermediate structure and copy needed
+        auto stPacket = SendPacket::Reserve(SM_CORECORD, sizeof(SMCORecord));
+        if(auto pSMCOR = stPacket.As<SMCORecord>()){
+            auto &stSMCOR = *pSMCOR;
+
+            stSMCOR.Type = CREATURE_PLAYER;
+
+            stSMCOR.Common.UID       = UID();
+            stSMCOR.Common.MapID     = MapID();
+            stSMCOR.Common.X         = X();
+            stSMCOR.Common.Y         = Y();
+            stSMCOR.Common.EndX      = X();
+            stSMCOR.Common.EndY      = Y();
+            stSMCOR.Common.Direction = Direction();
+            stSMCOR.Common.Speed     = Speed();
+            stSMCOR.Common.Action    = ACTION_STAND;
+
+            stSMCOR.Player.DBID      = m_DBID;
+            stSMCOR.Player.JobID     = m_JobID;
+            stSMCOR.Player.Level     = m_Level;
+
+            if(stPacket.Commit()){
+                extern NetPodN *g_NetPodN;
+                g_NetPodN->Send(nSessionID, stPacket);
+            }
+        }
     }else{
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "invalid session id");
@@ -168,20 +220,26 @@ void Player::ReportStand()
     if(m_SessionID){
         // any error found when checking motion
         // report an stand state to client for pull-back
-        SMAction stSMAction;
-        stSMAction.UID         = UID();
-        stSMAction.MapID       = MapID();
-        stSMAction.Action      = ACTION_STAND;
-        stSMAction.ActionParam = 0;
-        stSMAction.Speed       = 0;
-        stSMAction.Direction   = Direction();
-        stSMAction.X           = X();
-        stSMAction.Y           = Y();
-        stSMAction.EndX        = X();
-        stSMAction.EndY        = Y();
-
-        extern NetPodN *g_NetPodN;
-        g_NetPodN->Send(m_SessionID, SM_ACTION, stSMAction);
+        auto stPacket = SendPacket::Reserve(SM_ACTION, sizeof(SMAction));
+        if(auto pSMAction = stPacket.As<SMAction>()){
+            auto &stSMAction = *pSMAction;
+
+            stSMAction.UID         = UID();
+            stSMAction.MapID       = MapID();
+            stSMAction.Action      = ACTION_STAND;
+            stSMAction.ActionParam = 0;
+            stSMAction.Speed       = 0;
+            stSMAction.Direction   = Direction();
+            stSMAction.X           = X();
+            stSMAction.Y           = Y();
+            stSMAction.EndX        = X();
+            stSMAction.EndY        = Y();
+
+            if(stPacket.Commit()){
+                extern NetPodN *g_NetPodN;
+                g_NetPodN->Send(m_SessionID, stPacket);
+            }
+        }
     }
 }
 
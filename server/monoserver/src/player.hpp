@@ -24,6 +24,7 @@
 
 #include "monoserver.hpp"
 #include "charobject.hpp"
+#include "persisthub.hpp"
 
 #pragma pack(push, 1)
 typedef struct stPLAYERFEATURE
@@ -66,6 +67,10 @@ class Player: public CharObject
         PLAYERFEATURE   m_Feature;
         PLAYERFEATUREEX m_FeatureEx;
 
+    protected:
+        // last state marked to PersistHub
+        PersistHub::Record m_PersistRecord;
+
     public:
         Player(uint32_t,                // GUID
                 ServiceCore *,          //
@@ -121,6 +126,9 @@ class Player: public CharObject
     private:
         void For_CheckTime();
 
+    protected:
+        void MarkPersist();
+
     protected:
         void ReportStand();
         void ReportCORecord(uint32_t);
@@ -31,6 +31,7 @@ void Player::On_MPK_METRONOME(const MessagePack &, const Theron::Address &)
     extern MonoServer *g_MonoServer;
 
     Update();
+    MarkPersist();
 
     SMPing stSMP;
     stSMP.Tick = g_MonoServer->GetTimeTick();
@@ -145,6 +146,8 @@ void Player::On_MPK_MAPSWITCH(const MessagePack &rstMPK, const Theron::Address &
             stAMTMS.MapID  = m_Map->ID();
             stAMTMS.MapUID = m_Map->UID();
 
+            stAMTMS.SessionID = m_SessionID;
+
             stAMTMS.X = X();
             stAMTMS.Y = Y();
 
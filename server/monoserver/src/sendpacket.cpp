@@ -0,0 +1,213 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: sendpacket.cpp
+ *        Created: 05/22/2017 11:40:52
+ *  Last Modified: 05/22/2017 19:46:33
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <new>
+#include <cstring>
+#include "memorypn.hpp"
+#include "compress.hpp"
+#include "sendpacket.hpp"
+#include "monoserver.hpp"
+#include "servermessage.hpp"
+
+SendPacket SendPacket::Reserve(uint8_t nHC, size_t nDataLen)
+{
+    auto fnReportError = [nHC, nDataLen](){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid message: (%d, %d)", (int)(nHC), (int)(nDataLen));
+    };
+
+    // frame capacity and scratch size for each type
+    // for type 1 the compressed length needs at most two bytes: [0 - 254] or [255][0 - 255]
+    size_t nFrameCap   = 0;
+    size_t nScratchLen = 0;
+
+    SMSGParam stSMSG(nHC);
+    switch(stSMSG.Type()){
+        case 0:
+            {
+                if(nDataLen){ fnReportError(); return {}; }
+                nFrameCap = 1;
+                break;
+            }
+        case 1:
+            {
+                if(nDataLen != stSMSG.DataLen()){ fnReportError(); return {}; }
+                nFrameCap   = 1 + 2 + stSMSG.MaskLen() + nDataLen;
+                nScratchLen = nDataLen;
+                break;
+            }
+        case 2:
+            {
+                if(nDataLen != stSMSG.DataLen()){ fnReportError(); return {}; }
+                nFrameCap = 1 + nDataLen;
+                break;
+            }
+        case 3:
+            {
+                if(nDataLen > 0XFFFFFFFF){ fnReportError(); return {}; }
+                nFrameCap = 1 + 4 + nDataLen;
+                break;
+            }
+        default:
+            {
+                fnReportError();
+                return {};
+            }
+    }
+
+    extern MemoryPN *g_MemoryPN;
+    auto pBuf = g_MemoryPN->Get(sizeof(PacketHead) + nFrameCap + nScratchLen);
+
+    SendPacket stPacket;
+    stPacket.m_Head = new (pBuf) PacketHead(nHC, nDataLen, nFrameCap);
+
+    auto pFrame = stPacket.FrameBuf();
+    pFrame[0] = nHC;
+
+    switch(stSMSG.Type()){
+        case 1:
+            {
+                // clean the scratch area
+                // callers may leave padding bytes not filled, zeros compress best
+                std::memset(stPacket.ScratchBuf(), 0, nScratchLen);
+                break;
+            }
+        case 3:
+            {
+                auto nDataLenU32 = (uint32_t)(nDataLen);
+                std::memcpy(pFrame + 1, &nDataLenU32, sizeof(nDataLenU32));
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+    return stPacket;
+}
+
+SendPacket SendPacket::Build(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    if((pData == nullptr) != (nDataLen == 0)){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid message: (%d, %p, %d)", (int)(nHC), pData, (int)(nDataLen));
+        return {};
+    }
+
+    auto stPacket = Reserve(nHC, nDataLen);
+    if(stPacket.m_Head){
+        if(nDataLen){
+            std::memcpy(stPacket.Data(), pData, nDataLen);
+        }
+
+        if(stPacket.Commit()){
+            return stPacket;
+        }
+    }
+    return {};
+}
+
+uint8_t *SendPacket::Data()
+{
+    if(!(m_Head && !m_Head->Ready && m_Head->DataLen)){
+        return nullptr;
+    }
+
+    switch(SMSGParam(m_Head->HC).Type()){
+        case 1  : return ScratchBuf();
+        case 2  : return FrameBuf() + 1;
+        case 3  : return FrameBuf() + 1 + 4;
+        default : return nullptr;
+    }
+}
+
+bool SendPacket::Commit()
+{
+    if(!m_Head){
+        return false;
+    }
+
+    if(m_Head->Ready){
+        return true;
+    }
+
+    SMSGParam stSMSG(m_Head->HC);
+    if(stSMSG.Type() != 1){
+        // no encoding needed
+        // data has been filled in place
+        m_Head->FrameLen = m_Head->FrameCap;
+        m_Head->Ready    = true;
+        return true;
+    }
+
+    // length encoding:
+    // [0 - 254]          : length in 0 ~ 254
+    // [    255][0 ~ 255] : length as 0 ~ 255 + 255
+    //
+    // 1. most likely we are using 0 ~ 254
+    // 2. if compressed length more than 254 we need to bytes
+    // 3. we support range in [0, 255 + 255]
+    auto pFrame     = FrameBuf();
+    auto pData      = ScratchBuf();
+    auto nCountData = Compress::CountData(pData, m_Head->DataLen);
+
+    size_t nSizeLen = 0;
+    if(nCountData < 0){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Count data failed: HC = %d, DataLen = %d", (int)(m_Head->HC), (int)(m_Head->DataLen));
+        return false;
+    }else if(nCountData <= 254){
+        nSizeLen  = 1;
+        pFrame[1] = (uint8_t)(nCountData);
+    }else if(nCountData <= (255 + 255)){
+        nSizeLen  = 2;
+        pFrame[1] = 255;
+        pFrame[2] = (uint8_t)(nCountData - 255);
+    }else{
+        // compressed message is tooo long
+        // should use another mode to send this message type
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Compressed data too long: HC = %d, DataLen = %d", (int)(m_Head->HC), (int)(m_Head->DataLen));
+        return false;
+    }
+
+    if(Compress::Encode(pFrame + 1 + nSizeLen, pData, m_Head->DataLen) != nCountData){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Compress failed: HC = %d, DataLen = %d", (int)(m_Head->HC), (int)(m_Head->DataLen));
+        return false;
+    }
+
+    m_Head->FrameLen = 1 + nSizeLen + stSMSG.MaskLen() + (size_t)(nCountData);
+    m_Head->Ready    = true;
+    return true;
+}
+
+void SendPacket::Release()
+{
+    if(m_Head){
+        if(m_Head->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            m_Head->~PacketHead();
+
+            extern MemoryPN *g_MemoryPN;
+            g_MemoryPN->Free(m_Head);
+        }
+        m_Head = nullptr;
+    }
+}
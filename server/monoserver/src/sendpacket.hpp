@@ -0,0 +1,175 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: sendpacket.hpp
+ *        Created: 05/22/2017 11:03:27
+ *  Last Modified: 05/22/2017 19:47:15
+ *
+ *    Description: framed server message ready to write to socket
+ *
+ *                 previously Session::Send() copied the caller's structure into its own
+ *                 memory pool, compressed it if needed, and kept HC separately, then a
+ *                 message was built once per session
+ *
+ *                 SendPacket keeps the whole frame contiguous:
+ *
+ *                      type 0: [HC]
+ *                      type 1: [HC][CompLen: 1 or 2 bytes][Mask][Data]
+ *                      type 2: [HC][Data]
+ *                      type 3: [HC][DataLen: 4 bytes][Data]
+ *
+ *                 usage:
+ *                      auto stPacket = SendPacket::Reserve(SM_ACTION, sizeof(SMAction));
+ *                      auto pSMA     = stPacket.As<SMAction>();
+ *
+ *                      pSMA->UID = ...;
+ *                      stPacket.Commit();
+ *
+ *                 for type 2/3 Data() points into the frame, fill it in place and no copy
+ *                 needed; for type 1 Data() is a scratch area and Commit() encodes it into
+ *                 the frame, that's the only pass over the data
+ *
+ *                 after Commit() the packet is immutable and reference counted, copy of a
+ *                 SendPacket only increases the count, so one packet can be enqueued to
+ *                 many sessions, buffer is released to g_MemoryPN by the last reference
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+class SendPacket final
+{
+    private:
+        // placed at the beginning of the buffer from g_MemoryPN
+        // frame follows the head, then the scratch area for type 1
+        struct PacketHead
+        {
+            std::atomic<int> RefCount;
+
+            uint8_t HC;
+            bool    Ready;
+
+            size_t DataLen;
+            size_t FrameLen;
+            size_t FrameCap;
+
+            PacketHead(uint8_t nHC, size_t nDataLen, size_t nFrameCap)
+                : RefCount(1)
+                , HC(nHC)
+                , Ready(false)
+                , DataLen(nDataLen)
+                , FrameLen(0)
+                , FrameCap(nFrameCap)
+            {}
+        };
+
+    private:
+        PacketHead *m_Head;
+
+    public:
+        SendPacket()
+            : m_Head(nullptr)
+        {}
+
+        SendPacket(const SendPacket &rstPacket)
+            : m_Head(rstPacket.m_Head)
+        {
+            if(m_Head){
+                m_Head->RefCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        SendPacket(SendPacket &&rstPacket)
+            : m_Head(rstPacket.m_Head)
+        {
+            rstPacket.m_Head = nullptr;
+        }
+
+        SendPacket &operator = (SendPacket stPacket)
+        {
+            std::swap(m_Head, stPacket.m_Head);
+            return *this;
+        }
+
+       ~SendPacket()
+        {
+            Release();
+        }
+
+    public:
+        // allocate a packet for message nHC with raw data size nDataLen
+        // return an empty packet if (nHC, nDataLen) doesn't match the message attribute
+        static SendPacket Reserve(uint8_t, size_t);
+
+        // Reserve() + copy + Commit()
+        // for callers which already have the data in a buffer
+        static SendPacket Build(uint8_t, const uint8_t *, size_t);
+
+    public:
+        // writable raw data area before Commit()
+        // return nullptr if the packet is empty, committed, or message has no data
+        uint8_t *Data();
+
+        size_t DataLen() const
+        {
+            return m_Head ? m_Head->DataLen : 0;
+        }
+
+        template<typename T> T *As()
+        {
+            return (sizeof(T) == DataLen()) ? (T *)(Data()) : nullptr;
+        }
+
+    public:
+        // finalize the frame, do encoding for type 1
+        // the packet is immutable after successful Commit()
+        bool Commit();
+
+    public:
+        bool Ready() const
+        {
+            return m_Head && m_Head->Ready;
+        }
+
+        uint8_t HC() const
+        {
+            return m_Head ? m_Head->HC : 0;
+        }
+
+        const uint8_t *Frame() const
+        {
+            return Ready() ? FrameBuf() : nullptr;
+        }
+
+        size_t FrameLen() const
+        {
+            return Ready() ? m_Head->FrameLen : 0;
+        }
+
+    private:
+        uint8_t *FrameBuf() const
+        {
+            return (uint8_t *)(m_Head) + sizeof(PacketHead);
+        }
+
+        uint8_t *ScratchBuf() const
+        {
+            return FrameBuf() + m_Head->FrameCap;
+        }
+
+    private:
+        void Release();
+};
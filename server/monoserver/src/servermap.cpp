@@ -18,8 +18,10 @@
  * =====================================================================================
  */
 
+#include <cstdlib>
 #include <algorithm>
 
+#include "player.hpp"
 #include "monster.hpp"
 #include "actorpod.hpp"
 #include "mathfunc.hpp"
@@ -29,125 +31,6 @@
 #include "monoserver.hpp"
 #include "serverconfigurewindow.hpp"
 
-ServerMap::ServerPathFinder::ServerPathFinder(ServerMap *pMap, bool bCheckCreature)
-    : AStarPathFinder(
-            // 1. step check function
-            //    assert pMap should be not null
-            [pMap](int nSrcX, int nSrcY, int nDstX, int nDstY) -> bool {
-                switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
-                    case 0:
-                        {
-                            extern MonoServer *g_MonoServer;
-                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid argument: (%d, %d, %d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                            g_MonoServer->Restart();
-                            return false;
-                        }
-                    case 1:
-                    case 2:
-                        {
-                            return pMap->GroundValid(nDstX, nDstY);
-                        }
-                    default:
-                        {
-                            return false;
-                        }
-                }
-            },
-
-            // 2. move cost function, for directions as following
-            //    
-            //                  0
-            //               7     1
-            //             6    x    2
-            //               5     3
-            //                  4
-            //    we put directions 1, 3, 5, 7 as higher cost because for following grids:
-            //
-            //              A B C D E
-            //              F G H I J
-            //              K L M N O
-            //              P Q R S T
-            //
-            //    if we make all directions equally cost, then G->I: G -> C -> I
-            //    we want the result as G -> H -> I
-            [pMap, bCheckCreature](int nSrcX, int nSrcY, int nDstX, int nDstY) -> double {
-                switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
-                    case 0:
-                        {
-                            extern MonoServer *g_MonoServer;
-                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid argument: (%d, %d, %d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                            g_MonoServer->Restart();
-                            return 10000.0;
-                        }
-                    case 1:
-                        {
-                            if(pMap->GroundValid(nDstX, nDstY)){
-                                if(bCheckCreature){
-                                    // if there is no co on the way we take it
-                                    // however if there is, we can still take it but with very high cost
-                                    // for example: now A is targeting at C
-                                    //    +---+---+---+---+---+
-                                    //    |   |   |   | C |   |
-                                    //    +---+---+---+---+---+
-                                    //    |   |   | B |   |   |
-                                    //    +---+---+---+---+---+
-                                    //    |   | A |   |   |   |
-                                    //    +---+---+---+---+---+
-                                    //    |   |   |   |   |   |
-                                    //    +---+---+---+---+---+
-                                    // then we try to find a path Loc(A) -> Loc(C)
-                                    // if 1. we always allow if GroundValid(LOC) is true : co ignored
-                                    //    2. we always allow if CanMove(LOC)     is true : co affects
-                                    //
-                                    // for solution-1: A will stop at current position since A try to move to LOC(B) but it's occupied
-                                    //     solution-2: LOC(A) -> LOC(C) is invalid since start and end point has been taken by themselves
-                                    //
-                                    // so my solution: 1. always allow if GroundValid(LOC) is true
-                                    //                 2. if currently there is CO in the cell we give a higher cost
-                                    // then A will bypass B to go to C and stop as close as possible to C
-                                    //
-                                    // this also saves if C is surrendered by a lot of CO's
-                                    // in which case solution-1 will make A stop at a far distance between C
-                                    //               solution-2 will make C un-reachable
-                                    //            my solution   will make A stop at a place as close as possible to C
-                                    return pMap->CanMove(nDstX, nDstY) ? 1.0 : 100.0;
-                                }else{
-                                    // won't check creature
-                                    // then all walk-able step get cost 1.0
-                                    return 1.0;
-                                }
-                            }else{
-                                // can't go through, return the infinite
-                                return 10000.0;
-                            }
-                        }
-                    case 2:
-                        {
-                            // same logic for case-1
-                            // but we put higher cost (1.1) to prefer go straight
-                            if(pMap->GroundValid(nDstX, nDstY)){
-                                if(bCheckCreature){
-                                    return pMap->CanMove(nDstX, nDstY) ? 1.1 : 100.1;
-                                }else{ return 1.1; }
-                            }else{
-                                return 10000.0;
-                            }
-                        }
-                    default:
-                        {
-                            return 10000.0;
-                        }
-                }
-            }
-      )
-{
-    if(!pMap){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid argument: ServerMap = %p, CheckCreature = %d", pMap, (int)(bCheckCreature));
-        g_MonoServer->Restart();
-    }
-}
-
 extern ServerConfigureWindow *g_ServerConfigureWindow;
 ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     : ActiveObject()
@@ -155,20 +38,39 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     , m_Mir2xMapData((std::string(g_ServerConfigureWindow->GetMapPath()) + SYS_MAPFILENAME(nMapID)).c_str())
     , m_Metronome(nullptr)
     , m_ServiceCore(pServiceCore)
-    , m_CellRecordV2D()
-    , m_UIDRecordV2D()
+    , m_CellRecordV((size_t)(W()) * H())
+    , m_UIDGrid(W(), H())
+    , m_PathSnapshot()
+    , m_OccupiedBits(W(), H())
+    , m_FreezedBits(W(), H())
+    , m_AOIGrid(W(), H(), SYS_MAPVISIBLEW, SYS_MAPVISIBLEH)
+    , m_TickV()
+    , m_TickIndex()
+    , m_MetronomeCount(0)
+    , m_EmptyTick(0)
+    , m_Unloaded(false)
 {
+    auto pPathSnapshot = std::make_shared<PathFindPN::Snapshot>(W(), H());
     if(m_Mir2xMapData.Valid()){
-        m_UIDRecordV2D.clear();
-
-        m_UIDRecordV2D.resize(m_Mir2xMapData.W());
-        for(auto &rstRecordLine: m_UIDRecordV2D){
-            rstRecordLine.resize(m_Mir2xMapData.H());
+        // decode ground bits once
+        // then GroundValid() is one bit test
+        for(int nX = 0; nX < W(); ++nX){
+            for(int nY = 0; nY < H(); ++nY){
+                pPathSnapshot->WalkMap.Set(nX, nY, true
+                        && (m_Mir2xMapData.Cell(nX, nY).Param & 0X80000000)
+                        && (m_Mir2xMapData.Cell(nX, nY).Param & 0X00800000));
+            }
         }
 
-        m_CellRecordV2D.resize(m_Mir2xMapData.W());
-        for(auto &rstStateLine: m_CellRecordV2D){
-            rstStateLine.resize(m_Mir2xMapData.H());
+        // build and save it if no cached graph or out of date
+        // failed to save only costs a rebuild for next time
+        auto szGraphPath = std::string(g_ServerConfigureWindow->GetMapPath()) + SYS_MAPFILENAME(nMapID) + ".hpa";
+        if(!pPathSnapshot->Graph.Load(szGraphPath.c_str())){
+            pPathSnapshot->Graph.Build();
+            if(!pPathSnapshot->Graph.Save(szGraphPath.c_str())){
+                extern MonoServer *g_MonoServer;
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Save portal graph failed: %s", szGraphPath.c_str());
+            }
         }
     }else{
         extern MonoServer *g_MonoServer;
@@ -176,11 +78,14 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
         g_MonoServer->Restart();
     }
 
+    // always valid, empty if failed to load
+    m_PathSnapshot = pPathSnapshot;
+
     for(auto stLoc: SYS_MAPSWITCHLOC(nMapID)){
         if(ValidC(stLoc.X, stLoc.Y)){
-            m_CellRecordV2D[stLoc.X][stLoc.Y].UID   = 0;
-            m_CellRecordV2D[stLoc.X][stLoc.Y].MapID = stLoc.MapID;
-            m_CellRecordV2D[stLoc.X][stLoc.Y].Query = QUERY_NA;
+            GetCellRecord(stLoc.X, stLoc.Y).UID   = 0;
+            GetCellRecord(stLoc.X, stLoc.Y).MapID = stLoc.MapID;
+            GetCellRecord(stLoc.X, stLoc.Y).Query = QUERY_NA;
         }
     }
 
@@ -193,6 +98,7 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ServerMap>();
 }
 
 void ServerMap::Operate(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -238,6 +144,11 @@ void ServerMap::Operate(const MessagePack &rstMPK, const Theron::Address &rstFro
                 On_MPK_METRONOME(rstMPK, rstFromAddr);
                 break;
             }
+        case MPK_IDLE:
+            {
+                On_MPK_IDLE(rstMPK, rstFromAddr);
+                break;
+            }
         case MPK_TRYSPACEMOVE:
             {
                 On_MPK_TRYSPACEMOVE(rstMPK, rstFromAddr);
@@ -253,6 +164,11 @@ void ServerMap::Operate(const MessagePack &rstMPK, const Theron::Address &rstFro
                 On_MPK_PULLCOINFO(rstMPK, rstFromAddr);
                 break;
             }
+        case MPK_UNLOADMAP:
+            {
+                On_MPK_UNLOADMAP(rstMPK, rstFromAddr);
+                break;
+            }
         default:
             {
                 extern MonoServer *g_MonoServer;
@@ -262,56 +178,192 @@ void ServerMap::Operate(const MessagePack &rstMPK, const Theron::Address &rstFro
     }
 }
 
-bool ServerMap::CanMove(int nX, int nY)
+void ServerMap::UpdateOccupied(int nX, int nY)
 {
-    if(GroundValid(nX, nY)){
-        for(auto nUID: m_UIDRecordV2D[nX][nY]){
-            extern MonoServer *g_MonoServer;
-            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                if(stUIDRecord.ClassFrom<CharObject>()){
-                    return false;
+    if(ValidC(nX, nY)){
+        // class flag is cached in m_AOIGrid
+        // no GetUIDRecord() here, dead objects are cleaned by the metronome
+        bool bOccupied = false;
+        m_UIDGrid.ForEach(nX, nY, [this, &bOccupied](uint32_t nUID)
+        {
+            if(auto pRecord = m_AOIGrid.Find(nUID)){
+                if(pRecord->Flag & AOIFLAG_CHAROBJECT){
+                    bOccupied = true;
                 }
             }
+        });
+        m_OccupiedBits.Set(nX, nY, bOccupied);
+    }
+}
+
+bool ServerMap::AddGridUID(uint32_t nUID, int nX, int nY)
+{
+    extern MonoServer *g_MonoServer;
+    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+        uint32_t nFlag = AOIFLAG_NONE;
+        if(stUIDRecord.ClassFrom<ActiveObject>()){ nFlag |= AOIFLAG_ACTIVE;     }
+        if(stUIDRecord.ClassFrom<CharObject  >()){ nFlag |= AOIFLAG_CHAROBJECT; }
+        if(stUIDRecord.ClassFrom<Player      >()){ nFlag |= AOIFLAG_PLAYER;     }
+        return AddGridUID(nUID, nX, nY, nFlag, stUIDRecord.Address);
+    }
+    return false;
+}
+
+bool ServerMap::AddGridUID(uint32_t nUID, int nX, int nY, uint32_t nFlag, const Theron::Address &rstAddress)
+{
+    if(nUID && ValidC(nX, nY)){
+        m_UIDGrid.Add(nX, nY, nUID);
+        m_AOIGrid.Add(nUID, nFlag, rstAddress, nX, nY);
+        UpdateOccupied(nX, nY);
+
+        // new objects are always awake
+        // monster reports MPK_IDLE if nothing to do
+        if(nFlag & AOIFLAG_ACTIVE){
+            Wake(nUID);
+        }
+
+        if(nFlag & AOIFLAG_PLAYER){
+            WakeViewer(nUID);
         }
         return true;
     }
     return false;
 }
 
-bool ServerMap::RandomLocation(int *pX, int *pY)
+bool ServerMap::RemoveGridUID(uint32_t nUID, int nX, int nY)
 {
-    for(int nX = 0; nX < W(); ++nX){
-        for(int nY = 0; nY < H(); ++nY){
-            if(CanMove(nX, nY)){
-                if(pX){ *pX = nX; }
-                if(pY){ *pY = nY; }
-                return true;
-            }
-        }
+    Sleep(nUID);
+    m_AOIGrid.Remove(nUID);
+    if(m_UIDGrid.Remove(nX, nY, nUID)){
+        UpdateOccupied(nX, nY);
+        return true;
     }
     return false;
 }
 
-bool ServerMap::Empty()
+bool ServerMap::Wake(uint32_t nUID)
 {
-    for(int nX = 0; nX < W(); ++nX){
-        for(int nY = 0; nY < H(); ++nY){
-            if(GroundValid(nX, nY)){
-                if(m_CellRecordV2D[nX][nY].Freezed){
-                    return false;
-                }
-                for(auto nUID: m_UIDRecordV2D[nX][nY]){
-                    extern MonoServer *g_MonoServer;
-                    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                        return false;
-                    }
-                }
-            }
+    if(m_TickIndex.find(nUID) != m_TickIndex.end()){
+        return true;
+    }
+
+    if(auto pRecord = m_AOIGrid.Find(nUID)){
+        if(pRecord->Flag & AOIFLAG_ACTIVE){
+            m_TickIndex[nUID] = m_TickV.size();
+            m_TickV.emplace_back(nUID, pRecord->Address);
+            return true;
         }
     }
+    return false;
+}
+
+bool ServerMap::Sleep(uint32_t nUID)
+{
+    auto pIndex = m_TickIndex.find(nUID);
+    if(pIndex == m_TickIndex.end()){
+        return false;
+    }
+
+    auto nIndex = pIndex->second;
+    m_TickIndex.erase(pIndex);
+
+    if(nIndex + 1 != m_TickV.size()){
+        m_TickV[nIndex] = m_TickV.back();
+        m_TickIndex[m_TickV[nIndex].UID] = nIndex;
+    }
+    m_TickV.pop_back();
     return true;
 }
 
+void ServerMap::WakeViewer(uint32_t nUID)
+{
+    m_AOIGrid.QueryViewer(nUID, [this](const AOIGrid::AOIRecord &rstRecord){
+        if(rstRecord.Flag & AOIFLAG_ACTIVE){
+            Wake(rstRecord.UID);
+        }
+    });
+}
+
+bool ServerMap::HasPlayerViewer(uint32_t nUID) const
+{
+    bool bFind = false;
+    m_AOIGrid.QueryViewer(nUID, [&bFind](const AOIGrid::AOIRecord &rstRecord){
+        if(rstRecord.Flag & AOIFLAG_PLAYER){
+            bFind = true;
+        }
+    });
+    return bFind;
+}
+
+// pick a cell uniformly from all free cells
+// free: ground valid, no char object, not freezed
+bool ServerMap::RandomLocation(int *pX, int *pY) const
+{
+    auto &rstGroundV   = m_PathSnapshot->WalkMap.Words();
+    auto &rstOccupiedV = m_OccupiedBits.Words();
+    auto &rstFreezedV  = m_FreezedBits.Words();
+
+    auto fnFreeBits = [&](size_t nIndex) -> uint64_t
+    {
+        return rstGroundV[nIndex] & ~(rstOccupiedV[nIndex] | rstFreezedV[nIndex]);
+    };
+
+    size_t nFreeCount = 0;
+    for(size_t nIndex = 0; nIndex < rstGroundV.size(); ++nIndex){
+        nFreeCount += (size_t)(BitGrid::PopCount(fnFreeBits(nIndex)));
+    }
+
+    if(!nFreeCount){
+        return false;
+    }
+
+    // select the nPick-th set bit
+    auto nPick = (size_t)(std::rand()) % nFreeCount;
+    for(size_t nIndex = 0; nIndex < rstGroundV.size(); ++nIndex){
+        auto nBits  = fnFreeBits(nIndex);
+        auto nCount = (size_t)(BitGrid::PopCount(nBits));
+
+        if(nPick >= nCount){
+            nPick -= nCount;
+            continue;
+        }
+
+        // clear the lowest set bit nPick times
+        for(; nPick > 0; --nPick){
+            nBits &= (nBits - 1);
+        }
+
+        auto nCell = nIndex * 64 + (size_t)(BitGrid::LowestBit(nBits));
+        if(pX){ *pX = (int)(nCell % W()); }
+        if(pY){ *pY = (int)(nCell / W()); }
+        return true;
+    }
+    return false;
+}
+
+ServerMap::~ServerMap()
+{
+    // stop ticks before the actor is gone
+    delete m_Metronome;
+}
+
+bool ServerMap::Empty() const
+{
+    // no object at all, and no cell reserved for coming objects
+    return m_UIDGrid.Empty() && m_FreezedBits.None();
+}
+
+size_t ServerMap::MemorySize() const
+{
+    return 0
+        + m_Mir2xMapData.PrivateSize()
+        + m_CellRecordV.size() * sizeof(m_CellRecordV[0])
+        + m_UIDGrid.MemorySize()
+        + m_PathSnapshot->WalkMap.Words().size() * sizeof(uint64_t)
+        + m_OccupiedBits.Words().size() * sizeof(uint64_t)
+        + m_FreezedBits.Words().size() * sizeof(uint64_t);
+}
+
 Theron::Address ServerMap::Activate()
 {
     auto stAddress = ActiveObject::Activate();
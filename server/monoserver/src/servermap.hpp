@@ -20,35 +20,25 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <cstdint>
 #include <unordered_map>
 
+#include "aoigrid.hpp"
 #include "sysconst.hpp"
+#include "uidgrid.hpp"
 #include "uidrecord.hpp"
 #include "metronome.hpp"
-#include "pathfinder.hpp"
 #include "mir2xmapdata.hpp"
+#include "bitgrid.hpp"
+#include "pathfindpn.hpp"
 #include "activeobject.hpp"
 
 class ServiceCore;
 class ServerObject;
 class ServerMap: public ActiveObject
 {
-    private:
-        // bind to servermap
-        // only for server map internal usage
-        class ServerPathFinder: public AStarPathFinder
-        {
-            public:
-                ServerPathFinder(ServerMap*, bool);
-               ~ServerPathFinder() = default;
-        };
-
-        // the server pathfinder will call CanMove() etc
-        // which I refuse to set as public since it's dynamically updated
-        friend class ServerPathFinder;
-
     private:
         enum QueryType: int
         {
@@ -61,7 +51,6 @@ class ServerMap: public ActiveObject
     private:
         struct CellRecord
         {
-            bool Freezed;
             uint32_t UID;
             uint32_t MapID;
 
@@ -71,17 +60,34 @@ class ServerMap: public ActiveObject
             int Query;
 
             CellRecord()
-                : Freezed(false)
-                , UID(0)
+                : UID(0)
                 , MapID(0)
                 , Query(QUERY_NA)
             {}
         };
 
     private:
-        template<typename T> using Vec2D = std::vector<std::vector<T>>;
+        // active object receiving MPK_METRONOME
+        // address is cached, no GetUIDRecord() for each tick
+        struct TickRecord
+        {
+            uint32_t UID;
+            Theron::Address Address;
+
+            TickRecord(uint32_t nUID = 0, const Theron::Address &rstAddress = Theron::Address::Null())
+                : UID(nUID)
+                , Address(rstAddress)
+            {}
+        };
+
+    private:
+        // sweep all cells every SWEEP_TICK metronomes
+        // to clean UID's of objects deleted without leaving the map
+        constexpr static uint32_t SWEEP_TICK = 10;
 
     private:
+        // const, then a flat map file stays mapped and shared by all maps
+        // with the same ID, never copied by non-const access
         const uint32_t     m_ID;
         const Mir2xMapData m_Mir2xMapData;
 
@@ -90,15 +96,52 @@ class ServerMap: public ActiveObject
         ServiceCore *m_ServiceCore;
 
     private:
-        Vec2D<CellRecord> m_CellRecordV2D;
-        Vec2D<std::vector<uint32_t>> m_UIDRecordV2D;
+        // both row-major with W() * H() cells, one allocation each
+        // cell (nX, nY) of m_CellRecordV is at (nY * W() + nX), use GetCellRecord()
+        std::vector<CellRecord> m_CellRecordV;
+        UIDGrid m_UIDGrid;
+
+    private:
+        // GroundValid() of all cells and portal graph on it, built once at load
+        // shared with PathFindPN workers, never changed after built
+        // portal graph is cached as map file + ".hpa"
+        std::shared_ptr<const PathFindPN::Snapshot> m_PathSnapshot;
+
+    private:
+        // dynamic cell layers, one bit per cell
+        // m_OccupiedBits: any char object in the cell, kept in sync with m_UIDGrid
+        // m_FreezedBits : cell reserved for a pending move or map switch
+        BitGrid m_OccupiedBits;
+        BitGrid m_FreezedBits;
+
+    private:
+        // area-of-interest index for broadcast
+        // m_UIDGrid is still used for cell occupancy
+        AOIGrid m_AOIGrid;
+
+    private:
+        // compact list of awake active objects
+        // idle monsters are removed by MPK_IDLE and put back when a player comes into view
+        // then tick cost depends on active objects rather than map population
+        std::vector<TickRecord> m_TickV;
+        std::unordered_map<uint32_t, size_t> m_TickIndex;
+        uint32_t m_MetronomeCount;
+
+    private:
+        // time tick when the map became empty, 0 if not empty
+        // reports MPK_MAPIDLE to service core after idle for configured time
+        uint32_t m_EmptyTick;
+
+        // set after agreed to MPK_UNLOADMAP
+        // then reject all requests bringing objects in, it's going to be deleted
+        bool m_Unloaded;
 
     private:
         void Operate(const MessagePack &, const Theron::Address &);
 
     public:
         ServerMap(ServiceCore *, uint32_t);
-       ~ServerMap() = default;
+       ~ServerMap();
 
     public:
         uint32_t ID() const { return m_ID; }
@@ -110,13 +153,11 @@ class ServerMap: public ActiveObject
         }
 
     public:
+        // one bit test, decoded from map data at load
+        // immutable, safe to call from other actors
         bool GroundValid(int nX, int nY) const
         {
-            return true
-                && (m_Mir2xMapData.Valid())
-                && (m_Mir2xMapData.ValidC(nX, nY))
-                && (m_Mir2xMapData.Cell(nX, nY).Param & 0X80000000)
-                && (m_Mir2xMapData.Cell(nX, nY).Param & 0X00800000);
+            return m_PathSnapshot->WalkMap.Walkable(nX, nY);
         }
 
     public:
@@ -129,20 +170,58 @@ class ServerMap: public ActiveObject
     public:
         Theron::Address Activate();
 
+    public:
+        // approximate, only counts per-cell arrays and map data
+        // map data mapped from a flat file is shared by maps of the same ID and
+        // backed by the file, it's excluded, otherwise totals count it repeatedly
+        size_t MemorySize() const;
+
     private:
         bool Load(const char *);
 
     private:
-        bool Empty();
-        bool CanMove(int, int);
-        bool RandomLocation(int *, int *);
+        bool Empty() const;
+        bool RandomLocation(int *, int *) const;
+
+    private:
+        CellRecord &GetCellRecord(int nX, int nY)
+        {
+            return m_CellRecordV[(size_t)(nY) * W() + nX];
+        }
+
+    private:
+        bool CanMove(int nX, int nY) const
+        {
+            return GroundValid(nX, nY) && !m_OccupiedBits.Get(nX, nY);
+        }
+
+    private:
+        // recompute bit of m_OccupiedBits after UIDs of cell (nX, nY) changed
+        void UpdateOccupied(int, int);
+
+    private:
+        // keep m_UIDGrid, m_OccupiedBits and m_AOIGrid in sync
+        // address and class flag are cached in AOIGrid when adding
+        bool AddGridUID(uint32_t, int, int);
+        bool AddGridUID(uint32_t, int, int, uint32_t, const Theron::Address &);
+        bool RemoveGridUID(uint32_t, int, int);
+
+    private:
+        // maintain m_TickV
+        // Wake() only accepts records with AOIFLAG_ACTIVE in m_AOIGrid
+        bool Wake(uint32_t);
+        bool Sleep(uint32_t);
+        void WakeViewer(uint32_t);
+        bool HasPlayerViewer(uint32_t) const;
 
     private:
         void On_MPK_ACTION(const MessagePack &, const Theron::Address &);
+        void On_MPK_IDLE(const MessagePack &, const Theron::Address &);
         void On_MPK_NOTICE(const MessagePack &, const Theron::Address &);
         void On_MPK_TRYMOVE(const MessagePack &, const Theron::Address &);
         void On_MPK_TRYLEAVE(const MessagePack &, const Theron::Address &);
         void On_MPK_PATHFIND(const MessagePack &, const Theron::Address &);
+        void On_MPK_UNLOADMAP(const MessagePack &, const Theron::Address &);
         void On_MPK_METRONOME(const MessagePack &, const Theron::Address &);
         void On_MPK_PULLCOINFO(const MessagePack &, const Theron::Address &);
         void On_MPK_BADACTORPOD(const MessagePack &, const Theron::Address &);
@@ -17,7 +17,10 @@
  *
  * =====================================================================================
  */
+#include <vector>
+#include <utility>
 #include <cinttypes>
+#include "netpod.hpp"
 #include "player.hpp"
 #include "monster.hpp"
 #include "mathfunc.hpp"
@@ -26,39 +29,97 @@
 #include "metronome.hpp"
 #include "servermap.hpp"
 #include "monoserver.hpp"
+#include "pathfindpn.hpp"
+#include "serverconfigurewindow.hpp"
 
 void ServerMap::On_MPK_METRONOME(const MessagePack &, const Theron::Address &)
 {
-    for(auto &rstRecordLine: m_UIDRecordV2D){
-        for(auto &rstRecordV: rstRecordLine){
-
-            // this part check all recorded UID and remove those invalid ones
-            // do it periodically in 1s, then for all rest logic we can skip the clean job
-
-            for(size_t nIndex = 0; nIndex < rstRecordV.size();){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(rstRecordV[nIndex])){
-                    if(stUIDRecord.ClassFrom<ActiveObject>()){
-                        if(m_ActorPod->Forward(MPK_METRONOME, stUIDRecord.Address)){
-                            nIndex++;
-                            continue;
-                        }else{
-                            std::swap(rstRecordV[nIndex], rstRecordV.back());
-                            rstRecordV.pop_back();
-                            continue;
-                        }
-                    }else{
-                        nIndex++;
-                        continue;
-                    }
-                }else{
-                    std::swap(rstRecordV[nIndex], rstRecordV.back());
-                    rstRecordV.pop_back();
+    // 1. deliver ticks to awake active objects only
+    //    walk the compact list with cached address, sleeping monsters cost nothing
+    for(size_t nIndex = 0; nIndex < m_TickV.size();){
+        if(m_ActorPod->Forward(MPK_METRONOME, m_TickV[nIndex].Address)){
+            nIndex++;
+            continue;
+        }
+
+        // actor is gone
+        // remove it from the grid, this also removes m_TickV[nIndex]
+        auto nUID = m_TickV[nIndex].UID;
+        if(auto pRecord = m_AOIGrid.Find(nUID)){
+            int nX = pRecord->X;
+            int nY = pRecord->Y;
+            RemoveGridUID(nUID, nX, nY);
+        }else{
+            Sleep(nUID);
+        }
+    }
+
+    // 2. check all recorded UID and remove those invalid ones
+    //    do it periodically, then for all rest logic we can skip the clean job
+    if(m_MetronomeCount++ % SWEEP_TICK){
+        return;
+    }
+
+    // row-major, same order as cells are stored
+    // skipped for empty map, no scan at all
+    if(!m_UIDGrid.Empty()){
+        for(int nY = 0; nY < H(); ++nY){
+            for(int nX = 0; nX < W(); ++nX){
+                if(!m_UIDGrid.Count(nX, nY)){
                     continue;
                 }
+
+                auto nRemoved = m_UIDGrid.RemoveIf(nX, nY, [this](uint32_t nUID) -> bool
+                {
+                    extern MonoServer *g_MonoServer;
+                    if(g_MonoServer->GetUIDRecord(nUID)){
+                        return false;
+                    }
+
+                    Sleep(nUID);
+                    m_AOIGrid.Remove(nUID);
+                    return true;
+                });
+
+                if(nRemoved){
+                    UpdateOccupied(nX, nY);
+                }
             }
         }
     }
+
+    // 3. check if the map is idle
+    //    service core decides to unload it or not, and it asks before unloading
+    extern MonoServer *g_MonoServer;
+    extern ServerConfigureWindow *g_ServerConfigureWindow;
+    if(Empty()){
+        if(!m_EmptyTick){
+            m_EmptyTick = std::max<uint32_t>(1, g_MonoServer->GetTimeTick());
+        }
+
+        auto nIdleTime = g_MonoServer->GetTimeTick() - m_EmptyTick;
+        auto nIdleMax  = (uint32_t)(g_ServerConfigureWindow->MapIdleTime()) * 1000;
+        if(nIdleMax && nIdleTime >= nIdleMax && !m_Unloaded){
+            AMMapIdle stAMMI;
+            stAMMI.MapID    = ID();
+            stAMMI.IdleTime = nIdleTime;
+            m_ActorPod->Forward({MPK_MAPIDLE, stAMMI}, m_ServiceCore->GetAddress());
+        }
+    }else{
+        m_EmptyTick = 0;
+    }
+}
+
+void ServerMap::On_MPK_IDLE(const MessagePack &rstMPK, const Theron::Address &)
+{
+    AMIdle stAMI;
+    std::memcpy(&stAMI, rstMPK.Data(), sizeof(stAMI));
+
+    // monster has no target
+    // keep ticking it if any player can see it, it may get one soon
+    if(!HasPlayerViewer(stAMI.UID)){
+        Sleep(stAMI.UID);
+    }
 }
 
 void ServerMap::On_MPK_BADACTORPOD(const MessagePack &, const Theron::Address &)
@@ -71,24 +132,56 @@ void ServerMap::On_MPK_ACTION(const MessagePack &rstMPK, const Theron::Address &
     std::memcpy(&stAMA, rstMPK.Data(), sizeof(stAMA));
 
     if(ValidC(stAMA.X, stAMA.Y)){
-        auto nX0 = std::max<int>(0,   (stAMA.X - SYS_MAPVISIBLEW));
-        auto nY0 = std::max<int>(0,   (stAMA.Y - SYS_MAPVISIBLEH));
-        auto nX1 = std::min<int>(W(), (stAMA.X + SYS_MAPVISIBLEW));
-        auto nY1 = std::min<int>(H(), (stAMA.Y + SYS_MAPVISIBLEH));
-
-        for(int nX = nX0; nX <= nX1; ++nX){
-            for(int nY = nY0; nY <= nY1; ++nY){
-                if(ValidC(nX, nY)){
-                    for(auto nUID: m_UIDRecordV2D[nX][nY]){
-                        if(nUID != stAMA.UID){
-                            extern MonoServer *g_MonoServer;
-                            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                                if(stUIDRecord.ClassFrom<CharObject>()){
-                                    m_ActorPod->Forward({MPK_ACTION, stAMA}, stUIDRecord.Address);
-                                }
-                            }
-                        }
-                    }
+        // players with a bound session get SM_ACTION directly
+        // the packet is encoded once and shared by all of them
+        // other char objects still get the actor message
+        std::vector<uint32_t> stSessionIDList;
+        auto fnForward = [this, &stAMA, &stSessionIDList](const AOIGrid::AOIRecord &rstRecord){
+            if(true
+                    && (rstRecord.UID != stAMA.UID)
+                    && (rstRecord.Flag & AOIFLAG_CHAROBJECT)){
+                if(rstRecord.SessionID){
+                    stSessionIDList.push_back(rstRecord.SessionID);
+                }else{
+                    m_ActorPod->Forward({MPK_ACTION, stAMA}, rstRecord.Address);
+                }
+            }
+        };
+
+        // if the action happens at the recorded location
+        // the viewer set is exactly the receiver list, no range query needed
+        //
+        // otherwise (i.e. ACTION_MOVE reports the starting point) do range query
+        // it only visits nearby buckets and uses the cached address
+        auto pRecord = m_AOIGrid.Find(stAMA.UID);
+        if(true
+                && pRecord
+                && pRecord->X == stAMA.X
+                && pRecord->Y == stAMA.Y){
+            m_AOIGrid.QueryViewer(stAMA.UID, fnForward);
+        }else{
+            m_AOIGrid.QueryRange(stAMA.X, stAMA.Y, fnForward);
+        }
+
+        if(!stSessionIDList.empty()){
+            auto stPacket = SendPacket::Reserve(SM_ACTION, sizeof(SMAction));
+            if(auto pSMA = stPacket.As<SMAction>()){
+                pSMA->UID   = stAMA.UID;
+                pSMA->MapID = stAMA.MapID;
+
+                pSMA->Action      = stAMA.Action;
+                pSMA->ActionParam = stAMA.ActionParam;
+                pSMA->Speed       = stAMA.Speed;
+                pSMA->Direction   = stAMA.Direction;
+
+                pSMA->X    = stAMA.X;
+                pSMA->Y    = stAMA.Y;
+                pSMA->EndX = stAMA.EndX;
+                pSMA->EndY = stAMA.EndY;
+
+                if(stPacket.Commit()){
+                    extern NetPodN *g_NetPodN;
+                    g_NetPodN->Multicast(stSessionIDList, stPacket);
                 }
             }
         }
@@ -101,26 +194,22 @@ void ServerMap::On_MPK_NOTICE(const MessagePack &rstMPK, const Theron::Address &
     std::memcpy(&stAMN, rstMPK.Data(), sizeof(stAMN));
 
     if(ValidC(stAMN.X, stAMN.Y)){
-        auto nX0 = std::max<int>(0,   (stAMN.X - SYS_MAPVISIBLEW));
-        auto nY0 = std::max<int>(0,   (stAMN.Y - SYS_MAPVISIBLEH));
-        auto nX1 = std::min<int>(W(), (stAMN.X + SYS_MAPVISIBLEW));
-        auto nY1 = std::min<int>(H(), (stAMN.Y + SYS_MAPVISIBLEH));
-
-        for(int nX = nX0; nX <= nX1; ++nX){
-            for(int nY = nY0; nY <= nY1; ++nY){
-                if(ValidC(nX, nY)){
-                    for(auto nUID: m_UIDRecordV2D[nX][nY]){
-                        if(nUID != stAMN.UID){
-                            extern MonoServer *g_MonoServer;
-                            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                                if(stUIDRecord.ClassFrom<CharObject>()){
-                                    m_ActorPod->Forward({MPK_ACTION, stAMN}, stUIDRecord.Address);
-                                }
-                            }
-                        }
-                    }
-                }
+        auto fnForward = [this, &stAMN](const AOIGrid::AOIRecord &rstRecord){
+            if(true
+                    && (rstRecord.UID != stAMN.UID)
+                    && (rstRecord.Flag & AOIFLAG_CHAROBJECT)){
+                m_ActorPod->Forward({MPK_ACTION, stAMN}, rstRecord.Address);
             }
+        };
+
+        auto pRecord = m_AOIGrid.Find(stAMN.UID);
+        if(true
+                && pRecord
+                && pRecord->X == stAMN.X
+                && pRecord->Y == stAMN.Y){
+            m_AOIGrid.QueryViewer(stAMN.UID, fnForward);
+        }else{
+            m_AOIGrid.QueryRange(stAMN.X, stAMN.Y, fnForward);
         }
     }
 }
@@ -136,12 +225,17 @@ void ServerMap::On_MPK_ADDCHAROBJECT(const MessagePack &rstMPK, const Theron::Ad
         g_MonoServer->Restart();
     }
 
+    if(m_Unloaded){
+        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+        return;
+    }
+
     if(!CanMove(stAMACO.Common.X, stAMACO.Common.Y)){
         m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
         return;
     }
 
-    if(m_CellRecordV2D[stAMACO.Common.X][stAMACO.Common.Y].Freezed){
+    if(m_FreezedBits.Get(stAMACO.Common.X, stAMACO.Common.Y)){
         m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
         return;
     }
@@ -162,7 +256,7 @@ void ServerMap::On_MPK_ADDCHAROBJECT(const MessagePack &rstMPK, const Theron::Ad
                 auto nY   = stAMACO.Common.Y;
 
                 pCO->Activate();
-                m_UIDRecordV2D[nX][nY].push_back(nUID);
+                AddGridUID(nUID, nX, nY, AOIFLAG_ACTIVE | AOIFLAG_CHAROBJECT, pCO->GetAddress());
                 m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
                 break;
             }
@@ -181,7 +275,8 @@ void ServerMap::On_MPK_ADDCHAROBJECT(const MessagePack &rstMPK, const Theron::Ad
                 auto nY   = stAMACO.Common.Y;
 
                 pCO->Activate();
-                m_UIDRecordV2D[nX][nY].push_back(nUID);
+                AddGridUID(nUID, nX, nY, AOIFLAG_ACTIVE | AOIFLAG_CHAROBJECT | AOIFLAG_PLAYER, pCO->GetAddress());
+                m_AOIGrid.BindSession(nUID, stAMACO.Player.SessionID);
                 m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
                 m_ActorPod->Forward({MPK_BINDSESSION, stAMACO.Player.SessionID}, pCO->GetAddress());
                 break;
@@ -223,20 +318,12 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
         return;
     }
 
-    if(m_CellRecordV2D[stAMTM.EndX][stAMTM.EndY].Freezed){
+    if(m_FreezedBits.Get(stAMTM.EndX, stAMTM.EndY)){
         m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
         return;
     }
 
-    bool bFindCO = false;
-    for(auto &nUID: m_UIDRecordV2D[stAMTM.X][stAMTM.Y]){
-        if(nUID == stAMTM.UID){
-            bFindCO = true;
-            break;
-        }
-    }
-
-    if(!bFindCO){
+    if(!m_UIDGrid.Has(stAMTM.X, stAMTM.Y, stAMTM.UID)){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_FATAL, "CharObject is not in current map: UID = %" PRIu32 , stAMTM.UID);
         m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
@@ -291,23 +378,9 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
 
                     // 1. leave last cell
                     {
-                        bool bFind = false;
-                        auto &rstRecordV = m_UIDRecordV2D[stAMTM.X][stAMTM.Y];
-
-                        for(auto &nUID: rstRecordV){
-                            if(nUID == stAMTM.UID){
-                                // 1. mark as find
-                                bFind = true;
-
-                                // 2. remove from the object list
-                                std::swap(nUID, rstRecordV.back());
-                                rstRecordV.pop_back();
-
-                                break;
-                            }
-                        }
-
-                        if(!bFind){
+                        if(m_UIDGrid.Remove(stAMTM.X, stAMTM.Y, stAMTM.UID)){
+                            UpdateOccupied(stAMTM.X, stAMTM.Y);
+                        }else{
                             extern MonoServer *g_MonoServer;
                             g_MonoServer->AddLog(LOGTYPE_FATAL, "CharObject is not in current map: UID = %" PRIu32 , stAMTM.UID);
                             g_MonoServer->Restart();
@@ -318,17 +391,42 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                     //    check if it should switch the map
                     extern MonoServer *g_MonoServer;
                     if(auto stRecord = g_MonoServer->GetUIDRecord(stAMTM.UID)){
-                        m_UIDRecordV2D[nMostX][nMostY].push_back(stRecord.UID);
+                        m_UIDGrid.Add(nMostX, nMostY, stRecord.UID);
+                        if(!m_AOIGrid.Move(stRecord.UID, nMostX, nMostY)){
+                            uint32_t nFlag = AOIFLAG_ACTIVE | AOIFLAG_CHAROBJECT;
+                            if(stRecord.ClassFrom<Player>()){
+                                nFlag |= AOIFLAG_PLAYER;
+                            }
+
+                            m_AOIGrid.Add(stRecord.UID, nFlag, stRecord.Address, nMostX, nMostY);
+                            Wake(stRecord.UID);
+                        }
+                        UpdateOccupied(nMostX, nMostY);
+
+                        // player moved, monsters come into its view should wake up
+                        if(stRecord.ClassFrom<Player>()){
+                            WakeViewer(stRecord.UID);
+                        }
                         if(true
                                 && stRecord.ClassFrom<Player>()
-                                && m_CellRecordV2D[nMostX][nMostY].MapID){
-                            if(m_CellRecordV2D[nMostX][nMostY].UID){
+                                && GetCellRecord(nMostX, nMostY).MapID){
+
+                            // target map could have been unloaded since its UID was cached
+                            // query again, service core loads it on demand
+                            if(true
+                                    && GetCellRecord(nMostX, nMostY).UID
+                                    && !g_MonoServer->GetUIDRecord(GetCellRecord(nMostX, nMostY).UID)){
+                                GetCellRecord(nMostX, nMostY).UID   = 0;
+                                GetCellRecord(nMostX, nMostY).Query = QUERY_NA;
+                            }
+
+                            if(GetCellRecord(nMostX, nMostY).UID){
                                 AMMapSwitch stAMMS;
-                                stAMMS.UID   = m_CellRecordV2D[nMostX][nMostY].UID;
-                                stAMMS.MapID = m_CellRecordV2D[nMostX][nMostY].MapID;
+                                stAMMS.UID   = GetCellRecord(nMostX, nMostY).UID;
+                                stAMMS.MapID = GetCellRecord(nMostX, nMostY).MapID;
                                 m_ActorPod->Forward({MPK_MAPSWITCH, stAMMS}, stRecord.Address);
                             }else{
-                                switch(m_CellRecordV2D[nMostX][nMostY].Query){
+                                switch(GetCellRecord(nMostX, nMostY).Query){
                                     case QUERY_NA:
                                         {
                                             auto fnOnResp = [this, nMostX, nMostY, stRecord](const MessagePack &rstMPK, const Theron::Address &){
@@ -339,13 +437,13 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                                                             std::memcpy(&stAMUID, rstMPK.Data(), sizeof(stAMUID));
 
                                                             if(stAMUID.UID){
-                                                                m_CellRecordV2D[nMostX][nMostY].UID   = stAMUID.UID;
-                                                                m_CellRecordV2D[nMostX][nMostY].Query = QUERY_OK;
+                                                                GetCellRecord(nMostX, nMostY).UID   = stAMUID.UID;
+                                                                GetCellRecord(nMostX, nMostY).Query = QUERY_OK;
 
                                                                 // then we do the map switch notification
                                                                 AMMapSwitch stAMMS;
-                                                                stAMMS.UID   = m_CellRecordV2D[nMostX][nMostY].UID;
-                                                                stAMMS.MapID = m_CellRecordV2D[nMostX][nMostY].MapID;
+                                                                stAMMS.UID   = GetCellRecord(nMostX, nMostY).UID;
+                                                                stAMMS.MapID = GetCellRecord(nMostX, nMostY).MapID;
                                                                 m_ActorPod->Forward({MPK_MAPSWITCH, stAMMS}, stRecord.Address);
                                                             }
 
@@ -353,17 +451,17 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                                                         }
                                                     default:
                                                         {
-                                                            m_CellRecordV2D[nMostX][nMostY].UID   = 0;
-                                                            m_CellRecordV2D[nMostX][nMostY].Query = QUERY_ERROR;
+                                                            GetCellRecord(nMostX, nMostY).UID   = 0;
+                                                            GetCellRecord(nMostX, nMostY).Query = QUERY_ERROR;
                                                             break;
                                                         }
                                                 }
                                             };
 
                                             AMQueryMapUID stAMQMUID;
-                                            stAMQMUID.MapID = m_CellRecordV2D[nMostX][nMostY].MapID;
+                                            stAMQMUID.MapID = GetCellRecord(nMostX, nMostY).MapID;
                                             m_ActorPod->Forward({MPK_QUERYMAPUID, stAMQMUID}, m_ServiceCore->GetAddress(), fnOnResp);
-                                            m_CellRecordV2D[nMostX][nMostY].Query = QUERY_PENDING;
+                                            GetCellRecord(nMostX, nMostY).Query = QUERY_PENDING;
                                         }
                                     case QUERY_PENDING:
                                     case QUERY_OK:
@@ -375,6 +473,11 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                                 }
                             }
                         }
+                    }else{
+                        // it's gone while moving, already out of m_UIDGrid
+                        // drop the rest of it, otherwise AOI queries still find it
+                        Sleep(stAMTM.UID);
+                        m_AOIGrid.Remove(stAMTM.UID);
                     }
                     break;
                 }
@@ -383,7 +486,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                     break;
                 }
         }
-        m_CellRecordV2D[nMostX][nMostY].Freezed = false;
+        m_FreezedBits.Set(nMostX, nMostY, false);
     };
 
     AMMoveOK stAMMOK;
@@ -394,7 +497,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
     stAMMOK.EndX  = nMostX;
     stAMMOK.EndY  = nMostY;
 
-    m_CellRecordV2D[nMostX][nMostY].Freezed = true;
+    m_FreezedBits.Set(nMostX, nMostY, true);
     m_ActorPod->Forward({MPK_MOVEOK, stAMMOK}, rstFromAddr, rstMPK.ID(), fnOnR);
 }
 
@@ -407,14 +510,9 @@ void ServerMap::On_MPK_TRYLEAVE(const MessagePack &rstMPK, const Theron::Address
             && stAMTL.UID
             && stAMTL.MapID
             && ValidC(stAMTL.X, stAMTL.Y)){
-        auto &rstRecordV = m_UIDRecordV2D[stAMTL.X][stAMTL.Y];
-        for(auto &nUID: rstRecordV){
-            if(nUID == stAMTL.UID){
-                std::swap(rstRecordV.back(), nUID);
-                rstRecordV.pop_back();
-                m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
-                return;
-            }
+        if(RemoveGridUID(stAMTL.UID, stAMTL.X, stAMTL.Y)){
+            m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
+            return;
         }
     }
 
@@ -429,16 +527,13 @@ void ServerMap::On_MPK_PULLCOINFO(const MessagePack &rstMPK, const Theron::Addre
     AMPullCOInfo stAMPCOI;
     std::memcpy(&stAMPCOI, rstMPK.Data(), sizeof(stAMPCOI));
 
-    for(auto &rstRecordLine: m_UIDRecordV2D){
-        for(auto &rstRecordV: rstRecordLine){
-            for(auto nUID: rstRecordV){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                    m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI.SessionID}, stUIDRecord.Address);
-                }
-            }
+    // use the cached address in AOIGrid
+    // stale records are cleaned by the metronome
+    m_AOIGrid.ForEach([this, &stAMPCOI](const AOIGrid::AOIRecord &rstRecord){
+        if(rstRecord.Flag & AOIFLAG_ACTIVE){
+            m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI.SessionID}, rstRecord.Address);
         }
-    }
+    });
 }
 
 void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -446,9 +541,11 @@ void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Add
     AMTryMapSwitch stAMTMS;
     std::memcpy(&stAMTMS, rstMPK.Data(), sizeof(stAMTMS));
 
+    // player could have cached the UID of this map
+    // don't let it in after agreed to unload
     int nX = -1;
     int nY = -1;
-    if(RandomLocation(&nX, &nY)){
+    if(!m_Unloaded && RandomLocation(&nX, &nY)){
         AMMapSwitchOK stAMMSOK;
         stAMMSOK.Data = this;
         stAMMSOK.X    = nX;
@@ -458,10 +555,8 @@ void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Add
             switch(rstRMPK.Type()){
                 case MPK_OK:
                     {
-                        extern MonoServer *g_MonoServer;
-                        if(auto stRecord = g_MonoServer->GetUIDRecord(stAMTMS.UID)){
-                            m_UIDRecordV2D[stAMMSOK.X][stAMMSOK.Y].push_back(stRecord.UID);
-                        }
+                        AddGridUID(stAMTMS.UID, stAMMSOK.X, stAMMSOK.Y);
+                        m_AOIGrid.BindSession(stAMTMS.UID, stAMTMS.SessionID);
                         // won't check map switch here
                         break;
                     }
@@ -470,9 +565,9 @@ void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Add
                         break;
                     }
             }
-            m_CellRecordV2D[stAMMSOK.X][stAMMSOK.Y].Freezed = false;
+            m_FreezedBits.Set(stAMMSOK.X, stAMMSOK.Y, false);
         };
-        m_CellRecordV2D[nX][nY].Freezed = true;
+        m_FreezedBits.Set(nX, nY, true);
         m_ActorPod->Forward({MPK_MAPSWITCHOK, stAMMSOK}, rstFromAddr, rstMPK.ID(), fnOnResp);
     }else{
         m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
@@ -484,64 +579,61 @@ void ServerMap::On_MPK_PATHFIND(const MessagePack &rstMPK, const Theron::Address
     AMPathFind stAMPF;
     std::memcpy(&stAMPF, rstMPK.Data(), sizeof(stAMPF));
 
-    int nX0 = stAMPF.X;
-    int nY0 = stAMPF.Y;
-    int nX1 = stAMPF.EndX;
-    int nY1 = stAMPF.EndY;
-
+    // 1. nearby request for the same goal just finished
+    //    reply directly without posting a task
+    extern PathFindPN *g_PathFindPN;
     AMPathFindOK stAMPFOK;
-    stAMPFOK.UID   = stAMPF.UID;
-    stAMPFOK.MapID = ID();
-
-    // we fill all slots with -1 for initialization
-    // won't keep a record of ``how many path nodes are valid"
-    auto nPathCount = (int)(sizeof(stAMPFOK.Point) / sizeof(stAMPFOK.Point[0]));
-    for(int nIndex = 0; nIndex < nPathCount; ++nIndex){
-        stAMPFOK.Point[nIndex].X = -1;
-        stAMPFOK.Point[nIndex].Y = -1;
+    if(g_PathFindPN->Query(ID(), stAMPF, &stAMPFOK)){
+        m_ActorPod->Forward({MPK_PATHFINDOK, stAMPFOK}, rstFromAddr, rstMPK.ID());
+        return;
     }
 
-    ServerPathFinder stPathFinder(this, stAMPF.CheckCO);
-    if(true
-            && stPathFinder.Search(nX0, nY0, nX1, nY1)
-            && stPathFinder.GetSolutionStart()){
-
-        int nCurrN = 0;
-        int nCurrX = nX0;
-        int nCurrY = nY0;
-
-        while(auto pNode1 = stPathFinder.GetSolutionNext()){
-            if(nCurrN >= nPathCount){ break; }
-            int nEndX = pNode1->X();
-            int nEndY = pNode1->Y();
-            switch(LDistance2(nCurrX, nCurrY, nEndX, nEndY)){
-                case 1:
-                case 2:
-                    {
-                        stAMPFOK.Point[nCurrN].X = nCurrX;
-                        stAMPFOK.Point[nCurrN].Y = nCurrY;
-
-                        nCurrN++;
-
-                        nCurrX = nEndX;
-                        nCurrY = nEndY;
-                        break;
-                    }
-                case 0:
-                default:
-                    {
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid path node");
-                        break;
-                    }
+    // 2. CheckCO: occupied cell is still allowed but costs much more
+    //    for example: now A is targeting at C
+    //       +---+---+---+---+---+
+    //       |   |   |   | C |   |
+    //       +---+---+---+---+---+
+    //       |   |   | B |   |   |
+    //       +---+---+---+---+---+
+    //       |   | A |   |   |   |
+    //       +---+---+---+---+---+
+    //    if B is refused then C is un-reachable since it takes its own cell, if B is
+    //    ignored then A stops when trying to move to B, with higher cost A bypasses B
+    //    and stops as close as possible to C
+    //
+    //    worker can't read m_UIDGrid, take char objects in the visible range of
+    //    the start, only the first few steps are sent and they are in this range
+    std::vector<int> stOccupiedV;
+    if(stAMPF.CheckCO){
+        m_AOIGrid.QueryRange(stAMPF.X, stAMPF.Y, [this, &stOccupiedV](const AOIGrid::AOIRecord &rstRecord)
+        {
+            if(rstRecord.Flag & AOIFLAG_CHAROBJECT){
+                stOccupiedV.push_back(rstRecord.Y * W() + rstRecord.X);
             }
-        }
+        });
+    }
 
-        // we filled all possible nodes to the message
-        m_ActorPod->Forward({MPK_PATHFINDOK, stAMPFOK}, rstFromAddr, rstMPK.ID());
-        return;
+    // 3. search in worker thread
+    //    it replies MPK_PATHFINDOK / MPK_ERROR to the requestor directly
+    if(!g_PathFindPN->Submit(m_PathSnapshot, std::move(stOccupiedV), ID(), stAMPF, rstFromAddr, rstMPK.ID())){
+        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
     }
+}
 
-    // failed to find a path
-    m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+void ServerMap::On_MPK_UNLOADMAP(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
+{
+    // messages sent by service core before this one are all handled
+    // if still empty no one is coming, agree and stop accepting new objects
+    if(Empty()){
+        m_Unloaded = true;
+        m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
+
+        // service core deletes *this* by EraseUID() in ThreadPN once it gets MPK_OK
+        // detach from the actor thread now, same as CharObject::GoDie()
+        //
+        // don't touch any member after this, *this* could be gone
+        Deactivate();
+    }else{
+        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+    }
 }
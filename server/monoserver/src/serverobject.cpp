@@ -25,6 +25,7 @@
 extern MonoServer *g_MonoServer;
 ServerObject::ServerObject()
     : m_UID(g_MonoServer->GetUID())
+    , m_ClassMask(0)
 {
     // 1. link to the mono object pool
     //    never allocate ServerObject on stack
@@ -43,6 +44,19 @@ ServerObject::ServerObject()
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ServerObject>();
+}
+
+int ServerObject::NextClassID()
+{
+    static std::atomic<int> s_ClassCount(0);
+    auto nClassID = s_ClassCount.fetch_add(1);
+
+    if(nClassID >= 64){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Too many classes for class mask: ClassID = %d", nClassID);
+    }
+    return nClassID;
 }
 
 static std::array<ServerObject::ClassEntryItem, 997> s_ClassEntryV;
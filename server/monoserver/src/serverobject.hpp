@@ -26,6 +26,7 @@
 #include <string>
 #include <cstdint>
 #include <cstddef>
+#include <type_traits>
 #include "uidrecord.hpp"
 
 class ServerObject
@@ -56,6 +57,11 @@ class ServerObject
     private:
         const uint32_t m_UID;
 
+    private:
+        // ancestor bitmask of the most derived class constructed so far
+        // it's read by other threads through the UID registry, so make it atomic
+        std::atomic<uint64_t> m_ClassMask;
+
     public:
         explicit ServerObject();
         virtual ~ServerObject() = default;
@@ -87,14 +93,29 @@ class ServerObject
         }
 
     public:
+        // dense class id, assigned at the first access of each class
+        // at most 64 classes supported since the ancestor set is kept in an uint64_t
+        template<typename T> static int ClassID()
+        {
+            static const int s_ClassID = NextClassID();
+            return s_ClassID;
+        }
+
+        template<typename T> static uint64_t ClassBit()
+        {
+            auto nClassID = ClassID<typename std::remove_cv<T>::type>();
+            return (nClassID >= 0 && nClassID < 64) ? (((uint64_t)(1)) << nClassID) : 0;
+        }
+
+    public:
+        uint64_t ClassMask() const
+        {
+            return m_ClassMask.load(std::memory_order_relaxed);
+        }
+
         template<typename T> bool ClassFrom() const
         {
-            for(const auto &rstCodeName: ClassEntry()){
-                if(true
-                        && rstCodeName.Name == typeid(T).name()
-                        && rstCodeName.Code == typeid(T).hash_code()){ return true; }
-            }
-            return false;
+            return ClassMask() & ClassBit<T>();
         }
 
     protected:
@@ -105,7 +126,10 @@ class ServerObject
             using RT = typename std::remove_cv<T>::type;
             if(std::is_same<RT, ServerObject>::value){
                 if(rstParentEntry.empty()){
-                    return RegisterClass(typeid(ServerObject).hash_code(), typeid(ServerObject).name(), {});
+                    if(RegisterClass(typeid(ServerObject).hash_code(), typeid(ServerObject).name(), {})){
+                        AncestorMask<ServerObject>().store(ClassBit<ServerObject>());
+                        return true;
+                    }
                 }
             }else{
                 if(true
@@ -122,15 +146,38 @@ class ServerObject
             using RU = typename std::remove_cv<U>::type;
             using RV = typename std::remove_cv<V>::type;
 
-            return true
-                && !std::is_same   <RU,           RV>::value
-                &&  std::is_base_of<ServerObject, RU>::value
-                &&  std::is_base_of<ServerObject, RV>::value
-                &&  std::is_base_of<RV,           RU>::value
-                &&  RegisterClass<RU>(ClassEntry(typeid(RV).hash_code()));
+            if(true
+                    && !std::is_same   <RU,           RV>::value
+                    &&  std::is_base_of<ServerObject, RU>::value
+                    &&  std::is_base_of<ServerObject, RV>::value
+                    &&  std::is_base_of<RV,           RU>::value
+                    &&  RegisterClass<RU>(ClassEntry(typeid(RV).hash_code()))){
+
+                // parent has been registered when constructing the base part
+                // ancestor mask of current class is parent's mask plus its own bit
+                AncestorMask<RU>().store(AncestorMask<RV>().load() | ClassBit<RU>());
+                return true;
+            }
+            return false;
+        }
+
+        // RegisterClass() is done by std::call_once() only once for each class
+        // but for each object we need to update its class mask in every constructor
+        template<typename T> void SetClassMask()
+        {
+            m_ClassMask.store(AncestorMask<typename std::remove_cv<T>::type>().load(), std::memory_order_relaxed);
         }
 
         // RegisterClass() is used in constructor only
         // and RegisterClass(*this) is ``using virtual function in constructor"
         template<typename T> bool RegisterClass(const T &rstT) = delete;
+
+    private:
+        static int NextClassID();
+
+        template<typename T> static std::atomic<uint64_t> &AncestorMask()
+        {
+            static std::atomic<uint64_t> s_AncestorMask {0};
+            return s_AncestorMask;
+        }
 };
@@ -3,7 +3,7 @@
  *
  *       Filename: servicecore.cpp
  *        Created: 04/22/2016 18:16:53
- *  Last Modified: 05/15/2017 14:01:50
+ *  Last Modified: 06/05/2017 16:37:19
  *
  *    Description: 
  *
@@ -18,18 +18,28 @@
  * =====================================================================================
  */
 
+#include <chrono>
 #include <cstring>
+#include <cinttypes>
 #include <system_error>
 
 #include "player.hpp"
+#include "sysconst.hpp"
+#include "threadpn.hpp"
 #include "actorpod.hpp"
 #include "metronome.hpp"
+#include "servermap.hpp"
 #include "monoserver.hpp"
+#include "syncdriver.hpp"
 #include "servicecore.hpp"
 
 ServiceCore::ServiceCore()
     : ActiveObject()
     , m_MapRecord()
+    , m_MapLoadCount(0)
+    , m_MapUnloadCount(0)
+    , m_MapLoadTime(0)
+    , m_MapMemorySize(0)
 {
     auto fnRegisterClass = [this]() -> void {
         if(!RegisterClass<ServiceCore, ActiveObject>()){
@@ -40,6 +50,7 @@ ServiceCore::ServiceCore()
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ServiceCore>();
 }
 
 void ServiceCore::Operate(const MessagePack &rstMPK, const Theron::Address &rstAddr)
@@ -85,6 +96,16 @@ void ServiceCore::Operate(const MessagePack &rstMPK, const Theron::Address &rstA
                 On_MPK_QUERYMAPUID(rstMPK, rstAddr);
                 break;
             }
+        case MPK_MAPLOADED:
+            {
+                On_MPK_MAPLOADED(rstMPK, rstAddr);
+                break;
+            }
+        case MPK_MAPIDLE:
+            {
+                On_MPK_MAPIDLE(rstMPK, rstAddr);
+                break;
+            }
         default:
             {
                 extern MonoServer *g_MonoServer;
@@ -110,31 +131,97 @@ void ServiceCore::OperateNet(uint32_t nSID, uint8_t nType, const uint8_t *pData,
     }
 }
 
-bool ServiceCore::LoadMap(uint32_t nMapID)
+void ServiceCore::LoadMap(uint32_t nMapID)
 {
-    if(nMapID){
-        if(m_MapRecord.find(nMapID) == m_MapRecord.end()){
-            auto pMap = new ServerMap(this, nMapID);
+    auto &rstRecord = m_MapRecord[nMapID];
+    rstRecord.State = MAP_LOADING;
+
+    // decoding map data and building path graph is slow, do it in ThreadPN
+    // pServiceCore is only kept by the map, never accessed in that thread
+    extern ThreadPN *g_ThreadPN;
+    auto bAdded = g_ThreadPN->Add([pServiceCore = this, stSCAddr = GetAddress(), nMapID](){
+        auto stStartTime = std::chrono::steady_clock::now();
+        auto pMap = new ServerMap(pServiceCore, nMapID);
+
+        // before Activate(), after that the map is driven by its actor
+        AMMapLoaded stAMML;
+        stAMML.MapID      = nMapID;
+        stAMML.Data       = pMap;
+        stAMML.MemorySize = (uint32_t)(pMap->MemorySize());
+        stAMML.LoadTime   = (uint32_t)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - stStartTime).count());
 
-            pMap->Activate();
-            m_MapRecord[nMapID] = pMap;
+        pMap->Activate();
+        if(SyncDriver().Forward({MPK_MAPLOADED, stAMML}, stSCAddr)){
+            extern MonoServer *g_MonoServer;
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Report loaded map failed: ID = %" PRIu32, nMapID);
         }
-        return true;
+    });
+
+    if(!bAdded){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Post map loading failed: ID = %" PRIu32, nMapID);
+
+        rstRecord.State = MAP_NONE;
+        OnMapReady(nMapID);
     }
-    return false;
 }
 
-const ServerMap *ServiceCore::RetrieveMap(uint32_t nMapID)
+void ServiceCore::OnMapReady(uint32_t nMapID)
 {
-    if(nMapID){
-        auto pMap = m_MapRecord.find(nMapID);
-        if(pMap == m_MapRecord.end()){
-            if(LoadMap(nMapID)){
-                pMap = m_MapRecord.find(nMapID);
-            }
+    auto pRecord = m_MapRecord.find(nMapID);
+    if(pRecord == m_MapRecord.end()){
+        return;
+    }
+
+    // callbacks may request maps again
+    // take them out before calling
+    auto stOnReadyV = std::move(pRecord->second.OnReadyV);
+    pRecord->second.OnReadyV.clear();
+
+    auto pMap = (pRecord->second.State == MAP_READY) ? pRecord->second.Map : nullptr;
+    if(pRecord->second.State == MAP_NONE){
+        m_MapRecord.erase(pRecord);
+    }
+
+    for(auto &fnOnReady: stOnReadyV){
+        if(fnOnReady){
+            fnOnReady(pMap);
+        }
+    }
+}
+
+void ServiceCore::RetrieveMap(uint32_t nMapID, const std::function<void(const ServerMap *)> &fnOnMap)
+{
+    if(!(nMapID && SYS_MAPFILENAME(nMapID))){
+        if(fnOnMap){
+            fnOnMap(nullptr);
         }
+        return;
+    }
 
-        return (pMap == m_MapRecord.end()) ? nullptr : pMap->second;
+    auto &rstRecord = m_MapRecord[nMapID];
+    switch(rstRecord.State){
+        case MAP_READY:
+            {
+                if(fnOnMap){
+                    fnOnMap(rstRecord.Map);
+                }
+                return;
+            }
+        case MAP_NONE:
+            {
+                rstRecord.OnReadyV.push_back(fnOnMap);
+                LoadMap(nMapID);
+                return;
+            }
+        case MAP_LOADING:
+        case MAP_UNLOADING:
+        default:
+            {
+                // unloading map won't be used
+                // it's loaded again if someone is waiting after it's gone
+                rstRecord.OnReadyV.push_back(fnOnMap);
+                return;
+            }
     }
-    return nullptr;
 }
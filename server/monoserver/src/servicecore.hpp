@@ -3,7 +3,7 @@
  *
  *       Filename: servicecore.hpp
  *        Created: 04/22/2016 17:59:06
- *  Last Modified: 05/03/2017 11:23:06
+ *  Last Modified: 06/05/2017 15:02:44
  *
  *    Description: split monoserver into actor-code and non-actor code
  *                 put all actor code in this class
@@ -13,6 +13,15 @@
  *                 invoke, never use [this, ...] since this will access the internal
  *                 state from another thread
  *
+ *                 maps are loaded on demand and unloaded when idle:
+ *                      1. first request of a map posts the loading to ThreadPN, the map
+ *                         is created and activated there, then MPK_MAPLOADED comes back
+ *                      2. requests during loading are kept and handled when it's done
+ *                      3. map reports MPK_MAPIDLE when it's been empty for a while, then
+ *                         service core asks it by MPK_UNLOADMAP, map agrees only if it's
+ *                         still empty, since messages forwarded before the ask are handled
+ *                         first, no object can be on the way to an unloaded map
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -26,6 +35,8 @@
 
 #pragma once
 #include <vector>
+#include <cstdint>
+#include <functional>
 #include <unordered_map>
 
 #include "netpod.hpp"
@@ -34,8 +45,42 @@
 class ServerMap;
 class ServiceCore: public ActiveObject
 {
+    private:
+        enum MapState: int
+        {
+            MAP_NONE,
+            MAP_LOADING,
+            MAP_READY,
+            MAP_UNLOADING,
+        };
+
+        struct MapRecord
+        {
+            int State;
+            ServerMap *Map;
+            size_t MemorySize;
+
+            // requests waiting for the map to be ready
+            // called with nullptr if failed
+            std::vector<std::function<void(const ServerMap *)>> OnReadyV;
+
+            MapRecord()
+                : State(MAP_NONE)
+                , Map(nullptr)
+                , MemorySize(0)
+                , OnReadyV()
+            {}
+        };
+
     protected:
-        std::unordered_map<uint32_t, ServerMap *> m_MapRecord;
+        std::unordered_map<uint32_t, MapRecord> m_MapRecord;
+
+    private:
+        // metrics of map lifecycle, reported in log
+        uint32_t m_MapLoadCount;
+        uint32_t m_MapUnloadCount;
+        uint64_t m_MapLoadTime;
+        size_t   m_MapMemorySize;
 
     public:
         ServiceCore();
@@ -46,11 +91,18 @@ class ServiceCore: public ActiveObject
         void OperateNet(uint32_t, uint8_t, const uint8_t *, size_t);
 
     protected:
-        bool LoadMap(uint32_t);
-        const ServerMap *RetrieveMap(uint32_t);
+        // call fnOnMap with the map once it's loaded
+        // immediately if it's ready, nullptr if invalid map ID
+        void RetrieveMap(uint32_t, const std::function<void(const ServerMap *)> &);
+
+    private:
+        void LoadMap(uint32_t);
+        void OnMapReady(uint32_t);
 
     private:
         void On_MPK_LOGIN(const MessagePack &, const Theron::Address &);
+        void On_MPK_MAPIDLE(const MessagePack &, const Theron::Address &);
+        void On_MPK_MAPLOADED(const MessagePack &, const Theron::Address &);
         void On_MPK_NETPACKAGE(const MessagePack &, const Theron::Address &);
         void On_MPK_QUERYMAPUID(const MessagePack &, const Theron::Address &);
         void On_MPK_TRYMAPSWITCH(const MessagePack &, const Theron::Address &);
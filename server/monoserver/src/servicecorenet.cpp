@@ -17,9 +17,13 @@
  *
  * =====================================================================================
  */
+#include <string>
+#include <cstring>
+#include <algorithm>
+
 #include "dbpod.hpp"
-#include "threadpn.hpp"
 #include "monoserver.hpp"
+#include "accountcache.hpp"
 #include "servicecore.hpp"
 
 void ServiceCore::Net_CM_Login(uint32_t nSessionID, uint8_t, const uint8_t *pData, size_t)
@@ -27,40 +31,80 @@ void ServiceCore::Net_CM_Login(uint32_t nSessionID, uint8_t, const uint8_t *pDat
     CMLogin stCML;
     std::memcpy(&stCML, pData, sizeof(stCML));
 
-    // don't block ServiceCore too much, so we put rest of it 
-    // in the thread pool since it's db query and slow
+    // make sure strings from client are terminated
+    // std::string for capture, lambda below is copied into DBPod
+    std::string szID(stCML.ID, std::find(stCML.ID, stCML.ID + sizeof(stCML.ID), '\0'));
+    std::string szPassword(stCML.Password, std::find(stCML.Password, stCML.Password + sizeof(stCML.Password), '\0'));
+
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_INFO, "Login requested: (%s:%s)", szID.c_str(), szPassword.c_str());
 
-    auto fnDBOperation = [nSessionID, stSCAddr = GetAddress(), stCML](){
-        extern DBPodN *g_DBPodN;
-        extern MonoServer *g_MonoServer;
+    auto fnMakeAMLQDB = [nSessionID](const AccountCache::AccountRecord &rstRecord)
+    {
+        AMLoginQueryDB stAMLQDB;
 
-        g_MonoServer->AddLog(LOGTYPE_INFO, "Login requested: (%s:%s)", stCML.ID, stCML.Password);
-        auto pDBHDR = g_DBPodN->CreateDBHDR();
+        // 1. session
+        stAMLQDB.SessionID = nSessionID;
 
-        if(!pDBHDR->Execute("select fld_id from tbl_account where fld_account = '%s' and fld_password = '%s'", stCML.ID, stCML.Password)){
-            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pDBHDR->ErrorID(), pDBHDR->ErrorInfo());
+        // 2. needed information to create co
+        stAMLQDB.DBID  = rstRecord.GUID;
+        stAMLQDB.MapID = rstRecord.MapID;
+        stAMLQDB.MapX  = rstRecord.MapX;
+        stAMLQDB.MapY  = rstRecord.MapY;
+
+        // 3. additional information, we can retrieve it later
+        stAMLQDB.Level     = rstRecord.Level;
+        stAMLQDB.JobID     = rstRecord.JobID;
+        stAMLQDB.Direction = rstRecord.Direction;
+        return stAMLQDB;
+    };
+
+    // relogin and reconnect, no database access
+    extern AccountCache *g_AccountCache;
+    AccountCache::AccountRecord stRecord;
+    if(g_AccountCache->Get(szID.c_str(), szPassword.c_str(), &stRecord)){
+        m_ActorPod->Forward({MPK_LOGINQUERYDB, fnMakeAMLQDB(stRecord)}, GetAddress());
+        return;
+    }
+
+    // don't block ServiceCore too much, so we submit it to DBPod
+    // it returns immediately and result comes back as a message
+    //
+    // statements are prepared once per connection, account and password are bound as
+    // parameters, no formatting and quoting of user input
+    auto fnDBOperation = [nSessionID, stSCAddr = GetAddress(), szID, szPassword, fnMakeAMLQDB](DBConnection *pConn){
+        auto pAccount = pConn->Prepare("select fld_id from tbl_account where fld_account = ? and fld_password = ?");
+        if(!(true
+                    && pAccount
+                    && pAccount->Bind(0, szID.c_str())
+                    && pAccount->Bind(1, szPassword.c_str())
+                    && pAccount->Execute())){
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pAccount ? pAccount->ErrorID() : pConn->ErrorID(), pAccount ? pAccount->ErrorInfo() : pConn->ErrorInfo());
             SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
-        if(pDBHDR->RowCount() < 1){
-            g_MonoServer->AddLog(LOGTYPE_INFO, "can't find account: (%s:%s)", stCML.ID, stCML.Password);
+        if(pAccount->RowCount() < 1 || !pAccount->Fetch()){
+            g_MonoServer->AddLog(LOGTYPE_INFO, "can't find account: (%s:%s)", szID.c_str(), szPassword.c_str());
             SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
-        pDBHDR->Fetch();
-        // you can put another lambda here and put it in g_TaskHub
-        // but doesn't make sense since this function is already slow
-        int nID = std::atoi(pDBHDR->Get("fld_id"));
-        if(!pDBHDR->Execute("select * from mir2x.tbl_guid where fld_id = %d", nID)){
-            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pDBHDR->ErrorID(), pDBHDR->ErrorInfo());
+        AccountCache::AccountRecord stRecord;
+        stRecord.ID = (uint32_t)(pAccount->GetInt(0));
+
+        auto pGUID = pConn->Prepare("select * from mir2x.tbl_guid where fld_id = ?");
+        if(!(true
+                    && pGUID
+                    && pGUID->Bind(0, (int64_t)(stRecord.ID))
+                    && pGUID->Execute())){
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pGUID ? pGUID->ErrorID() : pConn->ErrorID(), pGUID ? pGUID->ErrorInfo() : pConn->ErrorInfo());
             SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
-        if(pDBHDR->RowCount() < 1){
-            g_MonoServer->AddLog(LOGTYPE_INFO, "no guid created for this account: (%s:%s)", stCML.ID, stCML.Password);
+        if(pGUID->RowCount() < 1 || !pGUID->Fetch()){
+            g_MonoServer->AddLog(LOGTYPE_INFO, "no guid created for this account: (%s:%s)", szID.c_str(), szPassword.c_str());
             SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
@@ -71,27 +115,26 @@ void ServiceCore::Net_CM_Login(uint32_t nSessionID, uint8_t, const uint8_t *pDat
         // fld_guid  -> everything of this char object
 
         // ok now we find the record coresponding to the id
-        AMLoginQueryDB stAMLQDB;
-
-        // 1. session
-        stAMLQDB.SessionID = nSessionID;
-
-        pDBHDR->Fetch();
-
-        // 2. needed information to create co
-        stAMLQDB.DBID  = std::atoi(pDBHDR->Get("fld_guid"));
-        stAMLQDB.MapID = std::atoi(pDBHDR->Get("fld_mapid"));
-        stAMLQDB.MapX  = std::atoi(pDBHDR->Get("fld_mapx"));
-        stAMLQDB.MapY  = std::atoi(pDBHDR->Get("fld_mapy"));
-
-        // 3. additional information, we can retrieve it later
-        stAMLQDB.Level     = std::atoi(pDBHDR->Get("fld_level"));
-        stAMLQDB.JobID     = std::atoi(pDBHDR->Get("fld_jobid"));
-        stAMLQDB.Direction = std::atoi(pDBHDR->Get("fld_direction"));
-
-        SyncDriver().Forward({MPK_LOGINQUERYDB, stAMLQDB}, stSCAddr);
+        stRecord.GUID      = (uint32_t)(pGUID->GetInt(pGUID->Column("fld_guid")));
+        stRecord.MapID     = (uint32_t)(pGUID->GetInt(pGUID->Column("fld_mapid")));
+        stRecord.MapX      = (int)(pGUID->GetInt(pGUID->Column("fld_mapx")));
+        stRecord.MapY      = (int)(pGUID->GetInt(pGUID->Column("fld_mapy")));
+        stRecord.Level     = (int)(pGUID->GetInt(pGUID->Column("fld_level")));
+        stRecord.JobID     = (int)(pGUID->GetInt(pGUID->Column("fld_jobid")));
+        stRecord.Direction = (int)(pGUID->GetInt(pGUID->Column("fld_direction")));
+
+        extern AccountCache *g_AccountCache;
+        g_AccountCache->Put(szID.c_str(), szPassword.c_str(), stRecord);
+
+        SyncDriver().Forward({MPK_LOGINQUERYDB, fnMakeAMLQDB(stRecord)}, stSCAddr);
     };
 
-    extern ThreadPN *g_ThreadPN;
-    g_ThreadPN->Add(fnDBOperation);
+    extern DBPodN *g_DBPodN;
+    if(!g_DBPodN->Submit(fnDBOperation)){
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "DBPod is not running, login failed: SessionID = %d", (int)(nSessionID));
+
+        // no result will come back, tell the client now
+        extern NetPodN *g_NetPodN;
+        g_NetPodN->Send(nSessionID, SM_LOGINFAIL, [nSessionID](){ g_NetPodN->Shutdown(nSessionID); });
+    }
 }
@@ -3,7 +3,7 @@
  *
  *       Filename: servicecoreop.cpp
  *        Created: 05/03/2016 21:29:58
- *  Last Modified: 05/04/2017 11:48:53
+ *  Last Modified: 06/05/2017 17:10:28
  *
  *    Description: 
  *
@@ -18,10 +18,14 @@
  * =====================================================================================
  */
 #include <string>
+#include <algorithm>
+#include <cinttypes>
 
 #include "player.hpp"
 #include "memorypn.hpp"
 #include "actorpod.hpp"
+#include "threadpn.hpp"
+#include "servermap.hpp"
 #include "monoserver.hpp"
 #include "servicecore.hpp"
 
@@ -58,19 +62,20 @@ void ServiceCore::On_MPK_ADDCHAROBJECT(const MessagePack &rstMPK, const Theron::
     AMAddCharObject stAMACO;
     std::memcpy(&stAMACO, rstMPK.Data(), sizeof(stAMACO));
 
-    if(stAMACO.Common.MapID){
-        auto pMap = RetrieveMap(stAMACO.Common.MapID);
+    // map may still be loading
+    // then this is done after MPK_MAPLOADED
+    RetrieveMap(stAMACO.Common.MapID, [this, stAMACO, nRespondID = rstMPK.ID(), rstFromAddr](const ServerMap *pMap){
         if(pMap && pMap->In(stAMACO.Common.MapID, stAMACO.Common.X, stAMACO.Common.Y)){
-            auto fnOP = [this, stAMACO, rstMPK, rstFromAddr](const MessagePack &rstRMPK, const Theron::Address &){
+            auto fnOP = [this, nRespondID, rstFromAddr](const MessagePack &rstRMPK, const Theron::Address &){
                 switch(rstRMPK.Type()){
                     case MPK_OK:
                         {
-                            m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
+                            m_ActorPod->Forward(MPK_OK, rstFromAddr, nRespondID);
                             break;
                         }
                     default:
                         {
-                            m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+                            m_ActorPod->Forward(MPK_ERROR, rstFromAddr, nRespondID);
                             break;
                         }
                 }
@@ -78,10 +83,10 @@ void ServiceCore::On_MPK_ADDCHAROBJECT(const MessagePack &rstMPK, const Theron::
             m_ActorPod->Forward({MPK_ADDCHAROBJECT, stAMACO}, pMap->GetAddress(), fnOP);
             return;
         }
-    }
 
-    // invalid map id, report error
-    m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+        // invalid map id, report error
+        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, nRespondID);
+    });
 }
 
 // don't try to find its sender, it's from a temp SyncDriver in the lambda
@@ -99,23 +104,8 @@ void ServiceCore::On_MPK_LOGINQUERYDB(const MessagePack &rstMPK, const Theron::A
         g_NetPodN->Send(stAMLQDB.SessionID, SM_LOGINFAIL, [nSID = stAMLQDB.SessionID](){g_NetPodN->Shutdown(nSID);});
     };
 
-    if(stAMLQDB.MapID){
-        auto pMap = m_MapRecord.find(stAMLQDB.MapID);
-        if(pMap == m_MapRecord.end()){
-            if(!LoadMap(stAMLQDB.MapID)){
-                fnOnBadDBRecord();
-                return;
-            }
-            pMap = m_MapRecord.find(stAMLQDB.MapID);
-        }
-
-        if((pMap == m_MapRecord.end()) || (pMap->second == nullptr) || (pMap->second->ID() != stAMLQDB.MapID)){
-            extern MonoServer *g_MonoServer;
-            g_MonoServer->AddLog(LOGTYPE_FATAL, "internal logic error");
-            g_MonoServer->Restart();
-        }
-
-        if(pMap->second->In(stAMLQDB.MapID, stAMLQDB.MapX, stAMLQDB.MapY)){
+    RetrieveMap(stAMLQDB.MapID, [this, stAMLQDB, fnOnBadDBRecord](const ServerMap *pMap){
+        if(pMap && pMap->In(stAMLQDB.MapID, stAMLQDB.MapX, stAMLQDB.MapY)){
             AMAddCharObject stAMACO;
             stAMACO.Type = TYPE_PLAYER;
             stAMACO.Common.MapID     = stAMLQDB.MapID;
@@ -127,7 +117,7 @@ void ServiceCore::On_MPK_LOGINQUERYDB(const MessagePack &rstMPK, const Theron::A
             stAMACO.Player.Direction = stAMLQDB.Direction;
             stAMACO.Player.SessionID = stAMLQDB.SessionID;
 
-            auto fnOnR = [this, stAMACO, fnOnBadDBRecord, pMap](const MessagePack &rstRMPK, const Theron::Address &){
+            auto fnOnR = [fnOnBadDBRecord](const MessagePack &rstRMPK, const Theron::Address &){
                 switch(rstRMPK.Type()){
                     case MPK_OK:
                         {
@@ -141,12 +131,12 @@ void ServiceCore::On_MPK_LOGINQUERYDB(const MessagePack &rstMPK, const Theron::A
                 }
             };
 
-            m_ActorPod->Forward({MPK_ADDCHAROBJECT, stAMACO}, pMap->second->GetAddress(), fnOnR);
+            m_ActorPod->Forward({MPK_ADDCHAROBJECT, stAMACO}, pMap->GetAddress(), fnOnR);
             return;
         }
-    }
 
-    fnOnBadDBRecord();
+        fnOnBadDBRecord();
+    });
 }
 
 void ServiceCore::On_MPK_QUERYMONSTERGINFO(const MessagePack &rstMPK, const Theron::Address &)
@@ -178,10 +168,12 @@ void ServiceCore::On_MPK_QUERYMAPLIST(const MessagePack &rstMPK, const Theron::A
     std::memset(&stAMML, 0, sizeof(stAMML));
 
     size_t nIndex = 0;
-    for(auto pMap: m_MapRecord){
-        if(pMap.second && pMap.second->ID()){
+    // only loaded maps
+    for(auto &rstRecord: m_MapRecord){
+        auto pMap = (rstRecord.second.State == MAP_READY) ? rstRecord.second.Map : nullptr;
+        if(pMap && pMap->ID()){
             if(nIndex < (sizeof(stAMML.MapList) / sizeof(stAMML.MapList[0]))){
-                stAMML.MapList[nIndex++] = pMap.second->ID();
+                stAMML.MapList[nIndex++] = pMap->ID();
             }else{
                 extern MonoServer *g_MonoServer;
                 g_MonoServer->AddLog(LOGTYPE_FATAL, "Need larger map list size in AMMapList");
@@ -197,11 +189,11 @@ void ServiceCore::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::A
     AMTryMapSwitch stAMTMS;
     std::memcpy(&stAMTMS, rstMPK.Data(), sizeof(stAMTMS));
 
-    if(stAMTMS.MapID){
-        if(auto pMap = RetrieveMap(stAMTMS.MapID)){
+    RetrieveMap(stAMTMS.MapID, [this, stAMTMS](const ServerMap *pMap){
+        if(pMap){
             m_ActorPod->Forward({MPK_TRYMAPSWITCH, stAMTMS}, pMap->GetAddress());
         }
-    }
+    });
 }
 
 void ServiceCore::On_MPK_QUERYMAPUID(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -209,11 +201,114 @@ void ServiceCore::On_MPK_QUERYMAPUID(const MessagePack &rstMPK, const Theron::Ad
     AMQueryMapUID stAMQMUID;
     std::memcpy(&stAMQMUID, rstMPK.Data(), sizeof(stAMQMUID));
 
-    if(auto pMap = RetrieveMap(stAMQMUID.MapID)){
-        AMUID stAMUID;
-        stAMUID.UID = pMap->UID();
-        m_ActorPod->Forward({MPK_UID, stAMUID}, rstFromAddr, rstMPK.ID());
-    }else{
-        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+    // requested by the map switch point, target map is loaded here
+    RetrieveMap(stAMQMUID.MapID, [this, nRespondID = rstMPK.ID(), rstFromAddr](const ServerMap *pMap){
+        if(pMap){
+            AMUID stAMUID;
+            stAMUID.UID = pMap->UID();
+            m_ActorPod->Forward({MPK_UID, stAMUID}, rstFromAddr, nRespondID);
+        }else{
+            m_ActorPod->Forward(MPK_ERROR, rstFromAddr, nRespondID);
+        }
+    });
+}
+
+void ServiceCore::On_MPK_MAPLOADED(const MessagePack &rstMPK, const Theron::Address &)
+{
+    AMMapLoaded stAMML;
+    std::memcpy(&stAMML, rstMPK.Data(), sizeof(stAMML));
+
+    auto pRecord = m_MapRecord.find(stAMML.MapID);
+    if(false
+            || !stAMML.Data
+            || pRecord == m_MapRecord.end()
+            || pRecord->second.State != MAP_LOADING){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_FATAL, "Unexpected map loaded: ID = %" PRIu32, stAMML.MapID);
+        g_MonoServer->Restart();
+        return;
     }
+
+    pRecord->second.State      = MAP_READY;
+    pRecord->second.Map        = (ServerMap *)(stAMML.Data);
+    pRecord->second.MemorySize = stAMML.MemorySize;
+
+    m_MapLoadCount++;
+    m_MapLoadTime   += stAMML.LoadTime;
+    m_MapMemorySize += stAMML.MemorySize;
+
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_INFO, "Map loaded: ID = %" PRIu32 ", Time = %" PRIu32 "ms, Memory = %" PRIu32 "KB; Loaded = %zu, Memory = %zuKB, Average load time = %" PRIu64 "ms",
+            stAMML.MapID, stAMML.LoadTime, stAMML.MemorySize / 1024, (size_t)(m_MapLoadCount - m_MapUnloadCount), m_MapMemorySize / 1024, m_MapLoadTime / m_MapLoadCount);
+
+    OnMapReady(stAMML.MapID);
+}
+
+void ServiceCore::On_MPK_MAPIDLE(const MessagePack &rstMPK, const Theron::Address &)
+{
+    AMMapIdle stAMMI;
+    std::memcpy(&stAMMI, rstMPK.Data(), sizeof(stAMMI));
+
+    // map reports this periodically while it's idle
+    // ignore if we are already asking it, or someone is waiting for it
+    auto pRecord = m_MapRecord.find(stAMMI.MapID);
+    if(false
+            || pRecord == m_MapRecord.end()
+            || pRecord->second.State != MAP_READY
+            || pRecord->second.Map == nullptr
+            || !pRecord->second.OnReadyV.empty()){
+        return;
+    }
+
+    auto fnOnR = [this, stAMMI](const MessagePack &rstRMPK, const Theron::Address &){
+        auto pRecord = m_MapRecord.find(stAMMI.MapID);
+        if(pRecord == m_MapRecord.end() || pRecord->second.State != MAP_UNLOADING){
+            extern MonoServer *g_MonoServer;
+            g_MonoServer->AddLog(LOGTYPE_FATAL, "Unexpected map unloading state: ID = %" PRIu32, stAMMI.MapID);
+            g_MonoServer->Restart();
+            return;
+        }
+
+        switch(rstRMPK.Type()){
+            case MPK_OK:
+                {
+                    // map agreed and won't accept anything
+                    // delete it in ThreadPN, same as char objects
+                    extern ThreadPN *g_ThreadPN;
+                    g_ThreadPN->Add([nUID = pRecord->second.Map->UID()](){
+                        extern MonoServer *g_MonoServer;
+                        g_MonoServer->EraseUID(nUID);
+                    });
+
+                    m_MapUnloadCount++;
+                    m_MapMemorySize -= std::min<size_t>(m_MapMemorySize, pRecord->second.MemorySize);
+
+                    pRecord->second.State      = MAP_NONE;
+                    pRecord->second.Map        = nullptr;
+                    pRecord->second.MemorySize = 0;
+
+                    extern MonoServer *g_MonoServer;
+                    g_MonoServer->AddLog(LOGTYPE_INFO, "Map unloaded: ID = %" PRIu32 ", Idle = %" PRIu32 "s; Loaded = %zu, Memory = %zuKB, Unloaded = %" PRIu32,
+                            stAMMI.MapID, stAMMI.IdleTime / 1000, (size_t)(m_MapLoadCount - m_MapUnloadCount), m_MapMemorySize / 1024, m_MapUnloadCount);
+
+                    // requested during unloading, load it again
+                    if(pRecord->second.OnReadyV.empty()){
+                        m_MapRecord.erase(pRecord);
+                    }else{
+                        LoadMap(stAMMI.MapID);
+                    }
+                    break;
+                }
+            default:
+                {
+                    // someone came in after it reported idle
+                    pRecord->second.State = MAP_READY;
+                    OnMapReady(stAMMI.MapID);
+                    break;
+                }
+        }
+    };
+
+    pRecord->second.State = MAP_UNLOADING;
+    m_ActorPod->Forward(MPK_UNLOADMAP, pRecord->second.Map->GetAddress(), fnOnR);
 }
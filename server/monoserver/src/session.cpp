@@ -23,83 +23,6 @@
 #include "compress.hpp"
 #include "monoserver.hpp"
 
-Session::SendTask::SendTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnOnDone)
-    : HC(nHC)
-    , Data(pData)
-    , DataLen(nDataLen)
-    , OnDone(std::move(fnOnDone))
-{
-    auto fnReportAndExit = [this](){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid server message: (%d, %p, %d)", (int)(HC), Data, (int)(DataLen));
-        g_MonoServer->Restart();
-    };
-
-    SMSGParam stSMSG(HC);
-    switch(stSMSG.Type()){
-        case 0:
-            {
-                // empty message, shouldn't contain anything
-                if(Data || DataLen){ fnReportAndExit(); return; }
-                break;
-            }
-        case 1:
-            {
-                // not empty, fixed size and compressed
-                // data stream structure: [DataLen, Mask, Data]
-                int nSizeLen = 0;
-                int nCompLen = 0;
-                int nMaskCnt = 0;
-
-                if(Data[0] == 255){
-                    nSizeLen = 2;
-                    nCompLen = 255 + (int)(Data[1]);
-                    nMaskCnt = Compress::CountMask(Data + 2, stSMSG.MaskLen());
-                }else{
-                    nSizeLen = 1;
-                    nCompLen = (int)(Data[0]);
-                    nMaskCnt = Compress::CountMask(Data + 1, stSMSG.MaskLen());
-                }
-
-                if(false
-                        || (nMaskCnt < 0)
-                        || (nCompLen != nMaskCnt)
-                        || (DataLen != ((size_t)(nSizeLen) + stSMSG.MaskLen() + (size_t)(nCompLen)))){
-                    fnReportAndExit();
-                    return;
-                }
-                break;
-            }
-        case 2:
-            {
-                // not empty, fixed size and not compressed
-                if(!(Data && (DataLen == stSMSG.DataLen()))){ fnReportAndExit(); return; }
-                break;
-            }
-        case 3:
-            {
-                // not empty, not fixed size and not compressed
-                if(!(Data && (DataLen >= 4))){
-                    fnReportAndExit();
-                    return;
-                }else{
-                    uint32_t nDataLenU32 = 0;
-                    std::memcpy(&nDataLenU32, Data, 4);
-                    if(((size_t)(nDataLenU32) + 4) != DataLen){
-                        fnReportAndExit();
-                        return;
-                    }
-                }
-                break;
-            }
-        default:
-            {
-                fnReportAndExit();
-                break;
-            }
-    }
-}
-
 Session::Session(uint32_t nSessionID, asio::ip::tcp::socket stSocket)
     : SyncDriver()
     , m_ID(nSessionID)
@@ -116,7 +39,10 @@ Session::Session(uint32_t nSessionID, asio::ip::tcp::socket stSocket)
     , m_SendQBuf1()
     , m_CurrSendQ(&(m_SendQBuf0))
     , m_NextSendQ(&(m_SendQBuf1))
-    , m_MemoryPN()
+    , m_SendBufV()
+    , m_SendByteCount(0)
+    , m_SendPackageCount(0)
+    , m_SendWriteCount(0)
 {}
 
 Session::~Session()
@@ -446,52 +372,26 @@ bool Session::DoReadBody(size_t nMaskLen, size_t nBodyLen)
     return true;
 }
 
-void Session::DoSendNext()
+void Session::DoSendNext(size_t nCount)
 {
     assert(m_FlushFlag);
-    assert(!m_CurrSendQ->empty());
+    assert(m_CurrSendQ->size() >= nCount);
 
-    if(m_CurrSendQ->front().OnDone){
-        m_CurrSendQ->front().OnDone();
-    }
+    // invoke callbacks in the order of Send()
+    // all messages in this batch have been written to the socket
+    for(size_t nIndex = 0; nIndex < nCount; ++nIndex){
+        if(m_CurrSendQ->front().OnDone){
+            m_CurrSendQ->front().OnDone();
+        }
 
-    if(m_CurrSendQ->front().Data && m_CurrSendQ->front().DataLen){
-        m_MemoryPN.Free(const_cast<uint8_t *>(m_CurrSendQ->front().Data));
+        // release the reference of the packet
+        // buffer is freed if no other session holds it
+        m_CurrSendQ->pop_front();
     }
-
-    m_CurrSendQ->pop();
-    DoSendHC();
+    DoSendV();
 }
 
-void Session::DoSendBuf()
-{
-    assert(m_FlushFlag);
-    assert(!m_CurrSendQ->empty());
-    if(m_CurrSendQ->front().Data && m_CurrSendQ->front().DataLen){
-        auto fnDoneSend = [this](std::error_code stEC, size_t){
-            if(stEC){
-                // 1. shutdown current connection
-                Shutdown();
-
-                // 2. report message and abort current process
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_FATAL, "Network error: %s", stEC.message().c_str());
-                g_MonoServer->Restart();
-                return;
-            }else{
-                // don't do buffer release and callback invocation here
-                // we put it in DoSendNext()
-                DoSendNext();
-            }
-        };
-
-        // the Data field should contains all needed size info
-        // when call Session::Send() it should be compressed if necessary and put it there
-        asio::async_write(m_Socket, asio::buffer(m_CurrSendQ->front().Data, m_CurrSendQ->front().DataLen), fnDoneSend);
-    }else{ DoSendNext(); }
-}
-
-void Session::DoSendHC()
+void Session::DoSendV()
 {
     // when we are here
     // we should already have m_FlushFlag set as true
@@ -499,7 +399,7 @@ void Session::DoSendHC()
 
     // we check m_CurrSendQ and if it empty we swap with the pending queue
     // we move this swap thing to the handler in FlushSendQ()
-    // means we only handle m_CurrSendQ in DoSendHC()
+    // means we only handle m_CurrSendQ in DoSendV()
     // but which means after we done m_CurrSendQ we have to wait next FlushSendQ() to drive the send
     if(m_CurrSendQ->empty()){
         std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
@@ -510,13 +410,31 @@ void Session::DoSendHC()
             return;
         }else{
             // else we still need to access m_CurrSendQ 
-            // keep m_FlushFlag to pervent other thread to call DoSendHC()
+            // keep m_FlushFlag to pervent other thread to call DoSendV()
             std::swap(m_CurrSendQ, m_NextSendQ);
         }
     }
 
     assert(!m_CurrSendQ->empty());
-    auto fnDoSendBuf = [this](std::error_code stEC, size_t){
+
+    // gather frames of pending messages into one buffer sequence
+    // m_CurrSendQ won't change before the write completes, so the buffers stay valid
+    size_t nCount     = 0;
+    size_t nByteCount = 0;
+
+    m_SendBufV.clear();
+    for(auto &rstTask: *m_CurrSendQ){
+        if(nCount >= SEND_BATCH_MAX){
+            break;
+        }
+
+        m_SendBufV.emplace_back(rstTask.Packet.Frame(), rstTask.Packet.FrameLen());
+
+        nCount     += 1;
+        nByteCount += rstTask.Packet.FrameLen();
+    }
+
+    auto fnDoneSend = [this, nCount, nByteCount](std::error_code stEC, size_t){
         if(stEC){
             // 1. shutdown current connection
             Shutdown();
@@ -526,9 +444,17 @@ void Session::DoSendHC()
             g_MonoServer->AddLog(LOGTYPE_FATAL, "Network error: %s", stEC.message().c_str());
             g_MonoServer->Restart();
             return;
-        }else{ DoSendBuf(); }
+        }else{
+            m_SendByteCount.fetch_add(nByteCount);
+            m_SendPackageCount.fetch_add(nCount);
+            m_SendWriteCount.fetch_add(1);
+
+            // don't do buffer release and callback invocation here
+            // we put it in DoSendNext()
+            DoSendNext(nCount);
+        }
     };
-    asio::async_write(m_Socket, asio::buffer(&(m_CurrSendQ->front().HC), 1), fnDoSendBuf);
+    asio::async_write(m_Socket, m_SendBufV, fnDoneSend);
 }
 
 bool Session::FlushSendQ()
@@ -541,14 +467,13 @@ bool Session::FlushSendQ()
         // but we need lock for m_NextSendQ, in child threads, in asio main loop
         //
         // but we need to make sure there is only one procedure in asio main loop accessing m_CurrSendQ
-        // because packages in m_CurrSendQ are divided into  two parts: HC / Data 
-        // one package only get erased after Data is sent
-        // then  multiple procesdure in asio main loop may send HC / Data more than one time
+        // because packages in m_CurrSendQ are gathered into one write and only get erased after it's done
+        // then  multiple procesdure in asio main loop may send one package more than one time
         if(!m_FlushFlag){
             //  mark as current some one is accessing it
             //  we don't even need to make m_FlushFlag atomic since it's in one thread
             m_FlushFlag = true;
-            DoSendHC();
+            DoSendV();
         }
     };
 
@@ -562,139 +487,20 @@ bool Session::FlushSendQ()
     return true;
 }
 
-bool Session::Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
+bool Session::Send(const SendPacket &rstPacket, std::function<void()> &&fnDone)
 {
-    uint8_t *pEncodeData = nullptr;
-    size_t   nEncodeSize = 0;
-
-    auto fnReportError = [nHC, pData, nDataLen](){
+    if(!rstPacket.Ready()){
         extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid message: (%d, %p, %d)", (int)(nHC), pData, (int)(nDataLen));
-    };
-
-    SMSGParam stSMSG(nHC);
-    switch(stSMSG.Type()){
-        case 0:
-            {
-                if(pData || nDataLen){ fnReportError(); return false; }
-                break;
-            }
-        case 1:
-            {
-                // not empty, fixed size, comperssed
-                if(!(pData && (nDataLen == stSMSG.DataLen()))){ fnReportError(); return false; }
-
-                // do compression, two solutions
-                //    1. we can allocate a buffer of size DataLen + (DataLen + 7) / 8
-                //    2. we can count data before compression to know buffer size we needed
-                // currently I'm using the second method, which helps to avoid re-allocate buffer if compressed size > 254
-
-                // length encoding:
-                // [0 - 254]          : length in 0 ~ 254
-                // [    255][0 ~ 255] : length as 0 ~ 255 + 255
-                //
-                // 1. most likely we are using 0 ~ 254
-                // 2. if compressed length more than 254 we need to bytes
-                // 3. we support range in [0, 255 + 255]
-
-                auto nCountData = Compress::CountData(pData, nDataLen);
-                if(nCountData < 0){
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Count data failed: HC = %d, Data = %p, DataLen = %d", (int)(nHC), pData, (int)(nDataLen));
-                    return false;
-                }else if(nCountData <= 254){
-                    // we need only one byte for length info
-                    pEncodeData = (uint8_t *)(m_MemoryPN.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 1));
-                    if(Compress::Encode(pEncodeData + 1, pData, nDataLen) != nCountData){
-                        // 1. keep a record for the failure
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Compress failed: HC = %d, Data = %p, DataLen = %d", (int)(nHC), pData, (int)(nDataLen));
-
-                        // free memory allocated and return immediately
-                        m_MemoryPN.Free(pEncodeData);
-                        return false;
-                    }
-
-                    pEncodeData[0] = (uint8_t)(nCountData);
-                    nEncodeSize    = 1 + stSMSG.MaskLen() + (size_t)(nCountData);
-                }else if(nCountData <= (255 + 255)){
-                    // we need two byte for length info
-                    pEncodeData = (uint8_t *)(m_MemoryPN.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 2));
-                    if(!Compress::Encode(pEncodeData + 2, pData, nDataLen)){
-                        // 1. keep a record for the failure
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Compress failed: HC = %d, Data = %p, DataLen = %d", (int)(nHC), pData, (int)(nDataLen));
-
-                        // free memory allocated and return immediately
-                        m_MemoryPN.Free(pEncodeData);
-                        return false;
-                    }
-
-                    pEncodeData[0] = 255;
-                    pEncodeData[1] = (uint8_t)(nCountData - 255);
-                    nEncodeSize    = 2 + stSMSG.MaskLen() + (size_t)(nCountData);
-                }else{
-                    // compressed message is tooo long
-                    // should use another mode to send this message type
-
-                    // 1. keep a record for the failure
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Compressed data too long: HC = %d, Data = %p, DataLen = %d", (int)(nHC), pData, (int)(nDataLen));
-
-                    // free memory allocated and return immediately
-                    m_MemoryPN.Free(pEncodeData);
-                    return false;
-                }
-                break;
-            }
-        case 2:
-            {
-                // not empty, fixed size, not compressed
-                if(!(pData && (nDataLen == stSMSG.DataLen()))){ fnReportError(); return false; }
-
-                pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen));
-                nEncodeSize = stSMSG.DataLen();
-
-                // for fixed size and uncompressed message
-                // we don't need to send the length info since it's public known
-                std::memcpy(pEncodeData, pData, nDataLen);
-                break;
-            }
-        case 3:
-            {
-                // not empty, not fixed size, not compressed
-                if(pData){
-                    if((nDataLen == 0) || (nDataLen > 0XFFFFFFFF)){ fnReportError(); return false; }
-                }else{
-                    if(nDataLen){ fnReportError(); return false; }
-                }
-
-                pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen + 4));
-                nEncodeSize = nDataLen + 4;
-
-                // 1. setup the message length encoding
-                {
-                    auto nDataLenU32 = (uint32_t)(nDataLen);
-                    std::memcpy(pEncodeData, &nDataLenU32, sizeof(nDataLenU32));
-                }
-
-                // 2. copy data if there is
-                if(pData){ std::memcpy(pEncodeData + 4, pData, nDataLen); }
-                break;
-            }
-        default:
-            {
-                fnReportError();
-                return false;
-            }
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Send packet not committed: HC = %d", (int)(rstPacket.HC()));
+        return false;
     }
 
     // ready to send
     {
         std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
-        m_NextSendQ->emplace(nHC, pEncodeData, nEncodeSize, std::move(fnDone));
+        m_NextSendQ->emplace_back(rstPacket, std::move(fnDone));
     }
 
-    // 3. notify asio main loop
+    // notify asio main loop
     return FlushSendQ();
 }
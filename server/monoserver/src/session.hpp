@@ -3,7 +3,7 @@
  *
  *       Filename: session.hpp
  *        Created: 09/03/2015 03:48:41 AM
- *  Last Modified: 04/27/2017 15:09:17
+ *  Last Modified: 05/22/2017 19:52:08
  *
  *    Description: actor <-> session <--- network ---> client
  *                 1. each session binds to an actor
@@ -12,7 +12,11 @@
  *                 requirements:
  *                 1. session only sends fully received messages to actors
  *                 2. AMNetPackage contains a buffer allocated by g_MemoryPN to actors
- *                 3. use internal memory pool for send messages
+ *                 3. send messages are pre-framed SendPacket's, built by Reserve() and
+ *                    Commit(), see sendpacket.hpp, session only holds a reference so
+ *                    one packet can be enqueued to many sessions without copy
+ *                 4. pending messages are gathered into one async_write as a buffer
+ *                    sequence, at most SEND_BATCH_MAX messages per write
  *
  *        Version: 1.0
  *       Revision: none
@@ -25,8 +29,9 @@
  * =====================================================================================
  */
 #pragma once
-#include <queue>
+#include <deque>
 #include <tuple>
+#include <vector>
 #include <mutex>
 #include <atomic>
 #include <cstdint>
@@ -34,26 +39,31 @@
 #include <functional>
 #include <Theron/Theron.h>
 
+#include "sendpacket.hpp"
 #include "syncdriver.hpp"
-#include "memorychunkpn.hpp"
 
 class Session final: public SyncDriver
 {
     private:
         struct SendTask
         {
-            uint8_t HC;
-
-            const uint8_t *Data;
-            size_t         DataLen;
+            // committed frame: [HC, Length, Data]
+            // shared by all sessions it's enqueued to
+            SendPacket Packet;
 
             std::function<void()> OnDone;
 
-            // there are argument check when constructing SendTask
-            // so put the implementation of the constructor in session.cpp
-            SendTask(uint8_t, const uint8_t *, size_t, std::function<void()> &&);
+            SendTask(const SendPacket &rstPacket, std::function<void()> &&fnOnDone)
+                : Packet(rstPacket)
+                , OnDone(std::move(fnOnDone))
+            {}
         };
 
+    private:
+        // max messages gathered into one async_write
+        // asio splits the buffer sequence internally if it exceeds the iov limit
+        constexpr static size_t SEND_BATCH_MAX = 256;
+
     private:
         const uint32_t m_ID;
 
@@ -79,16 +89,22 @@ class Session final: public SyncDriver
         std::mutex m_NextQLock;
 
     private:
-        std::queue<SendTask>  m_SendQBuf0;
-        std::queue<SendTask>  m_SendQBuf1;
-        std::queue<SendTask> *m_CurrSendQ;
-        std::queue<SendTask> *m_NextSendQ;
+        std::deque<SendTask>  m_SendQBuf0;
+        std::deque<SendTask>  m_SendQBuf1;
+        std::deque<SendTask> *m_CurrSendQ;
+        std::deque<SendTask> *m_NextSendQ;
 
     private:
-        // used for internal pending message storage
-        // support multi-thread since external thread call Send which refers to it
-        // then every session have an internal memory pool, too many?
-        MemoryChunkPN<64, 256, 2> m_MemoryPN;
+        // gathered buffer sequence for one async_write, one frame per message
+        // only accessed in asio main loop, reused to avoid allocation
+        std::vector<asio::const_buffer> m_SendBufV;
+
+    private:
+        // statistics of the send path
+        // m_SendWriteCount counts async_write calls, compare it with m_SendPackageCount
+        std::atomic<uint64_t> m_SendByteCount;
+        std::atomic<uint64_t> m_SendPackageCount;
+        std::atomic<uint64_t> m_SendWriteCount;
 
     public:
         Session(uint32_t, asio::ip::tcp::socket);
@@ -96,10 +112,13 @@ class Session final: public SyncDriver
 
     public:
         // family of send facilities
-        // Session class accepts buffer and make a copy of it internally
+        // Session class accepts buffer and make a copy of it internally as a SendPacket
         // Session class will do compression if needed based on message header code
+        //
+        // callers can also build a SendPacket by Reserve() / Commit() and send it
+        // this avoids the copy and the packet can be shared by many sessions
 
-        // send with a r-ref callback, this is the base of all send function
+        // send a committed packet with a r-ref callback, this is the base of all send function
         // current implementation is based on double-queue method
         // one queue (Q1) is used for store new packages in parallel
         // the other (Q2) queue is used to send all packages in ASIO main loop
@@ -108,9 +127,27 @@ class Session final: public SyncDriver
         // but for Q2 since it's only used in ASIO main loop, we don't need to protect it
         //
         // idea from: https://stackoverflow.com/questions/4029448/thread-safety-for-stl-queue
-       bool Send(uint8_t nHC, const uint8_t *pData, size_t nLen, std::function<void()> &&fnDone);
+        bool Send(const SendPacket &, std::function<void()> &&);
+
+    public:
+        bool Send(const SendPacket &rstPacket)
+        {
+            return Send(rstPacket, std::function<void()>());
+        }
+
+        bool Send(const SendPacket &rstPacket, const std::function<void()> &fnDone)
+        {
+            return Send(rstPacket, std::function<void()>(fnDone));
+        }
 
     public:
+        // send with a r-ref callback
+        bool Send(uint8_t nHC, const uint8_t *pData, size_t nLen, std::function<void()> &&fnDone)
+        {
+            auto stPacket = SendPacket::Build(nHC, pData, nLen);
+            return stPacket.Ready() && Send(stPacket, std::move(fnDone));
+        }
+
         // send with a const-ref callback
         bool Send(uint8_t nHC, const uint8_t *pData, size_t nLen, const std::function<void()> &fnDone)
         {
@@ -159,9 +196,8 @@ class Session final: public SyncDriver
         bool DoReadBody(size_t, size_t);
 
     private:
-        void DoSendHC();
-        void DoSendBuf();
-        void DoSendNext();
+        void DoSendV();
+        void DoSendNext(size_t);
 
     private:
         bool FlushSendQ();
@@ -199,6 +235,22 @@ class Session final: public SyncDriver
             return m_Delay;
         }
 
+    public:
+        uint64_t SendByteCount() const
+        {
+            return m_SendByteCount.load();
+        }
+
+        uint64_t SendPackageCount() const
+        {
+            return m_SendPackageCount.load();
+        }
+
+        uint64_t SendWriteCount() const
+        {
+            return m_SendWriteCount.load();
+        }
+
     public:
         const char *IP()
         {
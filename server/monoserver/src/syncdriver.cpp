@@ -29,16 +29,16 @@
 // return value:
 //      0. no error
 //      1. send failed
-int SyncDriver::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr)
+int SyncDriver::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr, uint32_t nRespond)
 {
     extern ServerEnv *g_ServerEnv;
     if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
         extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_INFO, "(Driver: 0X%0*" PRIXPTR ", Name: SyncDriver, UID: NA) -> (Type: %s, ID: 0, Resp: 0)",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), MessagePack(rstMB.Type()).Name());
+        g_MonoServer->AddLog(LOGTYPE_INFO, "(Driver: 0X%0*" PRIXPTR ", Name: SyncDriver, UID: NA) -> (Type: %s, ID: 0, Resp: %u)",
+                (int)(sizeof(this) * 2), (uintptr_t)(this), MessagePack(rstMB.Type()).Name(), nRespond);
     }
     extern Theron::Framework *g_Framework;
-    return g_Framework->Send<MessagePack>({rstMB, 0, 0}, m_Receiver.GetAddress(), rstAddr) ? 0 : 1;
+    return g_Framework->Send<MessagePack>({rstMB, 0, nRespond}, m_Receiver.GetAddress(), rstAddr) ? 0 : 1;
 }
 
 // send with expection of response message. this function firstly clear all cached
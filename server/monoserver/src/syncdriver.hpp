@@ -38,6 +38,13 @@ class SyncDriver
         virtual ~SyncDriver() = default;
 
     public:
-        int Forward(const MessageBuf &, const Theron::Address &);
+        int Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr)
+        {
+            return Forward(rstMB, rstAddr, (uint32_t)(0));
+        }
+
+        // send as response to message nRespond, without waiting
+        // for threads other than actors to reply, i.e. path finding workers
+        int Forward(const MessageBuf &, const Theron::Address &, uint32_t);
         int Forward(const MessageBuf &, const Theron::Address &, MessagePack *);
 };
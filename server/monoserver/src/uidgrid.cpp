@@ -0,0 +1,123 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidgrid.cpp
+ *        Created: 06/03/2017 10:51:06
+ *  Last Modified: 06/05/2017 10:45:37
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include "uidgrid.hpp"
+
+constexpr uint32_t UIDGrid::INLINE_COUNT;
+
+bool UIDGrid::Add(int nX, int nY, uint32_t nUID)
+{
+    if(!(nUID && ValidC(nX, nY))){
+        return false;
+    }
+
+    auto &rstSlot = m_SlotV[(size_t)(nY) * m_W + nX];
+    m_Count++;
+    if(rstSlot.Count < INLINE_COUNT){
+        rstSlot.UID[rstSlot.Count++] = nUID;
+        return true;
+    }
+
+    if(!rstSlot.Overflow){
+        if(m_FreeOverflowV.empty()){
+            m_OverflowV.emplace_back();
+            rstSlot.Overflow = (uint32_t)(m_OverflowV.size());
+        }else{
+            rstSlot.Overflow = m_FreeOverflowV.back();
+            m_FreeOverflowV.pop_back();
+        }
+    }
+
+    m_OverflowV[rstSlot.Overflow - 1].push_back(nUID);
+    rstSlot.Count++;
+    return true;
+}
+
+bool UIDGrid::Remove(int nX, int nY, uint32_t nUID)
+{
+    if(!(nUID && ValidC(nX, nY))){
+        return false;
+    }
+
+    auto &rstSlot = m_SlotV[(size_t)(nY) * m_W + nX];
+    auto  pOverflowV = rstSlot.Overflow ? &(m_OverflowV[rstSlot.Overflow - 1]) : nullptr;
+
+    // fill the hole by the last UID of the cell
+    // last one is in overflow list if it's not empty
+    auto fnPopBack = [&rstSlot, pOverflowV]() -> uint32_t
+    {
+        uint32_t nLastUID = 0;
+        if(pOverflowV && !pOverflowV->empty()){
+            nLastUID = pOverflowV->back();
+            pOverflowV->pop_back();
+        }else{
+            nLastUID = rstSlot.UID[rstSlot.Count - 1];
+        }
+
+        rstSlot.Count--;
+        return nLastUID;
+    };
+
+    bool bFind = false;
+    for(uint32_t nIndex = 0; nIndex < rstSlot.Count && nIndex < INLINE_COUNT; ++nIndex){
+        if(rstSlot.UID[nIndex] == nUID){
+            rstSlot.UID[nIndex] = fnPopBack();
+            bFind = true;
+            break;
+        }
+    }
+
+    if(!bFind && pOverflowV){
+        for(auto &rstUID: *pOverflowV){
+            if(rstUID == nUID){
+                rstUID = pOverflowV->back();
+                pOverflowV->pop_back();
+                rstSlot.Count--;
+
+                bFind = true;
+                break;
+            }
+        }
+    }
+
+    if(bFind){
+        m_Count--;
+    }
+
+    // recycle the overflow list
+    // keep its capacity for next cell
+    if(pOverflowV && pOverflowV->empty()){
+        m_FreeOverflowV.push_back(rstSlot.Overflow);
+        rstSlot.Overflow = 0;
+    }
+    return bFind;
+}
+
+bool UIDGrid::Has(int nX, int nY, uint32_t nUID) const
+{
+    bool bFind = false;
+    ForEach(nX, nY, [nUID, &bFind](uint32_t nRecordUID)
+    {
+        if(nRecordUID == nUID){
+            bFind = true;
+        }
+    });
+    return bFind;
+}
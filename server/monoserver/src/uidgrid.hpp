@@ -0,0 +1,140 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidgrid.hpp
+ *        Created: 06/03/2017 10:08:51
+ *  Last Modified: 06/05/2017 10:44:02
+ *
+ *    Description: UID list of each cell, flat and row-major
+ *
+ *                 it was vector<vector<vector<uint32_t>>> indexed by [x][y], each cell
+ *                 had its own heap block, and most of them are empty or have one UID
+ *
+ *                 now all cells are in one array, each has INLINE_COUNT inline slots,
+ *                 UIDs beyond that go to a shared overflow pool, overflow lists are
+ *                 recycled when the cell shrinks back
+ *
+ *                 order of UIDs in one cell is not kept
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class UIDGrid final
+{
+    private:
+        constexpr static uint32_t INLINE_COUNT = 3;
+
+    private:
+        struct CellSlot
+        {
+            uint32_t Count;
+
+            // 1-based index into m_OverflowV, 0 means none
+            uint32_t Overflow;
+
+            uint32_t UID[INLINE_COUNT];
+        };
+
+    private:
+        int m_W;
+        int m_H;
+
+    private:
+        std::vector<CellSlot> m_SlotV;
+
+    private:
+        // UIDs in all cells
+        size_t m_Count;
+
+    private:
+        std::vector<std::vector<uint32_t>> m_OverflowV;
+        std::vector<uint32_t> m_FreeOverflowV;
+
+    public:
+        UIDGrid(int nW = 0, int nH = 0)
+            : m_W((nW > 0) ? nW : 0)
+            , m_H((nH > 0) ? nH : 0)
+            , m_SlotV((size_t)(m_W) * m_H, CellSlot {0, 0, {0}})
+            , m_Count(0)
+            , m_OverflowV()
+            , m_FreeOverflowV()
+        {}
+
+       ~UIDGrid() = default;
+
+    public:
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+    public:
+        bool Empty() const
+        {
+            return m_Count == 0;
+        }
+
+        size_t MemorySize() const
+        {
+            return m_SlotV.size() * sizeof(CellSlot) + m_OverflowV.size() * sizeof(m_OverflowV[0]);
+        }
+
+    public:
+        size_t Count(int nX, int nY) const
+        {
+            return ValidC(nX, nY) ? m_SlotV[(size_t)(nY) * m_W + nX].Count : 0;
+        }
+
+    public:
+        bool Add(int, int, uint32_t);
+        bool Remove(int, int, uint32_t);
+        bool Has(int, int, uint32_t) const;
+
+    public:
+        template<typename F> void ForEach(int nX, int nY, F &&fnOp) const
+        {
+            if(ValidC(nX, nY)){
+                auto &rstSlot = m_SlotV[(size_t)(nY) * m_W + nX];
+                for(uint32_t nIndex = 0; nIndex < rstSlot.Count && nIndex < INLINE_COUNT; ++nIndex){
+                    fnOp(rstSlot.UID[nIndex]);
+                }
+
+                if(rstSlot.Overflow){
+                    for(auto nUID: m_OverflowV[rstSlot.Overflow - 1]){
+                        fnOp(nUID);
+                    }
+                }
+            }
+        }
+
+        // remove UIDs which fnPred(nUID) returns true
+        // return count of removed UIDs
+        template<typename F> size_t RemoveIf(int nX, int nY, F &&fnPred)
+        {
+            std::vector<uint32_t> stRemoveV;
+            ForEach(nX, nY, [&stRemoveV, &fnPred](uint32_t nUID)
+            {
+                if(fnPred(nUID)){
+                    stRemoveV.push_back(nUID);
+                }
+            });
+
+            for(auto nUID: stRemoveV){
+                Remove(nX, nY, nUID);
+            }
+            return stRemoveV.size();
+        }
+};
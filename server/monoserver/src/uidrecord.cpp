@@ -22,10 +22,11 @@
 #include "uidrecord.hpp"
 #include "monoserver.hpp"
 
-UIDRecord::UIDRecord(uint32_t nUID, Theron::Address stAddress,
+UIDRecord::UIDRecord(uint32_t nUID, Theron::Address stAddress, uint64_t nClassMask,
         const std::vector<ServerObject::ClassCodeName> &rstClassEntry)
     : UID(nUID)
     , Address(stAddress)
+    , ClassMask(nClassMask)
     , ClassEntry(rstClassEntry)
 {
     if(false
@@ -41,6 +42,7 @@ void UIDRecord::Print()
 {
     extern MonoServer *g_MonoServer;
     g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::UID                  = %" PRIu32, UID);
+    g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassMask            = 0X%016llX", (unsigned long long)(ClassMask));
     for(size_t nIndex= 0; nIndex < ClassEntry.size(); ++nIndex){
         g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassEntry[%d]::Code = %llu", (int)(nIndex), (unsigned long long)(ClassEntry[nIndex].Code));
         g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassEntry[%d]::Name = %s",   (int)(nIndex), ClassEntry[nIndex].Name.c_str());
@@ -28,10 +28,15 @@ struct UIDRecord
 {
     uint32_t UID;
     Theron::Address Address;
+
+    // ancestor bitmask of the object class
+    // ClassFrom() only checks this, ClassEntry is kept for debug
+    uint64_t ClassMask;
     const std::vector<ServerObject::ClassCodeName> &ClassEntry;
 
     UIDRecord(uint32_t,
             Theron::Address,
+            uint64_t,
             const std::vector<ServerObject::ClassCodeName> &);
 
     bool Valid()
@@ -48,13 +53,6 @@ struct UIDRecord
 
     template<typename T> bool ClassFrom()
     {
-        if(Valid()){
-            for(const auto &rstCodeName: ClassEntry){
-                if(true
-                        && rstCodeName.Name == typeid(T).name()
-                        && rstCodeName.Code == typeid(T).hash_code()){ return true; }
-            }
-        }
-        return false;
+        return Valid() && (ClassMask & ServerObject::ClassBit<T>());
     }
 };
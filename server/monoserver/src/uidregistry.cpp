@@ -0,0 +1,138 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidregistry.cpp
+ *        Created: 05/21/2017 10:40:19
+ *  Last Modified: 05/21/2017 18:29:47
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <thread>
+#include "uidregistry.hpp"
+
+UIDRegistry::UIDRegistry()
+    : m_ChunkV()
+    , m_Epoch(0)
+    , m_ShardV()
+    , m_WriterLock()
+{
+    for(auto &rstChunk: m_ChunkV){
+        rstChunk.store(nullptr);
+    }
+}
+
+UIDRegistry::~UIDRegistry()
+{
+    // won't delete the instances here
+    // MonoServer is destroyed at exit, all objects are gone with the process
+    for(auto &rstChunk: m_ChunkV){
+        delete rstChunk.exchange(nullptr);
+    }
+}
+
+size_t UIDRegistry::ShardIndex()
+{
+    // assign shard for each thread in round-robin
+    // then threads of the actor framework are well distributed
+    static std::atomic<size_t> s_ShardCount(0);
+    static thread_local size_t s_ShardIndex = s_ShardCount.fetch_add(1) % SHARD_COUNT;
+    return s_ShardIndex;
+}
+
+UIDRegistry::UIDChunk *UIDRegistry::GetChunk(uint32_t nUID)
+{
+    if(nUID && (nUID / CHUNK_SIZE) < CHUNK_COUNT){
+        auto &rstChunk = m_ChunkV[nUID / CHUNK_SIZE];
+        if(auto pChunk = rstChunk.load()){
+            return pChunk;
+        }
+
+        // allocate a new chunk and try to install it
+        // if other thread wins then use the installed one
+        UIDChunk *pExpected = nullptr;
+        auto pNewChunk = new UIDChunk();
+
+        if(rstChunk.compare_exchange_strong(pExpected, pNewChunk)){
+            return pNewChunk;
+        }
+
+        delete pNewChunk;
+        return pExpected;
+    }
+    return nullptr;
+}
+
+bool UIDRegistry::Link(uint32_t nUID, ServerObject *pObject)
+{
+    if(nUID && pObject){
+        if(auto pChunk = GetChunk(nUID)){
+            ServerObject *pExpected = nullptr;
+            return pChunk->Slot[nUID % CHUNK_SIZE].compare_exchange_strong(pExpected, pObject);
+        }
+    }
+    return false;
+}
+
+void UIDRegistry::Synchronize()
+{
+    // writer lock should be held
+    // slot has been unlinked, any reader which can still refer to the instance
+    // incremented a counter before loading the slot, and keeps it non-zero till done
+    //
+    // so wait both parities drain after the unlink, flip before each wait then new
+    // readers go to the other parity and the wait always ends
+    //
+    // waiting only one parity is wrong: a reader reads the epoch, stalls while last
+    // Erase() flips it, then increments the parity we don't wait and loads the slot
+    for(int nPhase = 0; nPhase < 2; ++nPhase){
+        auto nParity = m_Epoch.fetch_add(1) & 1;
+        for(auto &rstShard: m_ShardV){
+            while(rstShard.Count[nParity].load()){
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+ServerObject *UIDRegistry::Erase(uint32_t nUID)
+{
+    if(!(nUID && (nUID / CHUNK_SIZE) < CHUNK_COUNT)){
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_WriterLock);
+    auto pChunk = m_ChunkV[nUID / CHUNK_SIZE].load();
+    if(!pChunk){
+        return nullptr;
+    }
+
+    auto pObject = pChunk->Slot[nUID % CHUNK_SIZE].exchange(nullptr);
+    if(!pObject){
+        return nullptr;
+    }
+
+    // all slots in this chunk have been linked and erased
+    // UID's are never reused, release the chunk after readers drained
+    bool bReleaseChunk = (pChunk->EraseCount.fetch_add(1) + 1 == CHUNK_SIZE);
+    if(bReleaseChunk){
+        m_ChunkV[nUID / CHUNK_SIZE].store(nullptr);
+    }
+
+    Synchronize();
+
+    if(bReleaseChunk){
+        delete pChunk;
+    }
+    return pObject;
+}
@@ -0,0 +1,164 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidregistry.hpp
+ *        Created: 05/21/2017 10:12:44
+ *  Last Modified: 05/21/2017 18:30:02
+ *
+ *    Description: read-optimized (uid, instance) table used by MonoServer
+ *
+ *                 previously MonoServer used 17 mutex-sharded unordered_maps, and every
+ *                 GetUIDRecord() locked one of them, it's called from every actor thread
+ *                 in CanMove(), broadcast loops, Monster::TrackAttack() etc.
+ *
+ *                 UID's come from a monotonic counter and never reused, so the table is
+ *                 indexed by UID directly:
+ *
+ *                      m_ChunkV[UID / CHUNK_SIZE]->Slot[UID % CHUNK_SIZE]
+ *
+ *                 chunks are allocated lazily by CAS, slots are atomic pointers, so the
+ *                 read path never takes a lock
+ *
+ *                 memory reclamation is RCU-like: readers increment a per-shard counter
+ *                 of the current epoch parity before loading the slot, Erase() unlinks
+ *                 the slot then waits a two-phase grace period before returning the
+ *                 instance for deletion: flip the epoch and wait counters of the old
+ *                 parity to drain, then do it again for the other parity
+ *
+ *                 one phase is not enough, a reader may read the epoch, stall, then
+ *                 increment the counter of a parity which has already been flipped away
+ *
+ *                 writers (Erase) are serialized by one mutex, it's rare compared to read
+ *                 never call Erase() inside Read(), it waits for itself
+ *
+ *                 no logging inside, it's used by tools/uidbench without MonoServer
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+class ServerObject;
+class UIDRegistry final
+{
+    private:
+        constexpr static size_t CHUNK_SIZE  = 4096;
+        constexpr static size_t CHUNK_COUNT = 65536;
+        constexpr static size_t SHARD_COUNT = 32;
+
+    public:
+        // UID's should be in [1, UID_LIMIT), 2^28
+        constexpr static uint32_t UID_LIMIT = (uint32_t)(CHUNK_SIZE * CHUNK_COUNT);
+
+    private:
+        struct UIDChunk
+        {
+            // how many slots have been erased
+            // when all slots are linked and erased we can release the chunk
+            std::atomic<size_t> EraseCount;
+            std::array<std::atomic<ServerObject *>, CHUNK_SIZE> Slot;
+
+            UIDChunk()
+                : EraseCount(0)
+            {
+                for(auto &rstSlot: Slot){
+                    rstSlot.store(nullptr);
+                }
+            }
+        };
+
+        struct ReaderShard
+        {
+            // reader count for epoch parity 0 and 1
+            // padding to avoid false sharing between shards
+            std::atomic<uint32_t> Count[2];
+            char Padding[64 - 2 * sizeof(std::atomic<uint32_t>)];
+
+            ReaderShard()
+                : Count {{0}, {0}}
+            {}
+        };
+
+        class ReaderGuard final
+        {
+            private:
+                std::atomic<uint32_t> &m_Count;
+
+            public:
+                ReaderGuard(std::atomic<uint32_t> &rstCount)
+                    : m_Count(rstCount)
+                {
+                    m_Count.fetch_add(1);
+                }
+
+               ~ReaderGuard()
+                {
+                    m_Count.fetch_sub(1);
+                }
+        };
+
+    private:
+        std::array<std::atomic<UIDChunk *>, CHUNK_COUNT> m_ChunkV;
+
+    private:
+        std::atomic<uint32_t> m_Epoch;
+        std::array<ReaderShard, SHARD_COUNT> m_ShardV;
+
+    private:
+        std::mutex m_WriterLock;
+
+    public:
+        UIDRegistry();
+       ~UIDRegistry();
+
+    public:
+        // return false if invalid argument, out of range or uid has been linked
+        bool Link(uint32_t, ServerObject *);
+
+        // unlink the uid and wait all readers may refer it to finish
+        // return the instance, caller is responsible to delete it
+        ServerObject *Erase(uint32_t);
+
+    public:
+        // access the instance of given uid in a read section
+        // fnOp accepts ``const ServerObject *" which could be null
+        // the pointer is only valid inside fnOp, never keep it
+        template<typename F> void Read(uint32_t nUID, F &&fnOp)
+        {
+            ReaderGuard stGuard(m_ShardV[ShardIndex()].Count[m_Epoch.load() & 1]);
+            fnOp((const ServerObject *)(LoadSlot(nUID)));
+        }
+
+    private:
+        ServerObject *LoadSlot(uint32_t nUID) const
+        {
+            if(nUID && (nUID / CHUNK_SIZE) < CHUNK_COUNT){
+                if(auto pChunk = m_ChunkV[nUID / CHUNK_SIZE].load()){
+                    return pChunk->Slot[nUID % CHUNK_SIZE].load();
+                }
+            }
+            return nullptr;
+        }
+
+    private:
+        UIDChunk *GetChunk(uint32_t);
+
+    private:
+        void Synchronize();
+
+    private:
+        static size_t ShardIndex();
+};
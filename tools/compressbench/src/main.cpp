@@ -0,0 +1,294 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 04/25/2017 15:02:37
+ *  Last Modified: 04/25/2017 17:41:09
+ *
+ *    Description: compare Compress::Encode() / Decode() with the byte-at-a-time codec
+ *                 on the messages which are really compressed (type 1)
+ *
+ *                 messages are filled like a running server: small UID's and map
+ *                 ID's, coordinates less than 1000, most parameters zero, so the
+ *                 payload has the same zero pattern as on the wire
+ *
+ *                 each message is encoded on its own, as SendPacket::Commit() and
+ *                 NetIO do, and the output is checked byte by byte against the
+ *                 reference codec before timing
+ *
+ *                 usage: compressbench [messages per type] [rounds]
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+#include "compress.hpp"
+#include "clientmessage.hpp"
+#include "servermessage.hpp"
+
+// reference codec, same as the scalar one in compress.cpp
+// keep it here so the bench doesn't depend on which codec the cpu selects
+static int RefEncode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+{
+    auto pMask = pDst;
+    auto pComp = pDst + (nDataLen + 7) / 8;
+
+    int nCount = 0;
+    std::memset(pMask, 0, (nDataLen + 7) / 8);
+    for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+        if(pData[nIndex]){
+            pMask[nIndex / 8] |= (0X01 << (nIndex % 8));
+            pComp[nCount++]    = pData[nIndex];
+        }
+    }
+    return nCount;
+}
+
+static int RefDecode(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+{
+    int nCount = 0;
+    for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+        pOrig[nIndex] = (pMask[nIndex / 8] & (0X01 << (nIndex % 8))) ? pComp[nCount++] : 0;
+    }
+    return nCount;
+}
+
+class MessageGen final
+{
+    private:
+        uint32_t m_Seed;
+
+    public:
+        MessageGen(uint32_t nSeed)
+            : m_Seed(nSeed)
+        {}
+
+    public:
+        uint32_t Rand(uint32_t nMax)
+        {
+            m_Seed ^= (m_Seed << 13);
+            m_Seed ^= (m_Seed >> 17);
+            m_Seed ^= (m_Seed <<  5);
+            return m_Seed % nMax;
+        }
+
+    public:
+        template<typename T> void FillAction(T *pAction)
+        {
+            pAction->UID         = 1 + Rand(200000);
+            pAction->MapID       = 1 + Rand(32);
+            pAction->Action      = (uint8_t)(Rand(12));
+            pAction->ActionParam = (uint8_t)(Rand(4) ? 0 : Rand(8));
+            pAction->Speed       = (uint8_t)(Rand(4) ? 100 : 0);
+            pAction->Direction   = (uint8_t)(Rand(8));
+            pAction->X           = (uint16_t)(Rand(1000));
+            pAction->Y           = (uint16_t)(Rand(1000));
+            pAction->EndX        = (uint16_t)(Rand(2) ? pAction->X + Rand(3) : 0);
+            pAction->EndY        = (uint16_t)(Rand(2) ? pAction->Y + Rand(3) : 0);
+        }
+
+        void Fill(SMAction *pSMA)
+        {
+            FillAction(pSMA);
+        }
+
+        void Fill(CMAction *pCMA)
+        {
+            FillAction(pCMA);
+        }
+
+        void Fill(SMLoginOK *pSMLOK)
+        {
+            pSMLOK->UID       = 1 + Rand(200000);
+            pSMLOK->DBID      = 1 + Rand(5000);
+            pSMLOK->MapID     = 1 + Rand(32);
+            pSMLOK->X         = (uint16_t)(Rand(1000));
+            pSMLOK->Y         = (uint16_t)(Rand(1000));
+            pSMLOK->Male      = (uint8_t)(Rand(2));
+            pSMLOK->Direction = (uint8_t)(Rand(8));
+            pSMLOK->JobID     = 1 + Rand(3);
+            pSMLOK->Level     = 1 + Rand(60);
+        }
+
+        void Fill(SMMonsterGInfo *pSMMGI)
+        {
+            pSMMGI->MonsterID = 1 + Rand(400);
+            pSMMGI->LookIDN   = Rand(2);
+            pSMMGI->LookID    = 0X0800 + Rand(0X0400);
+        }
+
+        void Fill(CMQueryMonsterGInfo *pCMQMGI)
+        {
+            pCMQMGI->MonsterID = 1 + Rand(400);
+            pCMQMGI->LookIDN   = Rand(2);
+        }
+
+        void Fill(SMCORecord *pSMCOR)
+        {
+            // most of the co's in view are monsters
+            pSMCOR->Type = (uint8_t)(Rand(8) ? 1 : 2);
+            FillAction(&(pSMCOR->Common));
+            if(pSMCOR->Type == 1){
+                pSMCOR->Monster.MonsterID = 1 + Rand(400);
+            }else{
+                pSMCOR->Player.DBID  = 1 + Rand(5000);
+                pSMCOR->Player.JobID = 1 + Rand(3);
+                pSMCOR->Player.Level = 1 + Rand(60);
+            }
+        }
+};
+
+typedef struct{
+    double Ratio;       // compressed size / origin size, mask included
+    double RefEncode;   // ns per message
+    double Encode;
+    double RefDecode;
+    double Decode;
+}BenchResult;
+
+static double TimeRounds(int nRound, size_t nMessageCount, const std::function<int(size_t)> &fnOp)
+{
+    // use the result so nothing can be dropped by the compiler
+    static volatile int s_Sink = 0;
+
+    int nSum = 0;
+    auto stStart = std::chrono::steady_clock::now();
+    for(int nIndex = 0; nIndex < nRound; ++nIndex){
+        for(size_t nMessage = 0; nMessage < nMessageCount; ++nMessage){
+            nSum += fnOp(nMessage);
+        }
+    }
+
+    auto fNS = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stStart).count();
+    s_Sink = s_Sink + nSum;
+    return fNS / nRound / nMessageCount;
+}
+
+template<typename T> static bool RunBench(const char *szName, size_t nMessageCount, int nRound, BenchResult *pResult)
+{
+    const size_t nDataLen = sizeof(T);
+    const size_t nMaskLen = (nDataLen + 7) / 8;
+    const size_t nFrameLen = nMaskLen + nDataLen;
+
+    // exact size buffers, the SIMD codecs must not touch a byte outside
+    std::vector<uint8_t> stOrigV(nMessageCount * nDataLen, 0);
+    std::vector<uint8_t> stCompV(nMessageCount * nFrameLen, 0);
+    std::vector<uint8_t> stRefCompV(nMessageCount * nFrameLen, 0);
+    std::vector<uint8_t> stDecodeV(nMessageCount * nDataLen, 0);
+
+    MessageGen stGen(2463534242u + (uint32_t)(nDataLen));
+    for(size_t nMessage = 0; nMessage < nMessageCount; ++nMessage){
+        T stMessage;
+        std::memset(&stMessage, 0, sizeof(stMessage));
+
+        stGen.Fill(&stMessage);
+        std::memcpy(&(stOrigV[nMessage * nDataLen]), &stMessage, nDataLen);
+    }
+
+    size_t nTotalComp = 0;
+    for(size_t nMessage = 0; nMessage < nMessageCount; ++nMessage){
+        auto pOrig    = &(stOrigV[nMessage * nDataLen]);
+        auto pComp    = &(stCompV[nMessage * nFrameLen]);
+        auto pRefComp = &(stRefCompV[nMessage * nFrameLen]);
+        auto pDecode  = &(stDecodeV[nMessage * nDataLen]);
+
+        auto nRefCount = RefEncode(pRefComp, pOrig, nDataLen);
+        if(false
+                || Compress::CountData(pOrig, nDataLen) != nRefCount
+                || Compress::Encode(pComp, pOrig, nDataLen) != nRefCount
+                || Compress::CountMask(pComp, nMaskLen) != nRefCount
+                || std::memcmp(pComp, pRefComp, nMaskLen + nRefCount)){
+            std::printf("%s: encode mismatch at message %zu\n", szName, nMessage);
+            return false;
+        }
+
+        if(false
+                || Compress::Decode(pDecode, nDataLen, pComp, pComp + nMaskLen) != nRefCount
+                || std::memcmp(pDecode, pOrig, nDataLen)){
+            std::printf("%s: decode mismatch at message %zu\n", szName, nMessage);
+            return false;
+        }
+        nTotalComp += (nMaskLen + nRefCount);
+    }
+
+    pResult->Ratio = 1.0 * nTotalComp / (nMessageCount * nDataLen);
+
+    pResult->RefEncode = TimeRounds(nRound, nMessageCount, [&](size_t nMessage)
+    {
+        return RefEncode(&(stRefCompV[nMessage * nFrameLen]), &(stOrigV[nMessage * nDataLen]), nDataLen);
+    });
+
+    pResult->Encode = TimeRounds(nRound, nMessageCount, [&](size_t nMessage)
+    {
+        return Compress::Encode(&(stCompV[nMessage * nFrameLen]), &(stOrigV[nMessage * nDataLen]), nDataLen);
+    });
+
+    pResult->RefDecode = TimeRounds(nRound, nMessageCount, [&](size_t nMessage)
+    {
+        auto pComp = &(stRefCompV[nMessage * nFrameLen]);
+        return RefDecode(&(stDecodeV[nMessage * nDataLen]), nDataLen, pComp, pComp + nMaskLen);
+    });
+
+    pResult->Decode = TimeRounds(nRound, nMessageCount, [&](size_t nMessage)
+    {
+        auto pComp = &(stCompV[nMessage * nFrameLen]);
+        return Compress::Decode(&(stDecodeV[nMessage * nDataLen]), nDataLen, pComp, pComp + nMaskLen);
+    });
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc > 3){
+        std::printf("Usage: compressbench [messages per type] [rounds]\n\n");
+        return 1;
+    }
+
+    size_t nMessageCount = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    int    nRound        = (argc > 2) ? std::atoi(argv[2]) : 200;
+
+    if(nMessageCount == 0 || nRound <= 0){
+        std::printf("Invalid argument: messages per type = %zu, rounds = %d\n", nMessageCount, nRound);
+        return 1;
+    }
+
+    std::printf("codec: %s, reference: byte-at-a-time, time in ns per message\n\n", Compress::CodecName());
+    std::printf("%-22s %6s %7s %10s %10s %10s %10s\n", "message", "bytes", "ratio", "ref enc", "enc", "ref dec", "dec");
+
+    bool bPass = true;
+    auto fnRun = [&bPass, nMessageCount, nRound](const char *szName, size_t nDataLen, bool (*fnBench)(const char *, size_t, int, BenchResult *))
+    {
+        BenchResult stResult;
+        if(fnBench(szName, nMessageCount, nRound, &stResult)){
+            std::printf("%-22s %6zu %7.3f %10.2f %10.2f %10.2f %10.2f\n", szName, nDataLen,
+                    stResult.Ratio, stResult.RefEncode, stResult.Encode, stResult.RefDecode, stResult.Decode);
+        }else{
+            bPass = false;
+        }
+    };
+
+    fnRun("SM_LOGINOK",           sizeof(SMLoginOK),           RunBench<SMLoginOK>);
+    fnRun("SM_ACTION",            sizeof(SMAction),            RunBench<SMAction>);
+    fnRun("SM_MONSTERGINFO",      sizeof(SMMonsterGInfo),      RunBench<SMMonsterGInfo>);
+    fnRun("SM_CORECORD",          sizeof(SMCORecord),          RunBench<SMCORecord>);
+    fnRun("CM_ACTION",            sizeof(CMAction),            RunBench<CMAction>);
+    fnRun("CM_QUERYMONSTERGINFO", sizeof(CMQueryMonsterGInfo), RunBench<CMQueryMonsterGInfo>);
+
+    return bPass ? 0 : 1;
+}
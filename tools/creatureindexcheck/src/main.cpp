@@ -0,0 +1,238 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 06/06/2017 15:02:44
+ *  Last Modified: 06/06/2017 16:38:10
+ *
+ *    Description: check CreatureIndex
+ *                 1. Update() inserts, moves and refreshes, never duplicates
+ *                 2. Remove() and Update() out of the map take it out
+ *                 3. Clear() and Reset() drop all creatures
+ *                 4. rows stay sorted by (X, UID) after random moves, compared with
+ *                    a plain map of UID -> location
+ *
+ *                 creatures are never dereferenced, fake addresses are used
+ *
+ *                 print failed checks and return non-zero
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <map>
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include "creatureindex.hpp"
+
+// only used as addresses
+static std::array<char, 1024> g_ObjectV;
+
+static Creature *ObjectAddress(uint32_t nUID)
+{
+    return (Creature *)(&g_ObjectV[nUID % g_ObjectV.size()]);
+}
+
+static int g_FailCount = 0;
+static void Check(bool bResult, const char *szCheck)
+{
+    std::printf("[%s] %s\n", bResult ? "PASS" : "FAIL", szCheck);
+    if(!bResult){
+        g_FailCount++;
+    }
+}
+
+typedef struct{
+    int X;
+    int Y;
+    Creature *Object;
+}ModelLoc;
+
+// compare all rows with the model
+// expected row is (X, UID) in order, std::map sorts it
+static bool SameAsModel(const CreatureIndex &rstIndex, int nH, const std::map<uint32_t, ModelLoc> &rstModel)
+{
+    for(int nY = -1; nY <= nH; ++nY){
+        std::map<std::tuple<int, uint32_t>, Creature *> stRowMap;
+        for(auto &rstLoc: rstModel){
+            if(rstLoc.second.Y == nY){
+                stRowMap[std::make_tuple(rstLoc.second.X, rstLoc.first)] = rstLoc.second.Object;
+            }
+        }
+
+        auto &rstRow = rstIndex.Row(nY);
+        if(rstRow.size() != stRowMap.size()){
+            return false;
+        }
+
+        size_t nIndex = 0;
+        for(auto &rstExpect: stRowMap){
+            if(false
+                    || rstRow[nIndex].X      != std::get<0>(rstExpect.first)
+                    || rstRow[nIndex].UID    != std::get<1>(rstExpect.first)
+                    || rstRow[nIndex].Object != rstExpect.second){
+                return false;
+            }
+            nIndex++;
+        }
+    }
+    return true;
+}
+
+static void CheckUpdate()
+{
+    CreatureIndex stIndex;
+    stIndex.Reset(8);
+
+    stIndex.Update(3, ObjectAddress(3), 5, 2);
+    stIndex.Update(1, ObjectAddress(1), 5, 2);
+    stIndex.Update(2, ObjectAddress(2), 1, 2);
+
+    auto &rstRow = stIndex.Row(2);
+    Check(true
+            && rstRow.size() == 3
+            && rstRow[0].X == 1 && rstRow[0].UID == 2
+            && rstRow[1].X == 5 && rstRow[1].UID == 1
+            && rstRow[2].X == 5 && rstRow[2].UID == 3, "Update() inserts sorted by (X, UID)");
+
+    stIndex.Update(1, ObjectAddress(7), 5, 2);
+    Check(true
+            && stIndex.Row(2).size() == 3
+            && stIndex.Row(2)[1].UID == 1
+            && stIndex.Row(2)[1].Object == ObjectAddress(7), "Update() in the same cell refreshes the pointer only");
+
+    stIndex.Update(1, ObjectAddress(1), 0, 2);
+    Check(true
+            && stIndex.Row(2).size() == 3
+            && stIndex.Row(2)[0].X == 0 && stIndex.Row(2)[0].UID == 1
+            && stIndex.Row(2)[1].X == 1 && stIndex.Row(2)[1].UID == 2, "Update() in the same row moves the entry to its new place");
+
+    stIndex.Update(1, ObjectAddress(1), 0, 6);
+    Check(true
+            && stIndex.Row(2).size() == 2
+            && stIndex.Row(6).size() == 1
+            && stIndex.Row(6)[0].UID == 1, "Update() to another row takes the entry out of the old one");
+
+    Check(true
+            &&  stIndex.Has(0, 6)
+            &&  stIndex.Has(5, 2)
+            && !stIndex.Has(0, 2)
+            && !stIndex.Has(4, 2)
+            && !stIndex.Has(0, 8)
+            && !stIndex.Has(0, -1), "Has() tells occupied cells only");
+}
+
+static void CheckRemove()
+{
+    CreatureIndex stIndex;
+    stIndex.Reset(8);
+
+    stIndex.Update(1, ObjectAddress(1), 3, 3);
+    stIndex.Update(2, ObjectAddress(2), 4, 3);
+
+    stIndex.Remove(9);
+    Check(stIndex.Row(3).size() == 2, "Remove() ignores unknown UID");
+
+    stIndex.Remove(1);
+    Check(stIndex.Row(3).size() == 1 && stIndex.Row(3)[0].UID == 2 && !stIndex.Has(3, 3), "Remove() takes the entry out");
+
+    stIndex.Update(2, ObjectAddress(2), 4, 8);
+    Check(stIndex.Row(3).empty() && stIndex.Row(8).empty(), "Update() out of the map takes the entry out");
+
+    stIndex.Update(2, ObjectAddress(2), 4, 3);
+    stIndex.Update(2, nullptr, 5, 3);
+    Check(stIndex.Row(3).empty(), "Update() with null creature takes the entry out");
+
+    // re-inserted after it's taken out by moving off the map
+    stIndex.Update(2, ObjectAddress(2), 4, 3);
+    Check(stIndex.Row(3).size() == 1 && stIndex.Row(3)[0].UID == 2, "Update() inserts again after it left the map");
+}
+
+static void CheckClear()
+{
+    CreatureIndex stIndex;
+    stIndex.Reset(8);
+
+    stIndex.Update(1, ObjectAddress(1), 3, 3);
+    stIndex.Update(2, ObjectAddress(2), 4, 5);
+    stIndex.Clear();
+    Check(stIndex.Row(3).empty() && stIndex.Row(5).empty(), "Clear() drops all creatures");
+
+    // location cache is dropped as well
+    // otherwise same cell update finds nothing to refresh
+    stIndex.Update(1, ObjectAddress(1), 3, 3);
+    Check(stIndex.Row(3).size() == 1 && stIndex.Row(3)[0].UID == 1, "Update() after Clear() inserts again, rows are kept");
+
+    stIndex.Reset(4);
+    stIndex.Update(1, ObjectAddress(1), 3, 3);
+    stIndex.Update(2, ObjectAddress(2), 3, 5);
+    Check(stIndex.Row(3).size() == 1 && stIndex.Row(5).empty(), "Reset() drops all creatures and resizes rows");
+}
+
+static void CheckRandomMove()
+{
+    const int nW = 32;
+    const int nH = 32;
+
+    CreatureIndex stIndex;
+    stIndex.Reset(nH);
+
+    std::map<uint32_t, ModelLoc> stModel;
+
+    bool bSame = true;
+    uint32_t nSeed = 2463534242u;
+    for(int nStep = 0; nStep < 20000 && bSame; ++nStep){
+        nSeed ^= (nSeed << 13);
+        nSeed ^= (nSeed >> 17);
+        nSeed ^= (nSeed <<  5);
+
+        uint32_t nUID = 1 + nSeed % 200;
+        int      nOp  = (int)(nSeed / 200 % 16);
+
+        auto pLoc = stModel.find(nUID);
+        if(nOp == 0){
+            stIndex.Remove(nUID);
+            stModel.erase(nUID);
+        }else if(nOp == 1){
+            stIndex.Update(nUID, ObjectAddress(nUID), 0, nH);
+            stModel.erase(nUID);
+        }else if(nOp < 6 || pLoc == stModel.end()){
+            // spawn or jump anywhere
+            int nX = (int)(nSeed / 3200 % nW);
+            int nY = (int)(nSeed / 3200 / nW % nH);
+            stIndex.Update(nUID, ObjectAddress(nUID + nOp), nX, nY);
+            stModel[nUID] = {nX, nY, ObjectAddress(nUID + nOp)};
+        }else{
+            // walk one step, or stay
+            int nX = std::min<int>(nW - 1, std::max<int>(0, pLoc->second.X + (int)(nSeed / 3200 % 3) - 1));
+            int nY = std::min<int>(nH - 1, std::max<int>(0, pLoc->second.Y + (int)(nSeed / 9600 % 3) - 1));
+            stIndex.Update(nUID, ObjectAddress(nUID + nOp), nX, nY);
+            stModel[nUID] = {nX, nY, ObjectAddress(nUID + nOp)};
+        }
+        bSame = SameAsModel(stIndex, nH, stModel);
+    }
+
+    Check(bSame, "rows match (X, UID) order of the model after random moves");
+}
+
+int main()
+{
+    CheckUpdate();
+    CheckRemove();
+    CheckClear();
+    CheckRandomMove();
+
+    std::printf("%s: %d check(s) failed\n", g_FailCount ? "FAIL" : "PASS", g_FailCount);
+    return g_FailCount ? 1 : 0;
+}
@@ -52,12 +52,24 @@ status, errmsg = conn:execute [[
         fld_level     int unsigned not null,
         fld_jobid     int unsigned not null,
         fld_direction int unsigned not null,
+        fld_hp        int not null default 0,
+        fld_mp        int not null default 0,
         fld_name      char(32) not null
     )
 ]]
 
 if errmsg then print(status, errmsg) end
 
+-- hp/mp are written by PersistHub of monoserver
+-- add them for table created before they were introduced
+status, errmsg = conn:execute [[
+    alter table tbl_guid
+        add column if not exists fld_hp int not null default 0 after fld_direction,
+        add column if not exists fld_mp int not null default 0 after fld_hp
+]]
+
+if errmsg then print(status, errmsg) end
+
 -- try to add guid
 status, errmsg = conn:execute [[
     insert tbl_guid (fld_id, fld_mapid, fld_mapx, fld_mapy, fld_level, fld_jobid, fld_direction, fld_name) values
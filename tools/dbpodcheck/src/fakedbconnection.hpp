@@ -0,0 +1,105 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: fakedbconnection.hpp
+ *        Created: 06/05/2016 22:10:41
+ *  Last Modified: 06/05/2016 23:32:07
+ *
+ *    Description: fake backend for DBPod, no database behind it
+ *
+ *                 only what DBPod uses is provided: constructor, Valid() and
+ *                 CreateDBRecord(), a record only remembers the connection it's on
+ *
+ *                 InUse is set by whoever is working on the connection, DBPod should
+ *                 never let two of them in at the same time
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <vector>
+
+class FakeDBConnection;
+class FakeDBRecord
+{
+    private:
+        FakeDBConnection *m_Connection;
+
+    public:
+        FakeDBRecord(FakeDBConnection *pConnection)
+            : m_Connection(pConnection)
+        {}
+
+    public:
+        FakeDBConnection *Connection()
+        {
+            return m_Connection;
+        }
+};
+
+class FakeDBConnection
+{
+    public:
+        // connections created after this count are invalid, to check Launch() failure
+        static std::atomic<int> ValidLimit;
+        static std::atomic<int> CreateCount;
+
+    private:
+        const int  m_ID;
+        const bool m_Valid;
+
+    public:
+        // atomic since a broken DBPod could let two threads in
+        std::atomic<int> InUse;
+
+        // sequence of the tasks executed on this connection
+        // only touched by the one holding the connection
+        std::vector<int> TaskSeqV;
+
+    public:
+        FakeDBConnection(const char *, const char *, const char *, const char *, unsigned int)
+            : m_ID(CreateCount++)
+            , m_Valid(m_ID < ValidLimit)
+            , InUse(0)
+            , TaskSeqV()
+        {}
+
+    public:
+        bool Valid()
+        {
+            return m_Valid;
+        }
+
+        int ID() const
+        {
+            return m_ID;
+        }
+
+    public:
+        FakeDBRecord *CreateDBRecord(FakeDBRecord *pBuf = nullptr)
+        {
+            return pBuf ? (new (pBuf) FakeDBRecord(this)) : (new FakeDBRecord(this));
+        }
+
+    public:
+        // enter / leave the connection, return false if someone else is in
+        bool Enter()
+        {
+            return InUse.exchange(1) == 0;
+        }
+
+        void Leave()
+        {
+            InUse.store(0);
+        }
+};
@@ -0,0 +1,216 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 06/05/2016 22:10:41
+ *  Last Modified: 06/05/2016 23:47:52
+ *
+ *    Description: check DBPod on a fake connection
+ *                 1. Submit() on a pod not launched fails
+ *                 2. destructor executes all submitted tasks, in order per connection
+ *                 3. Launch() fails and cleans up if any connection is invalid
+ *                 4. task and DBHDR never share a connection at the same time
+ *                 5. CreateDBHDR() waits without spinning if all connections are busy
+ *
+ *                 print failed checks and return non-zero
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+#include "log.hpp"
+#include "dbpod.hpp"
+#include "fakedbconnection.hpp"
+
+Log *g_Log = nullptr;
+
+std::atomic<int> FakeDBConnection::ValidLimit(1 << 30);
+std::atomic<int> FakeDBConnection::CreateCount(0);
+
+template<size_t ConnectionSize> using FakeDBPod = DBPod<ConnectionSize, FakeDBConnection, FakeDBRecord>;
+
+static int g_FailCount = 0;
+static void Check(bool bResult, const char *szCheck)
+{
+    std::printf("[%s] %s\n", bResult ? "PASS" : "FAIL", szCheck);
+    if(!bResult){
+        g_FailCount++;
+    }
+}
+
+template<size_t ConnectionSize> static bool LaunchPod(FakeDBPod<ConnectionSize> *pPod)
+{
+    return pPod->Launch("localhost", "root", "", "mir2x", 3306) == 0;
+}
+
+static void CheckSubmitNotRunning()
+{
+    FakeDBPod<2> stPod;
+
+    bool bExecuted = false;
+    bool bSubmit   = stPod.Submit([&bExecuted](FakeDBConnection *){ bExecuted = true; });
+
+    Check(!bSubmit && !bExecuted, "Submit() fails before Launch()");
+}
+
+static void CheckDrain()
+{
+    const int nTaskCount = 2000;
+
+    std::atomic<int> nDoneCount(0);
+    std::vector<std::vector<int>> stSeqVV(4);
+
+    {
+        FakeDBPod<4> stPod;
+        if(!LaunchPod(&stPod)){
+            Check(false, "Launch() with valid connections");
+            return;
+        }
+
+        for(int nSeq = 0; nSeq < nTaskCount; ++nSeq){
+            stPod.Submit([nSeq, &nDoneCount, &stSeqVV](FakeDBConnection *pConn)
+            {
+                // slow task, make sure the queues are not empty at destruction
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                stSeqVV[pConn->ID() % 4].push_back(nSeq);
+                nDoneCount++;
+            });
+        }
+
+        // destructor here
+    }
+
+    bool bInOrder = true;
+    for(auto &rstSeqV: stSeqVV){
+        for(size_t nIndex = 1; nIndex < rstSeqV.size(); ++nIndex){
+            if(rstSeqV[nIndex - 1] >= rstSeqV[nIndex]){
+                bInOrder = false;
+            }
+        }
+    }
+
+    Check(nDoneCount == nTaskCount, "destructor drains all submitted tasks");
+    Check(bInOrder, "tasks on one connection run in submission order");
+}
+
+static void CheckLaunchFail()
+{
+    FakeDBConnection::ValidLimit = FakeDBConnection::CreateCount + 2;
+    {
+        FakeDBPod<4> stPod;
+        Check(!LaunchPod(&stPod), "Launch() fails if any connection is invalid");
+        Check(!stPod.Submit([](FakeDBConnection *){}), "Submit() fails after failed Launch()");
+    }
+    FakeDBConnection::ValidLimit = (1 << 30);
+}
+
+template<size_t ConnectionSize> static void CheckExclusive(const char *szCheck)
+{
+    std::atomic<int> nConflict(0);
+    std::atomic<int> nNullHDR(0);
+    {
+        FakeDBPod<ConnectionSize> stPod;
+        if(!LaunchPod(&stPod)){
+            Check(false, "Launch() with valid connections");
+            return;
+        }
+
+        auto fnWork = [&nConflict](FakeDBConnection *pConn)
+        {
+            if(!pConn->Enter()){
+                nConflict++;
+                return;
+            }
+
+            std::this_thread::yield();
+            pConn->Leave();
+        };
+
+        std::vector<std::thread> stThreadV;
+        for(int nThread = 0; nThread < 3; ++nThread){
+            stThreadV.emplace_back([&stPod, &nNullHDR, &fnWork]()
+            {
+                for(int nIndex = 0; nIndex < 500; ++nIndex){
+                    auto pHDR = stPod.CreateDBHDR();
+                    if(!pHDR){
+                        nNullHDR++;
+                        continue;
+                    }
+                    fnWork(pHDR->Connection());
+                }
+            });
+        }
+
+        for(int nIndex = 0; nIndex < 1500; ++nIndex){
+            stPod.Submit(fnWork);
+        }
+
+        for(auto &rstThread: stThreadV){
+            rstThread.join();
+        }
+    }
+
+    Check(nConflict == 0 && nNullHDR == 0, szCheck);
+}
+
+static void CheckCreateBlocking()
+{
+    FakeDBPod<2> stPod;
+    if(!LaunchPod(&stPod)){
+        Check(false, "Launch() with valid connections");
+        return;
+    }
+
+    auto pHDR0 = stPod.CreateDBHDR();
+    auto pHDR1 = stPod.CreateDBHDR();
+
+    std::atomic<bool> bGot(false);
+    std::thread stWaiter([&stPod, &bGot]()
+    {
+        auto pHDR = stPod.CreateDBHDR();
+        bGot = (pHDR != nullptr);
+    });
+
+    // process cpu time, a spinning waiter burns it while we sleep
+    auto nClock0 = std::clock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    auto fCPUSec = 1.0 * (std::clock() - nClock0) / CLOCKS_PER_SEC;
+
+    Check(!bGot, "CreateDBHDR() waits if all connections are busy");
+    Check(fCPUSec < 0.05, "CreateDBHDR() doesn't spin while waiting");
+
+    pHDR0.reset();
+    pHDR1.reset();
+
+    stWaiter.join();
+    Check(bGot, "CreateDBHDR() returns when a connection is released");
+}
+
+int main()
+{
+    g_Log = new Log("mir2x-dbpodcheck-v0.1");
+
+    CheckSubmitNotRunning();
+    CheckDrain();
+    CheckLaunchFail();
+    CheckExclusive<1>("DBHDR and task never share connection: 1 connection");
+    CheckExclusive<4>("DBHDR and task never share connection: 4 connections");
+    CheckCreateBlocking();
+
+    std::printf("%s: %d check(s) failed\n", g_FailCount ? "FAIL" : "PASS", g_FailCount);
+    return g_FailCount ? 1 : 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 03/18/2016 16:20:44
+ *  Last Modified: 03/18/2016 18:05:31
+ *
+ *    Description: check eviction of InnDB on integer resources
+ *                 1. CLOCK: oldest goes first, a referenced one gets a second chance
+ *                 2. byte budget is kept, a resource over the budget stays till the
+ *                    next loading
+ *                 3. HoldEviction() pins everything, limits are soft till release
+ *                 4. records in the linear cache are never evicted
+ *                 5. every loaded resource is freed exactly once
+ *
+ *                 print failed checks and return non-zero
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <array>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include "inndb.hpp"
+
+// resource is the key itself
+// size is set by the check, 10 bytes by default
+template<size_t LCDeepN, size_t LCLenN, size_t ResMaxN> class IntDB: public InnDB<uint32_t, uint32_t, LCDeepN, LCLenN, ResMaxN>
+{
+    public:
+        std::unordered_map<uint32_t, size_t> SizeMap;
+
+        std::vector<uint32_t> LoadV;
+        std::vector<uint32_t> FreeV;
+
+    public:
+        IntDB()
+            : InnDB<uint32_t, uint32_t, LCDeepN, LCLenN, ResMaxN>()
+            , SizeMap()
+            , LoadV()
+            , FreeV()
+        {}
+
+        virtual ~IntDB()
+        {
+            // FreeResource() can't be called in ~InnDB()
+            this->ClearCache();
+        }
+
+    public:
+        uint32_t LoadResource(uint32_t nKey)
+        {
+            LoadV.push_back(nKey);
+            return nKey;
+        }
+
+        void FreeResource(uint32_t &rstResource)
+        {
+            FreeV.push_back(rstResource);
+        }
+
+        size_t ResourceSize(const uint32_t &rstResource)
+        {
+            auto pSize = SizeMap.find(rstResource);
+            return (pSize == SizeMap.end()) ? 10 : pSize->second;
+        }
+
+    public:
+        void Retrieve(uint32_t nKey)
+        {
+            this->InnRetrieve(nKey, nullptr, [](uint32_t nKey) -> size_t { return LCLenN ? (nKey % LCLenN) : 0; }, nullptr);
+        }
+};
+
+static int g_FailCount = 0;
+static void Check(bool bResult, const char *szCheck)
+{
+    std::printf("[%s] %s\n", bResult ? "PASS" : "FAIL", szCheck);
+    if(!bResult){
+        g_FailCount++;
+    }
+}
+
+// cached count and bytes are consistent with the resources loaded but not freed
+template<typename DB> static bool StatConsistent(const DB &rstDB)
+{
+    std::unordered_map<uint32_t, int> stLiveMap;
+    for(auto nKey: rstDB.LoadV){
+        stLiveMap[nKey]++;
+    }
+    for(auto nKey: rstDB.FreeV){
+        stLiveMap[nKey]--;
+    }
+
+    size_t nCount = 0;
+    size_t nBytes = 0;
+    for(auto &rstLive: stLiveMap){
+        if(rstLive.second < 0 || rstLive.second > 1){
+            return false;
+        }
+
+        if(rstLive.second){
+            auto pSize = rstDB.SizeMap.find(rstLive.first);
+            nCount += 1;
+            nBytes += (pSize == rstDB.SizeMap.end()) ? 10 : pSize->second;
+
+            if(!rstDB.InnCached(rstLive.first)){
+                return false;
+            }
+        }
+    }
+    return nCount == rstDB.Stat().Count && nBytes == rstDB.Stat().Bytes;
+}
+
+static void CheckSecondChance()
+{
+    IntDB<0, 0, 8> stDB;
+    for(uint32_t nKey = 1; nKey <= 8; ++nKey){
+        stDB.Retrieve(nKey);
+    }
+    Check(stDB.FreeV.empty() && stDB.Stat().Count == 8, "nothing evicted under the count limit");
+
+    // all referenced when loaded
+    // the hand clears them in the first round and evicts the oldest in the second
+    stDB.Retrieve(9);
+    Check(stDB.FreeV == std::vector<uint32_t>({1}), "first eviction takes the oldest");
+
+    // 2 is referenced by the hit, 9 was still referenced since loaded
+    stDB.Retrieve(2);
+    stDB.Retrieve(10);
+    Check(stDB.FreeV == std::vector<uint32_t>({1, 3}), "referenced record gets a second chance");
+    Check(stDB.InnCached(2) && stDB.InnCached(9) && stDB.InnCached(10), "records given a second chance are kept");
+
+    stDB.Retrieve(2);
+    Check(stDB.Stat().Hit == 2 && stDB.Stat().Miss == 10 && stDB.Stat().Evict == 2, "hit / miss / evict counters");
+    Check(StatConsistent(stDB), "count and bytes match resources loaded but not freed");
+}
+
+static void CheckByteBudget()
+{
+    IntDB<0, 0, 64> stDB;
+    stDB.ByteBudget(100);
+
+    for(uint32_t nKey = 1; nKey <= 3; ++nKey){
+        stDB.SizeMap[nKey] = 30;
+        stDB.Retrieve(nKey);
+    }
+    Check(stDB.FreeV.empty() && stDB.Stat().Bytes == 90, "nothing evicted under the byte budget");
+
+    stDB.SizeMap[4] = 30;
+    stDB.Retrieve(4);
+    Check(stDB.FreeV == std::vector<uint32_t>({1}) && stDB.Stat().Bytes == 90, "loading over the byte budget evicts");
+
+    // larger than the budget
+    // all others go, it stays till next loading
+    stDB.SizeMap[5] = 150;
+    stDB.Retrieve(5);
+    Check(stDB.Stat().Count == 1 && stDB.InnCached(5) && stDB.Stat().Bytes == 150, "resource over the budget evicts all others but stays");
+
+    stDB.Retrieve(6);
+    Check(!stDB.InnCached(5) && stDB.InnCached(6) && stDB.Stat().Bytes == 10, "resource over the budget goes at next loading");
+
+    for(uint32_t nKey = 7; nKey <= 16; ++nKey){
+        stDB.Retrieve(nKey);
+    }
+    stDB.ByteBudget(40);
+    Check(stDB.Stat().Bytes == 100, "lower budget doesn't evict by itself");
+
+    stDB.Retrieve(17);
+    Check(stDB.Stat().Bytes == 40 && stDB.InnCached(17), "lower budget takes effect at next loading");
+    Check(StatConsistent(stDB), "count and bytes match resources loaded but not freed");
+}
+
+static void CheckHoldEviction()
+{
+    IntDB<0, 0, 4> stDB;
+
+    stDB.HoldEviction();
+    stDB.HoldEviction();
+    for(uint32_t nKey = 1; nKey <= 10; ++nKey){
+        stDB.Retrieve(nKey);
+    }
+    Check(stDB.FreeV.empty() && stDB.Stat().Count == 10, "nothing evicted while held, count limit is soft");
+
+    stDB.ReleaseEviction();
+    stDB.Retrieve(11);
+    Check(stDB.FreeV.empty() && stDB.Stat().Count == 11, "nested hold still pins after one release");
+
+    stDB.ReleaseEviction();
+    Check(stDB.FreeV.empty(), "release doesn't evict by itself");
+
+    stDB.Retrieve(12);
+    Check(stDB.Stat().Count == 4 && stDB.InnCached(12), "first loading after release evicts back to the limit");
+
+    // unbalanced release is ignored
+    stDB.ReleaseEviction();
+    stDB.Retrieve(13);
+    Check(stDB.Stat().Count == 4, "extra release is ignored");
+    Check(StatConsistent(stDB), "count and bytes match resources loaded but not freed");
+}
+
+static void CheckLinearCache()
+{
+    // linear cache of 4 buckets, 2 deep, bucket is key % 4
+    IntDB<2, 4, 12> stDB;
+    for(uint32_t nKey = 1; nKey <= 64; ++nKey){
+        stDB.Retrieve(nKey);
+
+        // 1 and 2 are retrieved after each loading
+        // they stay at head of their linear cache buckets
+        stDB.Retrieve(1);
+        stDB.Retrieve(2);
+    }
+    Check(stDB.InnCached(1) && stDB.InnCached(2), "records in the linear cache are not evicted");
+    Check(stDB.Stat().Count <= 12, "count limit is kept with linear cache");
+    Check(StatConsistent(stDB), "count and bytes match resources loaded but not freed");
+}
+
+static void CheckFreeOnce()
+{
+    std::vector<uint32_t> stLoadV;
+    std::vector<uint32_t> stFreeV;
+    {
+        IntDB<2, 4, 16> stDB;
+        stDB.ByteBudget(200);
+
+        uint32_t nSeed = 2463534242u;
+        for(int nRound = 0; nRound < 20000; ++nRound){
+            nSeed ^= (nSeed << 13);
+            nSeed ^= (nSeed >> 17);
+            nSeed ^= (nSeed <<  5);
+
+            uint32_t nKey = nSeed % 64;
+            stDB.SizeMap[nKey] = 5 + nKey % 40;
+
+            switch(nSeed / 64 % 16){
+                case 0 : stDB.HoldEviction();   break;
+                case 1 : stDB.ReleaseEviction(); break;
+                default: stDB.Retrieve(nKey);   break;
+            }
+        }
+
+        Check(StatConsistent(stDB), "count and bytes match resources loaded but not freed after random retrieving");
+
+        // free the rest as the destructor does
+        // logs are gone with the database
+        stDB.ClearCache();
+        stLoadV = stDB.LoadV;
+        stFreeV = stDB.FreeV;
+    }
+
+    std::unordered_map<uint32_t, int> stLiveMap;
+    for(auto nKey: stLoadV){
+        stLiveMap[nKey]++;
+    }
+    for(auto nKey: stFreeV){
+        stLiveMap[nKey]--;
+    }
+
+    bool bFreeOnce = true;
+    for(auto &rstLive: stLiveMap){
+        if(rstLive.second){
+            bFreeOnce = false;
+        }
+    }
+    Check(bFreeOnce, "every loaded resource is freed exactly once");
+}
+
+int main()
+{
+    CheckSecondChance();
+    CheckByteBudget();
+    CheckHoldEviction();
+    CheckLinearCache();
+    CheckFreeOnce();
+
+    std::printf("%s: %d check(s) failed\n", g_FailCount ? "FAIL" : "PASS", g_FailCount);
+    return g_FailCount ? 1 : 0;
+}
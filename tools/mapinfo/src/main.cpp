@@ -1,10 +1,45 @@
 #include <cstdio>
+#include <cstring>
 #include "mir2map.hpp"
+#include "mir2xmapdata.hpp"
+
+// convert mir2x map files to flat format
+// then they can be mapped and used without decoding
+static int ConvertFlat(int argc, char *argv[])
+{
+    if(argc < 4 || (argc % 2)){
+        printf("Usage: mapinfo -f src1 dst1 src2 dst2 ... srcN dstN\n\n");
+        return 1;
+    }
+
+    int nFailed = 0;
+    for(int nMapCnt = 2; nMapCnt + 1 < argc; nMapCnt += 2){
+        Mir2xMapData stMapData;
+        if(stMapData.Load(argv[nMapCnt])){
+            std::printf("load %s failed\n", argv[nMapCnt]);
+            nFailed++;
+            continue;
+        }
+
+        if(stMapData.SaveFlat(argv[nMapCnt + 1])){
+            std::printf("save %s failed\n", argv[nMapCnt + 1]);
+            nFailed++;
+            continue;
+        }
+        std::printf("%s -> %s, %d x %d\n", argv[nMapCnt], argv[nMapCnt + 1], stMapData.W(), stMapData.H());
+    }
+    return nFailed ? 1 : 0;
+}
 
 int main(int argc, char *argv[])
 {
     if(argc < 2){
-        printf("Usage: mapinfo map1 map2 ... mapN\n\n");
+        printf("Usage: mapinfo map1 map2 ... mapN\n");
+        printf("       mapinfo -f src1 dst1 src2 dst2 ... srcN dstN\n\n");
+    }
+
+    if(argc >= 2 && !std::strcmp(argv[1], "-f")){
+        return ConvertFlat(argc, argv);
     }
 
     Mir2Map stMap;
@@ -0,0 +1,514 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 05/30/2017 19:12:40
+ *  Last Modified: 05/30/2017 22:47:16
+ *
+ *    Description: compare GridPathFinder with AStarPathFinder on the same maps
+ *
+ *                 AStarPathFinder is set up as the removed ServerMap::ServerPathFinder:
+ *                 step check and cost by std::function, 1.0 straight, 1.1 diagonal,
+ *                 100.0 / 100.1 into an occupied cell if CheckCO
+ *
+ *                 for each map two modes are run on the same queries:
+ *                      uniform : CheckCO = false, GridPathFinder uses JPS
+ *                      weighted: CheckCO = true,  GridPathFinder uses A*
+ *
+ *                 reports nodes expanded, wall time, and path cost checked cell by
+ *                 cell with the same cost function, a finder which gives a longer
+ *                 path or fails where the other one succeeds is counted
+ *
+ *                 each AStarPathFinder query runs in a child process with a time limit:
+ *                 SearchStep() frees a closed node when it's reopened but its children
+ *                 still point to it, the fixed size allocator reuses it and the parent
+ *                 chain can become a cycle, then building the solution never returns,
+ *                 such queries are counted as hung, time and expansions exclude them
+ *
+ *                 maps are generated if no map file given, otherwise walkable cells
+ *                 are decoded the same way as ServerMap
+ *
+ *                 usage: pathbench [-q queries] [-d max distance] [-t seconds] [map1 map2 ...]
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "mathfunc.hpp"
+#include "pathfinder.hpp"
+#include "mir2xmapdata.hpp"
+#include "gridpathfinder.hpp"
+
+class BenchMap final
+{
+    public:
+        std::string Name;
+
+    public:
+        GridPathFinder::WalkMap WalkMap;
+
+        // cells taken by char objects, only used by weighted search
+        BitGrid OccupiedBits;
+
+    public:
+        BenchMap(const char *szName, int nW, int nH)
+            : Name(szName)
+            , WalkMap(nW, nH)
+            , OccupiedBits(nW, nH)
+        {}
+
+    public:
+        bool GroundValid(int nX, int nY) const
+        {
+            return true
+                && nX >= 0 && nX < WalkMap.W()
+                && nY >= 0 && nY < WalkMap.H()
+                && WalkMap.Walkable(nX, nY);
+        }
+
+        bool CanMove(int nX, int nY) const
+        {
+            return GroundValid(nX, nY) && !OccupiedBits.Get(nX, nY);
+        }
+};
+
+class BenchRand final
+{
+    private:
+        uint32_t m_Seed;
+
+    public:
+        BenchRand(uint32_t nSeed)
+            : m_Seed(nSeed)
+        {}
+
+    public:
+        int Rand(int nMax)
+        {
+            m_Seed ^= (m_Seed << 13);
+            m_Seed ^= (m_Seed >> 17);
+            m_Seed ^= (m_Seed <<  5);
+            return (int)(m_Seed % (uint32_t)(nMax));
+        }
+};
+
+// random blocked cells
+static BenchMap *MakeNoiseMap(const char *szName, int nW, int nH, int nBlockPercent, uint32_t nSeed)
+{
+    auto pMap = new BenchMap(szName, nW, nH);
+    BenchRand stRand(nSeed);
+
+    for(int nY = 0; nY < nH; ++nY){
+        for(int nX = 0; nX < nW; ++nX){
+            pMap->WalkMap.Set(nX, nY, stRand.Rand(100) >= nBlockPercent);
+        }
+    }
+    return pMap;
+}
+
+// rooms of nRoomSize x nRoomSize, walls with one door of 2 cells on each side
+// long walls make the search expand a lot, like the castle maps
+static BenchMap *MakeRoomMap(const char *szName, int nW, int nH, int nRoomSize, uint32_t nSeed)
+{
+    auto pMap = new BenchMap(szName, nW, nH);
+    BenchRand stRand(nSeed);
+
+    for(int nY = 0; nY < nH; ++nY){
+        for(int nX = 0; nX < nW; ++nX){
+            pMap->WalkMap.Set(nX, nY, (nX % nRoomSize) && (nY % nRoomSize));
+        }
+    }
+
+    for(int nRoomY = 0; nRoomY < nH; nRoomY += nRoomSize){
+        for(int nRoomX = 0; nRoomX < nW; nRoomX += nRoomSize){
+            auto nDoorX = nRoomX + 1 + stRand.Rand(nRoomSize - 3);
+            auto nDoorY = nRoomY + 1 + stRand.Rand(nRoomSize - 3);
+
+            for(int nDoor = 0; nDoor < 2; ++nDoor){
+                if(nDoorX + nDoor < nW){ pMap->WalkMap.Set(nDoorX + nDoor, nRoomY, true); }
+                if(nDoorY + nDoor < nH){ pMap->WalkMap.Set(nRoomX, nDoorY + nDoor, true); }
+            }
+        }
+    }
+    return pMap;
+}
+
+static BenchMap *LoadMap(const char *szPath)
+{
+    Mir2xMapData stMapData;
+    if(stMapData.Load(szPath) || !stMapData.Valid()){
+        return nullptr;
+    }
+
+    auto pMap = new BenchMap(szPath, stMapData.W(), stMapData.H());
+    for(int nX = 0; nX < stMapData.W(); ++nX){
+        for(int nY = 0; nY < stMapData.H(); ++nY){
+            pMap->WalkMap.Set(nX, nY, true
+                    && (stMapData.Cell(nX, nY).Param & 0X80000000)
+                    && (stMapData.Cell(nX, nY).Param & 0X00800000));
+        }
+    }
+    return pMap;
+}
+
+// 5% of walkable cells are taken
+static void PlaceCreature(BenchMap *pMap, uint32_t nSeed)
+{
+    BenchRand stRand(nSeed);
+    for(int nY = 0; nY < pMap->WalkMap.H(); ++nY){
+        for(int nX = 0; nX < pMap->WalkMap.W(); ++nX){
+            pMap->OccupiedBits.Set(nX, nY, pMap->GroundValid(nX, nY) && (stRand.Rand(100) < 5));
+        }
+    }
+}
+
+typedef struct{
+    int X0;
+    int Y0;
+    int X1;
+    int Y1;
+}BenchQuery;
+
+// start and goal are walkable, not taken, and not farther than nMaxDistance
+// goal could be unreachable, server gets such queries as well
+static std::vector<BenchQuery> MakeQuery(const BenchMap *pMap, int nQueryCount, int nMaxDistance, uint32_t nSeed)
+{
+    BenchRand stRand(nSeed);
+    std::vector<BenchQuery> stQueryV;
+
+    for(int nTry = 0; (int)(stQueryV.size()) < nQueryCount && nTry < nQueryCount * 1000; ++nTry){
+        int nX0 = stRand.Rand(pMap->WalkMap.W());
+        int nY0 = stRand.Rand(pMap->WalkMap.H());
+        int nX1 = nX0 + stRand.Rand(2 * nMaxDistance + 1) - nMaxDistance;
+        int nY1 = nY0 + stRand.Rand(2 * nMaxDistance + 1) - nMaxDistance;
+
+        if(true
+                && pMap->CanMove(nX0, nY0)
+                && pMap->CanMove(nX1, nY1)
+                && (nX0 != nX1 || nY0 != nY1)){
+            stQueryV.push_back({nX0, nY0, nX1, nY1});
+        }
+    }
+    return stQueryV;
+}
+
+// same as ServerPathFinder
+static double StepCost(const BenchMap *pMap, bool bCheckCO, int nSrcX, int nSrcY, int nDstX, int nDstY)
+{
+    switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
+        case 1:
+        case 2:
+            {
+                if(!pMap->GroundValid(nDstX, nDstY)){
+                    return 10000.0;
+                }
+
+                auto fCost = (LDistance2(nSrcX, nSrcY, nDstX, nDstY) == 1) ? 1.0 : 1.1;
+                if(bCheckCO && !pMap->CanMove(nDstX, nDstY)){
+                    fCost += 99.0;
+                }
+                return fCost;
+            }
+        default:
+            {
+                return 10000.0;
+            }
+    }
+}
+
+static double PathCost(const BenchMap *pMap, bool bCheckCO, const std::vector<PathFind::PathNode> &rstPathV)
+{
+    double fCost = 0.0;
+    for(size_t nIndex = 1; nIndex < rstPathV.size(); ++nIndex){
+        fCost += StepCost(pMap, bCheckCO, rstPathV[nIndex - 1].X, rstPathV[nIndex - 1].Y, rstPathV[nIndex].X, rstPathV[nIndex].Y);
+    }
+    return fCost;
+}
+
+typedef struct{
+    int    Found;
+    int    Hung;
+    size_t Expand;
+    double MS;
+
+    // found path of each query, empty if failed
+    std::vector<std::vector<PathFind::PathNode>> PathVV;
+
+    // query finished, only hung AStarPathFinder query is not
+    std::vector<bool> DoneV;
+}BenchResult;
+
+typedef struct{
+    int    Found;
+    int    Expand;
+    double MS;
+    int    PathLen;
+}AStarReply;
+
+// write all or fail
+static bool WriteAll(int nFD, const void *pData, size_t nSize)
+{
+    for(size_t nDone = 0; nDone < nSize;){
+        auto nCount = write(nFD, (const uint8_t *)(pData) + nDone, nSize - nDone);
+        if(nCount <= 0){
+            return false;
+        }
+        nDone += (size_t)(nCount);
+    }
+    return true;
+}
+
+static bool ReadAll(int nFD, void *pData, size_t nSize)
+{
+    for(size_t nDone = 0; nDone < nSize;){
+        auto nCount = read(nFD, (uint8_t *)(pData) + nDone, nSize - nDone);
+        if(nCount <= 0){
+            return false;
+        }
+        nDone += (size_t)(nCount);
+    }
+    return true;
+}
+
+// search in the current process and write AStarReply + path to nFD
+static void AStarQuery(const BenchMap *pMap, bool bCheckCO, const BenchQuery &rstQuery, int nFD)
+{
+    auto stStart = std::chrono::steady_clock::now();
+
+    // constructed per query, as ServerMap did
+    AStarPathFinder stFinder(
+            [pMap](int nSrcX, int nSrcY, int nDstX, int nDstY) -> bool
+            {
+                switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
+                    case 1  :
+                    case 2  : return pMap->GroundValid(nDstX, nDstY);
+                    default : return false;
+                }
+            },
+
+            [pMap, bCheckCO](int nSrcX, int nSrcY, int nDstX, int nDstY) -> double
+            {
+                return StepCost(pMap, bCheckCO, nSrcX, nSrcY, nDstX, nDstY);
+            });
+
+    std::vector<PathFind::PathNode> stPathV;
+    bool bFound = stFinder.Search(rstQuery.X0, rstQuery.Y0, rstQuery.X1, rstQuery.Y1);
+    if(bFound){
+        for(auto pNode = stFinder.GetSolutionStart(); pNode; pNode = stFinder.GetSolutionNext()){
+            stPathV.emplace_back(pNode->X(), pNode->Y());
+        }
+    }
+
+    AStarReply stReply;
+    stReply.Found   = bFound ? 1 : 0;
+    stReply.Expand  = stFinder.GetStepCount();
+    stReply.MS      = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stStart).count();
+    stReply.PathLen = (int)(stPathV.size());
+
+    if(WriteAll(nFD, &stReply, sizeof(stReply)) && !stPathV.empty()){
+        WriteAll(nFD, &(stPathV[0]), stPathV.size() * sizeof(stPathV[0]));
+    }
+}
+
+static BenchResult RunAStar(const BenchMap *pMap, bool bCheckCO, const std::vector<BenchQuery> &rstQueryV, int nTimeLimit)
+{
+    BenchResult stResult {0, 0, 0, 0.0, {}, {}};
+    stResult.PathVV.resize(rstQueryV.size());
+    stResult.DoneV.resize(rstQueryV.size(), false);
+
+    for(size_t nQuery = 0; nQuery < rstQueryV.size(); ++nQuery){
+        int nPipe[2];
+        if(pipe(nPipe)){
+            std::printf("pipe() failed\n");
+            std::exit(1);
+        }
+
+        auto nPID = fork();
+        if(nPID < 0){
+            std::printf("fork() failed\n");
+            std::exit(1);
+        }
+
+        if(nPID == 0){
+            // child: killed by SIGALRM if hung
+            close(nPipe[0]);
+            alarm((unsigned int)(nTimeLimit));
+
+            AStarQuery(pMap, bCheckCO, rstQueryV[nQuery], nPipe[1]);
+            close(nPipe[1]);
+            _exit(0);
+        }
+
+        // read before waitpid(), long path could fill the pipe
+        close(nPipe[1]);
+
+        AStarReply stReply;
+        bool bReply = ReadAll(nPipe[0], &stReply, sizeof(stReply));
+        if(bReply && stReply.PathLen > 0){
+            auto &rstPathV = stResult.PathVV[nQuery];
+            rstPathV.resize((size_t)(stReply.PathLen), {0, 0});
+            bReply = ReadAll(nPipe[0], &(rstPathV[0]), rstPathV.size() * sizeof(rstPathV[0]));
+        }
+
+        close(nPipe[0]);
+        waitpid(nPID, nullptr, 0);
+
+        if(!bReply){
+            stResult.PathVV[nQuery].clear();
+            stResult.Hung++;
+            continue;
+        }
+
+        stResult.Found  += stReply.Found;
+        stResult.Expand += (size_t)(stReply.Expand);
+        stResult.MS     += stReply.MS;
+
+        stResult.DoneV[nQuery] = true;
+    }
+    return stResult;
+}
+
+// skip the queries AStarPathFinder didn't finish, then time and expansions are on the same set
+static BenchResult RunGrid(const BenchMap *pMap, bool bCheckCO, const std::vector<BenchQuery> &rstQueryV, const std::vector<bool> &rstDoneV)
+{
+    BenchResult stResult {0, 0, 0, 0.0, {}, {}};
+    stResult.PathVV.resize(rstQueryV.size());
+    stResult.DoneV = rstDoneV;
+
+    auto stStart = std::chrono::steady_clock::now();
+    for(size_t nQuery = 0; nQuery < rstQueryV.size(); ++nQuery){
+        if(!rstDoneV[nQuery]){
+            continue;
+        }
+
+        auto &rstQuery = rstQueryV[nQuery];
+
+        GridPathFinder stFinder(&(pMap->WalkMap));
+        bool bFound = bCheckCO
+            ? stFinder.Search(rstQuery.X0, rstQuery.Y0, rstQuery.X1, rstQuery.Y1, [pMap](int nX, int nY){ return pMap->OccupiedBits.Get(nX, nY); })
+            : stFinder.Search(rstQuery.X0, rstQuery.Y0, rstQuery.X1, rstQuery.Y1);
+
+        if(bFound){
+            stResult.PathVV[nQuery] = stFinder.Path();
+            stResult.Found++;
+        }
+        stResult.Expand += stFinder.ExpandCount();
+    }
+
+    stResult.MS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stStart).count();
+    return stResult;
+}
+
+static void RunBench(const BenchMap *pMap, bool bCheckCO, const std::vector<BenchQuery> &rstQueryV, int nTimeLimit)
+{
+    auto stAStar = RunAStar(pMap, bCheckCO, rstQueryV, nTimeLimit);
+    auto stGrid  = RunGrid (pMap, bCheckCO, rstQueryV, stAStar.DoneV);
+
+    // compare path cost if both found
+    // count the one which is longer, equal cost paths could take different cells
+    int nAStarLonger = 0;
+    int nGridLonger  = 0;
+    for(size_t nQuery = 0; nQuery < rstQueryV.size(); ++nQuery){
+        if(stAStar.PathVV[nQuery].empty() || stGrid.PathVV[nQuery].empty()){
+            continue;
+        }
+
+        auto fAStarCost = PathCost(pMap, bCheckCO, stAStar.PathVV[nQuery]);
+        auto fGridCost  = PathCost(pMap, bCheckCO, stGrid .PathVV[nQuery]);
+
+        if(fAStarCost > fGridCost + 1e-3){ nAStarLonger++; }
+        if(fGridCost > fAStarCost + 1e-3){ nGridLonger++;  }
+    }
+
+    std::printf("%-24s %-8s %7zu %6d %6d %6d %12zu %12zu %10.2f %10.2f %8.1fx %6d %6d\n",
+            pMap->Name.c_str(),
+            bCheckCO ? "weighted" : "uniform",
+            rstQueryV.size(),
+            stAStar.Hung,
+            stAStar.Found,
+            stGrid.Found,
+            stAStar.Expand,
+            stGrid.Expand,
+            stAStar.MS,
+            stGrid.MS,
+            (stGrid.MS > 0.0) ? (stAStar.MS / stGrid.MS) : 0.0,
+            nAStarLonger,
+            nGridLonger);
+}
+
+int main(int argc, char *argv[])
+{
+    int nQueryCount  = 200;
+    int nMaxDistance = 64;
+    int nTimeLimit   = 1;
+
+    std::vector<BenchMap *> stMapV;
+    for(int nArg = 1; nArg < argc; ++nArg){
+        if(!std::strcmp(argv[nArg], "-q") && nArg + 1 < argc){
+            nQueryCount = std::atoi(argv[++nArg]);
+            continue;
+        }
+
+        if(!std::strcmp(argv[nArg], "-d") && nArg + 1 < argc){
+            nMaxDistance = std::atoi(argv[++nArg]);
+            continue;
+        }
+
+        if(!std::strcmp(argv[nArg], "-t") && nArg + 1 < argc){
+            nTimeLimit = std::atoi(argv[++nArg]);
+            continue;
+        }
+
+        if(auto pMap = LoadMap(argv[nArg])){
+            stMapV.push_back(pMap);
+        }else{
+            std::printf("load %s failed\n", argv[nArg]);
+        }
+    }
+
+    if(nQueryCount <= 0 || nMaxDistance <= 0 || nTimeLimit <= 0){
+        std::printf("Usage: pathbench [-q queries] [-d max distance] [-t seconds] [map1 map2 ...]\n\n");
+        return 1;
+    }
+
+    if(stMapV.empty()){
+        stMapV.push_back(MakeNoiseMap("noise-256x256-10%", 256, 256, 10, 1));
+        stMapV.push_back(MakeNoiseMap("noise-256x256-30%", 256, 256, 30, 2));
+        stMapV.push_back(MakeRoomMap ("rooms-512x512-32",  512, 512, 32, 3));
+    }
+
+    std::printf("queries per map: %d, max distance: %d, time in ms for all queries\n", nQueryCount, nMaxDistance);
+    std::printf("AStarPathFinder has 1000 nodes by default, it can fail or detour on long searches\n");
+    std::printf("AStarPathFinder query not done in %d second(s) is counted as hung\n\n", nTimeLimit);
+
+    std::printf("%-24s %-8s %7s %6s %6s %6s %12s %12s %10s %10s %9s %6s %6s\n",
+            "map", "mode", "queries", "hung", "found", "found", "expand", "expand", "time", "time", "speedup", "longer", "longer");
+    std::printf("%-24s %-8s %7s %6s %6s %6s %12s %12s %10s %10s %9s %6s %6s\n",
+            "", "", "", "astar", "astar", "grid", "astar", "grid", "astar", "grid", "", "astar", "grid");
+
+    for(auto pMap: stMapV){
+        PlaceCreature(pMap, 7);
+        auto stQueryV = MakeQuery(pMap, nQueryCount, nMaxDistance, 11);
+
+        RunBench(pMap, false, stQueryV, nTimeLimit);
+        RunBench(pMap, true,  stQueryV, nTimeLimit);
+        delete pMap;
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: fakeserver.cpp
+ *        Created: 06/02/2017 14:20:31
+ *  Last Modified: 06/02/2017 15:41:02
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstring>
+#include <condition_variable>
+
+#include "monoserver.hpp"
+#include "syncdriver.hpp"
+#include "fakeserver.hpp"
+
+// not used, fakeserver replaces everything referring to it
+MonoServer *g_MonoServer = nullptr;
+
+static std::mutex              g_ReplyLock;
+static std::condition_variable g_ReplyCond;
+static std::vector<FakeReply>  g_ReplyV;
+
+int SyncDriver::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr, uint32_t nRespond)
+{
+    FakeReply stReply;
+    stReply.Type    = rstMB.Type();
+    stReply.Address = rstAddr.AsString();
+    stReply.Respond = nRespond;
+
+    std::memset(&(stReply.AMPFOK), 0, sizeof(stReply.AMPFOK));
+    if(rstMB.Type() == MPK_PATHFINDOK && rstMB.DataLen() == sizeof(stReply.AMPFOK)){
+        std::memcpy(&(stReply.AMPFOK), rstMB.Data(), sizeof(stReply.AMPFOK));
+    }
+
+    {
+        std::lock_guard<std::mutex> stLockGuard(g_ReplyLock);
+        g_ReplyV.push_back(stReply);
+    }
+
+    g_ReplyCond.notify_all();
+    return 0;
+}
+
+void MonoServer::AddLog(const std::array<std::string, 4> &, const char *, ...)
+{
+}
+
+bool WaitFakeReply(size_t nIndex, int nTimeoutMS, FakeReply *pReply)
+{
+    std::unique_lock<std::mutex> stLock(g_ReplyLock);
+    if(!g_ReplyCond.wait_for(stLock, std::chrono::milliseconds(nTimeoutMS), [nIndex](){ return g_ReplyV.size() > nIndex; })){
+        return false;
+    }
+
+    if(pReply){
+        *pReply = g_ReplyV[nIndex];
+    }
+    return true;
+}
+
+size_t FakeReplyCount()
+{
+    std::lock_guard<std::mutex> stLockGuard(g_ReplyLock);
+    return g_ReplyV.size();
+}
@@ -0,0 +1,42 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: fakeserver.hpp
+ *        Created: 06/02/2017 14:12:09
+ *  Last Modified: 06/02/2017 15:40:26
+ *
+ *    Description: record what PathFindPN sends, no actor or framework behind it
+ *
+ *                 fakeserver.cpp defines SyncDriver::Forward() which only pushes the
+ *                 reply here, and an empty MonoServer::AddLog() for Report()
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include "actormessage.hpp"
+
+typedef struct
+{
+    int         Type;
+    std::string Address;
+    uint32_t    Respond;
+
+    // only valid for MPK_PATHFINDOK
+    AMPathFindOK AMPFOK;
+}FakeReply;
+
+// replies are sent by worker threads
+// wait until the nIndex-th reply comes, return false if timeout
+bool WaitFakeReply(size_t nIndex, int nTimeoutMS, FakeReply *);
+size_t FakeReplyCount();
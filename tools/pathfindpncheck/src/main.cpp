@@ -0,0 +1,235 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 06/02/2017 14:08:53
+ *  Last Modified: 06/02/2017 16:27:15
+ *
+ *    Description: check PathFindPN on a small map, replies are recorded by fakeserver
+ *                 1. worker replies MPK_PATHFINDOK / MPK_ERROR to the requestor, as
+ *                    the response of the given message ID
+ *                 2. Query() hits for the same goal from the same start region
+ *                 3. least recently used entry is evicted, a hit refreshes it
+ *                 4. entries expire, failed search is not cached
+ *
+ *                 print failed checks and return non-zero
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "pathfindpn.hpp"
+#include "fakeserver.hpp"
+
+static int g_FailCount = 0;
+static void Check(bool bResult, const char *szCheck)
+{
+    std::printf("[%s] %s\n", bResult ? "PASS" : "FAIL", szCheck);
+    if(!bResult){
+        g_FailCount++;
+    }
+}
+
+// 64 x 64 open map with a closed box
+// cells inside the box are walkable but can't be reached
+static std::shared_ptr<const PathFindPN::Snapshot> CreateSnapshot()
+{
+    auto pSnapshot = std::make_shared<PathFindPN::Snapshot>(64, 64);
+    for(int nX = 0; nX < 64; ++nX){
+        for(int nY = 0; nY < 64; ++nY){
+            bool bWall = true
+                && (nX >= 40 && nX <= 48)
+                && (nY >= 40 && nY <= 48)
+                && (nX == 40 || nX == 48 || nY == 40 || nY == 48);
+            pSnapshot->WalkMap.Set(nX, nY, !bWall);
+        }
+    }
+
+    pSnapshot->Graph.Build();
+    return pSnapshot;
+}
+
+static AMPathFind MakeAMPathFind(int nX, int nY, int nEndX, int nEndY)
+{
+    AMPathFind stAMPF;
+    stAMPF.UID     = 1001;
+    stAMPF.MapID   = 1;
+    stAMPF.CheckCO = false;
+    stAMPF.X       = nX;
+    stAMPF.Y       = nY;
+    stAMPF.EndX    = nEndX;
+    stAMPF.EndY    = nEndY;
+    return stAMPF;
+}
+
+// submit and wait for the reply
+static bool SubmitWait(PathFindPN *pPN, const std::shared_ptr<const PathFindPN::Snapshot> &pSnapshot, const AMPathFind &rstAMPF, const char *szAddr, uint32_t nRespond, FakeReply *pReply)
+{
+    auto nIndex = FakeReplyCount();
+    if(!pPN->Submit(pSnapshot, {}, rstAMPF.MapID, rstAMPF, Theron::Address(szAddr), nRespond)){
+        return false;
+    }
+    return WaitFakeReply(nIndex, 5000, pReply);
+}
+
+// worker replies before it fills the cache
+// poll until the entry shows up
+static bool QueryWait(PathFindPN *pPN, const AMPathFind &rstAMPF, AMPathFindOK *pAMPFOK)
+{
+    auto stDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while(std::chrono::steady_clock::now() < stDeadline){
+        if(pPN->Query(rstAMPF.MapID, rstAMPF, pAMPFOK)){
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static bool IsAdjacent(int nX0, int nY0, int nX1, int nY1)
+{
+    return std::max<int>(std::abs(nX0 - nX1), std::abs(nY0 - nY1)) == 1;
+}
+
+static void CheckReply(const std::shared_ptr<const PathFindPN::Snapshot> &pSnapshot)
+{
+    PathFindPN stPN(1, 16);
+    Check(!stPN.Submit(nullptr, {}, 1, MakeAMPathFind(2, 2, 60, 60), Theron::Address("requestor-a"), 17), "Submit() fails without snapshot");
+
+    FakeReply stReply;
+    bool bReply = SubmitWait(&stPN, pSnapshot, MakeAMPathFind(2, 2, 60, 60), "requestor-a", 17, &stReply);
+    Check(true
+            && bReply
+            && stReply.Type == MPK_PATHFINDOK
+            && stReply.Address == "requestor-a"
+            && stReply.Respond == 17
+            && stReply.AMPFOK.UID   == 1001
+            && stReply.AMPFOK.MapID == 1
+            && stReply.AMPFOK.Point[0].X == 2
+            && stReply.AMPFOK.Point[0].Y == 2
+            && IsAdjacent(2, 2, stReply.AMPFOK.Point[1].X, stReply.AMPFOK.Point[1].Y), "MPK_PATHFINDOK goes to requestor as response of its message");
+
+    bReply = SubmitWait(&stPN, pSnapshot, MakeAMPathFind(2, 2, 44, 44), "requestor-b", 23, &stReply);
+    Check(true
+            && bReply
+            && stReply.Type == MPK_ERROR
+            && stReply.Address == "requestor-b"
+            && stReply.Respond == 23, "MPK_ERROR goes to requestor as response of its message if unreachable");
+
+    // wait the worker till done, then nothing could fill the cache
+    AMPathFindOK stAMPFOK;
+    Check(QueryWait(&stPN, MakeAMPathFind(2, 2, 60, 60), &stAMPFOK), "found path is cached");
+    Check(!stPN.Query(1, MakeAMPathFind(2, 2, 44, 44), &stAMPFOK), "failed search is not cached");
+}
+
+static void CheckQuery(const std::shared_ptr<const PathFindPN::Snapshot> &pSnapshot)
+{
+    PathFindPN stPN(1, 16);
+
+    AMPathFindOK stAMPFOK;
+    Check(!stPN.Query(1, MakeAMPathFind(2, 2, 60, 60), &stAMPFOK), "Query() misses on empty cache");
+
+    FakeReply stReply;
+    if(!SubmitWait(&stPN, pSnapshot, MakeAMPathFind(2, 2, 60, 60), "requestor-a", 1, &stReply)){
+        Check(false, "Submit() replies for reachable goal");
+        return;
+    }
+
+    bool bHit = QueryWait(&stPN, MakeAMPathFind(2, 2, 60, 60), &stAMPFOK);
+    Check(true
+            && bHit
+            && stAMPFOK.UID   == 1001
+            && stAMPFOK.MapID == 1
+            && stAMPFOK.Point[0].X == 2
+            && stAMPFOK.Point[0].Y == 2
+            && stAMPFOK.Point[1].X == stReply.AMPFOK.Point[1].X
+            && stAMPFOK.Point[1].Y == stReply.AMPFOK.Point[1].Y, "Query() hits for the same start and goal");
+
+    // (1, 3) is next to the start, the path leaves it
+    bHit = stPN.Query(1, MakeAMPathFind(1, 3, 60, 60), &stAMPFOK);
+    Check(true
+            && bHit
+            && stAMPFOK.Point[0].X == 1
+            && stAMPFOK.Point[0].Y == 3
+            && IsAdjacent(1, 3, stAMPFOK.Point[1].X, stAMPFOK.Point[1].Y), "Query() hits from a cell next to the cached path, path starts from it");
+
+    Check(!stPN.Query(1, MakeAMPathFind(7, 0, 60, 60), &stAMPFOK), "Query() misses in the same region but away from the path");
+    Check(!stPN.Query(1, MakeAMPathFind(2, 2, 60, 59), &stAMPFOK), "Query() misses for another goal");
+    Check(!stPN.Query(2, MakeAMPathFind(2, 2, 60, 60), &stAMPFOK), "Query() misses on another map");
+    Check(!stPN.Query(1, MakeAMPathFind(9, 2, 60, 60), &stAMPFOK), "Query() misses from another region");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    Check(!stPN.Query(1, MakeAMPathFind(2, 2, 60, 60), &stAMPFOK), "cached path expires");
+}
+
+static void CheckEvict(const std::shared_ptr<const PathFindPN::Snapshot> &pSnapshot)
+{
+    auto stAMPF0 = MakeAMPathFind( 2, 2, 60, 60);
+    auto stAMPF1 = MakeAMPathFind(10, 2, 60, 60);
+    auto stAMPF2 = MakeAMPathFind(18, 2, 60, 60);
+
+    AMPathFindOK stAMPFOK;
+    {
+        PathFindPN stPN(1, 2);
+        SubmitWait(&stPN, pSnapshot, stAMPF0, "requestor-a", 1, nullptr);
+        QueryWait (&stPN, stAMPF0, &stAMPFOK);
+        SubmitWait(&stPN, pSnapshot, stAMPF1, "requestor-a", 2, nullptr);
+        QueryWait (&stPN, stAMPF1, &stAMPFOK);
+        SubmitWait(&stPN, pSnapshot, stAMPF2, "requestor-a", 3, nullptr);
+
+        bool bHit2 = QueryWait(&stPN, stAMPF2, &stAMPFOK);
+        bool bHit1 = stPN.Query(1, stAMPF1, &stAMPFOK);
+        bool bHit0 = stPN.Query(1, stAMPF0, &stAMPFOK);
+        Check(bHit2 && bHit1 && !bHit0, "full cache evicts the least recently added");
+    }
+
+    {
+        PathFindPN stPN(1, 2);
+        SubmitWait(&stPN, pSnapshot, stAMPF0, "requestor-a", 1, nullptr);
+        QueryWait (&stPN, stAMPF0, &stAMPFOK);
+        SubmitWait(&stPN, pSnapshot, stAMPF1, "requestor-a", 2, nullptr);
+        QueryWait (&stPN, stAMPF1, &stAMPFOK);
+
+        // hit moves entry 0 to the front
+        stPN.Query(1, stAMPF0, &stAMPFOK);
+        SubmitWait(&stPN, pSnapshot, stAMPF2, "requestor-a", 3, nullptr);
+
+        bool bHit2 = QueryWait(&stPN, stAMPF2, &stAMPFOK);
+        bool bHit1 = stPN.Query(1, stAMPF1, &stAMPFOK);
+        bool bHit0 = stPN.Query(1, stAMPF0, &stAMPFOK);
+        Check(bHit2 && !bHit1 && bHit0, "full cache evicts the least recently used, Query() hit refreshes");
+    }
+
+    {
+        PathFindPN stPN(1, 0);
+        FakeReply stReply;
+        bool bReply = SubmitWait(&stPN, pSnapshot, stAMPF0, "requestor-a", 4, &stReply);
+        Check(bReply && stReply.Type == MPK_PATHFINDOK && !QueryWait(&stPN, stAMPF0, &stAMPFOK), "zero capacity replies without caching");
+    }
+}
+
+int main()
+{
+    auto pSnapshot = CreateSnapshot();
+
+    CheckReply(pSnapshot);
+    CheckQuery(pSnapshot);
+    CheckEvict(pSnapshot);
+
+    std::printf("%s: %d check(s) failed\n", g_FailCount ? "FAIL" : "PASS", g_FailCount);
+    return g_FailCount ? 1 : 0;
+}
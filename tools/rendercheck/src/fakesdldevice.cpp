@@ -0,0 +1,40 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: fakesdldevice.cpp
+ *        Created: 06/08/2017 19:02:51
+ *  Last Modified: 06/08/2017 19:40:13
+ *
+ *    Description: SDLDevice for SurfaceDecoder without window, renderer or png decoding
+ *                 only constructor, destructor and CreateSurface() are provided
+ *
+ *                 first byte of the data is the width of a one-row ARGB8888 surface
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include "sdldevice.hpp"
+
+// headless, no SDL_Init(), no window
+SDLDevice::SDLDevice()
+{}
+
+SDLDevice::~SDLDevice()
+{}
+
+static SDLDevice g_FakeSDLDevice;
+SDLDevice *g_SDLDevice = &g_FakeSDLDevice;
+
+SDL_Surface *SDLDevice::CreateSurface(const uint8_t *pMem, size_t nSize)
+{
+    if(pMem == nullptr || nSize <= 0 || pMem[0] == 0){ return nullptr; }
+    return SDL_CreateRGBSurfaceWithFormat(0, pMem[0], 1, 32, SDL_PIXELFORMAT_ARGB8888);
+}
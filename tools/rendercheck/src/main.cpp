@@ -0,0 +1,410 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 06/08/2017 19:05:37
+ *  Last Modified: 06/08/2017 21:12:48
+ *
+ *    Description: headless checks of the static map layer and texture decoder
+ *                 1. torus texture of StaticMapLayer: after any sequence of view
+ *                    rolls, redrawing only exposed regions leaves every pixel of the
+ *                    view the same as drawing it from scratch
+ *                 2. SurfaceDecoder: urgent before prefetch, prefetch queue drops
+ *                    the oldest, pending prefetch is promoted by an urgent request,
+ *                    a pending key is never queued twice
+ *
+ *                 print failed checks and return non-zero
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
+#include <condition_variable>
+
+#include "torusfunc.hpp"
+#include "surfacedecoder.hpp"
+
+static int g_FailCount = 0;
+static void Check(bool bResult, const char *szCheck)
+{
+    std::printf("[%s] %s\n", bResult ? "PASS" : "FAIL", szCheck);
+    if(!bResult){
+        g_FailCount++;
+    }
+}
+
+// xorshift, no shared state
+static uint32_t NextRand(uint32_t *pSeed)
+{
+    *pSeed ^= (*pSeed << 13);
+    *pSeed ^= (*pSeed >> 17);
+    *pSeed ^= (*pSeed <<  5);
+    return *pSeed;
+}
+
+static void CheckTorusSplit()
+{
+    Check(true
+            && TorusMod( 13, 7) == 6
+            && TorusMod(  7, 7) == 0
+            && TorusMod( -1, 7) == 6
+            && TorusMod( -7, 7) == 0
+            && TorusMod(-15, 7) == 6, "TorusMod() is non-negative for negative x");
+
+    bool bCover = true;
+    uint32_t nSeed = 2463534242u;
+    for(int nRound = 0; nRound < 100000; ++nRound){
+        int nSize = 1 + (int)(NextRand(&nSeed) % 64);
+        int nW    = 1 + (int)(NextRand(&nSeed) % nSize);
+        int nX    = (int)(NextRand(&nSeed) % 1000) - 500;
+
+        int nNextX     = nX;
+        int nPieceCount = 0;
+        TorusSplit(nX, nW, nSize, [&bCover, &nNextX, &nPieceCount, nSize](int nMapX, int nTexX, int nLen)
+        {
+            if(false
+                    || nMapX != nNextX
+                    || nLen  <= 0
+                    || nTexX != TorusMod(nMapX, nSize)
+                    || nTexX + nLen > nSize){
+                bCover = false;
+            }
+
+            nNextX += nLen;
+            nPieceCount++;
+        });
+
+        if(nNextX != nX + nW || nPieceCount > 2){
+            bCover = false;
+        }
+    }
+    Check(bCover, "TorusSplit() covers the span by at most two pieces inside the texture");
+}
+
+// texture keeps map pixel drawn to each texel, (x, y) packed
+// draw and blit follow StaticMapLayer::DrawRegion() and Draw()
+class TorusTexture final
+{
+    private:
+        const int m_W;
+        const int m_H;
+
+    private:
+        std::vector<std::pair<int, int>> m_TexelV;
+
+    public:
+        TorusTexture(int nW, int nH)
+            : m_W(nW)
+            , m_H(nH)
+            , m_TexelV((size_t)(nW) * nH, {-1000000, -1000000})
+        {}
+
+    public:
+        void DrawRegion(int nX, int nY, int nW, int nH)
+        {
+            TorusSplit(nX, nW, m_W, [this, nY, nH](int nMapX, int nTexX, int nPieceW)
+            {
+                TorusSplit(nY, nH, m_H, [this, nMapX, nTexX, nPieceW](int nMapY, int nTexY, int nPieceH)
+                {
+                    for(int nDY = 0; nDY < nPieceH; ++nDY){
+                        for(int nDX = 0; nDX < nPieceW; ++nDX){
+                            m_TexelV[(size_t)(nTexY + nDY) * m_W + nTexX + nDX] = {nMapX + nDX, nMapY + nDY};
+                        }
+                    }
+                });
+            });
+        }
+
+        // copy view to the screen and compare with the map
+        bool BlitSame(int nViewX, int nViewY) const
+        {
+            bool bSame = true;
+            int  nBlit = 0;
+            TorusSplit(nViewX, m_W, m_W, [this, nViewX, nViewY, &bSame, &nBlit](int nMapX, int nTexX, int nPieceW)
+            {
+                TorusSplit(nViewY, m_H, m_H, [this, nViewX, nViewY, nMapX, nTexX, nPieceW, &bSame, &nBlit](int nMapY, int nTexY, int nPieceH)
+                {
+                    for(int nDY = 0; nDY < nPieceH; ++nDY){
+                        for(int nDX = 0; nDX < nPieceW; ++nDX){
+                            int nScreenX = nMapX + nDX - nViewX;
+                            int nScreenY = nMapY + nDY - nViewY;
+
+                            auto &rstTexel = m_TexelV[(size_t)(nTexY + nDY) * m_W + nTexX + nDX];
+                            if(rstTexel.first != nViewX + nScreenX || rstTexel.second != nViewY + nScreenY){
+                                bSame = false;
+                            }
+                            nBlit++;
+                        }
+                    }
+                });
+            });
+            return bSame && (nBlit == m_W * m_H);
+        }
+};
+
+static void CheckTorusRoll(int nW, int nH, const char *szCheck)
+{
+    TorusTexture stTexture(nW, nH);
+
+    int  nViewX = 0;
+    int  nViewY = 0;
+    bool bValid = false;
+    bool bSame  = true;
+    bool bInner = true;
+
+    uint32_t nSeed = 88172645u;
+    for(int nRound = 0; nRound < 5000; ++nRound){
+        int nX = nViewX;
+        int nY = nViewY;
+        switch(NextRand(&nSeed) % 8){
+            case 0:
+                {
+                    nX = (int)(NextRand(&nSeed) % 4000) - 2000;
+                    nY = (int)(NextRand(&nSeed) % 4000) - 2000;
+                    break;
+                }
+            case 1:
+                {
+                    bValid = false;
+                    break;
+                }
+            case 2:
+                {
+                    nX += (int)(NextRand(&nSeed) % (4 * nW + 1)) - 2 * nW;
+                    nY += (int)(NextRand(&nSeed) % (4 * nH + 1)) - 2 * nH;
+                    break;
+                }
+            default:
+                {
+                    nX += (int)(NextRand(&nSeed) % 7) - 3;
+                    nY += (int)(NextRand(&nSeed) % 7) - 3;
+                    break;
+                }
+        }
+
+        if(bValid){
+            TorusExposed(nViewX, nViewY, nX, nY, nW, nH, [&stTexture, &bInner, nX, nY, nW, nH](int nRegionX, int nRegionY, int nRegionW, int nRegionH)
+            {
+                if(false
+                        || nRegionW <= 0
+                        || nRegionH <= 0
+                        || nRegionX < nX
+                        || nRegionY < nY
+                        || nRegionX + nRegionW > nX + nW
+                        || nRegionY + nRegionH > nY + nH){
+                    bInner = false;
+                }
+                stTexture.DrawRegion(nRegionX, nRegionY, nRegionW, nRegionH);
+            });
+        }else{
+            stTexture.DrawRegion(nX, nY, nW, nH);
+        }
+
+        nViewX = nX;
+        nViewY = nY;
+        bValid = true;
+
+        if(!stTexture.BlitSame(nViewX, nViewY)){
+            bSame = false;
+        }
+    }
+
+    Check(bInner, "TorusExposed() regions are inside the new view");
+    Check(bSame, szCheck);
+}
+
+// decoder with a gate, the worker blocks on reading the gate key
+// then requests pile up in the queues and the order can be checked
+class GatedReader final
+{
+    private:
+        std::mutex              m_Lock;
+        std::condition_variable m_CV;
+
+    private:
+        const uint32_t m_GateKey;
+        bool m_Entered;
+        bool m_Opened;
+
+    private:
+        std::vector<uint32_t> m_ReadV;
+
+    public:
+        GatedReader(uint32_t nGateKey)
+            : m_Lock()
+            , m_CV()
+            , m_GateKey(nGateKey)
+            , m_Entered(false)
+            , m_Opened(false)
+            , m_ReadV()
+        {}
+
+    public:
+        // odd keys fail
+        bool Read(uint32_t nKey, std::vector<uint8_t> *pBuf)
+        {
+            std::unique_lock<std::mutex> stLock(m_Lock);
+            m_ReadV.push_back(nKey);
+            if(nKey == m_GateKey){
+                m_Entered = true;
+                m_CV.notify_all();
+                m_CV.wait(stLock, [this](){ return m_Opened; });
+            }
+
+            if(nKey % 2){
+                return false;
+            }
+
+            pBuf->assign(1, (uint8_t)(1 + nKey % 200));
+            return true;
+        }
+
+        bool WaitEntered()
+        {
+            std::unique_lock<std::mutex> stLock(m_Lock);
+            return m_CV.wait_for(stLock, std::chrono::seconds(5), [this](){ return m_Entered; });
+        }
+
+        void Open()
+        {
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_Lock);
+                m_Opened = true;
+            }
+            m_CV.notify_all();
+        }
+
+        std::vector<uint32_t> ReadOrder()
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_Lock);
+            return m_ReadV;
+        }
+};
+
+// take nCount results, keys in taken order
+static std::vector<uint32_t> TakeWait(SurfaceDecoder *pDecoder, size_t nCount, bool *pSurfaceOK)
+{
+    std::vector<uint32_t> stKeyV;
+    auto stDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(stKeyV.size() < nCount && std::chrono::steady_clock::now() < stDeadline){
+        uint32_t     nKey     = 0;
+        SDL_Surface *pSurface = nullptr;
+        if(!pDecoder->Take(&nKey, &pSurface)){
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // odd keys fail and come as null
+        if(pSurfaceOK && ((nKey % 2) ? (pSurface != nullptr) : (pSurface == nullptr || pSurface->w != (int)(1 + nKey % 200)))){
+            *pSurfaceOK = false;
+        }
+
+        if(pSurface){
+            SDL_FreeSurface(pSurface);
+        }
+        stKeyV.push_back(nKey);
+    }
+    return stKeyV;
+}
+
+static void CheckDecoderOrder()
+{
+    GatedReader stReader(100);
+    SurfaceDecoder stDecoder([&stReader](uint32_t nKey, std::vector<uint8_t> *pBuf){ return stReader.Read(nKey, pBuf); }, 3);
+
+    stDecoder.Request(100, true);
+    if(!stReader.WaitEntered()){
+        Check(false, "worker starts decoding the urgent key");
+        stReader.Open();
+        return;
+    }
+
+    stDecoder.Request(2, false);
+    stDecoder.Request(4, false);
+    stDecoder.Request(6, false);
+    stDecoder.Request(8, false);
+    Check(true
+            && !stDecoder.Pending(2)
+            &&  stDecoder.Pending(4)
+            &&  stDecoder.Pending(6)
+            &&  stDecoder.Pending(8), "full prefetch queue drops the oldest");
+
+    stDecoder.Request(10,  true);
+    stDecoder.Request( 6,  true);
+    stDecoder.Request(10, false);
+    stDecoder.Request(10,  true);
+    stDecoder.Request(100, true);
+    stDecoder.Request(13,  true);
+    Check(stDecoder.PendingCount() == 6, "pending key is not queued twice, including the one being decoded");
+
+    stReader.Open();
+
+    bool bSurfaceOK = true;
+    auto stTakeV = TakeWait(&stDecoder, 6, &bSurfaceOK);
+    auto stReadV = stReader.ReadOrder();
+    Check(stReadV == std::vector<uint32_t>({100, 10, 6, 13, 4, 8}), "urgent keys first in request order, promoted prefetch goes urgent, then prefetch");
+    Check(stTakeV == stReadV, "results come in decoding order");
+    Check(bSurfaceOK, "decoded key gets the surface, failed one gets null");
+    Check(stDecoder.PendingCount() == 0, "taken key is not pending");
+
+    // taken key can be requested again
+    stDecoder.Request(100, true);
+    stTakeV = TakeWait(&stDecoder, 1, nullptr);
+    Check(stTakeV == std::vector<uint32_t>({100}), "taken key can be requested again");
+}
+
+static void CheckDecoderNoPrefetch()
+{
+    GatedReader stReader(0);
+    SurfaceDecoder stDecoder([&stReader](uint32_t nKey, std::vector<uint8_t> *pBuf){ return stReader.Read(nKey, pBuf); }, 0);
+
+    stDecoder.Request(2, false);
+    stDecoder.Request(4, true);
+    Check(!stDecoder.Pending(2) && stDecoder.Pending(4), "prefetch is ignored if capacity is zero");
+
+    auto stTakeV = TakeWait(&stDecoder, 1, nullptr);
+    Check(stTakeV == std::vector<uint32_t>({4}), "urgent still works if prefetch capacity is zero");
+}
+
+static void CheckDecoderDestroy()
+{
+    // results and queued keys left in the decoder
+    // sanitizer reports if any surface leaks
+    GatedReader stReader(0);
+    {
+        SurfaceDecoder stDecoder([&stReader](uint32_t nKey, std::vector<uint8_t> *pBuf){ return stReader.Read(nKey, pBuf); }, 64);
+        for(uint32_t nKey = 2; nKey < 256; nKey += 2){
+            stDecoder.Request(nKey, (nKey % 4) == 0);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    Check(true, "destructor stops the worker with keys queued and results not taken");
+}
+
+int main()
+{
+    CheckTorusSplit();
+    CheckTorusRoll( 7,  5, "torus texture 7 x 5 matches the view after random rolls");
+    CheckTorusRoll(64, 48, "torus texture 64 x 48 matches the view after random rolls");
+
+    CheckDecoderOrder();
+    CheckDecoderNoPrefetch();
+    CheckDecoderDestroy();
+
+    std::printf("%s: %d check(s) failed\n", g_FailCount ? "FAIL" : "PASS", g_FailCount);
+    return g_FailCount ? 1 : 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 05/21/2017 19:02:16
+ *  Last Modified: 05/21/2017 20:15:43
+ *
+ *    Description: compare GetUIDRecord() contention of the UID table in MonoServer
+ *                 1. old one: 17 mutex-sharded unordered_map's
+ *                 2. new one: UIDRegistry
+ *
+ *                 N reader threads do random lookups, one writer keeps erasing and
+ *                 linking UID's like objects die and spawn, readers never dereference
+ *                 the instance
+ *
+ *                 usage: uidbench [max reader threads] [reads per thread]
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <array>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include "uidregistry.hpp"
+
+static const uint32_t UIDBENCH_UIDCOUNT = 100000;
+
+// only used as addresses
+static std::array<char, UIDBENCH_UIDCOUNT> g_ObjectV;
+
+static ServerObject *ObjectAddress(uint32_t nUID)
+{
+    return (ServerObject *)(&g_ObjectV[nUID % UIDBENCH_UIDCOUNT]);
+}
+
+class MutexUIDTable final
+{
+    private:
+        struct UIDLockRecord
+        {
+            std::mutex Lock;
+            std::unordered_map<uint32_t, ServerObject *> Record;
+        };
+
+    private:
+        std::array<UIDLockRecord, 17> m_UIDArray;
+
+    public:
+        bool Link(uint32_t nUID, ServerObject *pObject)
+        {
+            auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
+            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
+            return rstRecord.Record.emplace(nUID, pObject).second;
+        }
+
+        ServerObject *Erase(uint32_t nUID)
+        {
+            auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
+            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
+
+            auto pRecord = rstRecord.Record.find(nUID);
+            if(pRecord == rstRecord.Record.end()){
+                return nullptr;
+            }
+
+            auto pObject = pRecord->second;
+            rstRecord.Record.erase(pRecord);
+            return pObject;
+        }
+
+        template<typename F> void Read(uint32_t nUID, F &&fnOp)
+        {
+            auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
+            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
+
+            auto pRecord = rstRecord.Record.find(nUID);
+            fnOp((const ServerObject *)((pRecord == rstRecord.Record.end()) ? nullptr : pRecord->second));
+        }
+};
+
+typedef struct{
+    double ReadMOPS;    // million reads per second of all readers
+    size_t Found;       // reads which got an instance
+    size_t Churn;       // erase + link done by the writer
+}BenchResult;
+
+template<typename T> static BenchResult RunBench(int nThread, size_t nReadCount)
+{
+    T stTable;
+    for(uint32_t nUID = 1; nUID <= UIDBENCH_UIDCOUNT; ++nUID){
+        stTable.Link(nUID, ObjectAddress(nUID));
+    }
+
+    std::atomic<bool>   bStop(false);
+    std::atomic<size_t> nFound(0);
+    std::atomic<size_t> nChurn(0);
+
+    // writer: oldest UID dies, a new one spawns
+    // UID's are never reused, same as MonoServer::GetUID()
+    std::thread stWriter([&stTable, &bStop, &nChurn]()
+    {
+        uint32_t nOldest = 1;
+        uint32_t nNewest = UIDBENCH_UIDCOUNT;
+        while(!bStop.load()){
+            stTable.Erase(nOldest);
+            stTable.Link(nNewest + 1, ObjectAddress(nNewest + 1));
+
+            nOldest++;
+            nNewest++;
+            nChurn.fetch_add(1);
+        }
+    });
+
+    std::vector<std::thread> stReaderV;
+    auto stStart = std::chrono::steady_clock::now();
+    for(int nIndex = 0; nIndex < nThread; ++nIndex){
+        stReaderV.emplace_back([&stTable, &nFound, &nChurn, nIndex, nReadCount]()
+        {
+            // xorshift, cheap and no shared state
+            uint32_t nSeed = 2463534242u + (uint32_t)(nIndex) * 7919u;
+            size_t nLocalFound = 0;
+            for(size_t nRead = 0; nRead < nReadCount; ++nRead){
+                nSeed ^= (nSeed << 13);
+                nSeed ^= (nSeed >> 17);
+                nSeed ^= (nSeed <<  5);
+
+                // mostly hit the live range
+                uint32_t nUID = (uint32_t)(1 + nChurn.load(std::memory_order_relaxed) + nSeed % UIDBENCH_UIDCOUNT);
+                stTable.Read(nUID, [&nLocalFound](const ServerObject *pObject)
+                {
+                    if(pObject){
+                        nLocalFound++;
+                    }
+                });
+            }
+            nFound.fetch_add(nLocalFound);
+        });
+    }
+
+    for(auto &rstReader: stReaderV){
+        rstReader.join();
+    }
+
+    auto fSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stStart).count();
+    bStop.store(true);
+    stWriter.join();
+
+    return {(nThread * nReadCount) / fSeconds / 1000000.0, nFound.load(), nChurn.load()};
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc > 3){
+        std::printf("Usage: uidbench [max reader threads] [reads per thread]\n\n");
+        return 1;
+    }
+
+    int    nMaxThread = (argc > 1) ? std::atoi(argv[1]) : (int)(std::thread::hardware_concurrency());
+    size_t nReadCount = (argc > 2) ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+
+    if(nMaxThread <= 0 || nReadCount == 0){
+        std::printf("Invalid argument: max reader threads = %d, reads per thread = %zu\n", nMaxThread, nReadCount);
+        return 1;
+    }
+
+    std::printf("%8s %16s %16s %12s %12s\n", "threads", "mutex (Mop/s)", "registry (Mop/s)", "mutex churn", "reg churn");
+    for(int nThread = 1;; nThread = std::min<int>(nThread * 2, nMaxThread)){
+        auto stMutex    = RunBench<MutexUIDTable>(nThread, nReadCount);
+        auto stRegistry = RunBench<UIDRegistry  >(nThread, nReadCount);
+
+        std::printf("%8d %16.2f %16.2f %12zu %12zu\n", nThread, stMutex.ReadMOPS, stRegistry.ReadMOPS, stMutex.Churn, stRegistry.Churn);
+        if(nThread == nMaxThread){
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,274 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 06/05/2017 11:20:37
+ *  Last Modified: 06/05/2017 14:52:19
+ *
+ *    Description: compare per-cell UID lists of ServerMap
+ *                 1. old one: vector<vector<vector<uint32_t>>> indexed by [x][y]
+ *                 2. new one: UIDGrid
+ *
+ *                 objects walk randomly, half of them crowd around a few spots to
+ *                 fill the overflow lists, each round has three phases:
+ *
+ *                      move     : every object steps to a neighbor cell, Remove + Add
+ *                      broadcast: every 8th object visits all UIDs in the visible
+ *                                 range around it, like sending its action
+ *                      sweep    : visit all cells in storage order and all UIDs in
+ *                                 non-empty ones, like the metronome
+ *
+ *                 both run the same steps, UID sums are compared to make sure they
+ *                 see the same objects
+ *
+ *                 usage: uidgridbench [map width] [map height] [objects] [rounds]
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+#include "uidgrid.hpp"
+#include "sysconst.hpp"
+
+class VecUIDGrid final
+{
+    private:
+        template<typename T> using Vec2D = std::vector<std::vector<T>>;
+
+    private:
+        int m_W;
+        int m_H;
+
+    private:
+        Vec2D<std::vector<uint32_t>> m_UIDRecordV2D;
+
+    public:
+        VecUIDGrid(int nW, int nH)
+            : m_W(nW)
+            , m_H(nH)
+            , m_UIDRecordV2D(nW, std::vector<std::vector<uint32_t>>(nH))
+        {}
+
+    public:
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+        size_t MemorySize() const
+        {
+            size_t nSize = m_UIDRecordV2D.size() * sizeof(m_UIDRecordV2D[0]);
+            for(auto &rstRecordLine: m_UIDRecordV2D){
+                nSize += rstRecordLine.size() * sizeof(rstRecordLine[0]);
+                for(auto &rstRecordV: rstRecordLine){
+                    nSize += rstRecordV.capacity() * sizeof(uint32_t);
+                }
+            }
+            return nSize;
+        }
+
+        size_t Count(int nX, int nY) const
+        {
+            return ValidC(nX, nY) ? m_UIDRecordV2D[nX][nY].size() : 0;
+        }
+
+    public:
+        bool Add(int nX, int nY, uint32_t nUID)
+        {
+            if(ValidC(nX, nY)){
+                m_UIDRecordV2D[nX][nY].push_back(nUID);
+                return true;
+            }
+            return false;
+        }
+
+        bool Remove(int nX, int nY, uint32_t nUID)
+        {
+            if(ValidC(nX, nY)){
+                auto &rstRecordV = m_UIDRecordV2D[nX][nY];
+                for(auto &nRecordUID: rstRecordV){
+                    if(nRecordUID == nUID){
+                        std::swap(nRecordUID, rstRecordV.back());
+                        rstRecordV.pop_back();
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        template<typename F> void ForEach(int nX, int nY, F &&fnOp) const
+        {
+            if(ValidC(nX, nY)){
+                for(auto nUID: m_UIDRecordV2D[nX][nY]){
+                    fnOp(nUID);
+                }
+            }
+        }
+};
+
+// storage order of each grid
+template<typename F> static void SweepGrid(const VecUIDGrid &rstGrid, int nW, int nH, F &&fnOp)
+{
+    for(int nX = 0; nX < nW; ++nX){
+        for(int nY = 0; nY < nH; ++nY){
+            if(rstGrid.Count(nX, nY)){
+                rstGrid.ForEach(nX, nY, fnOp);
+            }
+        }
+    }
+}
+
+template<typename F> static void SweepGrid(const UIDGrid &rstGrid, int nW, int nH, F &&fnOp)
+{
+    for(int nY = 0; nY < nH; ++nY){
+        for(int nX = 0; nX < nW; ++nX){
+            if(rstGrid.Count(nX, nY)){
+                rstGrid.ForEach(nX, nY, fnOp);
+            }
+        }
+    }
+}
+
+typedef struct{
+    int X;
+    int Y;
+}ObjectLoc;
+
+typedef struct{
+    double MoveMOPS;        // million moves per second
+    double BroadcastMCPS;   // million cells visited per second by broadcast
+    double SweepMS;         // time of one sweep
+    size_t MemorySize;      // bytes after the last round
+
+    uint64_t Sum;           // sum of UIDs seen by broadcast and sweep
+}BenchResult;
+
+// xorshift, same sequence for both grids
+static uint32_t NextRand(uint32_t *pSeed)
+{
+    *pSeed ^= (*pSeed << 13);
+    *pSeed ^= (*pSeed >> 17);
+    *pSeed ^= (*pSeed <<  5);
+    return *pSeed;
+}
+
+template<typename T> static BenchResult RunBench(int nW, int nH, int nObjectCount, int nRoundCount)
+{
+    T stGrid(nW, nH);
+    std::vector<ObjectLoc> stLocV(nObjectCount);
+
+    // half of them crowd in 3 x 3 spots, several objects per cell
+    uint32_t nSeed = 2463534242u;
+    for(int nIndex = 0; nIndex < nObjectCount; ++nIndex){
+        if(nIndex % 2){
+            int nSpot = (int)(NextRand(&nSeed) % 16);
+            stLocV[nIndex].X = std::min<int>(nW - 1, (nSpot % 4 + 1) * nW / 5 + (int)(NextRand(&nSeed) % 3));
+            stLocV[nIndex].Y = std::min<int>(nH - 1, (nSpot / 4 + 1) * nH / 5 + (int)(NextRand(&nSeed) % 3));
+        }else{
+            stLocV[nIndex].X = (int)(NextRand(&nSeed) % nW);
+            stLocV[nIndex].Y = (int)(NextRand(&nSeed) % nH);
+        }
+        stGrid.Add(stLocV[nIndex].X, stLocV[nIndex].Y, (uint32_t)(nIndex + 1));
+    }
+
+    double   fMoveSec      = 0.0;
+    double   fBroadcastSec = 0.0;
+    double   fSweepSec     = 0.0;
+    uint64_t nCellCount    = 0;
+    uint64_t nSum          = 0;
+
+    for(int nRound = 0; nRound < nRoundCount; ++nRound){
+        auto stMoveStart = std::chrono::steady_clock::now();
+        for(int nIndex = 0; nIndex < nObjectCount; ++nIndex){
+            auto nRand = NextRand(&nSeed);
+            int  nX    = stLocV[nIndex].X + (int)(nRand % 3) - 1;
+            int  nY    = stLocV[nIndex].Y + (int)(nRand / 3 % 3) - 1;
+
+            if(stGrid.ValidC(nX, nY)){
+                stGrid.Remove(stLocV[nIndex].X, stLocV[nIndex].Y, (uint32_t)(nIndex + 1));
+                stGrid.Add(nX, nY, (uint32_t)(nIndex + 1));
+
+                stLocV[nIndex].X = nX;
+                stLocV[nIndex].Y = nY;
+            }
+        }
+
+        auto stBroadcastStart = std::chrono::steady_clock::now();
+        for(int nIndex = 0; nIndex < nObjectCount; nIndex += 8){
+            int nX0 = std::max<int>(0, stLocV[nIndex].X - SYS_MAPVISIBLEW / 2);
+            int nY0 = std::max<int>(0, stLocV[nIndex].Y - SYS_MAPVISIBLEH / 2);
+            int nX1 = std::min<int>(nW, stLocV[nIndex].X + SYS_MAPVISIBLEW / 2);
+            int nY1 = std::min<int>(nH, stLocV[nIndex].Y + SYS_MAPVISIBLEH / 2);
+
+            for(int nY = nY0; nY < nY1; ++nY){
+                for(int nX = nX0; nX < nX1; ++nX){
+                    stGrid.ForEach(nX, nY, [&nSum](uint32_t nUID){ nSum += nUID; });
+                }
+            }
+            nCellCount += (uint64_t)(nX1 - nX0) * (nY1 - nY0);
+        }
+
+        auto stSweepStart = std::chrono::steady_clock::now();
+        SweepGrid(stGrid, nW, nH, [&nSum](uint32_t nUID){ nSum += nUID; });
+        auto stSweepDone = std::chrono::steady_clock::now();
+
+        fMoveSec      += std::chrono::duration<double>(stBroadcastStart - stMoveStart     ).count();
+        fBroadcastSec += std::chrono::duration<double>(stSweepStart     - stBroadcastStart).count();
+        fSweepSec     += std::chrono::duration<double>(stSweepDone      - stSweepStart    ).count();
+    }
+
+    BenchResult stResult;
+    stResult.MoveMOPS      = (1.0 * nObjectCount * nRoundCount) / fMoveSec / 1000000.0;
+    stResult.BroadcastMCPS = nCellCount / fBroadcastSec / 1000000.0;
+    stResult.SweepMS       = fSweepSec * 1000.0 / nRoundCount;
+    stResult.MemorySize    = stGrid.MemorySize();
+    stResult.Sum           = nSum;
+    return stResult;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc > 5){
+        std::printf("Usage: uidgridbench [map width] [map height] [objects] [rounds]\n\n");
+        return 1;
+    }
+
+    int nW           = (argc > 1) ? std::atoi(argv[1]) : 800;
+    int nH           = (argc > 2) ? std::atoi(argv[2]) : 600;
+    int nObjectCount = (argc > 3) ? std::atoi(argv[3]) : 20000;
+    int nRoundCount  = (argc > 4) ? std::atoi(argv[4]) : 50;
+
+    if(nW <= 0 || nH <= 0 || nObjectCount <= 0 || nRoundCount <= 0){
+        std::printf("Invalid argument: map = %d x %d, objects = %d, rounds = %d\n", nW, nH, nObjectCount, nRoundCount);
+        return 1;
+    }
+
+    auto stVec  = RunBench<VecUIDGrid>(nW, nH, nObjectCount, nRoundCount);
+    auto stGrid = RunBench<UIDGrid   >(nW, nH, nObjectCount, nRoundCount);
+
+    std::printf("map %d x %d, %d objects, %d rounds\n\n", nW, nH, nObjectCount, nRoundCount);
+    std::printf("%10s %14s %18s %12s %12s\n", "", "move (Mop/s)", "broadcast (Mc/s)", "sweep (ms)", "memory (KB)");
+    std::printf("%10s %14.2f %18.2f %12.3f %12zu\n", "vector", stVec .MoveMOPS, stVec .BroadcastMCPS, stVec .SweepMS, stVec .MemorySize / 1024);
+    std::printf("%10s %14.2f %18.2f %12.3f %12zu\n", "uidgrid", stGrid.MoveMOPS, stGrid.BroadcastMCPS, stGrid.SweepMS, stGrid.MemorySize / 1024);
+
+    if(stVec.Sum != stGrid.Sum){
+        std::printf("\nMismatch: vector sum = %llu, uidgrid sum = %llu\n", (unsigned long long)(stVec.Sum), (unsigned long long)(stGrid.Sum));
+        return 1;
+    }
+    return 0;
+}